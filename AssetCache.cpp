@@ -0,0 +1,225 @@
+#include "AssetCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	const char INDEX_MAGIC[] = "asset-cache";
+
+	std::wstring ToHex(unsigned long long value)
+	{
+		char text[17];
+		snprintf(text, sizeof(text), "%016llx", value);
+		return std::wstring(text, text + 16);
+	}
+}
+
+AssetKey::AssetKey(const char* importer, unsigned int version)
+{
+	value = HashBytes(importer, strlen(importer), ((unsigned long long)ASSET_CACHE_FORMAT_VERSION << 32) | version);
+}
+
+void AssetKey::Add(const void* data, size_t size)
+{
+	value = HashBytes(data, size, value);
+}
+
+void AssetKey::Add(unsigned long long hash)
+{
+	value = HashBytes(&hash, sizeof(hash), value);
+}
+
+unsigned long long AssetKey::GetValue() const
+{
+	return value;
+}
+
+AssetCache::AssetCache(const std::filesystem::path& directory) :
+	directory(directory),
+	temporaryCount(0),
+	changed(false),
+	stats()
+{
+	//whatever is left in temp was a cook that never finished
+	std::error_code error;
+	std::filesystem::remove_all(directory / L"temp", error);
+	std::filesystem::create_directories(directory / L"objects", error);
+	std::filesystem::create_directories(directory / L"temp", error);
+
+	//an index from another format version is just ignored, and rewritten on the next Save
+	std::ifstream index(directory / L"index.txt");
+	std::string magic;
+	unsigned int version = 0;
+	if (!(index >> magic >> version) || magic != INDEX_MAGIC || version != ASSET_CACHE_FORMAT_VERSION)
+		return;
+
+	std::string line;
+	while (std::getline(index, line))
+	{
+		std::istringstream entry(line);
+		std::string type;
+		entry >> type;
+		if (type == "source")
+		{
+			SourceStamp stamp;
+			std::string path;
+			if (entry >> stamp.size >> stamp.writeTime >> std::hex >> stamp.hash >> std::dec && std::getline(entry >> std::ws, path))
+				sources[std::filesystem::u8path(path).wstring()] = stamp;
+		}
+		else if (type == "key")
+		{
+			unsigned long long key;
+			std::string name;
+			if (entry >> std::hex >> key >> std::dec >> name)
+				keys[key] = std::filesystem::u8path(name).wstring();
+		}
+	}
+}
+
+AssetCache::~AssetCache()
+{
+	if (changed)
+		Save();
+}
+
+bool AssetCache::HashSource(const std::filesystem::path& fileName, unsigned long long& hash)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::absolute(fileName, error);
+	unsigned long long size = std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+	long long writeTime = (long long)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	if (error)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = sources.find(path.wstring());
+		if (found != sources.end() && found->second.size == size && found->second.writeTime == writeTime)
+		{
+			hash = found->second.hash;
+			stats.sourcesUnchanged++;
+			return true;
+		}
+	}
+
+	//read outside the lock, so other cooks keep going
+	MappedFile source;
+	if (!source.Open(path))
+		return false;
+	hash = HashBytes(source.GetData(), source.GetSize());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	sources[path.wstring()] = { size, writeTime, hash };
+	stats.sourcesHashed++;
+	changed = true;
+	return true;
+}
+
+bool AssetCache::Find(unsigned long long key, std::filesystem::path& payload)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = keys.find(key);
+	if (found != keys.end())
+	{
+		std::error_code error;
+		payload = directory / L"objects" / found->second;
+		if (std::filesystem::exists(payload, error))
+		{
+			stats.hits++;
+			return true;
+		}
+
+		//deleted from under us
+		keys.erase(found);
+		changed = true;
+	}
+	stats.misses++;
+	return false;
+}
+
+std::filesystem::path AssetCache::GetTemporaryFileName(const wchar_t* extension)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return directory / L"temp" / (std::to_wstring(temporaryCount++) + extension);
+}
+
+bool AssetCache::Store(unsigned long long key, const std::filesystem::path& cookedFileName, std::filesystem::path& payload)
+{
+	MappedFile cooked;
+	if (!cooked.Open(cookedFileName))
+		return false;
+	unsigned long long contentHash = HashBytes(cooked.GetData(), cooked.GetSize());
+	size_t size = cooked.GetSize();
+	cooked.Close();
+
+	std::wstring name = ToHex(contentHash) + cookedFileName.extension().wstring();
+	payload = directory / L"objects" / name;
+
+	//stored payloads are never overwritten, so one that's mapped somewhere stays valid
+	std::error_code error;
+	bool duplicate = std::filesystem::exists(payload, error) && std::filesystem::file_size(payload, error) == size;
+	if (!duplicate)
+	{
+		std::filesystem::rename(cookedFileName, payload, error);
+		if (error)
+		{
+			//another thread stored the same bytes first
+			if (!std::filesystem::exists(payload, error))
+				return false;
+			duplicate = true;
+		}
+	}
+	if (duplicate)
+		std::filesystem::remove(cookedFileName, error);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	keys[key] = name;
+	changed = true;
+	if (duplicate)
+	{
+		stats.duplicates++;
+		stats.duplicateBytes += size;
+	}
+	return true;
+}
+
+bool AssetCache::Save()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::filesystem::path temporary = directory / L"index.txt.tmp";
+	{
+		std::ofstream index(temporary, std::ios::trunc);
+		if (!index)
+			return false;
+
+		index << INDEX_MAGIC << " " << ASSET_CACHE_FORMAT_VERSION << "\n";
+		for (const auto& source : sources)
+		{
+			index << "source " << source.second.size << " " << source.second.writeTime << " " <<
+				std::hex << source.second.hash << std::dec << " " << std::filesystem::path(source.first).u8string() << "\n";
+		}
+		for (const auto& key : keys)
+			index << "key " << std::hex << key.first << std::dec << " " << std::filesystem::path(key.second).u8string() << "\n";
+		if (!index)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, directory / L"index.txt", error);
+	if (error)
+		return false;
+	changed = false;
+	return true;
+}
+
+AssetCacheStats AssetCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Bump whenever the layout of the cache directory or its index changes
+#define ASSET_CACHE_FORMAT_VERSION 1
+
+// --------------------------------------------------------
+// What an asset cache has done since it was opened
+// --------------------------------------------------------
+struct AssetCacheStats
+{
+	unsigned int sourcesHashed;		// Sources read to hash them
+	unsigned int sourcesUnchanged;	// Sources whose hash came from the index instead
+	unsigned int hits;				// Cooks skipped, their payload was already stored
+	unsigned int misses;			// Cooks that had to run
+	unsigned int duplicates;		// Stored payloads identical to one already there
+	size_t duplicateBytes;
+};
+
+// --------------------------------------------------------
+// Builds a cook's key out of everything that goes into it,
+// so any change to the inputs gives a different key
+// --------------------------------------------------------
+class AssetKey
+{
+public:
+	// importer names the kind of cook, version is its output version
+	AssetKey(const char* importer, unsigned int version);
+
+	// Settings (plain structs, no padding left uninitialized) and source hashes, in a fixed order
+	void Add(const void* data, size_t size);
+	void Add(unsigned long long hash);
+
+	unsigned long long GetValue() const;
+
+private:
+	unsigned long long value;
+};
+
+// --------------------------------------------------------
+// A content addressed store of cooked assets
+//
+// - Payloads are stored once, under the hash of their own
+//   bytes (objects/<hash>.<extension>), and keys only point
+//   at them, so cooks that come out identical (the same
+//   face in two skies, say) share one file
+// - Source hashes are remembered with the file's size and
+//   write time, so a source that hasn't changed isn't read
+//   at all on a warm start; a hit skips its cook entirely
+// - The index (keys and source stamps) is a small text file
+//   written by Save, and on destruction when it changed
+// - Every method is thread safe, so cooks on a thread pool
+//   can share one cache
+// - Device free
+// --------------------------------------------------------
+class AssetCache
+{
+public:
+	// Opens the cache in directory (created if needed) and reads its index
+	explicit AssetCache(const std::filesystem::path& directory);
+	~AssetCache();
+
+	AssetCache(AssetCache const&) = delete;
+	void operator=(AssetCache const&) = delete;
+
+	// Hash of a source file's contents, false if it can't be read
+	bool HashSource(const std::filesystem::path& fileName, unsigned long long& hash);
+
+	// The payload stored for a key, if there is one and its file is still there
+	bool Find(unsigned long long key, std::filesystem::path& payload);
+
+	// A file name no other cook is using, to write a payload to before Store
+	std::filesystem::path GetTemporaryFileName(const wchar_t* extension);
+
+	// Moves a finished payload (written to a temporary file) into the store under key and sets
+	// payload to where it ended up.  An identical payload already stored is reused instead.
+	bool Store(unsigned long long key, const std::filesystem::path& cookedFileName, std::filesystem::path& payload);
+
+	// Writes the index (through a temporary file, like the payloads)
+	bool Save();
+
+	AssetCacheStats GetStats();
+
+private:
+	struct SourceStamp
+	{
+		unsigned long long size;
+		long long writeTime;
+		unsigned long long hash;
+	};
+
+	std::filesystem::path directory;
+	std::mutex mutex;
+	std::unordered_map<std::wstring, SourceStamp> sources;	// Keyed by absolute path
+	std::unordered_map<unsigned long long, std::wstring> keys;	// Payload file name (in objects) by key
+	unsigned int temporaryCount;
+	bool changed;
+	AssetCacheStats stats;
+};
@@ -0,0 +1,699 @@
+#include "BlockCompression.h"
+#include "Parallel.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Rows of blocks each compression task handles
+	const unsigned int BLOCK_ROWS_PER_TASK = 8;
+
+	// Least squares passes after the first fit, each only kept when it lowers the error
+	const int REFINE_ITERATIONS = 2;
+
+	// BC7 interpolation weights for 4 bit indices (out of 64)
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// --------------------------------------------------------
+	// Gathers one 4x4 block as RGBA texels, repeating the edge
+	// texels of a level that isn't a multiple of 4 in size
+	// --------------------------------------------------------
+	void LoadBlock(const TextureData& source, unsigned int mip, unsigned int blockX, unsigned int blockY, uint8_t texels[16][4])
+	{
+		const TextureMip& level = source.mips[mip];
+		const unsigned char* data = source.GetMipData(mip);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int x = std::min(blockX * 4 + (i & 3), level.width - 1);
+			unsigned int y = std::min(blockY * 4 + (i >> 2), level.height - 1);
+			if (source.format == TEXTURE_FORMAT_R8)
+			{
+				uint8_t value = data[(size_t)y * level.rowPitch + x];
+				texels[i][0] = texels[i][1] = texels[i][2] = value;
+				texels[i][3] = 255;
+			}
+			else
+				memcpy(texels[i], data + (size_t)y * level.rowPitch + x * 4, 4);
+		}
+	}
+
+	XMVECTOR LoadTexel(const uint8_t texel[4])
+	{
+		return XMVectorSet(texel[0], texel[1], texel[2], texel[3]);
+	}
+
+	// --------------------------------------------------------
+	// Principal axis of a set of colors (power iteration on
+	// their covariance), with their mean.  Only the channels
+	// set in mask take part.  Blocks of a single color get
+	// the luminance direction.
+	// --------------------------------------------------------
+	XMVECTOR PrincipalAxis(const XMVECTOR* colors, unsigned int count, FXMVECTOR mask, XMVECTOR& mean)
+	{
+		mean = XMVectorZero();
+		for (unsigned int i = 0; i < count; i++)
+			mean = XMVectorAdd(mean, colors[i]);
+		mean = XMVectorScale(mean, 1.0f / count);
+
+		XMMATRIX covariance = {};
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			XMVECTOR d = XMVectorMultiply(XMVectorSubtract(colors[i], mean), mask);
+			covariance.r[0] = XMVectorMultiplyAdd(XMVectorSplatX(d), d, covariance.r[0]);
+			covariance.r[1] = XMVectorMultiplyAdd(XMVectorSplatY(d), d, covariance.r[1]);
+			covariance.r[2] = XMVectorMultiplyAdd(XMVectorSplatZ(d), d, covariance.r[2]);
+			covariance.r[3] = XMVectorMultiplyAdd(XMVectorSplatW(d), d, covariance.r[3]);
+			minimum = XMVectorMin(minimum, colors[i]);
+			maximum = XMVectorMax(maximum, colors[i]);
+		}
+
+		//starting from the bounding box diagonal converges in a handful of steps
+		XMVECTOR axis = XMVectorMultiply(XMVectorSubtract(maximum, minimum), mask);
+		for (int i = 0; i < 8; i++)
+		{
+			XMVECTOR next = XMVector4Transform(axis, covariance);
+			float length = XMVectorGetX(XMVector4Length(next));
+			if (length < 1e-6f)
+				break;
+			axis = XMVectorScale(next, 1.0f / length);
+		}
+
+		if (XMVectorGetX(XMVector4LengthSq(axis)) < 1e-12f)
+			axis = XMVectorMultiply(XMVectorSet(0.2126f, 0.7152f, 0.0722f, 0.0f), mask);
+		return XMVector4Normalize(axis);
+	}
+
+	// Endpoints at the ends of the colors' projection onto axis
+	void FitEndpoints(const XMVECTOR* colors, unsigned int count, FXMVECTOR axis, FXMVECTOR mean, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float minimum = FLT_MAX;
+		float maximum = -FLT_MAX;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(colors[i], mean), axis));
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+		XMVECTOR limit = XMVectorReplicate(255.0f);
+		e0 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(maximum), mean), XMVectorZero(), limit);
+		e1 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(minimum), mean), XMVectorZero(), limit);
+	}
+
+	// --------------------------------------------------------
+	// Least squares endpoints for fixed interpolation weights:
+	// minimizes sum(|(1 - w) e0 + w e1 - color|^2) over every
+	// channel at once.  Returns false when every texel has the
+	// same weight (the system is singular).
+	// --------------------------------------------------------
+	bool SolveEndpoints(const XMVECTOR* colors, const float* weights, unsigned int count, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		XMVECTOR ax = XMVectorZero();
+		XMVECTOR bx = XMVectorZero();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float b = weights[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax = XMVectorMultiplyAdd(XMVectorReplicate(a), colors[i], ax);
+			bx = XMVectorMultiplyAdd(XMVectorReplicate(b), colors[i], bx);
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		float inverse = 1.0f / determinant;
+		XMVECTOR limit = XMVectorReplicate(255.0f);
+		e0 = XMVectorScale(XMVectorSubtract(XMVectorScale(ax, bb), XMVectorScale(bx, ab)), inverse);
+		e1 = XMVectorScale(XMVectorSubtract(XMVectorScale(bx, aa), XMVectorScale(ax, ab)), inverse);
+		e0 = XMVectorClamp(e0, XMVectorZero(), limit);
+		e1 = XMVectorClamp(e1, XMVectorZero(), limit);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Little endian bit packing for the 128 bit BC7 blocks
+	// --------------------------------------------------------
+	struct BlockWriter
+	{
+		uint8_t* block;
+		unsigned int position;
+
+		void Write(uint32_t value, unsigned int bitCount)
+		{
+			for (unsigned int i = 0; i < bitCount; i++, position++)
+				if (value & (1u << i))
+					block[position >> 3] |= (uint8_t)(1u << (position & 7));
+		}
+	};
+
+	struct BlockReader
+	{
+		const uint8_t* block;
+		unsigned int position;
+
+		uint32_t Read(unsigned int bitCount)
+		{
+			uint32_t value = 0;
+			for (unsigned int i = 0; i < bitCount; i++, position++)
+				value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+			return value;
+		}
+	};
+
+	// ------------------------------------------------ BC1 ----
+
+	uint16_t QuantizeColor565(FXMVECTOR color)
+	{
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, color);
+		unsigned int r = (unsigned int)std::min(31.0f, std::max(0.0f, c.x * 31.0f / 255.0f + 0.5f));
+		unsigned int g = (unsigned int)std::min(63.0f, std::max(0.0f, c.y * 63.0f / 255.0f + 0.5f));
+		unsigned int b = (unsigned int)std::min(31.0f, std::max(0.0f, c.z * 31.0f / 255.0f + 0.5f));
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	XMVECTOR ExpandColor565(uint16_t color)
+	{
+		unsigned int r = (color >> 11) & 31;
+		unsigned int g = (color >> 5) & 63;
+		unsigned int b = color & 31;
+		return XMVectorSet((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 0.0f);
+	}
+
+	// Picks the nearest of the 4 colors for every texel, returns the total squared error
+	float SelectIndicesBC1(const XMVECTOR* colors, uint16_t c0, uint16_t c1, uint32_t& indices, float* weights)
+	{
+		XMVECTOR e0 = ExpandColor565(c0);
+		XMVECTOR e1 = ExpandColor565(c1);
+		XMVECTOR palette[4] =
+		{
+			e0,
+			e1,
+			XMVectorLerp(e0, e1, 1.0f / 3.0f),
+			XMVectorLerp(e0, e1, 2.0f / 3.0f)
+		};
+		static const float paletteWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		indices = 0;
+		float error = 0.0f;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int best = 0;
+			float bestDistance = FLT_MAX;
+			for (unsigned int p = 0; p < 4; p++)
+			{
+				float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(colors[i], palette[p])));
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+			weights[i] = paletteWeights[best];
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	// Quantizes two endpoints into 4 color mode (c0 > c1) and indexes the block
+	float EncodeEndpointsBC1(const XMVECTOR* colors, FXMVECTOR e0, FXMVECTOR e1, uint16_t& c0, uint16_t& c1, uint32_t& indices, float* weights)
+	{
+		c0 = QuantizeColor565(e0);
+		c1 = QuantizeColor565(e1);
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		//equal endpoints would switch the block to 3 color mode, so index everything as c0
+		if (c0 == c1)
+		{
+			indices = 0;
+			float error = 0.0f;
+			XMVECTOR color = ExpandColor565(c0);
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				weights[i] = 0.0f;
+				error += XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(colors[i], color)));
+			}
+			return error;
+		}
+		return SelectIndicesBC1(colors, c0, c1, indices, weights);
+	}
+
+	void EncodeBlockBC1(const uint8_t texels[16][4], uint8_t* block)
+	{
+		XMVECTOR colors[16];
+		for (unsigned int i = 0; i < 16; i++)
+			colors[i] = XMVectorSetW(LoadTexel(texels[i]), 0.0f);
+
+		XMVECTOR mean;
+		XMVECTOR axis = PrincipalAxis(colors, 16, XMVectorSet(1, 1, 1, 0), mean);
+		XMVECTOR e0, e1;
+		FitEndpoints(colors, 16, axis, mean, e0, e1);
+
+		float weights[16];
+		uint16_t c0, c1;
+		uint32_t indices;
+		float error = EncodeEndpointsBC1(colors, e0, e1, c0, c1, indices, weights);
+
+		for (int iteration = 0; iteration < REFINE_ITERATIONS && error > 0.0f; iteration++)
+		{
+			if (!SolveEndpoints(colors, weights, 16, e0, e1))
+				break;
+
+			float newWeights[16];
+			uint16_t n0, n1;
+			uint32_t newIndices;
+			float newError = EncodeEndpointsBC1(colors, e0, e1, n0, n1, newIndices, newWeights);
+			if (newError >= error)
+				break;
+			error = newError;
+			c0 = n0;
+			c1 = n1;
+			indices = newIndices;
+			memcpy(weights, newWeights, sizeof(weights));
+		}
+
+		block[0] = (uint8_t)c0;
+		block[1] = (uint8_t)(c0 >> 8);
+		block[2] = (uint8_t)c1;
+		block[3] = (uint8_t)(c1 >> 8);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	void DecodeBlockBC1(const uint8_t* block, uint8_t texels[16][4])
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+		XMVECTOR e0 = XMVectorSetW(ExpandColor565(c0), 255.0f);
+		XMVECTOR e1 = XMVectorSetW(ExpandColor565(c1), 255.0f);
+
+		XMVECTOR palette[4] = { e0, e1 };
+		if (c0 > c1)
+		{
+			palette[2] = XMVectorLerp(e0, e1, 1.0f / 3.0f);
+			palette[3] = XMVectorLerp(e0, e1, 2.0f / 3.0f);
+		}
+		else
+		{
+			palette[2] = XMVectorLerp(e0, e1, 0.5f);
+			palette[3] = XMVectorZero();
+		}
+
+		uint32_t indices;
+		memcpy(&indices, block + 4, 4);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			XMVECTOR color = XMVectorRound(palette[(indices >> (i * 2)) & 3]);
+			XMFLOAT4 c;
+			XMStoreFloat4(&c, color);
+			texels[i][0] = (uint8_t)c.x;
+			texels[i][1] = (uint8_t)c.y;
+			texels[i][2] = (uint8_t)c.z;
+			texels[i][3] = (uint8_t)c.w;
+		}
+	}
+
+	// ------------------------------------------------ BC4 ----
+
+	// --------------------------------------------------------
+	// One channel in 8 value mode: the block's extremes are the
+	// endpoints and six evenly spaced values lie between them
+	// --------------------------------------------------------
+	void EncodeBlockBC4(const uint8_t texels[16][4], unsigned int channel, uint8_t* block)
+	{
+		uint8_t minimum = 255;
+		uint8_t maximum = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			minimum = std::min(minimum, texels[i][channel]);
+			maximum = std::max(maximum, texels[i][channel]);
+		}
+
+		memset(block, 0, 8);
+		block[0] = maximum;
+		block[1] = minimum;
+		if (maximum == minimum)
+			return;
+
+		//values run from r0 (index 0) through the interpolated ones (2..7) to r1 (index 1)
+		static const unsigned int ORDER_TO_INDEX[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+		float range = (float)(maximum - minimum);
+		uint64_t indices = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float t = (maximum - texels[i][channel]) / range * 7.0f;
+			unsigned int step = (unsigned int)std::min(7.0f, t + 0.5f);
+			indices |= (uint64_t)ORDER_TO_INDEX[step] << (i * 3);
+		}
+		for (unsigned int i = 0; i < 6; i++)
+			block[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+
+	void DecodeBlockBC4(const uint8_t* block, unsigned int channel, uint8_t texels[16][4])
+	{
+		float r0 = block[0];
+		float r1 = block[1];
+		float palette[8] = { r0, r1 };
+		if (block[0] > block[1])
+		{
+			for (unsigned int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7.0f;
+		}
+		else
+		{
+			for (unsigned int i = 2; i < 6; i++)
+				palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5.0f;
+			palette[6] = 0.0f;
+			palette[7] = 255.0f;
+		}
+
+		uint64_t indices = 0;
+		for (unsigned int i = 0; i < 6; i++)
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		for (unsigned int i = 0; i < 16; i++)
+			texels[i][channel] = (uint8_t)(palette[(indices >> (i * 3)) & 7] + 0.5f);
+	}
+
+	// ------------------------------------------------ BC7 ----
+
+	// Endpoint as 7 bits per channel plus one shared p bit, whichever p bit lands closer
+	void QuantizeEndpointBC7(FXMVECTOR endpoint, uint8_t quantized[4], uint32_t& pBit)
+	{
+		XMFLOAT4 e;
+		XMStoreFloat4(&e, endpoint);
+		float values[4] = { e.x, e.y, e.z, e.w };
+
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; p++)
+		{
+			uint8_t candidate[4];
+			float error = 0.0f;
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				int q = (int)((values[c] - p) * 0.5f + 0.5f);
+				q = std::min(127, std::max(0, q));
+				candidate[c] = (uint8_t)q;
+				float d = (float)((q << 1) | p) - values[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, 4);
+			}
+		}
+	}
+
+	// Picks the nearest of the 16 colors for every texel, returns the total squared error
+	float SelectIndicesBC7(const XMVECTOR* colors, const uint8_t q0[4], uint32_t p0, const uint8_t q1[4], uint32_t p1, uint8_t* indices, float* weights)
+	{
+		int e0[4], e1[4];
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			e0[c] = (q0[c] << 1) | (int)p0;
+			e1[c] = (q1[c] << 1) | (int)p1;
+		}
+
+		XMVECTOR palette[16];
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			int w = BC7_WEIGHTS[i];
+			palette[i] = XMVectorSet(
+				(float)(((64 - w) * e0[0] + w * e1[0] + 32) >> 6),
+				(float)(((64 - w) * e0[1] + w * e1[1] + 32) >> 6),
+				(float)(((64 - w) * e0[2] + w * e1[2] + 32) >> 6),
+				(float)(((64 - w) * e0[3] + w * e1[3] + 32) >> 6));
+		}
+
+		float error = 0.0f;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int best = 0;
+			float bestDistance = FLT_MAX;
+			for (unsigned int p = 0; p < 16; p++)
+			{
+				float distance = XMVectorGetX(XMVector4LengthSq(XMVectorSubtract(colors[i], palette[p])));
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices[i] = (uint8_t)best;
+			weights[i] = BC7_WEIGHTS[best] / 64.0f;
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	struct EncodingBC7
+	{
+		uint8_t q0[4];
+		uint8_t q1[4];
+		uint32_t p0;
+		uint32_t p1;
+		uint8_t indices[16];
+		float weights[16];
+		float error;
+	};
+
+	void EncodeEndpointsBC7(const XMVECTOR* colors, FXMVECTOR e0, FXMVECTOR e1, EncodingBC7& encoding)
+	{
+		QuantizeEndpointBC7(e0, encoding.q0, encoding.p0);
+		QuantizeEndpointBC7(e1, encoding.q1, encoding.p1);
+		encoding.error = SelectIndicesBC7(colors, encoding.q0, encoding.p0, encoding.q1, encoding.p1, encoding.indices, encoding.weights);
+	}
+
+	// --------------------------------------------------------
+	// Mode 6: one subset, RGBA endpoints of 7 bits plus a p bit
+	// each, 4 bit indices.  Not the best mode for every block,
+	// but a good one for most and cheap to search.
+	// --------------------------------------------------------
+	void EncodeBlockBC7(const uint8_t texels[16][4], uint8_t* block)
+	{
+		XMVECTOR colors[16];
+		for (unsigned int i = 0; i < 16; i++)
+			colors[i] = LoadTexel(texels[i]);
+
+		XMVECTOR mean;
+		XMVECTOR axis = PrincipalAxis(colors, 16, XMVectorSplatOne(), mean);
+		XMVECTOR e0, e1;
+		FitEndpoints(colors, 16, axis, mean, e0, e1);
+
+		EncodingBC7 best;
+		EncodeEndpointsBC7(colors, e0, e1, best);
+		for (int iteration = 0; iteration < REFINE_ITERATIONS && best.error > 0.0f; iteration++)
+		{
+			if (!SolveEndpoints(colors, best.weights, 16, e0, e1))
+				break;
+
+			EncodingBC7 refined;
+			EncodeEndpointsBC7(colors, e0, e1, refined);
+			if (refined.error >= best.error)
+				break;
+			best = refined;
+		}
+
+		//the first texel's index drops its top bit, so it has to be in the lower half
+		if (best.indices[0] & 8)
+		{
+			std::swap(best.q0, best.q1);
+			std::swap(best.p0, best.p1);
+			for (unsigned int i = 0; i < 16; i++)
+				best.indices[i] = (uint8_t)(15 - best.indices[i]);
+		}
+
+		memset(block, 0, 16);
+		BlockWriter writer = { block, 0 };
+		writer.Write(1 << 6, 7);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			writer.Write(best.q0[c], 7);
+			writer.Write(best.q1[c], 7);
+		}
+		writer.Write(best.p0, 1);
+		writer.Write(best.p1, 1);
+		writer.Write(best.indices[0], 3);
+		for (unsigned int i = 1; i < 16; i++)
+			writer.Write(best.indices[i], 4);
+	}
+
+	void DecodeBlockBC7(const uint8_t* block, uint8_t texels[16][4])
+	{
+		memset(texels, 0, 16 * 4);
+		if ((block[0] & 0x7f) != (1 << 6))
+			return;
+
+		BlockReader reader = { block, 7 };
+		int e0[4], e1[4];
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			e0[c] = (int)reader.Read(7) << 1;
+			e1[c] = (int)reader.Read(7) << 1;
+		}
+		uint32_t p0 = reader.Read(1);
+		uint32_t p1 = reader.Read(1);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			e0[c] |= (int)p0;
+			e1[c] |= (int)p1;
+		}
+
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			int w = BC7_WEIGHTS[reader.Read(i == 0 ? 3 : 4)];
+			for (unsigned int c = 0; c < 4; c++)
+				texels[i][c] = (uint8_t)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+		}
+	}
+
+	void EncodeBlock(TextureFormat format, const uint8_t texels[16][4], uint8_t* block)
+	{
+		switch (format)
+		{
+		case TEXTURE_FORMAT_BC1: EncodeBlockBC1(texels, block); break;
+		case TEXTURE_FORMAT_BC4: EncodeBlockBC4(texels, 0, block); break;
+		case TEXTURE_FORMAT_BC5: EncodeBlockBC4(texels, 0, block); EncodeBlockBC4(texels, 1, block + 8); break;
+		case TEXTURE_FORMAT_BC7: EncodeBlockBC7(texels, block); break;
+		default: break;
+		}
+	}
+
+	void DecodeBlock(TextureFormat format, const uint8_t* block, uint8_t texels[16][4])
+	{
+		//channels the format doesn't store
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			texels[i][1] = texels[i][2] = 0;
+			texels[i][3] = 255;
+		}
+
+		switch (format)
+		{
+		case TEXTURE_FORMAT_BC1: DecodeBlockBC1(block, texels); break;
+		case TEXTURE_FORMAT_BC4: DecodeBlockBC4(block, 0, texels); break;
+		case TEXTURE_FORMAT_BC5: DecodeBlockBC4(block, 0, texels); DecodeBlockBC4(block + 8, 1, texels); break;
+		case TEXTURE_FORMAT_BC7: DecodeBlockBC7(block, texels); break;
+		default: break;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Runs blockTask(mip, blockRow) over every row of blocks of
+	// every level, in groups of rows across the threads
+	// --------------------------------------------------------
+	template <typename BlockRowTask>
+	void ForEachBlockRow(const TextureData& texture, BlockRowTask blockTask)
+	{
+		for (unsigned int mip = 0; mip < texture.mips.size(); mip++)
+		{
+			unsigned int blockRows = (texture.mips[mip].height + 3) / 4;
+			unsigned int taskCount = (blockRows + BLOCK_ROWS_PER_TASK - 1) / BLOCK_ROWS_PER_TASK;
+			ParallelFor(taskCount, [&](unsigned int task)
+			{
+				unsigned int last = std::min(blockRows, (task + 1) * BLOCK_ROWS_PER_TASK);
+				for (unsigned int row = task * BLOCK_ROWS_PER_TASK; row < last; row++)
+					blockTask(mip, row);
+			});
+		}
+	}
+}
+
+bool CompressTexture(const TextureData& source, TextureFormat format, TextureData& compressed)
+{
+	if (IsBlockCompressed(source.format) || !IsBlockCompressed(format) || source.mips.empty())
+		return false;
+
+	compressed.Allocate(format, source.width, source.height, (unsigned int)source.mips.size());
+	unsigned int blockSize = GetBlockSize(format);
+
+	ForEachBlockRow(compressed, [&](unsigned int mip, unsigned int row)
+	{
+		const TextureMip& level = compressed.mips[mip];
+		uint8_t* blocks = compressed.GetMipData(mip) + (size_t)row * level.rowPitch;
+		uint8_t texels[16][4];
+		for (unsigned int x = 0; x < (level.width + 3) / 4; x++)
+		{
+			LoadBlock(source, mip, x, row, texels);
+			EncodeBlock(format, texels, blocks + x * blockSize);
+		}
+	});
+	return true;
+}
+
+bool DecompressTexture(const TextureData& compressed, TextureData& decompressed)
+{
+	if (!IsBlockCompressed(compressed.format))
+		return false;
+
+	decompressed.Allocate(TEXTURE_FORMAT_RGBA8, compressed.width, compressed.height, (unsigned int)compressed.mips.size());
+	unsigned int blockSize = GetBlockSize(compressed.format);
+
+	ForEachBlockRow(compressed, [&](unsigned int mip, unsigned int row)
+	{
+		const TextureMip& level = decompressed.mips[mip];
+		const uint8_t* blocks = compressed.GetMipData(mip) + (size_t)row * compressed.mips[mip].rowPitch;
+		uint8_t texels[16][4];
+		for (unsigned int x = 0; x < (level.width + 3) / 4; x++)
+		{
+			DecodeBlock(compressed.format, blocks + x * blockSize, texels);
+
+			//partial blocks at the edges only write the texels that exist
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				unsigned int tx = x * 4 + (i & 3);
+				unsigned int ty = row * 4 + (i >> 2);
+				if (tx < level.width && ty < level.height)
+					memcpy(decompressed.GetMipData(mip) + (size_t)ty * level.rowPitch + tx * 4, texels[i], 4);
+			}
+		}
+	});
+	return true;
+}
+
+float ComputePsnr(const TextureData& a, const TextureData& b, unsigned int channels)
+{
+	if (a.mips.empty() || b.mips.empty() || a.width != b.width || a.height != b.height ||
+		IsBlockCompressed(a.format) || IsBlockCompressed(b.format))
+		return 0.0f;
+
+	auto texel = [](const TextureData& texture, unsigned int x, unsigned int y, unsigned int c)
+	{
+		const unsigned char* row = texture.GetMipData(0) + (size_t)y * texture.mips[0].rowPitch;
+		if (texture.format == TEXTURE_FORMAT_R8)
+			return c < 3 ? row[x] : (unsigned char)255;
+		return row[x * 4 + c];
+	};
+
+	double squaredError = 0.0;
+	for (unsigned int y = 0; y < a.height; y++)
+	{
+		for (unsigned int x = 0; x < a.width; x++)
+		{
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				double d = (double)texel(a, x, y, c) - texel(b, x, y, c);
+				squaredError += d * d;
+			}
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)a.width * a.height * channels);
+	if (meanSquaredError <= 0.0)
+		return 99.0f;
+	return (float)(10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
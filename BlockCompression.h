@@ -0,0 +1,27 @@
+#pragma once
+
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// CPU block compression for the texture cooker
+//
+// - BC1 keeps RGB (opaque), BC4 red, BC5 red and green,
+//   BC7 (mode 6 only) RGBA
+// - Endpoints come from the principal axis of each block's
+//   colors, refined by least squares on the chosen indices
+// - Rows of blocks are split across threads; partial blocks
+//   at the edges repeat their edge texels
+// - Device free, so it can be run (and measured) anywhere
+// --------------------------------------------------------
+
+// Compresses every mip level of an R8 or RGBA8 texture.  R8 sources count as gray.
+// Returns false for a source that isn't uncompressed or a target that isn't a BC format.
+bool CompressTexture(const TextureData& source, TextureFormat format, TextureData& compressed);
+
+// Expands every mip level of a BC texture to RGBA8 (green and blue 0, alpha 255 where the
+// format doesn't store them).  BC7 blocks in modes other than 6 decode as black.
+bool DecompressTexture(const TextureData& compressed, TextureData& decompressed);
+
+// Peak signal to noise ratio (dB) between the first levels of two textures of the same size,
+// over their first channels (1 = R, 2 = RG, 3 = RGB, 4 = RGBA).  R8 textures count as gray.
+float ComputePsnr(const TextureData& a, const TextureData& b, unsigned int channels);
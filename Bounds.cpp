@@ -0,0 +1,179 @@
+#include "Bounds.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Positions handled per task, small enough that the second sweep over a range still hits the cache
+	const size_t POSITIONS_PER_TASK = 1 << 16;
+
+	// Relative padding so rounding in the sphere math never leaves a point just outside
+	const float SPHERE_PADDING = 1e-5f;
+
+	// Bounds of one task's range: box extremes plus a sphere in a single vector (xyz center, w radius)
+	struct PartialBounds
+	{
+		XMFLOAT3 boxMin;
+		XMFLOAT3 boxMax;
+		XMFLOAT4 sphere;
+	};
+
+	// --------------------------------------------------------
+	// Smallest sphere containing two spheres (xyz center,
+	// w radius)
+	// --------------------------------------------------------
+	XMVECTOR XM_CALLCONV MergeSpheres(FXMVECTOR a, FXMVECTOR b)
+	{
+		float radiusA = XMVectorGetW(a);
+		float radiusB = XMVectorGetW(b);
+		XMVECTOR offset = XMVectorSetW(XMVectorSubtract(b, a), 0.0f);
+		float distance = XMVectorGetX(XMVector3Length(offset));
+
+		//one already holds the other
+		if (distance + radiusB <= radiusA)
+			return a;
+		if (distance + radiusA <= radiusB)
+			return b;
+
+		float radius = 0.5f * (distance + radiusA + radiusB);
+		XMVECTOR center = XMVectorAdd(a, XMVectorScale(offset, (radius - radiusA) / distance));
+		return XMVectorSetW(center, radius);
+	}
+
+	// --------------------------------------------------------
+	// Box of one range, then the sphere around the box center
+	// reaching its furthest point.  The range is small enough
+	// to still be in the cache for the second sweep, so the
+	// positions only come from memory once.
+	// --------------------------------------------------------
+	PartialBounds ComputePartialBounds(const unsigned char* positions, size_t count, size_t stride)
+	{
+		auto load = [&](size_t i) { return XMLoadFloat3((const XMFLOAT3*)(positions + i * stride)); };
+
+		//4 points per step, folded pairwise so the min / max chains stay short
+		XMVECTOR minimum = load(0);
+		XMVECTOR maximum = minimum;
+		size_t batched = count & ~size_t(3);
+		for (size_t i = 0; i < batched; i += 4)
+		{
+			XMVECTOR p0 = load(i), p1 = load(i + 1), p2 = load(i + 2), p3 = load(i + 3);
+			minimum = XMVectorMin(minimum, XMVectorMin(XMVectorMin(p0, p1), XMVectorMin(p2, p3)));
+			maximum = XMVectorMax(maximum, XMVectorMax(XMVectorMax(p0, p1), XMVectorMax(p2, p3)));
+		}
+		for (size_t i = batched; i < count; i++)
+		{
+			minimum = XMVectorMin(minimum, load(i));
+			maximum = XMVectorMax(maximum, load(i));
+		}
+
+		//distances of 4 points at once, transposed so each vector holds one axis
+		XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+		XMVECTOR radiusSq = XMVectorZero();
+		for (size_t i = 0; i < batched; i += 4)
+		{
+			XMMATRIX offsets(
+				XMVectorSubtract(load(i), center),
+				XMVectorSubtract(load(i + 1), center),
+				XMVectorSubtract(load(i + 2), center),
+				XMVectorSubtract(load(i + 3), center));
+			offsets = XMMatrixTranspose(offsets);
+			XMVECTOR distanceSq = XMVectorAdd(XMVectorAdd(
+				XMVectorMultiply(offsets.r[0], offsets.r[0]),
+				XMVectorMultiply(offsets.r[1], offsets.r[1])),
+				XMVectorMultiply(offsets.r[2], offsets.r[2]));
+			radiusSq = XMVectorMax(radiusSq, distanceSq);
+		}
+		for (size_t i = batched; i < count; i++)
+			radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMVectorSubtract(load(i), center)));
+
+		//fold the 4 lanes together
+		radiusSq = XMVectorMax(XMVectorMax(XMVectorSplatX(radiusSq), XMVectorSplatY(radiusSq)), XMVectorMax(XMVectorSplatZ(radiusSq), XMVectorSplatW(radiusSq)));
+
+		PartialBounds partial;
+		XMStoreFloat3(&partial.boxMin, minimum);
+		XMStoreFloat3(&partial.boxMax, maximum);
+		XMStoreFloat4(&partial.sphere, XMVectorSetW(center, sqrtf(XMVectorGetX(radiusSq))));
+		return partial;
+	}
+}
+
+Bounds ComputeBounds(const XMFLOAT3* positions, size_t count, size_t stride)
+{
+	Bounds bounds = {};
+	if (count == 0)
+		return bounds;
+
+	const unsigned char* bytes = (const unsigned char*)positions;
+	size_t taskCount = (count + POSITIONS_PER_TASK - 1) / POSITIONS_PER_TASK;
+	std::vector<PartialBounds> partials(taskCount);
+	ParallelFor((unsigned int)taskCount, [&](unsigned int task)
+	{
+		size_t first = task * POSITIONS_PER_TASK;
+		size_t last = std::min(count, first + POSITIONS_PER_TASK);
+		partials[task] = ComputePartialBounds(bytes + first * stride, last - first, stride);
+	});
+
+	XMVECTOR minimum = XMLoadFloat3(&partials[0].boxMin);
+	XMVECTOR maximum = XMLoadFloat3(&partials[0].boxMax);
+	XMVECTOR merged = XMLoadFloat4(&partials[0].sphere);
+	for (size_t i = 1; i < taskCount; i++)
+	{
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&partials[i].boxMin));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&partials[i].boxMax));
+		merged = MergeSpheres(merged, XMLoadFloat4(&partials[i].sphere));
+	}
+
+	XMStoreFloat3(&bounds.boxMin, minimum);
+	XMStoreFloat3(&bounds.boxMax, maximum);
+
+	// Candidates that all hold every point: the merged range spheres, a
+	// sphere around the whole box's center reaching past every range
+	// sphere, and the sphere through the box corners.  Keep the smallest.
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	float cornerRadius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(maximum, minimum)));
+	float centeredRadius = 0.0f;
+	for (const PartialBounds& partial : partials)
+	{
+		XMVECTOR sphere = XMLoadFloat4(&partial.sphere);
+		centeredRadius = std::max(centeredRadius, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMVectorSetW(sphere, 0.0f), XMVectorSetW(boxCenter, 0.0f)))) + XMVectorGetW(sphere));
+	}
+
+	XMVECTOR sphere = XMVectorSetW(boxCenter, std::min(cornerRadius, centeredRadius));
+	if (XMVectorGetW(merged) < XMVectorGetW(sphere))
+		sphere = merged;
+
+	XMStoreFloat3(&bounds.sphereCenter, sphere);
+	bounds.sphereRadius = XMVectorGetW(sphere) * (1.0f + SPHERE_PADDING);
+	return bounds;
+}
+
+Bounds XM_CALLCONV TransformBounds(FXMMATRIX matrix, const Bounds& bounds)
+{
+	//box center goes through the matrix, the extents through its absolute values (Arvo)
+	XMVECTOR minimum = XMLoadFloat3(&bounds.boxMin);
+	XMVECTOR maximum = XMLoadFloat3(&bounds.boxMax);
+	XMVECTOR center = XMVector3TransformCoord(XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f), matrix);
+	XMVECTOR extent = XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f);
+
+	XMVECTOR worldExtent = XMVectorAdd(XMVectorAdd(
+		XMVectorMultiply(XMVectorSplatX(extent), XMVectorAbs(matrix.r[0])),
+		XMVectorMultiply(XMVectorSplatY(extent), XMVectorAbs(matrix.r[1]))),
+		XMVectorMultiply(XMVectorSplatZ(extent), XMVectorAbs(matrix.r[2])));
+
+	Bounds world;
+	XMStoreFloat3(&world.boxMin, XMVectorSubtract(center, worldExtent));
+	XMStoreFloat3(&world.boxMax, XMVectorAdd(center, worldExtent));
+
+	float scale = std::max({
+		XMVectorGetX(XMVector3Length(matrix.r[0])),
+		XMVectorGetX(XMVector3Length(matrix.r[1])),
+		XMVectorGetX(XMVector3Length(matrix.r[2])) });
+	XMStoreFloat3(&world.sphereCenter, XMVector3TransformCoord(XMLoadFloat3(&bounds.sphereCenter), matrix));
+	world.sphereRadius = bounds.sphereRadius * scale;
+	return world;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Axis aligned box and sphere around a set of points
+//
+// Both are kept since each is tighter for different shapes
+// (boxes for flat or long meshes, spheres for round ones),
+// and the sphere is cheaper to test and to transform
+// --------------------------------------------------------
+struct Bounds
+{
+	DirectX::XMFLOAT3 boxMin;
+	DirectX::XMFLOAT3 boxMax;
+	DirectX::XMFLOAT3 sphereCenter;
+	float sphereRadius;
+};
+
+// Box and sphere from a single pass over the positions, split across the worker threads for big inputs.
+// stride is the distance in bytes from one position to the next, so positions can be read straight out
+// of a vertex array.  All zero for an empty array.
+Bounds ComputeBounds(const DirectX::XMFLOAT3* positions, size_t count, size_t stride = sizeof(DirectX::XMFLOAT3));
+
+// Bounds of the points after going through a (row vector) world matrix.  The box is refit around the
+// transformed box and the sphere radius grows with the largest axis scale.
+Bounds XM_CALLCONV TransformBounds(DirectX::FXMMATRIX matrix, const Bounds& bounds);
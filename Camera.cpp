@@ -22,25 +22,40 @@ Camera::~Camera()
 	
 }
 
-void Camera::Update(float dt)
+CameraInput Camera::SampleInput(float dt)
 {
 	Input& input = Input::GetInstance();
+	CameraInput sample = {};
 
-	if (input.KeyDown('W')) { transform.MoveLocal(0, 0, dt * movementSpeed); }
-	if (input.KeyDown('S')) { transform.MoveLocal(0, 0, dt * -movementSpeed); }
-	if (input.KeyDown('A')) { transform.MoveLocal(dt * -movementSpeed, 0, 0); }
-	if (input.KeyDown('D')) { transform.MoveLocal(dt * movementSpeed, 0, 0); }
-	if (input.KeyDown(' ')) { transform.MoveWorld(0, dt * movementSpeed, 0); }
-	if (input.KeyDown('X')) { transform.MoveWorld(0, dt * -movementSpeed, 0); }
+	if (input.KeyDown('W')) { sample.localMove.z += dt * movementSpeed; }
+	if (input.KeyDown('S')) { sample.localMove.z -= dt * movementSpeed; }
+	if (input.KeyDown('A')) { sample.localMove.x -= dt * movementSpeed; }
+	if (input.KeyDown('D')) { sample.localMove.x += dt * movementSpeed; }
+	if (input.KeyDown(' ')) { sample.worldRise += dt * movementSpeed; }
+	if (input.KeyDown('X')) { sample.worldRise -= dt * movementSpeed; }
 
 	if (input.MouseLeftDown())
 	{
-		float xDelta = mouseLookSpeed * input.GetMouseXDelta();
-		float yDelta = mouseLookSpeed * input.GetMouseYDelta();
+		sample.yaw = mouseLookSpeed * input.GetMouseXDelta();
+		sample.pitch = mouseLookSpeed * input.GetMouseYDelta();
+	}
+	return sample;
+}
 
-		transform.Rotate(yDelta, xDelta, 0);
+void Camera::Update(const CameraInput& input)
+{
+	//only when moving, so a still camera doesn't dirty its transform
+	if (input.localMove.x != 0 || input.localMove.y != 0 || input.localMove.z != 0)
+		transform.MoveLocal(input.localMove);
+	if (input.worldRise != 0)
+		transform.MoveWorld(0, input.worldRise, 0);
 
+	if (input.pitch != 0 || input.yaw != 0)
+	{
+		//clamp before setting, the quaternion would otherwise carry pitch over the top
 		XMFLOAT3 rot = transform.GetPitchYawRoll();
+		rot.x += input.pitch;
+		rot.y += input.yaw;
 		if (rot.x > XM_PIDIV2 - 0.02f) rot.x = XM_PIDIV2 - 0.02f;
 		else if (rot.x < -XM_PIDIV2 + 0.02f) rot.x = -XM_PIDIV2 + 0.02f;
 		transform.SetRotation(rot);
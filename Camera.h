@@ -5,13 +5,24 @@
 #include "Input.h"
 #include "Transform.h"
 
+// A frame's worth of camera movement, sampled from Input on the main
+// thread so Update can run anywhere without touching the singleton
+struct CameraInput
+{
+	DirectX::XMFLOAT3 localMove;	//along the camera's right and forward
+	float worldRise;				//straight up or down
+	float pitch;
+	float yaw;
+};
+
 class Camera
 {
 public:
 	Camera(float x, float y, float z, float moveSpeed, float lookSpeed, float aspectRatio);
 	~Camera();
 
-	void Update(float dt);
+	CameraInput SampleInput(float dt);
+	void Update(const CameraInput& input);
 	void UpdateViewMatrix();
 	void UpdateProjectionMatrix(float aspectRatio);
 
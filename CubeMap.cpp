@@ -0,0 +1,48 @@
+#include "CubeMap.h"
+#include <cmath>
+
+using namespace DirectX;
+
+const CubeFaceAxes CUBE_FACE_AXES[6] =
+{
+	{ XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(0, -1, 0) },
+	{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, -1, 0) },
+	{ XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1) },
+	{ XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1) },
+	{ XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, -1, 0) },
+	{ XMFLOAT3(0, 0, -1), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, -1, 0) }
+};
+
+unsigned int GetCubeFace(FXMVECTOR direction, float& u, float& v)
+{
+	XMFLOAT3 d;
+	XMStoreFloat3(&d, direction);
+	float x = fabsf(d.x);
+	float y = fabsf(d.y);
+	float z = fabsf(d.z);
+
+	//the largest axis picks the face, ties go the way D3D breaks them (z, then y)
+	unsigned int face;
+	float major;
+	if (z >= x && z >= y)
+	{
+		face = d.z >= 0.0f ? 4 : 5;
+		major = z;
+	}
+	else if (y >= x)
+	{
+		face = d.y >= 0.0f ? 2 : 3;
+		major = y;
+	}
+	else
+	{
+		face = d.x >= 0.0f ? 0 : 1;
+		major = x;
+	}
+
+	//the face's own axes are unit length and at right angles to its center, so projecting onto them is enough
+	const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+	u = (d.x * axes.u.x + d.y * axes.u.y + d.z * axes.u.z) / major;
+	v = (d.x * axes.v.x + d.y * axes.v.y + d.z * axes.v.z) / major;
+	return face;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Where a cube face's texels point: the face's center plus
+// u and v (both -1 to 1, v down the image) along its axes,
+// as D3D samples a cube (+X, -X, +Y, -Y, +Z, -Z)
+// --------------------------------------------------------
+struct CubeFaceAxes
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 u;
+	DirectX::XMFLOAT3 v;
+};
+
+extern const CubeFaceAxes CUBE_FACE_AXES[6];
+
+// The face a direction (any length but zero) lands on, and where on it (u and v from -1 to 1)
+unsigned int GetCubeFace(DirectX::FXMVECTOR direction, float& u, float& v);
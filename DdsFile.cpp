@@ -0,0 +1,252 @@
+#include "DdsFile.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const unsigned int DDS_MAGIC = 0x20534444;			// "DDS "
+	const unsigned int DDS_COOK_MAGIC = 0x4b4f4f43;		// "COOK"
+	const unsigned int DDS_FOURCC_DX10 = 0x30315844;	// "DX10"
+
+	const unsigned int DDSD_CAPS = 0x1;
+	const unsigned int DDSD_HEIGHT = 0x2;
+	const unsigned int DDSD_WIDTH = 0x4;
+	const unsigned int DDSD_PITCH = 0x8;
+	const unsigned int DDSD_PIXELFORMAT = 0x1000;
+	const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+	const unsigned int DDSD_LINEARSIZE = 0x80000;
+	const unsigned int DDPF_FOURCC = 0x4;
+	const unsigned int DDSCAPS_COMPLEX = 0x8;
+	const unsigned int DDSCAPS_TEXTURE = 0x1000;
+	const unsigned int DDSCAPS_MIPMAP = 0x400000;
+	const unsigned int DDSCAPS2_CUBEMAP = 0x200;
+	const unsigned int DDSCAPS2_CUBEMAP_ALLFACES = 0xfc00;
+	const unsigned int DDS_DIMENSION_TEXTURE2D = 3;
+	const unsigned int DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+	struct DdsPixelFormat
+	{
+		unsigned int size;
+		unsigned int flags;
+		unsigned int fourCC;
+		unsigned int rgbBitCount;
+		unsigned int rBitMask;
+		unsigned int gBitMask;
+		unsigned int bBitMask;
+		unsigned int aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		unsigned int size;
+		unsigned int flags;
+		unsigned int height;
+		unsigned int width;
+		unsigned int pitchOrLinearSize;
+		unsigned int depth;
+		unsigned int mipMapCount;
+		unsigned int reserved1[11];		// [0] cook magic, [1] version, [2..3] source hash
+		DdsPixelFormat pixelFormat;
+		unsigned int caps;
+		unsigned int caps2;
+		unsigned int caps3;
+		unsigned int caps4;
+		unsigned int reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		unsigned int dxgiFormat;
+		unsigned int resourceDimension;
+		unsigned int miscFlag;
+		unsigned int arraySize;
+		unsigned int miscFlags2;
+	};
+
+	// DXGI_FORMAT values, spelled out so this file doesn't need the D3D headers
+	unsigned int GetDxgiCode(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TEXTURE_FORMAT_R8: return 61;
+		case TEXTURE_FORMAT_RGBA8: return 28;
+		case TEXTURE_FORMAT_BC1: return 71;
+		case TEXTURE_FORMAT_BC4: return 80;
+		case TEXTURE_FORMAT_BC5: return 83;
+		case TEXTURE_FORMAT_BC7: return 98;
+		case TEXTURE_FORMAT_RGBA16F: return 10;
+		case TEXTURE_FORMAT_RG16F: return 34;
+		}
+		return 0;
+	}
+
+	bool GetTextureFormat(unsigned int dxgiCode, TextureFormat& format)
+	{
+		const TextureFormat formats[] = { TEXTURE_FORMAT_R8, TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC4, TEXTURE_FORMAT_BC5, TEXTURE_FORMAT_BC7,
+			TEXTURE_FORMAT_RGBA16F, TEXTURE_FORMAT_RG16F };
+		for (TextureFormat candidate : formats)
+		{
+			if (GetDxgiCode(candidate) == dxgiCode)
+			{
+				format = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Writes one image, or the six faces of a cube one after another (every level of a face before the next face)
+	bool WriteImages(const std::filesystem::path& fileName, const TextureData* const* images, unsigned int imageCount, const DdsCookTag& tag)
+	{
+		const TextureData& data = *images[0];
+		if (data.mips.empty())
+			return false;
+
+		bool compressed = IsBlockCompressed(data.format);
+		bool cube = imageCount == 6;
+
+		DdsHeader header = {};
+		header.size = sizeof(DdsHeader);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | (compressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+		header.height = data.height;
+		header.width = data.width;
+		header.pitchOrLinearSize = compressed ? data.mips[0].rowPitch * GetRowCount(data.format, data.height) : data.mips[0].rowPitch;
+		header.depth = 1;
+		header.mipMapCount = (unsigned int)data.mips.size();
+		header.reserved1[0] = DDS_COOK_MAGIC;
+		header.reserved1[1] = tag.version;
+		header.reserved1[2] = (unsigned int)tag.sourceHash;
+		header.reserved1[3] = (unsigned int)(tag.sourceHash >> 32);
+		header.pixelFormat.size = sizeof(DdsPixelFormat);
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+		header.caps = DDSCAPS_TEXTURE | (data.mips.size() > 1 || cube ? DDSCAPS_COMPLEX : 0) | (data.mips.size() > 1 ? DDSCAPS_MIPMAP : 0);
+		header.caps2 = cube ? DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES : 0;
+
+		//a cube's array size counts whole cubes, not faces
+		DdsHeaderDx10 extension = {};
+		extension.dxgiFormat = GetDxgiCode(data.format);
+		extension.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		extension.miscFlag = cube ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+		extension.arraySize = 1;
+
+		std::error_code error;
+		std::filesystem::create_directories(fileName.parent_path(), error);
+
+		//written to the side and renamed, so a half written file is never picked up
+		std::filesystem::path tempName = fileName;
+		tempName += ".tmp";
+
+		{
+			std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+
+			file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)&extension, sizeof(extension));
+			for (unsigned int i = 0; i < imageCount; i++)
+				file.write((const char*)images[i]->pixels.data(), images[i]->pixels.size());
+
+			if (!file.good())
+				return false;
+		}
+
+		std::filesystem::rename(tempName, fileName, error);
+		return !error;
+	}
+
+	// Everything before the texels
+	const size_t DDS_HEADERS_SIZE = sizeof(DDS_MAGIC) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+	// Checks a file's headers (a cube or not, as asked) and reads its cook tag
+	bool ReadHeaders(MappedFile& file, bool cube, DdsHeader& header, TextureFormat& format, DdsCookTag& tag)
+	{
+		if (file.GetSize() < DDS_HEADERS_SIZE)
+			return false;
+
+		unsigned int magic;
+		DdsHeaderDx10 extension;
+		memcpy(&magic, file.GetData(), sizeof(magic));
+		memcpy(&header, file.GetData() + sizeof(magic), sizeof(header));
+		memcpy(&extension, file.GetData() + sizeof(magic) + sizeof(header), sizeof(extension));
+
+		if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) ||
+			!(header.pixelFormat.flags & DDPF_FOURCC) || header.pixelFormat.fourCC != DDS_FOURCC_DX10 ||
+			extension.resourceDimension != DDS_DIMENSION_TEXTURE2D || extension.arraySize != 1 ||
+			((extension.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0) != cube ||
+			!GetTextureFormat(extension.dxgiFormat, format) || header.width == 0 || header.height == 0)
+			return false;
+
+		//a full chain is at most 32 levels, anything more is a broken file
+		if (header.mipMapCount == 0)
+			header.mipMapCount = 1;
+		if (header.mipMapCount > 32)
+			return false;
+
+		tag = {};
+		if (header.reserved1[0] == DDS_COOK_MAGIC)
+		{
+			tag.version = header.reserved1[1];
+			tag.sourceHash = header.reserved1[2] | ((unsigned long long)header.reserved1[3] << 32);
+		}
+		return true;
+	}
+}
+
+bool WriteDds(const std::filesystem::path& fileName, const TextureData& data, const DdsCookTag& tag)
+{
+	const TextureData* image = &data;
+	return WriteImages(fileName, &image, 1, tag);
+}
+
+bool WriteDdsCube(const std::filesystem::path& fileName, const TextureData faces[6], const DdsCookTag& tag)
+{
+	const TextureData* images[6];
+	for (int i = 0; i < 6; i++)
+	{
+		if (faces[i].format != faces[0].format || faces[i].width != faces[0].width || faces[i].height != faces[0].height ||
+			faces[i].mips.size() != faces[0].mips.size())
+			return false;
+		images[i] = &faces[i];
+	}
+	return WriteImages(fileName, images, 6, tag);
+}
+
+bool ReadDds(const std::filesystem::path& fileName, TextureData& data, DdsCookTag& tag, unsigned int firstMip)
+{
+	MappedFile file;
+	DdsHeader header;
+	TextureFormat format;
+	if (!file.Open(fileName) || !ReadHeaders(file, false, header, format, tag) || firstMip >= header.mipMapCount)
+		return false;
+
+	//levels are stored tightly one after another, so the ones wanted are a single range
+	size_t skipped = GetTextureBytes(format, header.width, header.height, firstMip);
+	data.Allocate(format, std::max(1u, header.width >> firstMip), std::max(1u, header.height >> firstMip), header.mipMapCount - firstMip);
+	if (file.GetSize() - DDS_HEADERS_SIZE < skipped + data.pixels.size())
+		return false;
+	memcpy(data.pixels.data(), file.GetData() + DDS_HEADERS_SIZE + skipped, data.pixels.size());
+	return true;
+}
+
+bool ReadDdsCube(const std::filesystem::path& fileName, TextureData faces[6], DdsCookTag& tag)
+{
+	MappedFile file;
+	DdsHeader header;
+	TextureFormat format;
+	if (!file.Open(fileName) || !ReadHeaders(file, true, header, format, tag))
+		return false;
+
+	size_t faceBytes = GetTextureBytes(format, header.width, header.height, header.mipMapCount);
+	if (file.GetSize() - DDS_HEADERS_SIZE < faceBytes * 6)
+		return false;
+	for (int i = 0; i < 6; i++)
+	{
+		faces[i].Allocate(format, header.width, header.height, header.mipMapCount);
+		memcpy(faces[i].pixels.data(), file.GetData() + DDS_HEADERS_SIZE + faceBytes * i, faceBytes);
+	}
+	return true;
+}
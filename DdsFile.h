@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// What the texture cooker stamps on the DDS files it writes,
+// so a stale file can be told apart from a fresh one
+// (zero when the file didn't come from the cooker)
+// --------------------------------------------------------
+struct DdsCookTag
+{
+	unsigned int version;
+	unsigned long long sourceHash;
+};
+
+// --------------------------------------------------------
+// Minimal DDS reader and writer for the texture cache
+//
+// - Always writes the DX10 extended header, so the file
+//   names its DXGI format exactly and any DDS viewer opens it
+// - Only reads 2D textures and cubes in the formats
+//   TextureData holds
+// - The cook tag rides in the header's reserved words, which
+//   other tools ignore
+// --------------------------------------------------------
+
+// Writes every mip level of data, returns false if the file couldn't be written
+bool WriteDds(const std::filesystem::path& fileName, const TextureData& data, const DdsCookTag& tag);
+
+// Returns false for a missing file or one this reader doesn't handle.  firstMip skips the
+// levels before it, so data starts at that level (for streaming part of a mip chain back in).
+bool ReadDds(const std::filesystem::path& fileName, TextureData& data, DdsCookTag& tag, unsigned int firstMip = 0);
+
+// Writes the six faces of a cube (+X, -X, +Y, -Y, +Z, -Z), which must match in format, size and levels
+bool WriteDdsCube(const std::filesystem::path& fileName, const TextureData faces[6], const DdsCookTag& tag);
+
+// Reads every level of a cube's six faces, false for a missing file or one that isn't a cube
+bool ReadDdsCube(const std::filesystem::path& fileName, TextureData faces[6], DdsCookTag& tag);
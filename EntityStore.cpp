@@ -0,0 +1,220 @@
+#include "EntityStore.h"
+
+// Fills a row from the last one and drops the last, for columns the archetype has (the rest are empty)
+template <typename T>
+static void SwapRemove(std::vector<T>& column, unsigned int row)
+{
+	if (column.empty())
+		return;
+
+	column[row] = column.back();
+	column.pop_back();
+}
+
+EntityStore::EntityStore(TransformStore* transforms, TransformHierarchy* hierarchy) :
+	transforms(transforms),
+	hierarchy(hierarchy),
+	count(0)
+{
+}
+
+EntityStore::~EntityStore()
+{
+	for (std::unique_ptr<EntityArchetype>& archetype : archetypes)
+	{
+		for (unsigned int transform : archetype->transforms)
+			ReleaseTransform(transform);
+	}
+}
+
+EntityId EntityStore::Create(unsigned int components)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)slots.size();
+		slots.push_back({ nullptr, 0, 1 });
+	}
+
+	EntityId id = { slot, slots[slot].generation };
+	InsertRow(GetArchetype(components), id, nullptr, 0);
+	count++;
+	return id;
+}
+
+void EntityStore::Destroy(EntityId id)
+{
+	if (!IsAlive(id))
+		return;
+
+	EntityArchetype* archetype = slots[id.index].archetype;
+	unsigned int row = slots[id.index].row;
+	if (archetype->components & ENTITY_TRANSFORM)
+		ReleaseTransform(archetype->transforms[row]);
+	RemoveRow(archetype, row);
+
+	//old ids of the slot stop resolving (0 is skipped, it's what a zeroed id has)
+	if (++slots[id.index].generation == 0)
+		slots[id.index].generation = 1;
+	slots[id.index].archetype = nullptr;
+	freeSlots.push_back(id.index);
+	count--;
+}
+
+bool EntityStore::IsAlive(EntityId id)
+{
+	return id.index < slots.size() && slots[id.index].generation == id.generation && slots[id.index].archetype != nullptr;
+}
+
+void EntityStore::AddComponents(EntityId id, unsigned int components)
+{
+	MoveEntity(id, GetComponents(id) | components);
+}
+
+void EntityStore::RemoveComponents(EntityId id, unsigned int components)
+{
+	MoveEntity(id, GetComponents(id) & ~components);
+}
+
+unsigned int EntityStore::GetComponents(EntityId id)
+{
+	return IsAlive(id) ? slots[id.index].archetype->components : 0;
+}
+
+unsigned int EntityStore::GetCount()
+{
+	return count;
+}
+
+const std::vector<EntityArchetype*>& EntityStore::Query(unsigned int components)
+{
+	auto found = queries.find(components);
+	if (found != queries.end())
+		return found->second;
+
+	std::vector<EntityArchetype*>& matches = queries[components];
+	for (std::unique_ptr<EntityArchetype>& archetype : archetypes)
+	{
+		if ((archetype->components & components) == components)
+			matches.push_back(archetype.get());
+	}
+	return matches;
+}
+
+unsigned int EntityStore::GetTransform(EntityId id)
+{
+	return slots[id.index].archetype->transforms[slots[id.index].row];
+}
+
+unsigned int EntityStore::GetMesh(EntityId id)
+{
+	return slots[id.index].archetype->meshes[slots[id.index].row];
+}
+
+unsigned int EntityStore::GetMaterial(EntityId id)
+{
+	return slots[id.index].archetype->materials[slots[id.index].row];
+}
+
+void EntityStore::SetMesh(EntityId id, unsigned int mesh)
+{
+	EntityArchetype* archetype = slots[id.index].archetype;
+	unsigned int row = slots[id.index].row;
+	archetype->meshes[row] = mesh;
+
+	//bounds came from the old mesh
+	if (archetype->components & ENTITY_BOUNDS)
+		archetype->bounds[row].valid = false;
+}
+
+void EntityStore::SetMaterial(EntityId id, unsigned int material)
+{
+	slots[id.index].archetype->materials[slots[id.index].row] = material;
+}
+
+void EntityStore::SetMotion(EntityId id, EntityMotion motion)
+{
+	slots[id.index].archetype->motions[slots[id.index].row] = motion;
+}
+
+EntityArchetype* EntityStore::GetArchetype(unsigned int components)
+{
+	//only a handful of archetypes ever exist, so a search is fine
+	for (std::unique_ptr<EntityArchetype>& archetype : archetypes)
+	{
+		if (archetype->components == components)
+			return archetype.get();
+	}
+
+	archetypes.push_back(std::make_unique<EntityArchetype>());
+	archetypes.back()->components = components;
+
+	//it may belong in any cached query
+	queries.clear();
+	return archetypes.back().get();
+}
+
+void EntityStore::InsertRow(EntityArchetype* to, EntityId id, EntityArchetype* from, unsigned int row)
+{
+	unsigned int shared = from ? from->components & to->components : 0;
+
+	to->ids.push_back(id);
+	if (to->components & ENTITY_TRANSFORM)
+		to->transforms.push_back(shared & ENTITY_TRANSFORM ? from->transforms[row] : transforms->Create());
+	if (to->components & ENTITY_MESH)
+		to->meshes.push_back(shared & ENTITY_MESH ? from->meshes[row] : 0);
+	if (to->components & ENTITY_MATERIAL)
+		to->materials.push_back(shared & ENTITY_MATERIAL ? from->materials[row] : 0);
+	if (to->components & ENTITY_BOUNDS)
+		to->bounds.push_back(shared & ENTITY_BOUNDS ? from->bounds[row] : EntityBounds{});
+	if (to->components & ENTITY_LOD)
+		to->lods.push_back(shared & ENTITY_LOD ? from->lods[row] : EntityLod{});
+	if (to->components & ENTITY_MOTION)
+		to->motions.push_back(shared & ENTITY_MOTION ? from->motions[row] : EntityMotion{});
+
+	slots[id.index].archetype = to;
+	slots[id.index].row = to->GetCount() - 1;
+}
+
+void EntityStore::RemoveRow(EntityArchetype* archetype, unsigned int row)
+{
+	//the last row moves into the hole (unless it is the hole, its entity may already live somewhere else)
+	unsigned int last = archetype->GetCount() - 1;
+	if (row != last)
+		slots[archetype->ids[last].index].row = row;
+
+	SwapRemove(archetype->ids, row);
+	SwapRemove(archetype->transforms, row);
+	SwapRemove(archetype->meshes, row);
+	SwapRemove(archetype->materials, row);
+	SwapRemove(archetype->bounds, row);
+	SwapRemove(archetype->lods, row);
+	SwapRemove(archetype->motions, row);
+}
+
+void EntityStore::MoveEntity(EntityId id, unsigned int components)
+{
+	if (!IsAlive(id) || slots[id.index].archetype->components == components)
+		return;
+
+	EntityArchetype* from = slots[id.index].archetype;
+	unsigned int row = slots[id.index].row;
+	EntityArchetype* to = GetArchetype(components);
+	InsertRow(to, id, from, row);
+
+	//a transform that's dropped goes back to the store
+	if ((from->components & ENTITY_TRANSFORM) && !(components & ENTITY_TRANSFORM))
+		ReleaseTransform(from->transforms[row]);
+	RemoveRow(from, row);
+}
+
+void EntityStore::ReleaseTransform(unsigned int transform)
+{
+	hierarchy->Remove(transform);
+	transforms->Destroy(transform);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Bounds.h"
+#include "TransformHierarchy.h"
+#include "TransformStore.h"
+
+// --------------------------------------------------------
+// Components an entity can have, as bits of an archetype's
+// component mask
+// --------------------------------------------------------
+enum EntityComponent
+{
+	ENTITY_TRANSFORM = 1 << 0,	// Slot in the transform store
+	ENTITY_MESH = 1 << 1,		// Handle the game resolves to a mesh
+	ENTITY_MATERIAL = 1 << 2,	// Handle the game resolves to a material
+	ENTITY_BOUNDS = 1 << 3,		// World bounds, cached
+	ENTITY_LOD = 1 << 4,		// Level of detail picked for the frame
+	ENTITY_MOTION = 1 << 5		// Scripted movement
+};
+
+// A slot index and the generation it had when the entity was made, so ids of
+// destroyed entities stop resolving even once their slot is reused.  Generations
+// start at 1, so a zeroed id never names an entity.
+struct EntityId
+{
+	unsigned int index;
+	unsigned int generation;
+};
+
+// Mesh bounds moved into world space, and the transform and mesh versions they were built from
+struct EntityBounds
+{
+	Bounds world;
+	unsigned int transformVersion;
+	unsigned int meshVersion;
+	bool valid;
+};
+
+// Level of detail picked by the last lod pass, the bounding sphere's diameter on screen
+// (in pixels, FLT_MAX with the camera inside it) and the meshlets that survived culling
+struct EntityLod
+{
+	unsigned int lod;
+	float projectedSize;
+	unsigned int visibleMeshlets;
+};
+
+// Every axis with a nonzero bob is driven to origin + bob * sin(time), any other axis is
+// left alone (so the editor can still move it); a nonzero spin sets the rotation to
+// pitch, yaw and roll of spin * time
+struct EntityMotion
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 bob;
+	DirectX::XMFLOAT3 spin;
+};
+
+// --------------------------------------------------------
+// Every entity with one exact set of components, one dense
+// column per component, row i of each being entity ids[i]
+//
+// Columns for components the archetype doesn't have stay
+// empty.  Rows move when entities are destroyed, so hold on
+// to ids, not rows.
+// --------------------------------------------------------
+struct EntityArchetype
+{
+	unsigned int components;
+	std::vector<EntityId> ids;
+	std::vector<unsigned int> transforms;
+	std::vector<unsigned int> meshes;
+	std::vector<unsigned int> materials;
+	std::vector<EntityBounds> bounds;
+	std::vector<EntityLod> lods;
+	std::vector<EntityMotion> motions;
+
+	unsigned int GetCount() { return (unsigned int)ids.size(); }
+};
+
+// --------------------------------------------------------
+// Entities, stored by archetype
+//
+// - Systems ask for the archetypes with the components they
+//   need and loop over their columns, so a pass over the
+//   scene touches only the data it reads, front to back
+// - Destroying swaps the last row of the archetype into the
+//   hole, keeping columns dense
+// - Adding or removing components moves the entity's row to
+//   the archetype for its new set
+// - Transform components are slots of a transform store,
+//   made and handed back (unparented from the hierarchy
+//   first) with the entity or component
+// - Device free; not thread safe, and entities must not be
+//   made, destroyed or changed while iterating (a query that
+//   was already cached may be looked up again from several
+//   threads, each writing its own rows of the columns)
+// --------------------------------------------------------
+class EntityStore
+{
+public:
+	EntityStore(TransformStore* transforms, TransformHierarchy* hierarchy);
+	~EntityStore();
+
+	// A new entity with zeroed components (an identity transform, handles 0, invalid bounds)
+	EntityId Create(unsigned int components);
+	void Destroy(EntityId id);
+	bool IsAlive(EntityId id);
+
+	void AddComponents(EntityId id, unsigned int components);
+	void RemoveComponents(EntityId id, unsigned int components);
+	unsigned int GetComponents(EntityId id);
+
+	unsigned int GetCount();
+
+	// Archetypes that have at least these components (some may be empty), cached until a new archetype appears
+	const std::vector<EntityArchetype*>& Query(unsigned int components);
+
+	// One entity's components, for setup and the odd lookup (systems should loop over Query instead);
+	// the entity has to be alive and have the component
+	unsigned int GetTransform(EntityId id);
+	unsigned int GetMesh(EntityId id);
+	unsigned int GetMaterial(EntityId id);
+	void SetMesh(EntityId id, unsigned int mesh);
+	void SetMaterial(EntityId id, unsigned int material);
+	void SetMotion(EntityId id, EntityMotion motion);
+
+private:
+	TransformStore* transforms;
+	TransformHierarchy* hierarchy;
+
+	std::vector<std::unique_ptr<EntityArchetype>> archetypes;
+	std::unordered_map<unsigned int, std::vector<EntityArchetype*>> queries;
+
+	//where each entity slot's row is, and the slot's current generation, together since they're always read together
+	struct Slot
+	{
+		EntityArchetype* archetype;	//null while the slot is free
+		unsigned int row;
+		unsigned int generation;
+	};
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+	unsigned int count;
+
+	EntityArchetype* GetArchetype(unsigned int components);
+
+	// Adds a row for the entity, copying the components it shares with a row of another archetype
+	// (if from isn't null) and zeroing the rest
+	void InsertRow(EntityArchetype* to, EntityId id, EntityArchetype* from, unsigned int row);
+
+	// Removes a row by moving the last one into it
+	void RemoveRow(EntityArchetype* archetype, unsigned int row);
+
+	// Moves an entity's row to the archetype for a new set of components
+	void MoveEntity(EntityId id, unsigned int components);
+
+	void ReleaseTransform(unsigned int transform);
+};
@@ -0,0 +1,356 @@
+#include "EnvironmentBaker.h"
+#include "CubeMap.h"
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Smallest sky level a sample reads.  Below this, clamping bilinear reads at the face edges
+	// distorts more than the extra blur saves; measured against a brute force convolution.
+	const unsigned int MIN_SAMPLED_SIZE = 8;
+
+	// Gamma decoding for every 8 bit value, light only adds up linearly
+	struct SrgbTable
+	{
+		float values[256];
+
+		SrgbTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	// One level of the sky in linear light, each face's texels row by row
+	struct RadianceLevel
+	{
+		unsigned int size;
+		std::vector<XMFLOAT4> faces[6];
+	};
+
+	// --------------------------------------------------------
+	// One importance sample of a GGX lobe around +Z: where it
+	// points, how much it counts, and the two sky levels (level
+	// and level + 1, blended) it reads
+	// --------------------------------------------------------
+	struct LobeSample
+	{
+		XMFLOAT3 direction;
+		float weight;
+		unsigned int level;
+		float blend;
+	};
+
+	// Van der Corput sequence, the second coordinate of the Hammersley points
+	float RadicalInverse(unsigned int bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return bits * 2.3283064365386963e-10f;
+	}
+
+	// A GGX distributed half vector around +Z for the i'th of count Hammersley points,
+	// alpha being roughness squared as in D_GGX
+	XMFLOAT3 SampleHalfVector(unsigned int i, unsigned int count, float alpha)
+	{
+		float phi = XM_2PI * i / count;
+		float u = RadicalInverse(i);
+		float cosTheta = sqrtf((1.0f - u) / (1.0f + (alpha * alpha - 1.0f) * u));
+		float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+		return XMFLOAT3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+	}
+
+	// --------------------------------------------------------
+	// The samples of one roughness's lobe, reflected about the
+	// half vectors with the view along +Z
+	//
+	// - Samples under the horizon are dropped, and the rest
+	//   weighted by n dot l, normalized to add up to 1
+	// - Each one reads the sky level whose texels cover about
+	//   as much solid angle as the sample stands for (GPU Gems
+	//   3, chapter 20, without its extra level of blur, which
+	//   measured worse here), up to the last level read
+	// --------------------------------------------------------
+	std::vector<LobeSample> BuildLobe(float roughness, unsigned int sampleCount, unsigned int size, unsigned int lastLevel)
+	{
+		float alpha = roughness * roughness;
+		float alpha2 = alpha * alpha;
+		float texelSolidAngle = 4.0f * XM_PI / (6.0f * size * size);
+
+		std::vector<LobeSample> samples;
+		float weightSum = 0.0f;
+		for (unsigned int i = 0; i < sampleCount; i++)
+		{
+			XMFLOAT3 h = SampleHalfVector(i, sampleCount, alpha);
+			float NdotL = 2.0f * h.z * h.z - 1.0f;
+			if (NdotL <= 0.0f)
+				continue;
+
+			//with v along n, the pdf of l is D(h) / 4
+			float denominator = h.z * h.z * (alpha2 - 1.0f) + 1.0f;
+			float pdf = alpha2 / (XM_PI * denominator * denominator) * 0.25f;
+			float sampleSolidAngle = 1.0f / (sampleCount * pdf);
+			float lod = 0.5f * log2f(sampleSolidAngle / texelSolidAngle);
+			lod = lod < 0.0f ? 0.0f : lod > lastLevel ? (float)lastLevel : lod;
+
+			LobeSample sample;
+			sample.direction = XMFLOAT3(2.0f * h.z * h.x, 2.0f * h.z * h.y, NdotL);
+			sample.weight = NdotL;
+			sample.level = (unsigned int)lod;
+			sample.blend = lod - sample.level;
+			if (sample.level == lastLevel)
+				sample.blend = 0.0f;
+			samples.push_back(sample);
+			weightSum += NdotL;
+		}
+
+		for (LobeSample& sample : samples)
+			sample.weight /= weightSum;
+		return samples;
+	}
+
+	// Bilinear read of one face of a level, u and v from -1 to 1, clamped at the face's edges
+	XMVECTOR SampleFace(const RadianceLevel& level, unsigned int face, float u, float v)
+	{
+		float last = level.size - 1.0f;
+		float x = (u + 1.0f) * 0.5f * level.size - 0.5f;
+		float y = (v + 1.0f) * 0.5f * level.size - 0.5f;
+		x = x < 0.0f ? 0.0f : x > last ? last : x;
+		y = y < 0.0f ? 0.0f : y > last ? last : y;
+
+		unsigned int x0 = (unsigned int)x;
+		unsigned int y0 = (unsigned int)y;
+		unsigned int x1 = x0 + 1 < level.size ? x0 + 1 : x0;
+		unsigned int y1 = y0 + 1 < level.size ? y0 + 1 : y0;
+
+		const XMFLOAT4* texels = level.faces[face].data();
+		XMVECTOR top = XMVectorLerp(XMLoadFloat4(&texels[y0 * level.size + x0]), XMLoadFloat4(&texels[y0 * level.size + x1]), x - x0);
+		XMVECTOR bottom = XMVectorLerp(XMLoadFloat4(&texels[y1 * level.size + x0]), XMLoadFloat4(&texels[y1 * level.size + x1]), x - x0);
+		return XMVectorLerp(top, bottom, y - y0);
+	}
+
+	// Unit direction through the center of a texel of a face that size
+	XMVECTOR GetTexelDirection(unsigned int face, unsigned int x, unsigned int y, unsigned int size)
+	{
+		const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+		float u = (x + 0.5f) * 2.0f / size - 1.0f;
+		float v = (y + 0.5f) * 2.0f / size - 1.0f;
+		XMVECTOR direction = XMVectorMultiplyAdd(XMLoadFloat3(&axes.u), XMVectorReplicate(u), XMLoadFloat3(&axes.center));
+		direction = XMVectorMultiplyAdd(XMLoadFloat3(&axes.v), XMVectorReplicate(v), direction);
+		return XMVector3Normalize(direction);
+	}
+
+	// --------------------------------------------------------
+	// The sky box filtered down to size in linear light, then
+	// halved level by level down to MIN_SAMPLED_SIZE (or size,
+	// if that's smaller)
+	// --------------------------------------------------------
+	std::vector<RadianceLevel> BuildRadianceLevels(const TextureData* const faces[6], unsigned int size)
+	{
+		static const SrgbTable srgb;
+		unsigned int sourceSize = faces[0]->width;
+
+		std::vector<RadianceLevel> levels(1);
+		for (unsigned int levelSize = size; levelSize > MIN_SAMPLED_SIZE; levelSize /= 2)
+			levels.emplace_back();
+		RadianceLevel& base = levels[0];
+		base.size = size;
+		for (int face = 0; face < 6; face++)
+			base.faces[face].resize((size_t)size * size);
+
+		//one task per row of the first level, each averaging its own block of source texels
+		ParallelFor(6 * size, [&](unsigned int task)
+		{
+			unsigned int face = task / size;
+			unsigned int y = task % size;
+			const TextureData& data = *faces[face];
+			unsigned int texelSize = GetTexelSize(data.format);
+			unsigned int firstRow = y * sourceSize / size;
+			unsigned int lastRow = (y + 1) * sourceSize / size;
+
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int firstColumn = x * sourceSize / size;
+				unsigned int lastColumn = (x + 1) * sourceSize / size;
+				XMVECTOR sum = XMVectorZero();
+				for (unsigned int row = firstRow; row < lastRow; row++)
+				{
+					const unsigned char* texel = data.GetMipData(0) + (size_t)row * data.mips[0].rowPitch + firstColumn * texelSize;
+					for (unsigned int column = firstColumn; column < lastColumn; column++, texel += texelSize)
+					{
+						sum = XMVectorAdd(sum, texelSize == 1 ?
+							XMVectorReplicate(srgb.values[texel[0]]) :
+							XMVectorSet(srgb.values[texel[0]], srgb.values[texel[1]], srgb.values[texel[2]], 0.0f));
+					}
+				}
+				sum = XMVectorScale(sum, 1.0f / ((lastRow - firstRow) * (lastColumn - firstColumn)));
+				XMStoreFloat4(&base.faces[face][(size_t)y * size + x], XMVectorSetW(sum, 1.0f));
+			}
+		});
+
+		//the rest are small, a face per task
+		for (size_t i = 1; i < levels.size(); i++)
+		{
+			const RadianceLevel& parent = levels[i - 1];
+			RadianceLevel& level = levels[i];
+			level.size = parent.size / 2;
+			ParallelFor(6, [&](unsigned int face)
+			{
+				level.faces[face].resize((size_t)level.size * level.size);
+				const XMFLOAT4* texels = parent.faces[face].data();
+				for (unsigned int y = 0; y < level.size; y++)
+				{
+					for (unsigned int x = 0; x < level.size; x++)
+					{
+						const XMFLOAT4* corner = texels + (size_t)y * 2 * parent.size + x * 2;
+						XMVECTOR sum = XMVectorAdd(XMLoadFloat4(corner), XMLoadFloat4(corner + 1));
+						sum = XMVectorAdd(sum, XMVectorAdd(XMLoadFloat4(corner + parent.size), XMLoadFloat4(corner + parent.size + 1)));
+						XMStoreFloat4(&level.faces[face][(size_t)y * level.size + x], XMVectorScale(sum, 0.25f));
+					}
+				}
+			});
+		}
+		return levels;
+	}
+}
+
+EnvironmentSettings::EnvironmentSettings() :
+	size(128),
+	mipCount(6),
+	sampleCount(256),
+	lutSize(128),
+	lutSampleCount(512)
+{
+}
+
+float GetPrefilteredRoughness(unsigned int mip, unsigned int mipCount)
+{
+	return mipCount > 1 ? (float)mip / (mipCount - 1) : 0.0f;
+}
+
+bool PrefilterEnvironment(const TextureData* const faces[6], const EnvironmentSettings& settings, TextureData prefiltered[6])
+{
+	for (int face = 0; face < 6; face++)
+	{
+		const TextureData* data = faces[face];
+		if (!data || data->mips.empty() || data->width != data->height || data->width != faces[0]->width ||
+			(data->format != TEXTURE_FORMAT_RGBA8 && data->format != TEXTURE_FORMAT_R8))
+			return false;
+	}
+
+	unsigned int size = settings.size;
+	if (size == 0 || faces[0]->width < size || settings.mipCount == 0 ||
+		settings.mipCount > GetFullMipCount(size, size) || settings.sampleCount == 0)
+		return false;
+
+	std::vector<RadianceLevel> levels = BuildRadianceLevels(faces, size);
+	for (int face = 0; face < 6; face++)
+		prefiltered[face].Allocate(TEXTURE_FORMAT_RGBA16F, size, size, settings.mipCount);
+
+	//roughness 0 is a mirror, so the first level is just the filtered sky
+	for (int face = 0; face < 6; face++)
+	{
+		XMHALF4* texels = (XMHALF4*)prefiltered[face].GetMipData(0);
+		for (size_t i = 0; i < levels[0].faces[face].size(); i++)
+			XMStoreHalf4(&texels[i], XMLoadFloat4(&levels[0].faces[face][i]));
+	}
+
+	for (unsigned int mip = 1; mip < settings.mipCount; mip++)
+	{
+		std::vector<LobeSample> lobe = BuildLobe(GetPrefilteredRoughness(mip, settings.mipCount), settings.sampleCount, size, (unsigned int)levels.size() - 1);
+		unsigned int mipSize = prefiltered[0].mips[mip].width;
+
+		//one task per row, every texel rotating the same lobe to its own normal
+		ParallelFor(6 * mipSize, [&](unsigned int task)
+		{
+			unsigned int face = task / mipSize;
+			unsigned int y = task % mipSize;
+			XMHALF4* row = (XMHALF4*)(prefiltered[face].GetMipData(mip) + (size_t)y * prefiltered[face].mips[mip].rowPitch);
+
+			for (unsigned int x = 0; x < mipSize; x++)
+			{
+				XMVECTOR normal = GetTexelDirection(face, x, y, mipSize);
+				XMVECTOR up = fabsf(XMVectorGetZ(normal)) < 0.999f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(1, 0, 0, 0);
+				XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+				XMVECTOR bitangent = XMVector3Cross(normal, tangent);
+
+				XMVECTOR sum = XMVectorZero();
+				for (const LobeSample& sample : lobe)
+				{
+					XMVECTOR direction = XMVectorScale(tangent, sample.direction.x);
+					direction = XMVectorMultiplyAdd(bitangent, XMVectorReplicate(sample.direction.y), direction);
+					direction = XMVectorMultiplyAdd(normal, XMVectorReplicate(sample.direction.z), direction);
+
+					float u, v;
+					unsigned int sampleFace = GetCubeFace(direction, u, v);
+					XMVECTOR radiance = SampleFace(levels[sample.level], sampleFace, u, v);
+					if (sample.blend > 0.0f)
+						radiance = XMVectorLerp(radiance, SampleFace(levels[sample.level + 1], sampleFace, u, v), sample.blend);
+					sum = XMVectorMultiplyAdd(radiance, XMVectorReplicate(sample.weight), sum);
+				}
+				XMStoreHalf4(&row[x], XMVectorSetW(sum, 1.0f));
+			}
+		});
+	}
+	return true;
+}
+
+void IntegrateBrdfLut(const EnvironmentSettings& settings, TextureData& lut)
+{
+	unsigned int size = settings.lutSize;
+	unsigned int sampleCount = settings.lutSampleCount;
+	lut.Allocate(TEXTURE_FORMAT_RG16F, size, size);
+
+	ParallelFor(size, [&](unsigned int y)
+	{
+		float roughness = (y + 0.5f) / size;
+		float alpha = roughness * roughness;
+		float k = alpha * 0.5f;
+
+		//the half vectors only depend on roughness, so the whole row shares them
+		std::vector<XMFLOAT3> halfVectors(sampleCount);
+		for (unsigned int i = 0; i < sampleCount; i++)
+			halfVectors[i] = SampleHalfVector(i, sampleCount, alpha);
+
+		XMHALF2* row = (XMHALF2*)(lut.GetMipData(0) + (size_t)y * lut.mips[0].rowPitch);
+		for (unsigned int x = 0; x < size; x++)
+		{
+			float NdotV = (x + 0.5f) / size;
+			XMFLOAT3 view(sqrtf(1.0f - NdotV * NdotV), 0.0f, NdotV);
+
+			float scale = 0.0f;
+			float bias = 0.0f;
+			for (const XMFLOAT3& h : halfVectors)
+			{
+				float VdotH = view.x * h.x + view.z * h.z;
+				float NdotL = 2.0f * VdotH * h.z - view.z;
+				if (NdotL <= 0.0f || VdotH <= 0.0f)
+					continue;
+
+				//the sample's weight once the pdf cancels: G * (v dot h) / ((n dot h) * (n dot v))
+				float G = NdotV / (NdotV * (1.0f - k) + k) * NdotL / (NdotL * (1.0f - k) + k);
+				float visibility = G * VdotH / (h.z * NdotV);
+				float fresnel = powf(1.0f - VdotH, 5.0f);
+				scale += (1.0f - fresnel) * visibility;
+				bias += fresnel * visibility;
+			}
+
+			XMHALF2 texel;
+			XMStoreHalf2(&texel, XMVectorSet(scale / sampleCount, bias / sampleCount, 0.0f, 0.0f));
+			row[x] = texel;
+		}
+	});
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "TextureData.h"
+
+// Bump whenever the baker changes its output, so old bakes get rebuilt
+#define ENVIRONMENT_BAKER_VERSION 1
+
+// --------------------------------------------------------
+// How big and how carefully the specular image based
+// lighting is baked (every field goes into the bake's key)
+// --------------------------------------------------------
+struct EnvironmentSettings
+{
+	unsigned int size;				// Faces of the first, mirror sharp, level of the prefiltered cube
+	unsigned int mipCount;			// Levels of the prefiltered cube, roughness 0 at the first to 1 at the last
+	unsigned int sampleCount;		// GGX samples per prefiltered texel
+	unsigned int lutSize;			// Both sides of the BRDF LUT
+	unsigned int lutSampleCount;	// GGX samples per LUT texel
+
+	EnvironmentSettings();
+};
+
+// The roughness a level of the prefiltered cube is convolved for, evenly
+// spaced so the shaders can pick a level with roughness * (mipCount - 1)
+float GetPrefilteredRoughness(unsigned int mip, unsigned int mipCount);
+
+// --------------------------------------------------------
+// Prefilters a sky's cubemap for the split sum
+// approximation (Karis, "Real Shading in Unreal Engine 4")
+//
+// - Faces are in D3D order (+X, -X, +Y, -Y, +Z, -Z), square,
+//   all one size and at least settings.size, gamma encoded
+//   RGBA8 (or R8)
+// - The sky is first box filtered down to settings.size in
+//   linear light, and that becomes the first level
+// - Every later level is the sky convolved with the GGX lobe
+//   for its roughness, assuming the view is along the normal,
+//   from importance samples (Hammersley points) that each
+//   read a blurrier copy of the sky the more sky they stand
+//   for (filtered importance sampling), so a few hundred
+//   samples come out free of noise
+// - Samples are the same for every texel of a level, so they
+//   are built once and only rotated to each texel's normal;
+//   texels are spread over the worker threads a row at a
+//   time, with DirectXMath vectors doing the sums
+// - Output faces are RGBA16F, settings.mipCount levels each
+// - Device free.  Returns false if the faces don't match.
+// --------------------------------------------------------
+bool PrefilterEnvironment(const TextureData* const faces[6], const EnvironmentSettings& settings, TextureData prefiltered[6]);
+
+// --------------------------------------------------------
+// Integrates the split sum's environment BRDF into a
+// settings.lutSize square RG16F texture
+//
+// - U is n dot v and V is roughness, both at texel centers
+// - Red and green are the scale and bias of F0, so the
+//   specular light is prefiltered * (F0 * r + g)
+// - Uses the same GGX and Schlick Fresnel as the shaders,
+//   with the Smith term's k at roughness^2 / 2 as image
+//   based lighting wants (not the (r + 1)^2 / 8 of lights)
+// - Device free, rows are spread over the worker threads
+// --------------------------------------------------------
+void IntegrateBrdfLut(const EnvironmentSettings& settings, TextureData& lut);
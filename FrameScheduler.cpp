@@ -0,0 +1,310 @@
+#include "FrameScheduler.h"
+#include "Parallel.h"
+#include <algorithm>
+
+//times a thread out of chunks yields before it parks
+static const unsigned int IDLE_SPINS = 64;
+
+FrameScheduler::FrameScheduler(unsigned int threadCount) :
+	systemsLeft(0),
+	queuedCount(0),
+	parkedThreads(0),
+	frame(0),
+	stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = GetWorkerCount();
+
+	report.frameTime = 0;
+	report.workTime = 0;
+	report.criticalPathWork = 0;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		queues.push_back(std::make_unique<WorkQueue>());
+
+	//the thread calling Run is the first one
+	threads.reserve(threadCount - 1);
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(&FrameScheduler::WorkerLoop, this, i);
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	frameStarted.notify_all();
+
+	for (auto& t : threads)
+		t.join();
+}
+
+unsigned int FrameScheduler::AddSystem(const FrameSystem& system)
+{
+	unsigned int index = (unsigned int)systems.size();
+	systems.push_back(system);
+	states.push_back(std::make_unique<SystemState>());
+	report.systems.push_back({});
+
+	//it waits for every earlier system it conflicts with
+	for (unsigned int earlier = 0; earlier < index; earlier++)
+	{
+		const FrameSystem& other = systems[earlier];
+		if ((system.writes & (other.reads | other.writes)) || (other.writes & system.reads))
+		{
+			states[index]->dependencies.push_back(earlier);
+			states[earlier]->dependents.push_back(index);
+		}
+	}
+	return index;
+}
+
+unsigned int FrameScheduler::GetSystemCount()
+{
+	return (unsigned int)systems.size();
+}
+
+const FrameSystem& FrameScheduler::GetSystem(unsigned int index)
+{
+	return systems[index];
+}
+
+const std::vector<unsigned int>& FrameScheduler::GetDependencies(unsigned int index)
+{
+	return states[index]->dependencies;
+}
+
+void FrameScheduler::Run()
+{
+	frameStart = std::chrono::steady_clock::now();
+	if (systems.empty())
+		return;
+
+	for (unsigned int i = 0; i < systems.size(); i++)
+	{
+		SystemState& state = *states[i];
+		state.waitingOn = (unsigned int)state.dependencies.size();
+		state.started = false;
+		state.work = 0;
+		report.systems[i] = {};
+	}
+	systemsLeft = (unsigned int)systems.size();
+
+	//last first, so this thread (taking the newest) starts on the first while the others steal the rest
+	for (unsigned int i = (unsigned int)systems.size(); i-- > 0;)
+	{
+		if (states[i]->dependencies.empty())
+			Release(i, 0);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		frame++;
+	}
+	frameStarted.notify_all();
+	Work(0);
+
+	report.frameTime = GetTime();
+	report.workTime = 0;
+	for (FrameSystemTiming& timing : report.systems)
+		report.workTime += timing.work;
+	BuildCriticalPath();
+}
+
+const FrameReport& FrameScheduler::GetReport()
+{
+	return report;
+}
+
+unsigned int FrameScheduler::GetThreadCount()
+{
+	return (unsigned int)queues.size();
+}
+
+void FrameScheduler::WorkerLoop(unsigned int queue)
+{
+	unsigned int seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameStarted.wait(lock, [&]() { return stopping || frame != seen; });
+			if (stopping)
+				return;
+			seen = frame;
+		}
+
+		Work(queue);
+	}
+}
+
+void FrameScheduler::Work(unsigned int queue)
+{
+	Chunk chunk;
+	unsigned int idle = 0;
+	while (systemsLeft > 0)
+	{
+		//read before looking, so chunks queued after a failed look are noticed when parking
+		unsigned int queued = queuedCount;
+		if (TakeChunk(queue, chunk))
+		{
+			RunChunk(queue, chunk);
+			idle = 0;
+			continue;
+		}
+
+		//the next system is usually released within microseconds, so yield a little before sleeping
+		if (++idle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(workMutex);
+		parkedThreads++;
+		workQueued.wait(lock, [&]() { return queuedCount != queued || systemsLeft == 0; });
+		parkedThreads--;
+		idle = 0;
+	}
+}
+
+bool FrameScheduler::TakeChunk(unsigned int queue, Chunk& chunk)
+{
+	{
+		WorkQueue& own = *queues[queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.chunks.empty())
+		{
+			chunk = own.chunks.back();
+			own.chunks.pop_back();
+			return true;
+		}
+	}
+
+	//the oldest chunk of the next busy thread along, the one its owner would get to last
+	for (unsigned int i = 1; i < queues.size(); i++)
+	{
+		WorkQueue& victim = *queues[(queue + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.chunks.empty())
+		{
+			chunk = victim.chunks.front();
+			victim.chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameScheduler::RunChunk(unsigned int queue, const Chunk& chunk)
+{
+	SystemState& state = *states[chunk.system];
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	if (!state.started.exchange(true))
+		report.systems[chunk.system].start = std::chrono::duration<float, std::milli>(begin - frameStart).count();
+
+	systems[chunk.system].run(chunk.begin, chunk.end);
+
+	state.work += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+	if (state.chunksLeft.fetch_sub(1) == 1)
+		Finish(chunk.system, queue);
+}
+
+void FrameScheduler::Release(unsigned int system, unsigned int queue)
+{
+	const FrameSystem& info = systems[system];
+	FrameSystemTiming& timing = report.systems[system];
+	timing.ready = GetTime();
+
+	unsigned int items = info.count ? info.count() : 1;
+	unsigned int chunkSize = info.count ? std::max(1u, info.chunkSize) : 1;
+	timing.items = items;
+	timing.chunks = (items + chunkSize - 1) / chunkSize;
+
+	//nothing to do this frame, it's done as soon as it's ready
+	if (timing.chunks == 0)
+	{
+		timing.start = timing.ready;
+		Finish(system, queue);
+		return;
+	}
+
+	//backwards, so the owner (taking the newest) goes through them in order and thieves take the last ones
+	states[system]->chunksLeft = timing.chunks;
+	{
+		WorkQueue& own = *queues[queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		for (unsigned int chunk = timing.chunks; chunk-- > 0;)
+			own.chunks.push_back({ system, chunk * chunkSize, std::min(items, (chunk + 1) * chunkSize) });
+	}
+	WakeParked();
+}
+
+void FrameScheduler::Finish(unsigned int system, unsigned int queue)
+{
+	SystemState& state = *states[system];
+	FrameSystemTiming& timing = report.systems[system];
+	timing.end = GetTime();
+	timing.work = state.work / 1000000.0f;
+
+	for (unsigned int dependent : state.dependents)
+	{
+		if (states[dependent]->waitingOn.fetch_sub(1) == 1)
+			Release(dependent, queue);
+	}
+
+	//last, the frame isn't over until every dependent is queued
+	if (--systemsLeft == 0)
+		WakeParked();
+}
+
+void FrameScheduler::WakeParked()
+{
+	//a thread that parks later sees the new count, and taking the lock waits out one that's between counting and waiting
+	queuedCount++;
+	if (parkedThreads == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+	}
+	workQueued.notify_all();
+}
+
+float FrameScheduler::GetTime()
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+}
+
+void FrameScheduler::BuildCriticalPath()
+{
+	report.criticalPath.clear();
+	report.criticalPathWork = 0;
+
+	//back from the last system to finish, through whichever dependency held each one up the longest
+	unsigned int system = 0;
+	for (unsigned int i = 1; i < systems.size(); i++)
+	{
+		if (report.systems[i].end > report.systems[system].end)
+			system = i;
+	}
+
+	while (true)
+	{
+		report.criticalPath.push_back(system);
+		report.criticalPathWork += report.systems[system].end - report.systems[system].start;
+
+		const std::vector<unsigned int>& dependencies = states[system]->dependencies;
+		if (dependencies.empty())
+			break;
+
+		unsigned int latest = dependencies[0];
+		for (unsigned int dependency : dependencies)
+		{
+			if (report.systems[dependency].end > report.systems[latest].end)
+				latest = dependency;
+		}
+		system = latest;
+	}
+	std::reverse(report.criticalPath.begin(), report.criticalPath.end());
+}
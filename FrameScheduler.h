@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bits above the entity components, for data systems touch that isn't on entities
+enum FrameResource
+{
+	FRAME_RESOURCE_CAMERA = 1 << 16		// The active camera: its own transform slot and view matrix
+};
+
+// One piece of per-frame update work, and the data it touches.  Reads and
+// writes are bit masks of EntityComponent and FrameResource bits.  A system with a count runs over items
+// 0 ... count() - 1, split into chunks of chunkSize that may run on different
+// threads, so each chunk must only write its own items; without one it's a
+// single call of run(0, 1).
+struct FrameSystem
+{
+	const char* name;
+	unsigned int reads;
+	unsigned int writes;
+	std::function<void(unsigned int begin, unsigned int end)> run;
+	std::function<unsigned int()> count;	//asked once the system's dependencies are done
+	unsigned int chunkSize;
+};
+
+// When one system ran in the last frame, in milliseconds from the frame's start
+struct FrameSystemTiming
+{
+	float ready;		//its dependencies were done
+	float start;		//its first chunk started
+	float end;			//its last chunk finished
+	float work;			//every chunk's time added up
+	unsigned int items;
+	unsigned int chunks;
+};
+
+// --------------------------------------------------------
+// How the last frame went: the time it took, the time all
+// the systems took added up (so work / frame is how many
+// threads were busy on average), and the critical path, the
+// chain of systems each waiting on the one before it that
+// ended with the last system to finish
+// --------------------------------------------------------
+struct FrameReport
+{
+	float frameTime;
+	float workTime;
+	std::vector<FrameSystemTiming> systems;
+	std::vector<unsigned int> criticalPath;	//system indices, first to last
+	float criticalPathWork;					//start to end of every system on it, added up
+};
+
+// --------------------------------------------------------
+// Runs a frame's update systems across threads
+//
+// - Two systems conflict if one writes anything the other
+//   reads or writes; conflicting systems run in the order
+//   they were added, anything else may overlap
+// - Every thread keeps its own queue of chunks, taking the
+//   newest from it and stealing the oldest from the others
+//   when it runs dry, so a finished system's dependents are
+//   started where its data is still in cache
+// - Chunk boundaries come from chunkSize, never the thread
+//   count, and conflicting systems never overlap, so (as
+//   long as systems stick to what they declared) a frame
+//   comes out the same on any number of threads as it does
+//   run serially in the order the systems were added
+// - A thread with nothing to take yields a few times (a
+//   dependent is usually released within microseconds),
+//   then sleeps until chunks are queued or the frame ends
+// - Device free; systems are added up front and Run is
+//   called from one thread at a time
+// --------------------------------------------------------
+class FrameScheduler
+{
+public:
+	// Threads to run systems on, counting the one that calls Run; 0 means the worker count
+	explicit FrameScheduler(unsigned int threadCount = 0);
+	~FrameScheduler();
+
+	FrameScheduler(FrameScheduler const&) = delete;
+	void operator=(FrameScheduler const&) = delete;
+
+	// Returns the system's index in the report
+	unsigned int AddSystem(const FrameSystem& system);
+	unsigned int GetSystemCount();
+	const FrameSystem& GetSystem(unsigned int index);
+
+	// Indices of the earlier systems this one waits for
+	const std::vector<unsigned int>& GetDependencies(unsigned int index);
+
+	// Runs every system once, returning when they're all done (the calling thread works too)
+	void Run();
+
+	const FrameReport& GetReport();
+	unsigned int GetThreadCount();
+
+private:
+	struct Chunk
+	{
+		unsigned int system;
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	//one per thread, the caller's being queue 0
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Chunk> chunks;
+	};
+
+	//a system's place in the graph, and how far it got this frame
+	struct SystemState
+	{
+		std::vector<unsigned int> dependencies;
+		std::vector<unsigned int> dependents;
+		std::atomic<unsigned int> waitingOn;
+		std::atomic<unsigned int> chunksLeft;
+		std::atomic<bool> started;
+		std::atomic<long long> work;	//nanoseconds
+	};
+
+	std::vector<FrameSystem> systems;
+	std::vector<std::unique_ptr<SystemState>> states;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	FrameReport report;
+
+	std::chrono::steady_clock::time_point frameStart;
+	std::atomic<unsigned int> systemsLeft;
+
+	//threads out of work sleep on this until chunks are queued or the last system finishes
+	std::mutex workMutex;
+	std::condition_variable workQueued;
+	std::atomic<unsigned int> queuedCount;
+	std::atomic<unsigned int> parkedThreads;
+
+	//worker threads sleep between frames
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable frameStarted;
+	unsigned int frame;
+	bool stopping;
+
+	void WorkerLoop(unsigned int queue);
+
+	// Runs chunks, its own first then stolen ones, until the frame's systems are done
+	void Work(unsigned int queue);
+	bool TakeChunk(unsigned int queue, Chunk& chunk);
+	void RunChunk(unsigned int queue, const Chunk& chunk);
+
+	// Queues a system whose dependencies are done on the thread that finished the last of them
+	void Release(unsigned int system, unsigned int queue);
+	void Finish(unsigned int system, unsigned int queue);
+
+	// Wakes any threads parked in Work
+	void WakeParked();
+
+	float GetTime();
+	void BuildCriticalPath();
+};
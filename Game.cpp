@@ -6,16 +6,29 @@
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
 #include "Transform.h"
+#include <cfloat>
 #include <iostream>
-#include "WICTextureLoader.h"
+#include <filesystem>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
+#include <chrono>
+#include "Parallel.h"
+#include "PngDecoder.h"
 
 // For the DirectX Math library
 using namespace DirectX;
 
+namespace
+{
+	//folders in Assets/Skies, in the order the UI lists them
+	const char* SKY_NAMES[] = { "Clouds_Blue", "Clouds_Pink", "Cold_Sunset", "Planet" };
+
+	//what an entity needs to be drawn
+	const unsigned int DRAWN_COMPONENTS = ENTITY_TRANSFORM | ENTITY_MESH | ENTITY_MATERIAL | ENTITY_BOUNDS | ENTITY_LOD;
+}
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -42,11 +55,19 @@ Game::Game(HINSTANCE hInstance)
 
 #endif
 	//Giving all variables initial values
-	ambientColor = DirectX::XMFLOAT3(0.05f, 0.05f, 0.05f);
-	entityCount = 0;
+	ambientIntensity = 1.0f;
+	activeSky = 0;
+	skySwitchMilliseconds = 0.0f;
+	skyBakeMilliseconds = 0.0f;
+	skyBakeCached = false;
+	brdfLutCached = false;
+	for (int i = 0; i < skyCount; i++)
+		skyMissing[i] = false;
 	activeCameraIndex = 0;
-	meshes = new std::shared_ptr<Mesh>[entityCount];
-	entities = new std::shared_ptr<GameEntity>[entityCount];
+	cameraInput = {};
+	systemTotalTime = 0.0f;
+	textureLoadMilliseconds = 0.0f;
+	textureBudgetMegabytes = 32;
 	std::memset(nextWindowTitle, '\0', sizeof(nextWindowTitle));
 	std::memset(windowTitles[0], '\0', sizeof(windowTitles[0]));
 	for (int i = 0; i < 10; ++i) {
@@ -73,16 +94,8 @@ Game::~Game()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
-	delete[] meshes;
-	meshes = nullptr;
-
-	delete[] entities;
-	entities = nullptr;
-
-	delete[] entityPositions;
-	delete[] entityRotations;
-	delete[] entityScales;
-
+	//entities first, they hand their transforms back
+	entities.reset();
 }
 
 // --------------------------------------------------------
@@ -112,6 +125,9 @@ void Game::Init()
 
 	numCameras = 3;
 
+	//every cooked texture and mesh is stored here, and only cooked again when its source or settings change
+	assetCache = std::make_shared<AssetCache>(FixPath(L"../../Cache/Assets"));
+
 	//load shaders into pointers
 	LoadShaders();
 
@@ -123,6 +139,7 @@ void Game::Init()
 
 	//create game entities
 	CreateGeometry();
+	CreateSystems();
 
 	//shadow rasterizer
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
@@ -152,6 +169,9 @@ void Game::Init()
 	ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
 
+	//levels of detail may be off by up to a pixel
+	lodPixelError = 1.0f;
+
 	//No blur to start
 	blurRadius = 0;
 
@@ -201,17 +221,22 @@ void Game::LoadShaders()
 		device, context, FixPath(L"SkyPixelShader.cso").c_str());
 	//customPixelShader1 = std::make_shared<SimplePixelShader>(device, context, FixPath(L"CustomPixelShader1.cso").c_str());
 
+	//every mesh vertex shader reads the same packed vertex, so they share one explicit input layout
+	//(reflection can't know that the 16 bit inputs are SNORM / half floats)
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> meshInputLayout =
+		Mesh::CreateInputLayout(device, FixPath(L"VertexShader.cso").c_str());
+
 	vs = std::make_shared<SimpleVertexShader>(
-		device, context, FixPath(L"VertexShader.cso").c_str());
+		device, context, FixPath(L"VertexShader.cso").c_str(), meshInputLayout, false);
 
 	nvs = std::make_shared<SimpleVertexShader>(
-		device, context, FixPath(L"NormalMapVertexShader.cso").c_str());
+		device, context, FixPath(L"NormalMapVertexShader.cso").c_str(), meshInputLayout, false);
 
 	skyVS = std::make_shared<SimpleVertexShader>(
-		device, context, FixPath(L"SkyVertexShader.cso").c_str());
+		device, context, FixPath(L"SkyVertexShader.cso").c_str(), meshInputLayout, false);
 
 	shadowVS = std::make_shared<SimpleVertexShader>(
-		device, context, FixPath(L"ShadowMapVertexShader.cso").c_str());
+		device, context, FixPath(L"ShadowMapVertexShader.cso").c_str(), meshInputLayout, false);
 
 	PBRps = std::make_shared<SimplePixelShader>(
 		device, context, FixPath(L"PBRPixelShader.cso").c_str());
@@ -465,109 +490,92 @@ void Game::CreateTextures()
 		&samplerDescription,
 		&shadowSampler);
 
-	//fully white specular map
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Specular_Maps/fully_specular.png").c_str(), 0, fullySpecularSRV.GetAddressOf());
-
-	//flat normal map
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Normal_Maps/flat_normal.png").c_str(), 0, flatNormalSRV.GetAddressOf());
+	//decodes run on worker threads while the loader creates finished textures here
+	TextureLoader textureLoader(device);
+	textureStreamer = std::make_shared<TextureStreamer>(device, (size_t)textureBudgetMegabytes * 1024 * 1024);
+	textureLoader.SetStreamer(textureStreamer);
+	textureLoader.SetAssetCache(assetCache);
+
+	//small textures share atlases, one per role: the fully white specular map, the flat normal map, broken tiles and cushion
+	textureLoader.LoadAtlas({
+		{ FixPath(L"../../Assets/Specular_Maps/fully_specular.png"), fullySpecularSRV.GetAddressOf(), &fullySpecularRemap },
+		{ FixPath(L"../../Assets/Specular_Maps/brokentiles_specular.png"), brokenTilesSpecularSRV.GetAddressOf(), &brokenTilesSpecularRemap } },
+		TEXTURE_ROLE_SPECULAR);
+	textureLoader.LoadAtlas({
+		{ FixPath(L"../../Assets/Normal_Maps/flat_normals.png"), flatNormalSRV.GetAddressOf(), &flatNormalRemap },
+		{ FixPath(L"../../Assets/Normal_Maps/cushion_normals.png"), cushionNormalSRV.GetAddressOf(), &cushionNormalRemap } },
+		TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadAtlas({
+		{ FixPath(L"../../Assets/Textures/brokentiles.png"), brokenTilesSRV.GetAddressOf(), &brokenTilesRemap },
+		{ FixPath(L"../../Assets/Textures/cushion.png"), cushionSRV.GetAddressOf(), &cushionRemap } },
+		TEXTURE_ROLE_ALBEDO);
 
 	//rusty metal
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Textures/rustymetal.png").c_str(), 0, rustyMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Specular_Maps/rustymetal_specular.png").c_str(), 0, rustyMetalSpecularSRV.GetAddressOf());
-
-	//broken tiles
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Textures/brokentiles.png").c_str(), 0, brokenTilesSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Specular_Maps/brokentiles_specular.png").c_str(), 0, brokenTilesSpecularSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/Textures/rustymetal.png").c_str(), rustyMetalSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/Specular_Maps/rustymetal_specular.png").c_str(), rustyMetalSpecularSRV.GetAddressOf(), TEXTURE_ROLE_SPECULAR);
 
 	//tiles
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Textures/tiles.png").c_str(), 0, tilesSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Specular_Maps/tiles_specular.png").c_str(), 0, tilesSpecularSRV.GetAddressOf());
-
-	//cushion
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Textures/cushion.png").c_str(), 0, cushionSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Normal_Maps/cushion_normals.png").c_str(), 0, cushionNormalSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/Textures/tiles.png").c_str(), tilesSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/Specular_Maps/tiles_specular.png").c_str(), tilesSpecularSRV.GetAddressOf(), TEXTURE_ROLE_SPECULAR);
 
 	//rock
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Textures/rock.png").c_str(), 0, rockSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/Normal_Maps/rock_normals.png").c_str(), 0, rockNormalSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/Textures/rock.png").c_str(), rockSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/Normal_Maps/rock_normals.png").c_str(), rockNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
 
+	//the PBR sets have no occlusion maps, so only roughness and metal get packed
 	//cobblestone
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/cobblestone_albedo.png").c_str(), 0, cobblestoneSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/cobblestone_metal.png").c_str(), 0, cobblestoneMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/cobblestone_normals.png").c_str(), 0, cobblestoneNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/cobblestone_roughness.png").c_str(), 0, cobblestoneRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/cobblestone_albedo.png").c_str(), cobblestoneSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/cobblestone_normals.png").c_str(), cobblestoneNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/cobblestone_roughness.png"), FixPath(L"../../Assets/PBR/Metal/cobblestone_metal.png") },
+		cobblestoneOrmSRV.GetAddressOf());
 
 	//bronze
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/bronze_albedo.png").c_str(), 0, bronzeSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/bronze_metal.png").c_str(), 0, bronzeMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/bronze_normals.png").c_str(), 0, bronzeNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/bronze_roughness.png").c_str(), 0, bronzeRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/bronze_albedo.png").c_str(), bronzeSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/bronze_normals.png").c_str(), bronzeNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/bronze_roughness.png"), FixPath(L"../../Assets/PBR/Metal/bronze_metal.png") },
+		bronzeOrmSRV.GetAddressOf());
 
 	//floor
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/floor_albedo.png").c_str(), 0, floorSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/floor_metal.png").c_str(), 0, floorMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/floor_normals.png").c_str(), 0, floorNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/floor_roughness.png").c_str(), 0, floorRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/floor_albedo.png").c_str(), floorSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/floor_normals.png").c_str(), floorNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/floor_roughness.png"), FixPath(L"../../Assets/PBR/Metal/floor_metal.png") },
+		floorOrmSRV.GetAddressOf());
 
 	//paint
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/paint_albedo.png").c_str(), 0, paintSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/paint_metal.png").c_str(), 0, paintMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/paint_normals.png").c_str(), 0, paintNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/paint_roughness.png").c_str(), 0, paintRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/paint_albedo.png").c_str(), paintSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/paint_normals.png").c_str(), paintNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/paint_roughness.png"), FixPath(L"../../Assets/PBR/Metal/paint_metal.png") },
+		paintOrmSRV.GetAddressOf());
 
 	//rough
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/rough_albedo.png").c_str(), 0, roughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/rough_metal.png").c_str(), 0, roughMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/rough_normals.png").c_str(), 0, roughNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/rough_roughness.png").c_str(), 0, roughRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/rough_albedo.png").c_str(), roughSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/rough_normals.png").c_str(), roughNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/rough_roughness.png"), FixPath(L"../../Assets/PBR/Metal/rough_metal.png") },
+		roughOrmSRV.GetAddressOf());
 
 	//scratched
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/scratched_albedo.png").c_str(), 0, scratchedSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/scratched_metal.png").c_str(), 0, scratchedMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/scratched_normals.png").c_str(), 0, scratchedNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/scratched_roughness.png").c_str(), 0, scratchedRoughnessSRV.GetAddressOf());
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/scratched_albedo.png").c_str(), scratchedSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/scratched_normals.png").c_str(), scratchedNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/scratched_roughness.png"), FixPath(L"../../Assets/PBR/Metal/scratched_metal.png") },
+		scratchedOrmSRV.GetAddressOf());
 
 	//wood
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Albedo/wood_albedo.png").c_str(), 0, woodSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Metal/wood_metal.png").c_str(), 0, woodMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Normal/wood_normals.png").c_str(), 0, woodNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), FixPath(L"../../Assets/PBR/Roughness/wood_roughness.png").c_str(), 0, woodRoughnessSRV.GetAddressOf());
-
-
-
-
-	cloudsBlueSRV = CreateCubemap(
-		FixPath(L"../../Assets/Skies/Clouds_Blue/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Blue/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Blue/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Blue/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Blue/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Blue/back.png").c_str());
-	/*
-	cloudsPinkSRV = CreateCubemap(
-		FixPath(L"../../Assets/Skies/Clouds_Pink/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Pink/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Pink/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Pink/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Pink/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/Clouds_Pink/back.png").c_str());
-
-	coldSunsetSRV = CreateCubemap(
-		FixPath(L"../../Assets/Skies/Cold_Sunset/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/Cold_Sunset/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/Cold_Sunset/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/Cold_Sunset/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/Cold_Sunset/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/Cold_Sunset/back.png").c_str());
-
-	planetSRV = CreateCubemap(
-		FixPath(L"../../Assets/Skies/Planet/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/Planet/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/Planet/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/Planet/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/Planet/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/Planet/back.png").c_str());
-	*/
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Albedo/wood_albedo.png").c_str(), woodSRV.GetAddressOf(), TEXTURE_ROLE_ALBEDO);
+	textureLoader.Load(FixPath(L"../../Assets/PBR/Normal/wood_normals.png").c_str(), woodNormalSRV.GetAddressOf(), TEXTURE_ROLE_NORMAL);
+	textureLoader.LoadOrm({ L"", FixPath(L"../../Assets/PBR/Roughness/wood_roughness.png"), FixPath(L"../../Assets/PBR/Metal/wood_metal.png") },
+		woodOrmSRV.GetAddressOf());
+
+	textureLoader.Finish();
+	textureLoadStats = textureLoader.GetStats();
+	textureLoadMilliseconds = textureLoader.GetTotalMilliseconds();
+
+	//the BRDF LUT doesn't depend on the sky, so it's baked (or read back) once here
+	TextureData brdfLut;
+	TextureCookInfo brdfLutInfo;
+	if (CookBrdfLut(EnvironmentSettings(), assetCache.get(), brdfLut, &brdfLutInfo))
+		CreateTextureFromData(device, brdfLut, brdfLutSRV.GetAddressOf());
+	brdfLutCached = brdfLutInfo.cacheHit;
+	assetCache->Save();
 }
 
 
@@ -575,80 +583,73 @@ void Game::CreateMaterials()
 {
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), vs, tps, 0.5f, false));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", rustyMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", rustyMetalSpecularSRV);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", textureStreamer->GetTexture(rustyMetalSRV));
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", textureStreamer->GetTexture(rustyMetalSpecularSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), vs, tps, 0.5f, false));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", brokenTilesSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", brokenTilesSpecularSRV);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", textureStreamer->GetTexture(brokenTilesSRV), brokenTilesRemap);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", textureStreamer->GetTexture(brokenTilesSpecularSRV), brokenTilesSpecularRemap);
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), vs, tps, 0.5f, false));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", tilesSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", tilesSpecularSRV);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", textureStreamer->GetTexture(tilesSRV));
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", textureStreamer->GetTexture(tilesSpecularSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, nps, 0.5f, false));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", cushionSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", fullySpecularSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureNormal", cushionNormalSRV);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", textureStreamer->GetTexture(cushionSRV), cushionRemap);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", textureStreamer->GetTexture(fullySpecularSRV), fullySpecularRemap);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureNormal", textureStreamer->GetTexture(cushionNormalSRV), cushionNormalRemap);
 
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, nps, 0.5f, false));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", rockSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", fullySpecularSRV);
-	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureNormal", rockNormalSRV);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTexture", textureStreamer->GetTexture(rockSRV));
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureSpecular", textureStreamer->GetTexture(fullySpecularSRV), fullySpecularRemap);
+	materials[materials.size() - 1].AddTextureSRV("SurfaceTextureNormal", textureStreamer->GetTexture(rockNormalSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", cobblestoneSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", cobblestoneMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", cobblestoneNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", cobblestoneRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(cobblestoneSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(cobblestoneNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(cobblestoneOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", bronzeSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", bronzeMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", bronzeNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", bronzeRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(bronzeSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(bronzeNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(bronzeOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", floorSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", floorMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", floorNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", floorRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(floorSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(floorNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(floorOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", paintSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", paintMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", paintNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", paintRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(paintSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(paintNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(paintOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", roughSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", roughMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", roughNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", roughRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(roughSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(roughNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(roughOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", scratchedSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", scratchedMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", scratchedNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", scratchedRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(scratchedSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(scratchedNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(scratchedOrmSRV));
 
 	materials.push_back(Material(DirectX::XMFLOAT4(1, 1, 1, 1), nvs, PBRps, 0.5f, true));
 	materials[materials.size() - 1].AddSampler("BasicSampler", samplerState);
-	materials[materials.size() - 1].AddTextureSRV("Albedo", woodSRV);
-	materials[materials.size() - 1].AddTextureSRV("MetalnessMap", woodMetalSRV);
-	materials[materials.size() - 1].AddTextureSRV("NormalMap", woodNormalSRV);
-	materials[materials.size() - 1].AddTextureSRV("RoughnessMap", woodRoughnessSRV);
+	materials[materials.size() - 1].AddTextureSRV("Albedo", textureStreamer->GetTexture(woodSRV));
+	materials[materials.size() - 1].AddTextureSRV("NormalMap", textureStreamer->GetTexture(woodNormalSRV));
+	materials[materials.size() - 1].AddTextureSRV("OrmMap", textureStreamer->GetTexture(woodOrmSRV));
 }
 
 void Game::CreateLights()
@@ -715,22 +716,11 @@ void Game::CreateLights()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
-	//clean up empty meshes before reassignment
-	delete[] meshes;
-	meshCount = 7;
-	entityCount = 5;
-	meshes = new std::shared_ptr<Mesh>[meshCount];
-	delete[] entities;
-	entities = new std::shared_ptr<GameEntity>[entityCount];
-
-	delete[] entityPositions;
-	entityPositions = new DirectX::XMFLOAT3[entityCount];
-
-	delete[] entityRotations;
-	entityRotations = new DirectX::XMFLOAT3[entityCount];
+	//drop any meshes from before, their handles are about to be reassigned
+	meshes.clear();
 
-	delete[] entityScales;
-	entityScales = new DirectX::XMFLOAT3[entityCount];
+	//a new store drops any entities from before
+	entities = std::make_shared<EntityStore>(&TransformStore::GetDefault(), &TransformHierarchy::GetDefault());
 
 	// Create some temporary variables to represent colors
 	// - Not necessary, just makes things more readable
@@ -876,33 +866,52 @@ void Game::CreateGeometry()
 		meshes[3] = cube;
 	}
 	*/
-	meshes[0] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/sphere.obj").c_str());
-	meshes[1] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/cube.obj").c_str());
-	meshes[2] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/cylinder.obj").c_str());
-	meshes[3] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/helix.obj").c_str());
-	meshes[4] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/quad.obj").c_str());
-	meshes[5] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str());
-	meshes[6] = std::make_shared<Mesh>(device, FixPath(L"../../Assets/Models/torus.obj").c_str());
+	//the cube loads right away, it stands in for every other mesh until that one is uploaded
+	meshRegistry = std::make_shared<MeshRegistry>(device, FixPath(L"../../Assets/Models/cube.obj").c_str(), assetCache);
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/sphere.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/cube.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/cylinder.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/helix.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/quad.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str()));
+	meshes.push_back(meshRegistry->Load(FixPath(L"../../Assets/Models/torus.obj").c_str()));
 	
-	entities[0] = std::make_shared<GameEntity>(meshes[0], std::make_shared<Material>(materials[8]));
-	entities[1] = std::make_shared<GameEntity>(meshes[6], std::make_shared<Material>(materials[5]));
-	entities[2] = std::make_shared<GameEntity>(meshes[1], std::make_shared<Material>(materials[6]));
-	entities[3] = std::make_shared<GameEntity>(meshes[3], std::make_shared<Material>(materials[7]));
-	
-
+	TransformStore& transforms = TransformStore::GetDefault();
+
+	//a row of animated shapes: sphere bobbing up and down, torus rolling, cube bobbing back and forth, helix turning
+	unsigned int rowMeshes[] = { 0, 6, 1, 3 };
+	unsigned int rowMaterials[] = { 8, 5, 6, 7 };
+	XMFLOAT3 rowBobs[] = { XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 0) };
+	XMFLOAT3 rowSpins[] = { XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 0), XMFLOAT3(0, 1, 0) };
+	EntityId row[4];
 	for (int i = 0; i < 4; i++)
 	{
-		entities[i]->GetTransform()->SetPosition(DirectX::XMFLOAT3(-7.5f + 5 * i, 0, 5));
-		entityPositions[i] = entities[i]->GetTransform()->GetPosition();
+		row[i] = entities->Create(DRAWN_COMPONENTS | ENTITY_MOTION);
+		entities->SetMesh(row[i], rowMeshes[i]);
+		entities->SetMaterial(row[i], rowMaterials[i]);
+
+		XMFLOAT3 position(-7.5f + 5 * i, 0, 5);
+		transforms.SetPosition(entities->GetTransform(row[i]), position);
+		entities->SetMotion(row[i], { position, rowBobs[i], rowSpins[i] });
 	}
 
-	entities[4] = std::make_shared<GameEntity>(meshes[5], std::make_shared<Material>(materials[11]));
-	entities[4]->GetTransform()->SetPosition(DirectX::XMFLOAT3(0, -2.5f, 0));
-	entities[4]->GetTransform()->SetScale(DirectX::XMFLOAT3(20, 20, 20));
+	EntityId ground = entities->Create(DRAWN_COMPONENTS);
+	entities->SetMesh(ground, 5);
+	entities->SetMaterial(ground, 11);
+	transforms.SetPosition(entities->GetTransform(ground), XMFLOAT3(0, -2.5f, 0));
+	transforms.SetScale(entities->GetTransform(ground), XMFLOAT3(20, 20, 20));
+
+	//a small sphere riding on the helix, it turns with it without being moved by hand
+	EntityId moon = entities->Create(DRAWN_COMPONENTS);
+	entities->SetMesh(moon, 0);
+	entities->SetMaterial(moon, 8);
+	TransformHierarchy::GetDefault().SetParent(entities->GetTransform(moon), entities->GetTransform(row[3]));
+	transforms.SetPosition(entities->GetTransform(moon), XMFLOAT3(1.5f, 1.0f, 0));
+	transforms.SetScale(entities->GetTransform(moon), XMFLOAT3(0.35f, 0.35f, 0.35f));
 
 	//create Skybox
 	sky = std::make_shared<Sky>(meshes[1], samplerState, device, skyVS, skyPS);
-	sky->SetShaderResourceView(cloudsBlueSRV);
+	SetSky(0);
 
 }
 
@@ -1043,17 +1052,19 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
 
+	//swap in any meshes that finished importing since last frame
+	meshRegistry->Update();
+
+	//the UI edits entities directly (and ImGui is single threaded), so it's done before the systems start
 	BuildUi();
-	//update shader camera values
 
-	cameras[activeCameraIndex]->UpdateViewMatrix();
+	//input and the window size are read here, the systems only get what they need from them
+	cameraInput = cameras[activeCameraIndex]->SampleInput(deltaTime);
 	cameras[activeCameraIndex]->UpdateProjectionMatrix(float(windowWidth) / float(windowHeight));
-	cameras[activeCameraIndex]->Update(deltaTime);
 
-	entities[0]->GetTransform()->SetPosition(DirectX::XMFLOAT3(entities[0]->GetTransform()->GetPosition().x, sin(totalTime), 5));
-	entities[1]->GetTransform()->SetRotation(0, 0, totalTime);
-	entities[2]->GetTransform()->SetPosition(DirectX::XMFLOAT3(entities[2]->GetTransform()->GetPosition().x, 0, 5 +  sin(totalTime)));
-	entities[3]->GetTransform()->SetRotation(0, totalTime, 0);
+	//camera, scripted movement and matrices
+	systemTotalTime = totalTime;
+	scheduler->Run();
 
 	/*
 		//When using DirectXMath, need to:
@@ -1100,6 +1111,18 @@ void Game::Draw(float deltaTime, float totalTime)
 		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 	}
 
+	//pick each entity's level of detail before any pass draws it, and ask for the texture detail that size needs
+	const std::vector<EntityArchetype*>& drawn = entities->Query(DRAWN_COMPONENTS);
+	for (EntityArchetype* archetype : drawn)
+	{
+		for (unsigned int i = 0; i < archetype->GetCount(); i++)
+		{
+			UpdateEntityLod(archetype->transforms[i], meshes[archetype->meshes[i]].get(), archetype->bounds[i], archetype->lods[i]);
+			materials[archetype->materials[i]].RequestTextureDetail(archetype->lods[i].projectedSize);
+		}
+	}
+	textureStreamer->Update();
+
 	//clear the shadow map depth stencil view
 	context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 
@@ -1134,16 +1157,25 @@ void Game::Draw(float deltaTime, float totalTime)
 	context->RSSetState(shadowRasterizer.Get());
 
 	PBRps->SetSamplerState("ShadowSampler", shadowSampler);
+	PBRps->SetSamplerState("EnvironmentSampler", ppSampler);
 
 	//loop through and create shadow map
-	for (unsigned int i = 0; i < entityCount; i++)
+	TransformHierarchy& hierarchy = TransformHierarchy::GetDefault();
+	for (EntityArchetype* archetype : drawn)
 	{
-		//set vertex shader data
-		shadowVS->SetMatrix4x4("world", entities[i]->GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		for (unsigned int i = 0; i < archetype->GetCount(); i++)
+		{
+			Mesh* mesh = meshes[archetype->meshes[i]].get();
+
+			//set vertex shader data
+			shadowVS->SetMatrix4x4("world", hierarchy.GetWorldMatrix(archetype->transforms[i]));
+			shadowVS->SetFloat3("positionOffset", mesh->GetQuantization().positionOffset);
+			shadowVS->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+			shadowVS->CopyAllBufferData();
 
-		//draw the entities through the mesh to avoid resetting shaders and materials
-		entities[i]->GetMesh()->Draw(context);
+			//draw the entities through the mesh to avoid resetting shaders and materials
+			mesh->Draw(context, archetype->lods[i].lod);
+		}
 	}
 
 	//reset the pipeline
@@ -1180,19 +1212,23 @@ void Game::Draw(float deltaTime, float totalTime)
 	nvs->SetMatrix4x4("lightProjMatrix", projMatrix);
 	PBRps->SetShaderResourceView("ShadowMap", shadowSRV);
 	//loop through list of entities drawing each
-	for (unsigned int i = 0; i < entityCount; i++)
+	for (EntityArchetype* archetype : drawn)
 	{
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("viewMatrix", cameras[activeCameraIndex]->GetView());
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("projectionMatrix", cameras[activeCameraIndex]->GetProjection());
-
-		entities[i]->GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * lights.size());
-		entities[i]->GetMaterial()->GetPixelShader()->SetInt("numLights", lights.size());
-		if (!entities[i]->GetMaterial()->GetPBR())
+		for (unsigned int i = 0; i < archetype->GetCount(); i++)
 		{
-			entities[i]->GetMaterial()->GetPixelShader()->SetFloat3("ambientColor", ambientColor);
+			Material& material = materials[archetype->materials[i]];
+			material.GetVertexShader()->SetMatrix4x4("viewMatrix", cameras[activeCameraIndex]->GetView());
+			material.GetVertexShader()->SetMatrix4x4("projectionMatrix", cameras[activeCameraIndex]->GetProjection());
+
+			material.GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * lights.size());
+			material.GetPixelShader()->SetInt("numLights", lights.size());
+			material.GetPixelShader()->SetFloat("ambientIntensity", ambientIntensity);
+			material.GetPixelShader()->SetShaderResourceView("SkyIrradianceSH", sky->GetIrradianceSRV());
+			material.GetPixelShader()->SetShaderResourceView("PrefilteredSky", sky->GetPrefilteredSRV());
+			material.GetPixelShader()->SetShaderResourceView("BrdfLut", brdfLutSRV);
+
+			DrawEntity(archetype->transforms[i], meshes[archetype->meshes[i]].get(), material, archetype->lods[i], totalTime);
 		}
-
-		entities[i]->Draw(context, cameras[activeCameraIndex], totalTime);
 	}
 	
 	sky->Draw(context, cameras[activeCameraIndex]);
@@ -1355,40 +1391,135 @@ void Game::BuildUi()
 			ImGui::End();
 		}
 	}
+	if (ImGui::CollapsingHeader("Update Systems"))
+	{
+		//last frame's, this one's systems haven't run yet
+		const FrameReport& report = scheduler->GetReport();
+		ImGui::Text("%d thread(s): %.3f ms, %.3f ms of work (%.2f threads busy on average)", scheduler->GetThreadCount(),
+			report.frameTime, report.workTime, report.frameTime > 0 ? report.workTime / report.frameTime : 0.0f);
+		for (unsigned int i = 0; i < scheduler->GetSystemCount(); i++)
+		{
+			const FrameSystemTiming& timing = report.systems[i];
+			ImGui::Text("%s: %d item(s) in %d chunk(s), ready %.3f, ran %.3f - %.3f ms, %.3f ms of work", scheduler->GetSystem(i).name,
+				timing.items, timing.chunks, timing.ready, timing.start, timing.end, timing.work);
+		}
+
+		std::string path;
+		for (unsigned int system : report.criticalPath)
+			path += (path.empty() ? "" : " > ") + std::string(scheduler->GetSystem(system).name);
+		ImGui::Text("Critical path: %s (%.3f ms running)", path.c_str(), report.criticalPathWork);
+	}
 	if (ImGui::CollapsingHeader("Meshes"))
 	{
-		for (unsigned int i = 0; i < meshCount; i++)
+		ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.1f, 20.0f);
+		ImGui::Text("%d mesh(es) registered, %d still loading", meshRegistry->GetMeshCount(), meshRegistry->GetPendingCount());
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			ImGui::Text("Mesh %d: %d triangle(s), %d vertices%s", i, meshes[i]->GetIndexCount() / 3, meshes[i]->GetVertexCount(),
+				meshes[i]->IsReady() ? "" : " (placeholder)");
+			ImGui::Text("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+				meshes[i]->GetCacheStatsBefore().acmr, meshes[i]->GetCacheStatsAfter().acmr,
+				meshes[i]->GetCacheStatsBefore().atvr, meshes[i]->GetCacheStatsAfter().atvr);
+			ImGui::Text("  %d bit indices, packing error: position %.5f, normal %.3f deg, tangent %.3f deg, uv %.5f",
+				meshes[i]->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? 16 : 32,
+				meshes[i]->GetPackingError().position, meshes[i]->GetPackingError().normalDegrees,
+				meshes[i]->GetPackingError().tangentDegrees, meshes[i]->GetPackingError().uv);
+			ImGui::Text("  Bounds (%.2f, %.2f, %.2f) - (%.2f, %.2f, %.2f), sphere radius %.3f",
+				meshes[i]->GetBounds().boxMin.x, meshes[i]->GetBounds().boxMin.y, meshes[i]->GetBounds().boxMin.z,
+				meshes[i]->GetBounds().boxMax.x, meshes[i]->GetBounds().boxMax.y, meshes[i]->GetBounds().boxMax.z,
+				meshes[i]->GetBounds().sphereRadius);
+			if (meshes[i]->GetMeshletCount() > 0)
+				ImGui::Text("  %d meshlet(s)", meshes[i]->GetMeshletCount());
+			for (unsigned int lod = 1; lod < meshes[i]->GetLodCount(); lod++)
+				ImGui::Text("  LOD %d: %d triangle(s), error %.4f", lod, meshes[i]->GetLod(lod).indexCount / 3, meshes[i]->GetLod(lod).error);
+		}
+	}
+	if (ImGui::CollapsingHeader("Textures"))
+	{
+		size_t totalBytes = 0;
+		size_t separateBytes = 0;
+		for (const TextureLoadStats& stats : textureLoadStats)
+		{
+			totalBytes += stats.bytes;
+			separateBytes += stats.separateBytes;
+		}
+		ImGui::Text("%d texture(s) loaded in %.1f ms", (int)textureLoadStats.size(), textureLoadMilliseconds);
+		ImGui::Text("%.1f MB (%.1f MB cooked one texture per map)", totalBytes / 1048576.0f, separateBytes / 1048576.0f);
+
+		AssetCacheStats cacheStats = assetCache->GetStats();
+		ImGui::Text("Asset cache: %d hit(s), %d cooked, %d of %d source(s) unchanged", cacheStats.hits, cacheStats.misses,
+			cacheStats.sourcesUnchanged, cacheStats.sourcesUnchanged + cacheStats.sourcesHashed);
+		ImGui::Text("  %d duplicate payload(s) shared, %.1f MB saved", cacheStats.duplicates, cacheStats.duplicateBytes / 1048576.0f);
+
+		TextureResidency& residency = textureStreamer->GetResidency();
+		if (ImGui::SliderInt("Texture Budget (MB)", &textureBudgetMegabytes, 1, 128))
+			residency.SetBudget((size_t)textureBudgetMegabytes * 1024 * 1024);
+		unsigned int reduced = 0;
+		for (unsigned int i = 0; i < residency.GetTextureCount(); i++)
+		{
+			if (residency.GetTexture(i).residentMip > 0)
+				reduced++;
+		}
+		ImGui::Text("%.1f MB resident, %d level change(s) streaming", residency.GetResidentBytes() / 1048576.0f, textureStreamer->GetPendingCount());
+		ImGui::Text("%d of %d streamed texture(s) below full detail", reduced, residency.GetTextureCount());
+		for (const TextureLoadStats& stats : textureLoadStats)
+		{
+			ImGui::Text("%s: %dx%d %s, decode %.2f ms, upload %.2f ms%s",
+				std::filesystem::path(stats.fileName).filename().u8string().c_str(), stats.width, stats.height,
+				GetTextureFormatName(stats.format), stats.decodeMilliseconds, stats.uploadMilliseconds,
+				!stats.decoded ? " (failed)" : stats.cached ? " (cached)" : "");
+			if (stats.atlasEfficiency > 0.0f)
+				ImGui::Text("  atlas %.0f%% filled", stats.atlasEfficiency * 100.0f);
+		}
+	}
+	if (ImGui::CollapsingHeader("Sky"))
+	{
+		int picked = activeSky;
+		if (ImGui::Combo("Sky", &picked, SKY_NAMES, skyCount) && picked != activeSky)
+			SetSky(picked);
+		for (int i = 0; i < skyCount; i++)
 		{
-			ImGui::Text("Mesh %d: %d triangle(s)", i, meshes[i]->GetIndexCount() / 3);
+			if (skyMissing[i])
+				ImGui::Text("%s is missing faces", SKY_NAMES[i]);
 		}
+		ImGui::SliderFloat("Ambient Intensity", &ambientIntensity, 0.0f, 2.0f);
+		ImGui::Text("Irradiance projected in %.2f ms, last switch took %.2f ms", sky->GetProjectionMilliseconds(), skySwitchMilliseconds);
+		ImGui::Text("Specular prefiltered in %.2f ms%s, BRDF LUT%s", skyBakeMilliseconds,
+			skyBakeCached ? " (cached)" : "", brdfLutCached ? " cached" : " baked");
 	}
 	if (ImGui::CollapsingHeader("Edit Entity Values"))
 	{
-		for (unsigned int i = 0; i < entityCount; i++)
+		TransformStore& transforms = TransformStore::GetDefault();
+		for (EntityArchetype* archetype : entities->Query(ENTITY_TRANSFORM))
 		{
-
-			if (ImGui::TreeNode(("Entity " + std::to_string(i + 1)).c_str()))
+			for (unsigned int i = 0; i < archetype->GetCount(); i++)
 			{
-				entityPositions[i] = entities[i]->GetTransform()->GetPosition();
-
-				ImGui::DragFloat3("Position", reinterpret_cast<float*>(&entityPositions[i]), 0.1f);
-
-				entities[i]->GetTransform()->SetPosition(entityPositions[i]);
-
-				entityRotations[i] = entities[i]->GetTransform()->GetPitchYawRoll();
-
-				ImGui::DragFloat3("Rotation", reinterpret_cast<float*>(&entityRotations[i]), 0.1f);
-
-				entities[i]->GetTransform()->SetRotation(entityRotations[i]);
-
-				entityScales[i] = entities[i]->GetTransform()->GetScale();
-
-				ImGui::DragFloat3("Scale", reinterpret_cast<float*>(&entityScales[i]), 0.1f);
+				if (ImGui::TreeNode(("Entity " + std::to_string(archetype->ids[i].index + 1)).c_str()))
+				{
+					if ((archetype->components & DRAWN_COMPONENTS) == DRAWN_COMPONENTS)
+					{
+						Mesh* mesh = meshes[archetype->meshes[i]].get();
+						ImGui::Text("LOD: %d", archetype->lods[i].lod);
+						if (mesh->GetMeshletCount() > 0)
+							ImGui::Text("Meshlets drawn: %d / %d", archetype->lods[i].visibleMeshlets, mesh->GetMeshletCount());
+					}
 
-				entities[i]->GetTransform()->SetScale(entityScales[i]);
-				ImGui::TreePop();
+					//only written back when dragged, so the rotation isn't pushed through the euler conversion every frame
+					unsigned int transform = archetype->transforms[i];
+					XMFLOAT3 position = transforms.GetPosition(transform);
+					if (ImGui::DragFloat3("Position", reinterpret_cast<float*>(&position), 0.1f))
+						transforms.SetPosition(transform, position);
+
+					XMFLOAT3 rotation = transforms.GetPitchYawRoll(transform);
+					if (ImGui::DragFloat3("Rotation", reinterpret_cast<float*>(&rotation), 0.1f))
+						transforms.SetPitchYawRoll(transform, rotation);
+
+					XMFLOAT3 scale = transforms.GetScale(transform);
+					if (ImGui::DragFloat3("Scale", reinterpret_cast<float*>(&scale), 0.1f))
+						transforms.SetScale(transform, scale);
+					ImGui::TreePop();
+				}
 			}
-
 		}
 	}
 	if (ImGui::CollapsingHeader("Lights"))
@@ -1501,10 +1632,11 @@ void Game::BuildUi()
 //   for assignments, given that you clearly cite that this is not
 //   code of your own design.
 //
-// - Note: This code assumes youre putting the function in Sky.cpp, 
-//   youve included WICTextureLoader.h and you have an ID3D11Device 
-//   ComPtr called device.  Make any adjustments necessary for
-//   your own implementation.
+// - Note: This version lives in Game.cpp, decodes the faces with
+//   LoadPng from PngDecoder.h (not WICTextureLoader.h) and hands the
+//   decoded faces back, so the sky's irradiance and specular bakes
+//   can read them.  It uses Game's ID3D11Device ComPtr, "device",
+//   and returns nullptr when a face is missing or doesn't match.
 // --------------------------------------------------------
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
 	const wchar_t* right,
@@ -1512,24 +1644,24 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
 	const wchar_t* up,
 	const wchar_t* down,
 	const wchar_t* front,
-	const wchar_t* back)
+	const wchar_t* back,
+	TextureData faces[6])
 {
-	// Load the 6 textures into an array.
-	// - We need references to the TEXTURES, not SHADER RESOURCE VIEWS!
+	// Decode the 6 textures on the worker threads.
+	// - Decoded on the CPU rather than through WIC, so the sky can project its irradiance from them
 	// - Explicitly NOT generating mipmaps, as we don't need them for the sky!
 	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[6] = {};
-	CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)textures[0].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)textures[1].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)textures[2].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
+	const wchar_t* fileNames[6] = { right, left, up, down, front, back };
+	bool decoded[6] = {};
+	ParallelFor(6, [&](unsigned int i) { decoded[i] = LoadPng(fileNames[i], faces[i]); });
 
 	// We'll assume all of the textures are the same color format and resolution,
-	// so get the description of the first texture
-	D3D11_TEXTURE2D_DESC faceDesc = {};
-	textures[0]->GetDesc(&faceDesc);
+	// but a face that's missing (or doesn't match) means there's no cube at all
+	for (int i = 0; i < 6; i++)
+	{
+		if (!decoded[i] || faces[i].format != faces[0].format || faces[i].width != faces[0].width || faces[i].height != faces[0].height)
+			return nullptr;
+	}
 
 	// Describe the resource for the cube map, which is simply 
 	// a "texture 2d array" with the TEXTURECUBE flag set.  
@@ -1539,41 +1671,30 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
 	cubeDesc.ArraySize = 6;            // Cube map!
 	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE; // We'll be using as a texture in a shader
 	cubeDesc.CPUAccessFlags = 0;       // No read back
-	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
-	cubeDesc.Width = faceDesc.Width;   // Match the size
-	cubeDesc.Height = faceDesc.Height; // Match the size
+	cubeDesc.Format = faces[0].format == TEXTURE_FORMAT_R8 ? DXGI_FORMAT_R8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM; // What the decoder produced
+	cubeDesc.Width = faces[0].width;   // Match the size
+	cubeDesc.Height = faces[0].height; // Match the size
 	cubeDesc.MipLevels = 1;            // Only need 1
 	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // This should be treated as a CUBE, not 6 separate textures
-	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE; // Filled in once, right here
 	cubeDesc.SampleDesc.Count = 1;
 	cubeDesc.SampleDesc.Quality = 0;
 
-	// Create the final texture resource to hold the cube map
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
-	device->CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
-
-	// Loop through the individual face textures and copy them,
-	// one at a time, to the cube map texure
+	// One subresource per face (each has only the one mip)
+	D3D11_SUBRESOURCE_DATA faceData[6] = {};
 	for (int i = 0; i < 6; i++)
 	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,  // Which mip (zero, since there's only one)
-			i,  // Which array element?
-			1); // How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		context->CopySubresourceRegion(
-			cubeMapTexture.Get(),  // Destination resource
-			subresource,           // Dest subresource index (one of the array elements)
-			0, 0, 0,               // XYZ location of copy
-			textures[i].Get(),     // Source resource
-			0,                     // Source subresource index (we're assuming there's only one)
-			0);                    // Source subresource "box" of data to copy (zero means the whole thing)
+		faceData[i].pSysMem = faces[i].GetMipData(0);
+		faceData[i].SysMemPitch = faces[i].mips[0].rowPitch;
 	}
 
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
+	// Create the final texture resource to hold the cube map, with the faces as its initial data
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
+	if (FAILED(device->CreateTexture2D(&cubeDesc, faceData, cubeMapTexture.GetAddressOf())))
+		return nullptr;
+
+	// At this point, all of the faces are in the cube map 
+	// texture, so we can describe a shader resource view for it
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = cubeDesc.Format;         // Same format as texture
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
@@ -1587,3 +1708,255 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
 	// Send back the SRV, which is what we need for our shaders
 	return cubeSRV;
 }
+
+void Game::SetSky(int index)
+{
+	if (skyMissing[index])
+		return;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (skySRVs[index])
+	{
+		//already projected, so switching back only recreates the tiny irradiance buffer
+		sky->SetShaderResourceView(skySRVs[index], skyIrradiance[index]);
+	}
+	else
+	{
+		std::string name = SKY_NAMES[index];
+		std::wstring folder = FixPath(L"../../Assets/Skies/" + std::wstring(name.begin(), name.end()) + L"/");
+		std::filesystem::path fileNames[6] = {
+			folder + L"right.png", folder + L"left.png", folder + L"up.png",
+			folder + L"down.png", folder + L"front.png", folder + L"back.png" };
+		TextureData faces[6];
+		skySRVs[index] = CreateCubemap(
+			fileNames[0].c_str(),
+			fileNames[1].c_str(),
+			fileNames[2].c_str(),
+			fileNames[3].c_str(),
+			fileNames[4].c_str(),
+			fileNames[5].c_str(),
+			faces);
+
+		//a sky that can't be loaded is just left out, the current one stays
+		if (!skySRVs[index])
+		{
+			skyMissing[index] = true;
+			return;
+		}
+
+		const TextureData* faceList[6] = { &faces[0], &faces[1], &faces[2], &faces[3], &faces[4], &faces[5] };
+		sky->SetShaderResourceView(skySRVs[index], faceList);
+		skyIrradiance[index] = sky->GetIrradiance();
+
+		//specular light, only prefiltered the first time these faces are seen (see CookEnvironment)
+		std::chrono::steady_clock::time_point bakeStart = std::chrono::steady_clock::now();
+		TextureData prefiltered[6];
+		TextureCookInfo bakeInfo;
+		if (CookEnvironment(fileNames, faceList, EnvironmentSettings(), assetCache.get(), prefiltered, &bakeInfo))
+			CreateCubeTextureFromData(device, prefiltered, skyPrefilteredSRVs[index].GetAddressOf());
+		skyBakeMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bakeStart).count();
+		skyBakeCached = bakeInfo.cacheHit;
+	}
+	sky->SetPrefilteredSRV(skyPrefilteredSRVs[index]);
+	activeSky = index;
+	skySwitchMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Declares the work Update hands to the scheduler.  The
+// camera only sets its own slot of the transform store,
+// and the store lets different slots be set at once, so it
+// runs alongside scripted movement (split into chunks of
+// rows); the matrix rebuild waits for both, since it
+// rebuilds every slot they moved.
+// --------------------------------------------------------
+void Game::CreateSystems()
+{
+	scheduler = std::make_shared<FrameScheduler>();
+
+	FrameSystem camera = {};
+	camera.name = "Camera";
+	camera.writes = FRAME_RESOURCE_CAMERA;
+	camera.run = [this](unsigned int, unsigned int) { cameras[activeCameraIndex]->Update(cameraInput); };
+	scheduler->AddSystem(camera);
+
+	FrameSystem motion = {};
+	motion.name = "Motion";
+	motion.reads = ENTITY_MOTION;
+	motion.writes = ENTITY_TRANSFORM;
+	motion.count = [this]()
+	{
+		unsigned int count = 0;
+		for (EntityArchetype* archetype : entities->Query(ENTITY_TRANSFORM | ENTITY_MOTION))
+			count += archetype->GetCount();
+		return count;
+	};
+	motion.chunkSize = 1024;
+	motion.run = [this](unsigned int begin, unsigned int end) { UpdateMotion(begin, end); };
+	scheduler->AddSystem(motion);
+
+	//rebuild every matrix touched this frame in one batch, instead of one at a time as they're drawn,
+	//then carry them down to the children of whatever moved
+	FrameSystem matrices = {};
+	matrices.name = "Transform matrices";
+	matrices.writes = ENTITY_TRANSFORM | FRAME_RESOURCE_CAMERA;
+	matrices.run = [](unsigned int, unsigned int) { TransformHierarchy::GetDefault().UpdateMatrices(); };
+	scheduler->AddSystem(matrices);
+}
+
+// --------------------------------------------------------
+// Scripted movement for a chunk of the entities that have
+// some.  Chunks may run at once, each setting only its own
+// rows' transforms.
+// --------------------------------------------------------
+void Game::UpdateMotion(unsigned int begin, unsigned int end)
+{
+	//the count already ran this query, so it's a lookup of the cached list here
+	TransformStore& transforms = TransformStore::GetDefault();
+	float wave = sin(systemTotalTime);
+	unsigned int first = 0;
+	for (EntityArchetype* archetype : entities->Query(ENTITY_TRANSFORM | ENTITY_MOTION))
+	{
+		unsigned int count = archetype->GetCount();
+		for (unsigned int i = begin > first ? begin - first : 0; i < count && first + i < end; i++)
+		{
+			const EntityMotion& motion = archetype->motions[i];
+			unsigned int transform = archetype->transforms[i];
+			if (motion.bob.x != 0 || motion.bob.y != 0 || motion.bob.z != 0)
+			{
+				XMFLOAT3 position = transforms.GetPosition(transform);
+				if (motion.bob.x != 0)
+					position.x = motion.origin.x + motion.bob.x * wave;
+				if (motion.bob.y != 0)
+					position.y = motion.origin.y + motion.bob.y * wave;
+				if (motion.bob.z != 0)
+					position.z = motion.origin.z + motion.bob.z * wave;
+				transforms.SetPosition(transform, position);
+			}
+			if (motion.spin.x != 0 || motion.spin.y != 0 || motion.spin.z != 0)
+				transforms.SetPitchYawRoll(transform, XMFLOAT3(motion.spin.x * systemTotalTime, motion.spin.y * systemTotalTime, motion.spin.z * systemTotalTime));
+		}
+
+		first += count;
+		if (first >= end)
+			break;
+	}
+}
+
+// --------------------------------------------------------
+// World bounds of an entity, rebuilt only when its matrix
+// or its mesh's data changed since they were last built
+// --------------------------------------------------------
+Bounds Game::GetEntityBounds(unsigned int transform, Mesh* mesh, EntityBounds& bounds)
+{
+	TransformHierarchy& hierarchy = TransformHierarchy::GetDefault();
+	unsigned int version = hierarchy.GetWorldVersion(transform);
+	unsigned int meshVersion = mesh->GetUploadVersion();
+	if (!bounds.valid || version != bounds.transformVersion || meshVersion != bounds.meshVersion)
+	{
+		XMFLOAT4X4 world = hierarchy.GetWorldMatrix(transform);
+		bounds.world = TransformBounds(XMLoadFloat4x4(&world), mesh->GetBounds());
+		bounds.transformVersion = version;
+		bounds.meshVersion = meshVersion;
+		bounds.valid = true;
+	}
+	return bounds.world;
+}
+
+// --------------------------------------------------------
+// Picks an entity's level of detail from the size of its
+// bounding sphere on the active camera's screen
+// --------------------------------------------------------
+void Game::UpdateEntityLod(unsigned int transform, Mesh* mesh, EntityBounds& bounds, EntityLod& lod)
+{
+	std::shared_ptr<Camera> camera = cameras[activeCameraIndex];
+	Bounds world = GetEntityBounds(transform, mesh, bounds);
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(
+		XMVectorSubtract(XMLoadFloat3(&world.sphereCenter), XMLoadFloat3(&cameraPosition))));
+	float radius = world.sphereRadius;
+
+	//full detail whenever the camera is inside the sphere
+	if (distance <= radius)
+	{
+		lod.lod = 0;
+		lod.projectedSize = FLT_MAX;
+		return;
+	}
+
+	//_22 of a perspective projection is cot(fov / 2), which turns view space size into screen size
+	float projectedRadius = radius * camera->GetProjection()._22 * windowHeight * 0.5f / distance;
+	lod.lod = mesh->SelectLod(projectedRadius, lod.lod, lodPixelError);
+	lod.projectedSize = projectedRadius * 2.0f;
+}
+
+// --------------------------------------------------------
+// Draws one entity with its material, culling the full
+// detail level's meshlets against the active camera
+// --------------------------------------------------------
+void Game::DrawEntity(unsigned int transform, Mesh* mesh, Material& material, EntityLod& lod, float totalTime)
+{
+	std::shared_ptr<Camera> camera = cameras[activeCameraIndex];
+	TransformHierarchy& hierarchy = TransformHierarchy::GetDefault();
+
+	material.GetVertexShader()->SetShader();
+	material.GetPixelShader()->SetShader();
+	material.PrepareMaterial();
+
+	//provide data for vertex shader's cbuffer(s)
+	material.GetVertexShader()->SetMatrix4x4("worldMatrix", hierarchy.GetWorldMatrix(transform));
+	material.GetVertexShader()->SetMatrix4x4("worldInvTranspose", hierarchy.GetWorldInverseTransposeMatrix(transform));
+	material.GetVertexShader()->SetFloat3("positionOffset", mesh->GetQuantization().positionOffset);
+	material.GetVertexShader()->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+
+	//copy data to gpu
+	material.GetVertexShader()->CopyAllBufferData();
+
+	if (!material.GetPBR())
+	{
+		material.GetPixelShader()->SetFloat("roughness", material.GetRoughness());
+	}
+
+	material.GetPixelShader()->SetFloat4("colorTint", material.GetColorTint());
+	material.GetPixelShader()->SetFloat("totalTime", totalTime);
+	material.GetPixelShader()->SetFloat3("cameraPos", camera->GetTransform()->GetPosition());
+
+	//copy data to gpu
+	material.GetPixelShader()->CopyAllBufferData();
+
+	//only the full detail level is split into meshlets, coarser levels are small enough to draw whole
+	lod.visibleMeshlets = mesh->GetMeshletCount();
+	if (lod.lod != 0 || lod.visibleMeshlets == 0)
+	{
+		mesh->Draw(context, lod.lod);
+		return;
+	}
+
+	XMFLOAT4X4 world = hierarchy.GetWorldMatrix(transform);
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	//a mirrored world matrix flips which side the rasterizer treats as the front, so the cones don't apply;
+	//the sign of the upper 3x3's determinant (the product of the scales) says whether it's mirrored
+	float determinant = XMVectorGetX(XMVector3Dot(worldMatrix.r[0], XMVector3Cross(worldMatrix.r[1], worldMatrix.r[2])));
+	if (determinant <= 0.0f)
+	{
+		mesh->Draw(context, lod.lod);
+		return;
+	}
+
+	//the hierarchy already has the inverse transpose in closed form, so the inverse is just its transpose
+	XMMATRIX inverseWorld = XMMatrixTranspose(XMLoadFloat4x4(&hierarchy.GetWorldInverseTransposeMatrix(transform)));
+
+	//culling runs in mesh space, so only the planes and the camera get transformed
+	XMFLOAT4 planes[6];
+	ExtractFrustumPlanes(worldMatrix * XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection), planes);
+
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	XMFLOAT3 localCamera;
+	XMStoreFloat3(&localCamera, XMVector3TransformCoord(XMLoadFloat3(&cameraPosition), inverseWorld));
+
+	lod.visibleMeshlets = CullMeshlets(mesh->GetMeshlets(), mesh->GetMeshletCount(), planes, localCamera, visibleRanges);
+	mesh->DrawRanges(context, visibleRanges);
+}
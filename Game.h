@@ -1,13 +1,17 @@
 #pragma once
 
 #include "DXCore.h"
+#include "AssetCache.h"
 #include "Mesh.h"
+#include "MeshRegistry.h"
+#include "TextureLoader.h"
 #include <DirectXMath.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <memory>
 #include "Camera.h"
 #include "SimpleShader.h"
-#include "GameEntity.h"
+#include "EntityStore.h"
+#include "FrameScheduler.h"
 #include "Material.h"
 #include "Light.h"
 #include "Sky.h"
@@ -37,14 +41,31 @@ private:
 	void UpdateImGui(float deltaTime);
 	void BuildUi();
 	void CreateLights();
-	// Helper for creating a cubemap from 6 individual textures
+	// Helper for creating a cubemap from 6 individual textures, decoded into faces (null if one can't be)
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
 		const wchar_t* right,
 		const wchar_t* left,
 		const wchar_t* up,
 		const wchar_t* down,
 		const wchar_t* front,
-		const wchar_t* back);
+		const wchar_t* back,
+		TextureData faces[6]);
+	// Switches to one of the skies, loading it (and projecting its irradiance) the first time
+	void SetSky(int index);
+
+	// Declares the per frame update work (camera, scripted movement, matrices) as systems for the scheduler
+	void CreateSystems();
+	// Scripted movement for rows begin to end, counted across every archetype with motion in query order
+	void UpdateMotion(unsigned int begin, unsigned int end);
+
+	// Per entity work, run over the entity store's columns
+	// - World bounds are rebuilt only when the transform's matrix or the mesh's data changed (a mesh
+	//   still loading in the background gets new bounds when it's uploaded)
+	// - The level of detail comes from the size of the bounding sphere on screen
+	// - Drawing culls the full detail level's meshlets, coarser levels are small enough to draw whole
+	Bounds GetEntityBounds(unsigned int transform, Mesh* mesh, EntityBounds& bounds);
+	void UpdateEntityLod(unsigned int transform, Mesh* mesh, EntityBounds& bounds, EntityLod& lod);
+	void DrawEntity(unsigned int transform, Mesh* mesh, Material& material, EntityLod& lod, float totalTime);
 
 
 	// Note the usage of ComPtr below
@@ -59,13 +80,34 @@ private:
 	char nextWindowTitle[256];
 	char windowTitles[10][256];
 
-	std::shared_ptr<Mesh>* meshes;
-	std::shared_ptr<GameEntity>* entities;
-	DirectX::XMFLOAT3* entityPositions;
-	DirectX::XMFLOAT3* entityRotations;
-	DirectX::XMFLOAT3* entityScales;
-	unsigned int entityCount;
-	unsigned int meshCount;
+	//cooked textures and meshes, shared by the loaders
+	std::shared_ptr<AssetCache> assetCache;
+
+	//every model comes through here, imported in the background and uploaded in Update
+	std::shared_ptr<MeshRegistry> meshRegistry;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+
+	//everything in the scene, whose mesh and material handles index meshes and materials
+	std::shared_ptr<EntityStore> entities;
+
+	//runs the update systems every frame, in parallel wherever they don't touch the same data
+	std::shared_ptr<FrameScheduler> scheduler;
+	float systemTotalTime;		//this frame's time, for the systems to read
+	CameraInput cameraInput;	//sampled before the systems start, Input isn't safe off the main thread
+
+	//meshlet ranges that survived culling for the entity being drawn, kept around so drawing doesn't allocate
+	std::vector<MeshletDrawRange> visibleRanges;
+
+	//largest on-screen error (in pixels) a level of detail may introduce
+	float lodPixelError;
+
+	//per-texture decode and upload times from CreateTextures
+	std::vector<TextureLoadStats> textureLoadStats;
+	float textureLoadMilliseconds;
+
+	//streams texture detail in and out as entities need it, within the budget
+	std::shared_ptr<TextureStreamer> textureStreamer;
+	int textureBudgetMegabytes;
 
 	std::vector<std::shared_ptr<Camera>> cameras;
 	unsigned int activeCameraIndex;
@@ -93,7 +135,8 @@ private:
 
 	std::vector<Material> materials;
 
-	DirectX::XMFLOAT3 ambientColor;
+	//scales the sky's irradiance, the ambient light every surface shader gets
+	float ambientIntensity;
 
 	std::vector<Light> lights;
 	DirectX::XMMATRIX lightViewMatrix;
@@ -105,69 +148,78 @@ private:
 	int shadowMapResolution;
 	
 
+	//small textures are packed into atlases; each remap is its texture's uv scale (xy) and offset (zw) there
 	//used for textures without a specular map
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> fullySpecularSRV;
+	DirectX::XMFLOAT4 fullySpecularRemap;
 
 	//used for textures without a normal map
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> flatNormalSRV;
+	DirectX::XMFLOAT4 flatNormalRemap;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rustyMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rustyMetalSpecularSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> brokenTilesSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> brokenTilesSpecularSRV;
+	DirectX::XMFLOAT4 brokenTilesRemap;
+	DirectX::XMFLOAT4 brokenTilesSpecularRemap;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesSpecularSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cushionSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cushionNormalSRV;
+	DirectX::XMFLOAT4 cushionRemap;
+	DirectX::XMFLOAT4 cushionNormalRemap;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rockSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rockNormalSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughnessSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodOrmSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 
-	//Skies
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cloudsBlueSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cloudsPinkSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> coldSunsetSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> planetSRV;
+	//Skies, each loaded the first time it's picked and kept (with its irradiance and prefiltered cube) for switching back
+	static const int skyCount = 4;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySRVs[skyCount];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyPrefilteredSRVs[skyCount];
+	SH9Color skyIrradiance[skyCount];
+	bool skyMissing[skyCount];
+	int activeSky;
+	float skySwitchMilliseconds;
+	float skyBakeMilliseconds;	//prefiltering (or reading back) the last sky loaded
+	bool skyBakeCached;
+
+	//the split sum's BRDF LUT, shared by every sky
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> brdfLutSRV;
+	bool brdfLutCached;
 
 
 	std::shared_ptr<Sky> sky;
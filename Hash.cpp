@@ -0,0 +1,65 @@
+#include "Hash.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned long long PRIME_1 = 0x9E3779B185EBCA87ull;
+	const unsigned long long PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+	const unsigned long long PRIME_3 = 0x165667B19E3779F9ull;
+
+	unsigned long long Rotate(unsigned long long x, int bits)
+	{
+		return (x << bits) | (x >> (64 - bits));
+	}
+
+	unsigned long long Round(unsigned long long accumulator, unsigned long long input)
+	{
+		accumulator += input * PRIME_2;
+		return Rotate(accumulator, 31) * PRIME_1;
+	}
+
+	unsigned long long Read64(const unsigned char* p)
+	{
+		unsigned long long value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+}
+
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+
+	//four independent lanes keep the multiplies pipelined on big inputs
+	unsigned long long lanes[4] = { seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1 };
+	while (end - p >= 32)
+	{
+		for (int i = 0; i < 4; i++)
+			lanes[i] = Round(lanes[i], Read64(p + i * 8));
+		p += 32;
+	}
+
+	unsigned long long h = Rotate(lanes[0], 1) + Rotate(lanes[1], 7) + Rotate(lanes[2], 12) + Rotate(lanes[3], 18);
+	h += (unsigned long long)size;
+
+	while (end - p >= 8)
+	{
+		h ^= Round(0, Read64(p));
+		h = Rotate(h, 27) * PRIME_1 + PRIME_3;
+		p += 8;
+	}
+	while (p < end)
+	{
+		h ^= (*p++) * PRIME_3;
+		h = Rotate(h, 11) * PRIME_1;
+	}
+
+	//final avalanche so every input bit affects every output bit
+	h ^= h >> 33;
+	h *= PRIME_2;
+	h ^= h >> 29;
+	h *= PRIME_3;
+	h ^= h >> 32;
+	return h;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// Fast 64 bit hash of a block of memory, used to key cached assets on their source data.
+// Not cryptographic - it only needs to notice when a file changes.
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed = 0);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// --------------------------------------------------------
+// Read-only memory mapping of a whole file
+//
+// - Uses CreateFileMapping on Windows and mmap everywhere else
+//   so the asset loaders can run (and be timed) off-device
+// - The mapping stays valid until Close() or destruction
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+	bool Open(const std::filesystem::path& fileName);
+	void Close();
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
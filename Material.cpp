@@ -49,9 +49,16 @@ std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
     return ps;
 }
 
-void Material::AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+void Material::AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, DirectX::XMFLOAT4 uvRemap)
 {
     textureSRVs.insert({ shaderVariableName, srv });
+    textureRemaps.insert({ shaderVariableName + "Remap", uvRemap });
+}
+
+void Material::AddTextureSRV(std::string shaderVariableName, std::shared_ptr<StreamedTexture> texture, DirectX::XMFLOAT4 uvRemap)
+{
+    streamedTextures.insert({ shaderVariableName, texture });
+    textureRemaps.insert({ shaderVariableName + "Remap", uvRemap });
 }
 
 void Material::AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
@@ -59,13 +66,19 @@ void Material::AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr
     samplers.insert({ shaderVariableName, samplerState });
 }
 
-//bind the srvs and samplers before drawing
+//bind the srvs, samplers and uv remaps before drawing
 void Material::PrepareMaterial()
 {
     for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
+    for (auto& t : streamedTextures) { ps->SetShaderResourceView(t.first.c_str(), t.second->view); }
     for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second); }
+    for (auto& r : textureRemaps) { ps->SetFloat4(r.first, r.second); }
 }
 
+void Material::RequestTextureDetail(float projectedSize)
+{
+    for (auto& t : streamedTextures) { t.second->Request(projectedSize); }
+}
 
 void Material::SetRoughness(float roughness)
 {
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 #include <DirectXMath.h>
 #include "SimpleShader.h"
+#include "TextureStreamer.h"
 #include <memory>
 #include <unordered_map>
 
@@ -29,11 +30,17 @@ public:
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 
-	void AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	//uvRemap (scale in xy, offset in zw) goes to the shader as <shaderVariableName>Remap, for textures packed in an atlas
+	void AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, DirectX::XMFLOAT4 uvRemap = DirectX::XMFLOAT4(1, 1, 0, 0));
+	//streamed textures are bound through their handle, which always has the current view
+	void AddTextureSRV(std::string shaderVariableName, std::shared_ptr<StreamedTexture> texture, DirectX::XMFLOAT4 uvRemap = DirectX::XMFLOAT4(1, 1, 0, 0));
 	void AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 	void PrepareMaterial();
 
+	//asks the streamer for enough texture detail to cover an object projectedSize pixels across this frame
+	void RequestTextureDetail(float projectedSize);
+
 	void SetRoughness(float roughness);
 	float GetRoughness();
 
@@ -50,6 +57,9 @@ private:
 	std::shared_ptr<SimplePixelShader> ps;
 
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
+	std::unordered_map<std::string, std::shared_ptr<StreamedTexture>> streamedTextures;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+	//every texture's, even when it's the identity, so one material's remap never carries over to the next
+	std::unordered_map<std::string, DirectX::XMFLOAT4> textureRemaps;
 };
 
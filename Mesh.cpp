@@ -1,233 +1,92 @@
 #include "Mesh.h"
-#include <fstream>
+#include "TangentSpace.h"
+#include <algorithm>
+#include <cstddef>
+#include <d3dcompiler.h>
 #include <vector>
 
-Mesh::Mesh(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount)
+Mesh::Mesh(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount):
+	indexCount(0),
+	vertexCount(0),
+	bounds(),
+	indexFormat(DXGI_FORMAT_R32_UINT),
+	quantization(),
+	packingError(),
+	cacheStatsBefore(),
+	cacheStatsAfter(),
+	uploadVersion(0),
+	ready(false)
 {
-	this->indexCount = indexCount;
-	this->context = context;
-	
-	CalculateTangents(vertices, vertexCount, indices, indexCount);
-	CreateBuffers(device, vertices, vertexCount, &indices[0]);
-	
-}
+	MeshData data;
+	data.lods.push_back({ 0, (unsigned int)indexCount, 0.0f });
 
+	GenerateTangents(vertices, vertexCount, indices, indexCount);
+	std::vector<unsigned int> indexList(indices, indices + indexCount);
+	PackMeshData(std::vector<Vertex>(vertices, vertices + vertexCount), indexList, data);
+	Upload(device, data);
+}
 
-Mesh::Mesh(Microsoft::WRL::ComPtr<ID3D11Device> device, const wchar_t* fileName):
-	indexCount(0)
+Mesh::Mesh(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const wchar_t* fileName,
+	AssetCache* cache,
+	bool optimize,
+	const MeshLodSettings& lodSettings):
+	indexCount(0),
+	vertexCount(0),
+	bounds(),
+	indexFormat(DXGI_FORMAT_R32_UINT),
+	quantization(),
+	packingError(),
+	cacheStatsBefore(),
+	cacheStatsAfter(),
+	uploadVersion(0),
+	ready(false)
 {
+	//all the CPU work lives in ImportMesh, so it can also run on a worker thread (see MeshRegistry)
+	MeshData data;
+	if (ImportMesh(fileName, cache, optimize, lodSettings, data))
+		Upload(device, data);
+}
 
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-
-	// File input object
-	std::ifstream obj(fileName);
+Mesh::Mesh(const std::shared_ptr<Mesh>& placeholder):
+	Mesh(*placeholder)
+{
+	ready = false;
+}
 
-	// Check for successful open
-	if (!obj.is_open())
+void Mesh::Upload(Microsoft::WRL::ComPtr<ID3D11Device> device, const MeshData& data)
+{
+	if (data.indexCount == 0)
 		return;
 
-	// Variables used while reading the file
-	std::vector<DirectX::XMFLOAT3> positions;	// Positions from the file
-	std::vector<DirectX::XMFLOAT3> normals;		// Normals from the file
-	std::vector<DirectX::XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			DirectX::XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			DirectX::XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			DirectX::XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(DirectX::XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.position = positions[i[0] - 1];
-			v1.uv = uvs[i[1] - 1];
-			v1.normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.position = positions[i[3] - 1];
-			v2.uv = uvs[i[4] - 1];
-			v2.normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.position = positions[i[6] - 1];
-			v3.uv = uvs[i[7] - 1];
-			v3.normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.uv.y = 1.0f - v1.uv.y;
-			v2.uv.y = 1.0f - v2.uv.y;
-			v3.uv.y = 1.0f - v3.uv.y;
-
-			// Flip Z (LH vs. RH)
-			v1.position.z *= -1.0f;
-			v2.position.z *= -1.0f;
-			v3.position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.normal.z *= -1.0f;
-			v2.normal.z *= -1.0f;
-			v3.normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.position = positions[i[9] - 1];
-				v4.uv = uvs[i[10] - 1];
-				v4.normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.uv.y = 1.0f - v4.uv.y;
-				v4.position.z *= -1.0f;
-				v4.normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
-	}
-
-	// Close the file and create the actual buffers
-	obj.close();
-
-	indexCount = indexCounter;
-
-	CalculateTangents(&verts[0], verts.size(), &indices[0], indexCount);
-	CreateBuffers(device, &verts[0], vertCounter, &indices[0]);
-
+	lods = data.lods;
+	meshlets = data.meshlets;
+	indexCount = (int)lods[0].indexCount;
+	vertexCount = (int)data.vertexCount;
+	bounds = data.bounds;
+	quantization = data.quantization;
+	packingError = data.packingError;
+	cacheStatsBefore = data.cacheStatsBefore;
+	cacheStatsAfter = data.cacheStatsAfter;
+
+	//new buffers replace (rather than overwrite) the old ones, copies of a placeholder keep theirs
+	vertexBuffer.Reset();
+	indexBuffer.Reset();
+	CreateBuffers(device, data.vertices, data.vertexCount, data.indices, data.indexCount, data.indexStride);
+	uploadVersion++;
+	ready = true;
 }
 
-
-void Mesh::CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* vertices, unsigned int vertexCount, unsigned int* indices)
+void Mesh::CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, const PackedVertex* vertices, unsigned int vertexCount, const void* indices, unsigned int indexCount, unsigned int indexStride)
 {
+	indexFormat = indexStride == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
 	//Vertex Buffer
 	// Create the buffer description.
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE; // no changing after it reaches GPU.
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount; // bytewidth = number of verts * size of single vert.
+	vbd.ByteWidth = sizeof(PackedVertex) * vertexCount; // bytewidth = number of verts * size of single vert.
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
@@ -245,7 +104,7 @@ void Mesh::CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* ve
 	// Create the buffer description.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;
+	ibd.ByteWidth = indexStride * indexCount;
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -261,6 +120,32 @@ void Mesh::CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* ve
 
 }
 
+Microsoft::WRL::ComPtr<ID3D11InputLayout> Mesh::CreateInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device, const wchar_t* vertexShaderFile)
+{
+	//any vertex shader taking VertexShaderInput from ShaderIncludes.hlsli can validate the layout
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	if (FAILED(D3DReadFileToBlob(vertexShaderFile, shaderBlob.GetAddressOf())))
+		return inputLayout;
+
+	D3D11_INPUT_ELEMENT_DESC elements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, offsetof(PackedVertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(PackedVertex, uv), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	device->CreateInputLayout(
+		elements,
+		ARRAYSIZE(elements),
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		inputLayout.GetAddressOf());
+
+	return inputLayout;
+}
+
 Mesh::~Mesh()
 {
 	vertexBuffer.Reset();
@@ -283,111 +168,120 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
-void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context)
+int Mesh::GetVertexCount()
+{
+	return vertexCount;
+}
+
+VertexCacheStats Mesh::GetCacheStatsBefore()
+{
+	return cacheStatsBefore;
+}
+
+VertexCacheStats Mesh::GetCacheStatsAfter()
+{
+	return cacheStatsAfter;
+}
+
+VertexQuantization Mesh::GetQuantization()
+{
+	return quantization;
+}
+
+VertexPackingError Mesh::GetPackingError()
+{
+	return packingError;
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+unsigned int Mesh::GetLodCount()
 {
+	return (unsigned int)lods.size();
+}
+
+MeshLod Mesh::GetLod(unsigned int lod)
+{
+	return lods[lod];
+}
+
+unsigned int Mesh::GetMeshletCount()
+{
+	return (unsigned int)meshlets.size();
+}
+
+const Meshlet* Mesh::GetMeshlets()
+{
+	return meshlets.data();
+}
 
-	UINT stride = sizeof(Vertex);
+Bounds Mesh::GetBounds()
+{
+	return bounds;
+}
+
+bool Mesh::IsReady()
+{
+	return ready;
+}
+
+unsigned int Mesh::GetUploadVersion()
+{
+	return uploadVersion;
+}
+
+unsigned int Mesh::SelectLod(float projectedRadius, unsigned int currentLod, float maxPixelError, float hysteresis)
+{
+	if (bounds.sphereRadius <= 0.0f)
+		return 0;
+
+	//errors only grow along the chain, so stop at the first level that is too coarse
+	unsigned int selected = 0;
+	for (unsigned int i = 1; i < lods.size(); i++)
+	{
+		float pixelError = lods[i].error / bounds.sphereRadius * projectedRadius;
+		float limit = i > currentLod ? maxPixelError * (1.0f - hysteresis) : maxPixelError;
+		if (pixelError > limit)
+			break;
+		selected = i;
+	}
+	return selected;
+}
+
+void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context, unsigned int lod)
+{
+
+	UINT stride = sizeof(PackedVertex);
 	UINT offset = 0;
 
 	//set the vertex buffer
 	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
 	//set the index buffer
-	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+
+	if (lods.empty())
+		return;
+	const MeshLod& level = lods[std::min<size_t>(lod, lods.size() - 1)];
 
 	//call to draw mesh
 	context->DrawIndexed(
-		indexCount,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
+		level.indexCount,     // The number of indices to use (just this level of detail)
+		level.indexStart,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
 
 }
 
-// --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
-// --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::DrawRanges(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<MeshletDrawRange>& ranges)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].tangent = DirectX::XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->position.x - v1->position.x;
-		float y1 = v2->position.y - v1->position.y;
-		float z1 = v2->position.z - v1->position.z;
-					   					
-		float x2 = v3->position.x - v1->position.x;
-		float y2 = v3->position.y - v1->position.y;
-		float z2 = v3->position.z - v1->position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->uv.x - v1->uv.x;
-		float t1 = v2->uv.y - v1->uv.y;
-
-		float s2 = v3->uv.x - v1->uv.x;
-		float t2 = v3->uv.y - v1->uv.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->tangent.x += tx;
-		v1->tangent.y += ty;
-		v1->tangent.z += tz;
-
-		v2->tangent.x += tx;
-		v2->tangent.y += ty;
-		v2->tangent.z += tz;
-
-		v3->tangent.x += tx;
-		v3->tangent.y += ty;
-		v3->tangent.z += tz;
-	}
+	UINT stride = sizeof(PackedVertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		DirectX::XMVECTOR normal = DirectX::XMLoadFloat3(&verts[i].normal);
-		DirectX::XMVECTOR tangent = DirectX::XMLoadFloat3(&verts[i].tangent);
-		
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = DirectX::XMVector3Normalize(
-			DirectX::XMVectorSubtract(tangent, DirectX::XMVectorMultiply(normal, DirectX::XMVector3Dot(normal, tangent))));
-		
-		// Store the tangent
-		DirectX::XMStoreFloat3(&verts[i].tangent, tangent);
-	}
-}
\ No newline at end of file
+	//neighbouring visible meshlets were already merged, so this is one draw per gap
+	for (const MeshletDrawRange& range : ranges)
+		context->DrawIndexed(range.indexCount, range.indexStart, 0);
+}
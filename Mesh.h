@@ -3,7 +3,15 @@
 #include <wrl/client.h> 
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
 #include "Vertex.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshImporter.h"
+#include "Meshlet.h"
+#include "VertexPacking.h"
 
 class Mesh
 {
@@ -13,28 +21,103 @@ class Mesh
 		Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 
 		int indexCount;
+		int vertexCount;
 
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context;
+		//every level of detail lives in the one index buffer, level 0 is full detail
+		std::vector<MeshLod> lods;
+
+		//clusters of the full detail level for culling, empty for small meshes
+		std::vector<Meshlet> meshlets;
+
+		//mesh space box and sphere, for culling, sorting and picking the level of detail
+		Bounds bounds;
+
+		//16 bit indices whenever the vertex count allows it
+		DXGI_FORMAT indexFormat;
 
-		void CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* vertices, unsigned int vertexCount, unsigned int* indices);
+		//maps the quantized positions in the vertex buffer back to mesh space
+		VertexQuantization quantization;
+		VertexPackingError packingError;
 
-		void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+		//post-transform cache behaviour before and after the optimization pass
+		VertexCacheStats cacheStatsBefore;
+		VertexCacheStats cacheStatsAfter;
+
+		//bumped by every Upload, so anything derived from the mesh data knows to rebuild
+		unsigned int uploadVersion;
+		bool ready;
+
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context;
+
+		void CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, const PackedVertex* vertices, unsigned int vertexCount, const void* indices, unsigned int indexCount, unsigned int indexStride);
 
 	public:
 
 		Mesh(Microsoft::WRL::ComPtr<ID3D11Device> device, Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount);
 
-		Mesh(Microsoft::WRL::ComPtr<ID3D11Device> device, const wchar_t* fileName);
+		//maps the imported mesh from cache when it's there for this source and these options,
+		//otherwise imports the OBJ (building its LOD chain) and stores it in cache for next time
+		Mesh(
+			Microsoft::WRL::ComPtr<ID3D11Device> device,
+			const wchar_t* fileName,
+			AssetCache* cache = nullptr,
+			bool optimize = true,
+			const MeshLodSettings& lodSettings = MeshLodSettings());
 		
+		//stands in for a mesh that is still loading: draws with the placeholder's buffers and data,
+		//but isn't ready until its own data is uploaded
+		explicit Mesh(const std::shared_ptr<Mesh>& placeholder);
+
 		~Mesh();
 
+		//replaces the mesh with imported data and creates its buffers, call on the thread that owns the device
+		void Upload(Microsoft::WRL::ComPtr<ID3D11Device> device, const MeshData& data);
+
+		//false until data has been uploaded (a mesh that failed to import never becomes ready)
+		bool IsReady();
+
+		unsigned int GetUploadVersion();
+
 		Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 		
 		Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 		
+		//index count of the full detail level
 		int GetIndexCount();
+
+		int GetVertexCount();
+
+		VertexCacheStats GetCacheStatsBefore();
+
+		VertexCacheStats GetCacheStatsAfter();
+
+		VertexQuantization GetQuantization();
+
+		VertexPackingError GetPackingError();
+
+		DXGI_FORMAT GetIndexFormat();
+
+		unsigned int GetLodCount();
+
+		MeshLod GetLod(unsigned int lod);
+
+		unsigned int GetMeshletCount();
+
+		const Meshlet* GetMeshlets();
+
+		Bounds GetBounds();
+
+		//coarsest level whose error, scaled by the projected bounding sphere radius (in pixels), stays under
+		//maxPixelError.  Moving to a coarser level than currentLod needs extra headroom so levels don't flicker.
+		unsigned int SelectLod(float projectedRadius, unsigned int currentLod, float maxPixelError, float hysteresis = 0.25f);
+
+		//input layout for PackedVertex, validated against the given compiled vertex shader
+		static Microsoft::WRL::ComPtr<ID3D11InputLayout> CreateInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device, const wchar_t* vertexShaderFile);
 		
-		void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+		void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int lod = 0);
+
+		//draws the full detail level, but only the given index ranges (the survivors of CullMeshlets)
+		void DrawRanges(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<MeshletDrawRange>& ranges);
 
 
 };
@@ -0,0 +1,119 @@
+#include "MeshCache.h"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+
+	// Blobs start on cache line boundaries
+	const unsigned long long BLOB_ALIGNMENT = 64;
+
+	unsigned long long AlignUp(unsigned long long value)
+	{
+		return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+	}
+
+	// The layout of our current PackedVertex struct, which a cache file must match exactly
+	unsigned int GetVertexLayout(MeshCacheAttribute* attributes)
+	{
+		attributes[0] = { 0, MESH_ATTRIBUTE_SHORTN4, (unsigned int)offsetof(PackedVertex, position) };
+		attributes[1] = { 1, MESH_ATTRIBUTE_SHORTN2, (unsigned int)offsetof(PackedVertex, normal) };
+		attributes[2] = { 2, MESH_ATTRIBUTE_HALF2, (unsigned int)offsetof(PackedVertex, uv) };
+		attributes[3] = { 3, MESH_ATTRIBUTE_SHORTN2, (unsigned int)offsetof(PackedVertex, tangent) };
+		return 4;
+	}
+}
+
+bool ReadMeshCache(MappedFile& file, unsigned long long sourceHash, unsigned int flags, const MeshLodSettings& lodSettings, MeshCacheView& view)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.GetData();
+	if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+		header->formatVersion != MESH_CACHE_FORMAT_VERSION ||
+		header->importerVersion != MESH_IMPORTER_VERSION ||
+		header->sourceHash != sourceHash ||
+		header->flags != flags ||
+		memcmp(&header->lodSettings, &lodSettings, sizeof(MeshLodSettings)) != 0)
+		return false;
+
+	MeshCacheAttribute layout[8] = {};
+	unsigned int attributeCount = GetVertexLayout(layout);
+	if (header->vertexStride != sizeof(PackedVertex) ||
+		(header->indexStride != sizeof(unsigned short) && header->indexStride != sizeof(unsigned int)) ||
+		header->attributeCount != attributeCount ||
+		memcmp(header->attributes, layout, sizeof(MeshCacheAttribute) * attributeCount) != 0)
+		return false;
+
+	//make sure a truncated file can't send us reading past the mapping
+	unsigned long long vertexEnd = header->vertexOffset + (unsigned long long)header->vertexCount * header->vertexStride;
+	unsigned long long indexEnd = header->indexOffset + (unsigned long long)header->indexCount * header->indexStride;
+	unsigned long long meshletEnd = header->meshletOffset + (unsigned long long)header->meshletCount * sizeof(Meshlet);
+	if (vertexEnd > file.GetSize() || indexEnd > file.GetSize() || meshletEnd > file.GetSize())
+		return false;
+
+	if (header->lodCount == 0 || header->lodCount > MESH_MAX_LODS)
+		return false;
+	for (unsigned int i = 0; i < header->lodCount; i++)
+		if ((unsigned long long)header->lods[i].indexStart + header->lods[i].indexCount > header->indexCount)
+			return false;
+
+	//meshlets split the full detail level, so none of them may reach into the other levels
+	const Meshlet* meshlets = (const Meshlet*)(file.GetData() + header->meshletOffset);
+	for (unsigned int i = 0; i < header->meshletCount; i++)
+		if ((unsigned long long)meshlets[i].indexStart + meshlets[i].triangleCount * 3ull > header->lods[0].indexCount)
+			return false;
+
+	view.header = header;
+	view.vertices = (const PackedVertex*)(file.GetData() + header->vertexOffset);
+	view.indices = file.GetData() + header->indexOffset;
+	view.meshlets = meshlets;
+	return true;
+}
+
+bool WriteMeshCache(const std::filesystem::path& fileName, MeshCacheHeader header, const PackedVertex* vertices, const void* indices, const Meshlet* meshlets)
+{
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.formatVersion = MESH_CACHE_FORMAT_VERSION;
+	header.importerVersion = MESH_IMPORTER_VERSION;
+	header.vertexStride = sizeof(PackedVertex);
+	memset(header.attributes, 0, sizeof(header.attributes));
+	header.attributeCount = GetVertexLayout(header.attributes);
+
+	unsigned long long vertexBytes = (unsigned long long)header.vertexCount * header.vertexStride;
+	unsigned long long indexBytes = (unsigned long long)header.indexCount * header.indexStride;
+	header.vertexOffset = AlignUp(sizeof(MeshCacheHeader));
+	unsigned long long meshletBytes = (unsigned long long)header.meshletCount * sizeof(Meshlet);
+	header.indexOffset = AlignUp(header.vertexOffset + vertexBytes);
+	header.meshletOffset = AlignUp(header.indexOffset + indexBytes);
+
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::filesystem::path tempName = fileName;
+	tempName += ".tmp";
+
+	{
+		std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		const char padding[BLOB_ALIGNMENT] = {};
+		file.write((const char*)&header, sizeof(header));
+		file.write(padding, header.vertexOffset - sizeof(header));
+		file.write((const char*)vertices, vertexBytes);
+		file.write(padding, header.indexOffset - (header.vertexOffset + vertexBytes));
+		file.write((const char*)indices, indexBytes);
+		file.write(padding, header.meshletOffset - (header.indexOffset + indexBytes));
+		file.write((const char*)meshlets, meshletBytes);
+
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tempName, fileName, error);
+	return !error;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <filesystem>
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "Vertex.h"
+#include "VertexPacking.h"
+
+// Bump whenever the import steps (parse, weld, optimize, meshlets, simplify, tangents, packing) change their output
+#define MESH_IMPORTER_VERSION 6
+
+// Bump whenever the layout of the cache file itself changes
+#define MESH_CACHE_FORMAT_VERSION 5
+
+#define MESH_CACHE_FLAG_OPTIMIZED 0x1
+
+// Storage formats a vertex attribute can use in a cache file
+enum MeshAttributeFormat
+{
+	MESH_ATTRIBUTE_FLOAT3,
+	MESH_ATTRIBUTE_FLOAT2,
+	MESH_ATTRIBUTE_SHORTN4,
+	MESH_ATTRIBUTE_SHORTN2,
+	MESH_ATTRIBUTE_HALF2
+};
+
+// Describes one attribute of the vertices stored in a cache file
+struct MeshCacheAttribute
+{
+	unsigned int semantic;		// 0 position, 1 normal, 2 uv, 3 tangent
+	unsigned int format;		// MeshAttributeFormat
+	unsigned int offset;		// Byte offset within the vertex
+};
+
+// --------------------------------------------------------
+// Header at the start of a binary mesh cache file
+//
+// The vertex, index and meshlet blobs that follow are 64 byte aligned
+// and laid out exactly as the GPU buffers expect, so a
+// memory-mapped cache can be handed straight to CreateBuffer
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	char magic[4];
+	unsigned int formatVersion;
+	unsigned int importerVersion;
+	unsigned int flags;
+	unsigned long long sourceHash;
+
+	unsigned int vertexCount;
+	unsigned int indexCount;	// Every LOD together
+	unsigned int vertexStride;
+	unsigned int indexStride;	// 2 or 4 bytes
+	unsigned int attributeCount;
+	MeshCacheAttribute attributes[8];
+
+	Bounds bounds;
+	VertexQuantization quantization;
+
+	MeshLodSettings lodSettings;
+	unsigned int lodCount;
+	MeshLod lods[MESH_MAX_LODS];
+	unsigned int meshletCount;	// Clusters of the full detail level, 0 when it isn't split
+
+	VertexCacheStats cacheStatsBefore;
+	VertexCacheStats cacheStatsAfter;
+	VertexPackingError packingError;
+
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+	unsigned long long meshletOffset;
+};
+
+// Pointers into a mapped cache file, valid for as long as the file stays mapped
+struct MeshCacheView
+{
+	const MeshCacheHeader* header;
+	const PackedVertex* vertices;
+	const void* indices;
+	const Meshlet* meshlets;
+};
+
+// Checks a mapped cache file against the source hash, importer version, flags, LOD settings and vertex layout
+bool ReadMeshCache(MappedFile& file, unsigned long long sourceHash, unsigned int flags, const MeshLodSettings& lodSettings, MeshCacheView& view);
+
+// Writes a cache file (through a temporary file, so a crash never leaves a half written cache).
+// The header describes the contents (hash, flags, counts, index stride, bounds, quantization, LODs, stats);
+// the magic, versions, vertex layout and blob offsets are filled in here.
+bool WriteMeshCache(const std::filesystem::path& fileName, MeshCacheHeader header, const PackedVertex* vertices, const void* indices, const Meshlet* meshlets);
@@ -0,0 +1,176 @@
+#include "MeshImporter.h"
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include "TangentSpace.h"
+#include <algorithm>
+#include <chrono>
+
+MeshData::MeshData() :
+	bounds(),
+	quantization(),
+	packingError(),
+	cacheStatsBefore(),
+	cacheStatsAfter(),
+	timings(),
+	vertices(nullptr),
+	vertexCount(0),
+	indices(nullptr),
+	indexCount(0),
+	indexStride(sizeof(unsigned int))
+{
+}
+
+void PackMeshData(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, MeshData& data)
+{
+	data.bounds = ComputeBounds(&vertices[0].position, vertices.size(), sizeof(Vertex));
+	data.quantization = ComputeVertexQuantization(data.bounds.boxMin, data.bounds.boxMax);
+
+	data.packedVertices.resize(vertices.size());
+	PackVertices(vertices.data(), vertices.size(), data.quantization, data.packedVertices.data());
+	data.packingError = AnalyzeVertexPacking(vertices, data.packedVertices, data.quantization);
+	data.vertices = data.packedVertices.data();
+	data.vertexCount = (unsigned int)data.packedVertices.size();
+
+	//halve the index buffer when every index fits in 16 bits
+	data.indexCount = (unsigned int)indices.size();
+	if (vertices.size() < 65536)
+	{
+		data.indices16.assign(indices.begin(), indices.end());
+		data.indices = data.indices16.data();
+		data.indexStride = sizeof(unsigned short);
+	}
+	else
+	{
+		data.indices32 = std::move(indices);
+		data.indices = data.indices32.data();
+		data.indexStride = sizeof(unsigned int);
+	}
+}
+
+bool ImportMesh(
+	const wchar_t* fileName,
+	AssetCache* cache,
+	bool optimize,
+	const MeshLodSettings& lodSettings,
+	MeshData& data)
+{
+	unsigned int flags = optimize ? MESH_CACHE_FLAG_OPTIMIZED : 0;
+	unsigned long long sourceHash = 0;
+	unsigned long long key = 0;
+
+	//milliseconds since the last stage ended
+	data.timings = {};
+	std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+	auto endStage = [&]()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		float elapsed = std::chrono::duration<float, std::milli>(now - stageStart).count();
+		stageStart = now;
+		return elapsed;
+	};
+
+	if (cache)
+	{
+		//an unchanged source is never even opened on a hit
+		if (!cache->HashSource(fileName, sourceHash))
+			return false;
+		AssetKey cookKey("mesh", MESH_IMPORTER_VERSION);
+		cookKey.Add(&flags, sizeof(flags));
+		cookKey.Add(&lodSettings, sizeof(lodSettings));
+		cookKey.Add(sourceHash);
+		key = cookKey.GetValue();
+
+		//a valid payload already holds the final buffers, so the data just points into the mapping
+		std::filesystem::path payload;
+		MeshCacheView view;
+		if (cache->Find(key, payload) && data.cache.Open(payload) && ReadMeshCache(data.cache, sourceHash, flags, lodSettings, view) && view.header->indexCount > 0)
+		{
+			data.lods.assign(view.header->lods, view.header->lods + view.header->lodCount);
+			data.meshlets.assign(view.meshlets, view.meshlets + view.header->meshletCount);
+			data.bounds = view.header->bounds;
+			data.quantization = view.header->quantization;
+			data.packingError = view.header->packingError;
+			data.cacheStatsBefore = view.header->cacheStatsBefore;
+			data.cacheStatsAfter = view.header->cacheStatsAfter;
+			data.vertices = view.vertices;
+			data.vertexCount = view.header->vertexCount;
+			data.indices = view.indices;
+			data.indexCount = view.header->indexCount;
+			data.indexStride = view.header->indexStride;
+			data.timings.cache = endStage();
+			return true;
+		}
+		data.cache.Close();
+		data.timings.cache = endStage();
+	}
+
+	MappedFile source;
+	if (!source.Open(fileName))
+		return false;
+
+	ObjData obj;
+	ParseObj(source.GetData(), source.GetSize(), obj);
+	source.Close();
+	data.timings.parse = endStage();
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(obj, verts, indices);
+	data.timings.weld = endStage();
+
+	if (indices.empty())
+		return false;
+
+	data.cacheStatsBefore = AnalyzeVertexCache(indices, verts.size());
+	if (optimize)
+	{
+		//cache order first, then overdraw sorting (which keeps most of the cache order), then fetch order
+		OptimizeVertexCache(indices, verts.size());
+		OptimizeOverdraw(indices, verts, 1.05f);
+
+		//meshlets are grown in that order and reordered locally, so they keep most of both
+		if (indices.size() / 3 >= MESHLET_MIN_MESH_TRIANGLES)
+			BuildMeshlets(indices, verts, data.meshlets);
+
+		OptimizeVertexFetch(verts, indices);
+	}
+	data.cacheStatsAfter = AnalyzeVertexCache(indices, verts.size());
+	data.timings.optimize = endStage();
+
+	//simpler levels are appended to the index list and share the vertices
+	size_t fullIndexCount = indices.size();
+	BuildLodChain(indices, verts, lodSettings, data.lods);
+	data.timings.simplify = endStage();
+
+	//tangents are accumulated through the full detail indices, so welded vertices average their faces
+	GenerateTangents(verts.data(), verts.size(), indices.data(), fullIndexCount);
+	data.timings.tangents = endStage();
+	PackMeshData(verts, indices, data);
+	data.timings.pack = endStage();
+
+	if (cache)
+	{
+		MeshCacheHeader header = {};
+		header.flags = flags;
+		header.sourceHash = sourceHash;
+		header.vertexCount = data.vertexCount;
+		header.indexCount = data.indexCount;
+		header.indexStride = data.indexStride;
+		header.bounds = data.bounds;
+		header.quantization = data.quantization;
+		header.lodSettings = lodSettings;
+		header.lodCount = (unsigned int)data.lods.size();
+		std::copy(data.lods.begin(), data.lods.end(), header.lods);
+		header.cacheStatsBefore = data.cacheStatsBefore;
+		header.cacheStatsAfter = data.cacheStatsAfter;
+		header.packingError = data.packingError;
+		header.meshletCount = (unsigned int)data.meshlets.size();
+		std::filesystem::path cooked = cache->GetTemporaryFileName(L".mesh");
+		std::filesystem::path payload;
+		if (WriteMeshCache(cooked, header, data.vertices, data.indices, data.meshlets.data()))
+			cache->Store(key, cooked, payload);
+		data.timings.cache += endStage();
+	}
+
+	return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include "AssetCache.h"
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "Vertex.h"
+#include "VertexPacking.h"
+
+// Where an import's time went, in milliseconds (a cache hit only spends cache time)
+struct MeshImportTimings
+{
+	float cache;		// Looking the payload up, and storing it after a miss
+	float parse;		// Mapping and parsing the OBJ text
+	float weld;
+	float optimize;		// Vertex cache, overdraw, meshlets and fetch order
+	float simplify;		// The LOD chain
+	float tangents;
+	float pack;
+};
+
+// --------------------------------------------------------
+// Everything a Mesh needs except its device buffers
+//
+// - Built entirely on the CPU, so importing can run on any
+//   thread (and be timed) without a device
+// - vertices/indices point either into the mapped cache
+//   file or into the owned arrays below, so a cache hit is
+//   never copied before it reaches the GPU
+// - Not copyable (it may own a file mapping)
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	Bounds bounds;
+	VertexQuantization quantization;
+	VertexPackingError packingError;
+	VertexCacheStats cacheStatsBefore;
+	VertexCacheStats cacheStatsAfter;
+	MeshImportTimings timings;
+
+	//final GPU data, index stride is 2 or 4 bytes
+	const PackedVertex* vertices;
+	unsigned int vertexCount;
+	const void* indices;
+	unsigned int indexCount;
+	unsigned int indexStride;
+
+	//backing storage for the pointers above
+	MappedFile cache;
+	std::vector<PackedVertex> packedVertices;
+	std::vector<unsigned int> indices32;
+	std::vector<unsigned short> indices16;
+
+	MeshData();
+};
+
+// Maps the payload cache holds (when there is one) for the source and the options, otherwise parses, welds,
+// optimizes, builds the LOD chain, meshlets and tangents, packs the result and stores it in cache.
+// Returns false when the source can't be read or has no triangles.
+bool ImportMesh(
+	const wchar_t* fileName,
+	AssetCache* cache,
+	bool optimize,
+	const MeshLodSettings& lodSettings,
+	MeshData& data);
+
+// Packs finished vertices (tangents included) into data, picking 16 bit indices when they fit.
+// The indices are moved into data when they stay 32 bit.
+void PackMeshData(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, MeshData& data);
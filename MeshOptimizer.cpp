@@ -0,0 +1,359 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Size of the LRU cache Forsyth's scoring is tuned for
+	const int FORSYTH_CACHE_SIZE = 32;
+
+	// Valences above this all score the same
+	const int FORSYTH_MAX_VALENCE = 32;
+
+	// Size of the FIFO used to find cluster boundaries for overdraw sorting
+	const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+	// Soft cluster boundaries aren't placed until a cluster has at least this many triangles
+	const size_t MIN_CLUSTER_SIZE = 16;
+
+	struct ForsythTables
+	{
+		float cacheScore[FORSYTH_CACHE_SIZE];
+		float valenceScore[FORSYTH_MAX_VALENCE + 1];
+
+		ForsythTables()
+		{
+			for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+			{
+				// The last triangle's vertices get a fixed score so the
+				// optimizer doesn't just pick a triangle sharing an edge
+				if (i < 3)
+					cacheScore[i] = 0.75f;
+				else
+					cacheScore[i] = powf(1.0f - (i - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+			}
+
+			//vertices with few triangles left get boosted so we don't leave lone triangles behind
+			valenceScore[0] = 0.0f;
+			for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+				valenceScore[i] = 2.0f / sqrtf((float)i);
+		}
+
+		float Score(int cachePosition, unsigned int liveTriangles)
+		{
+			if (liveTriangles == 0)
+				return 0.0f;
+
+			float score = cachePosition >= 0 ? cacheScore[cachePosition] : 0.0f;
+			return score + valenceScore[std::min<unsigned int>(liveTriangles, FORSYTH_MAX_VALENCE)];
+		}
+	};
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	//a vertex is in the FIFO if it was pushed less than cacheSize misses ago
+	std::vector<size_t> pushedAt(vertexCount, 0);
+	size_t misses = 0;
+
+	for (unsigned int index : indices)
+	{
+		if (pushedAt[index] == 0 || misses - pushedAt[index] >= cacheSize)
+		{
+			misses++;
+			pushedAt[index] = misses;
+		}
+	}
+
+	stats.acmr = misses / float(indices.size() / 3);
+	stats.atvr = misses / float(vertexCount);
+	return stats;
+}
+
+float AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, size_t vertexSize)
+{
+	if (vertexCount == 0)
+		return 0.0f;
+
+	//a small direct mapped cache is a close enough stand-in for the GPU's vertex fetch cache
+	const size_t lineSize = 64;
+	const size_t lineCount = 64;
+	size_t cacheLines[lineCount];
+	std::fill(cacheLines, cacheLines + lineCount, (size_t)-1);
+
+	size_t bytesFetched = 0;
+	for (unsigned int index : indices)
+	{
+		size_t firstLine = index * vertexSize / lineSize;
+		size_t lastLine = ((index + 1) * vertexSize - 1) / lineSize;
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			if (cacheLines[line % lineCount] != line)
+			{
+				cacheLines[line % lineCount] = line;
+				bytesFetched += lineSize;
+			}
+		}
+	}
+
+	return bytesFetched / float(vertexCount * vertexSize);
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	static ForsythTables tables;
+
+	//build vertex -> triangle adjacency, which shrinks as triangles are emitted
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int index : indices)
+		liveTriangles[index]++;
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = tables.Score(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	//room for the full cache plus the three vertices pushed in front of it
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	size_t inputCursor = 0;
+	int best = (int)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+
+	while (best >= 0)
+	{
+		const unsigned int* tri = &indices[best * 3];
+		emitted[best] = true;
+		result.insert(result.end(), tri, tri + 3);
+
+		//the triangle's vertices go to the front of the LRU cache
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+			newCache[newCount++] = tri[k];
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		//the emitted triangle no longer counts towards its vertices' valence
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int* begin = &adjacency[adjacencyStart[v]];
+			unsigned int* end = begin + liveTriangles[v];
+			std::iter_swap(std::find(begin, end, (unsigned int)best), end - 1);
+			liveTriangles[v]--;
+		}
+
+		//rescore every vertex whose cache position changed, including the ones that fell out
+		best = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			float score = tables.Score(i < FORSYTH_CACHE_SIZE ? i : -1, liveTriangles[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v] + liveTriangles[v]; a++)
+			{
+				unsigned int t = adjacency[a];
+				triangleScore[t] += delta;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = (int)t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		//nothing left touching the cache, so restart from the next triangle in input order
+		if (best < 0)
+		{
+			while (inputCursor < triangleCount && emitted[inputCursor])
+				inputCursor++;
+			if (inputCursor < triangleCount)
+				best = (int)inputCursor;
+		}
+	}
+
+	indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Hard boundaries go wherever the cache was effectively flushed (all
+	// three vertices missed), since reordering there costs nothing.
+	std::vector<bool> missed(indices.size());
+	std::vector<size_t> pushedAt(vertices.size(), 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int index = indices[i];
+		missed[i] = pushedAt[index] == 0 || misses - pushedAt[index] >= OVERDRAW_CACHE_SIZE;
+		if (missed[i])
+			pushedAt[index] = ++misses;
+	}
+
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (t == 0 || (missed[t * 3] && missed[t * 3 + 1] && missed[t * 3 + 2]))
+			hardBoundaries.push_back(t);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries split the hard clusters further.  Each run is
+	// simulated from a cold cache (as it will be once the clusters are
+	// shuffled) and ends once its ACMR gets within the threshold of the
+	// ACMR of the whole hard cluster.
+	std::vector<size_t> clusterStarts;
+	std::vector<size_t> runPushedAt(vertices.size(), 0);
+	size_t runClock = 0;
+	for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+	{
+		size_t start = hardBoundaries[c];
+		size_t end = hardBoundaries[c + 1];
+
+		size_t clusterMisses = 0;
+		for (size_t i = start * 3; i < end * 3; i++)
+			clusterMisses += missed[i];
+		float clusterAcmr = clusterMisses / float(end - start);
+
+		clusterStarts.push_back(start);
+		size_t runStart = start;
+		size_t runBase = runClock;
+		for (size_t t = start; t < end; t++)
+		{
+			//anything pushed before the run started counts as a miss
+			for (size_t i = t * 3; i < t * 3 + 3; i++)
+			{
+				unsigned int index = indices[i];
+				if (runPushedAt[index] <= runBase || runClock - runPushedAt[index] >= OVERDRAW_CACHE_SIZE)
+					runPushedAt[index] = ++runClock;
+			}
+
+			size_t runLength = t + 1 - runStart;
+			float runAcmr = (runClock - runBase) / float(runLength);
+			if (runLength >= MIN_CLUSTER_SIZE && t + 1 < end && runAcmr <= clusterAcmr * threshold)
+			{
+				clusterStarts.push_back(t + 1);
+				runStart = t + 1;
+				runBase = runClock;
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	//area weighted centroid and normal for each cluster, plus the whole mesh's centroid
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].position);
+
+			//cross product length is twice the area, which cancels out in the averages
+			XMVECTOR faceNormal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float faceArea = XMVectorGetX(XMVector3Length(faceNormal));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), faceArea / 3.0f));
+			normal = XMVectorAdd(normal, faceNormal);
+			area += faceArea;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+	//clusters facing away from the centre are likely to occlude the rest, so they go first
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[c]), meshCentroid);
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+		order[c] = (unsigned int)c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (unsigned int c : order)
+		result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)result.size();
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	//anything never referenced is dropped
+	vertices.swap(result);
+}
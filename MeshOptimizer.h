@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// post-transform vertex cache
+//
+// - ACMR: average cache misses per triangle (0.5 is ideal
+//   for large closed meshes, 3.0 means no reuse at all)
+// - ATVR: average transforms per vertex (1.0 is ideal)
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	float acmr;
+	float atvr;
+};
+
+// Simulates a FIFO post-transform cache of the given size over a triangle list
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Bytes read from the vertex buffer divided by the vertex buffer size, assuming 64 byte cache lines
+float AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, size_t vertexSize);
+
+// Reorders triangles for post-transform cache reuse (Tom Forsyth's linear-speed algorithm)
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Splits a cache-optimized triangle list into clusters and sorts them so outward facing
+// clusters draw first (Sander et al.).  A threshold of 1.05 allows the ACMR to get 5% worse.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold);
+
+// Reorders vertices into the order they are first used and rewrites the indices to match
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
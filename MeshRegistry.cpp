@@ -0,0 +1,109 @@
+#include "MeshRegistry.h"
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Absolute, lexically normal form of a path (the file
+	// doesn't need to exist).  Windows paths are case
+	// insensitive, so they're lowercased there too.
+	// --------------------------------------------------------
+	std::wstring NormalizeMeshPath(const wchar_t* fileName)
+	{
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::weakly_canonical(fileName, error);
+		if (error)
+			path = std::filesystem::absolute(fileName, error);
+		if (error)
+			path = fileName;
+
+		std::wstring normalized = path.lexically_normal().wstring();
+#ifdef _WIN32
+		std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+#endif
+		return normalized;
+	}
+}
+
+MeshRegistry::MeshRegistry(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const wchar_t* placeholderFileName,
+	std::shared_ptr<AssetCache> cache,
+	unsigned int threadCount) :
+	device(device),
+	cache(cache),
+	pendingCount(0),
+	pool(threadCount)
+{
+	placeholder = std::make_shared<Mesh>(device, placeholderFileName, cache.get());
+	meshes[NormalizeMeshPath(placeholderFileName)] = placeholder;
+}
+
+std::shared_ptr<Mesh> MeshRegistry::Load(const wchar_t* fileName, bool optimize, const MeshLodSettings& lodSettings)
+{
+	std::wstring key = NormalizeMeshPath(fileName);
+	auto existing = meshes.find(key);
+	if (existing != meshes.end())
+		return existing->second;
+
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(placeholder);
+	meshes[key] = mesh;
+	pendingCount++;
+
+	//the job gets its own copies of everything, the caller's strings may not outlive it
+	std::wstring source = fileName;
+	pool.Submit([this, mesh, source, optimize, lodSettings]()
+	{
+		std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+		bool succeeded = ImportMesh(source.c_str(), cache.get(), optimize, lodSettings, *data);
+
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		finished.push_back({ mesh, data, succeeded });
+	});
+
+	return mesh;
+}
+
+unsigned int MeshRegistry::Update(unsigned int maxUploads)
+{
+	std::vector<FinishedImport> uploads;
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		size_t count = std::min<size_t>(maxUploads, finished.size());
+		uploads.assign(std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.begin() + count));
+		finished.erase(finished.begin(), finished.begin() + count);
+	}
+
+	//meshes that failed to import just keep showing the placeholder
+	for (FinishedImport& upload : uploads)
+	{
+		if (upload.succeeded)
+			upload.mesh->Upload(device, *upload.data);
+		pendingCount--;
+	}
+
+	return (unsigned int)uploads.size();
+}
+
+void MeshRegistry::WaitAll()
+{
+	pool.Wait();
+	Update();
+}
+
+std::shared_ptr<Mesh> MeshRegistry::GetPlaceholder()
+{
+	return placeholder;
+}
+
+unsigned int MeshRegistry::GetPendingCount()
+{
+	return pendingCount;
+}
+
+unsigned int MeshRegistry::GetMeshCount()
+{
+	return (unsigned int)meshes.size();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <wrl/client.h>
+#include <d3d11.h>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Mesh.h"
+#include "MeshImporter.h"
+#include "Parallel.h"
+
+// --------------------------------------------------------
+// Hands out one shared Mesh per source file
+//
+// - Paths are normalized before lookup, so "a/../b.obj" and
+//   "b.obj" are the same mesh
+// - Imports (parsing, welding, optimizing, tangents, the
+//   asset cache) run on a thread pool; only Update touches
+//   the device, creating buffers on the calling thread
+// - Load returns immediately with a copy of the placeholder
+//   that becomes the real mesh once Update has uploaded it
+// --------------------------------------------------------
+class MeshRegistry
+{
+public:
+	// The placeholder is loaded right away (and registered like any other mesh).
+	// Every import goes through cache, when there is one.
+	MeshRegistry(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		const wchar_t* placeholderFileName,
+		std::shared_ptr<AssetCache> cache = nullptr,
+		unsigned int threadCount = 0);
+
+	// The existing mesh for the file, or a new one that starts loading in the background.
+	// The options of the first Load of a file are the ones that count.
+	std::shared_ptr<Mesh> Load(
+		const wchar_t* fileName,
+		bool optimize = true,
+		const MeshLodSettings& lodSettings = MeshLodSettings());
+
+	// Uploads up to maxUploads finished imports, returns how many it uploaded
+	unsigned int Update(unsigned int maxUploads = UINT_MAX);
+
+	// Blocks until every import has finished, then uploads them all
+	void WaitAll();
+
+	std::shared_ptr<Mesh> GetPlaceholder();
+
+	// Meshes still importing or waiting for their upload
+	unsigned int GetPendingCount();
+
+	unsigned int GetMeshCount();
+
+private:
+	struct FinishedImport
+	{
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<MeshData> data;
+		bool succeeded;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::shared_ptr<Mesh> placeholder;
+	std::shared_ptr<AssetCache> cache;
+
+	//keyed by normalized path, only touched by the owning thread
+	std::unordered_map<std::wstring, std::shared_ptr<Mesh>> meshes;
+	unsigned int pendingCount;
+
+	//filled by the pool, drained by Update
+	std::mutex finishedMutex;
+	std::vector<FinishedImport> finished;
+
+	//last, so it's destroyed (and its jobs stopped) before anything they touch
+	ThreadPool pool;
+};
@@ -0,0 +1,463 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// How much seam edges resist being moved, relative to the surface
+	const double SEAM_WEIGHT = 10.0;
+
+	// Symmetric 4x4 quadric, stored as the 10 unique coefficients plus the
+	// total area that went into it so errors can be reported as distances
+	struct Quadric
+	{
+		double a2, b2, c2, d2;
+		double ab, ac, ad;
+		double bc, bd;
+		double cd;
+		double weight;
+
+		void AddPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a; b2 += w * b * b; c2 += w * c * c; d2 += w * d * d;
+			ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			bc += w * b * c; bd += w * b * d;
+			cd += w * c * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+			ab += q.ab; ac += q.ac; ad += q.ad;
+			bc += q.bc; bd += q.bd;
+			cd += q.cd;
+			weight += q.weight;
+		}
+
+		// Weighted sum of squared distances from p to every plane in the quadric
+		double Evaluate(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + b2 * y * y + c2 * z * z + d2
+				+ 2 * (ab * x * y + ac * x * z + bc * y * z)
+				+ 2 * (ad * x + bd * y + cd * z);
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		float cost;		// Squared distance
+	};
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&a);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), p0), XMVectorSubtract(XMLoadFloat3(&c), p0));
+	}
+
+	// Maps every vertex to the first vertex sharing its exact position and links
+	// those "wedges" (same position, different normal or uv) into circular lists.
+	// Drops triangles that repeat an earlier one's positions and winding.
+	// Positions on open or non-manifold edges are locked.
+	void ClassifyVertices(
+		std::vector<unsigned int>& indices,
+		const std::vector<Vertex>& vertices,
+		std::vector<unsigned int>& positionRemap,
+		std::vector<unsigned int>& nextWedge,
+		std::vector<bool>& locked)
+	{
+		size_t vertexCount = vertices.size();
+		std::vector<unsigned int> order(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			order[i] = (unsigned int)i;
+
+		auto samePosition = [&](unsigned int a, unsigned int b)
+		{
+			const XMFLOAT3& p = vertices[a].position;
+			const XMFLOAT3& q = vertices[b].position;
+			return p.x == q.x && p.y == q.y && p.z == q.z;
+		};
+		auto less = [&](unsigned int a, unsigned int b)
+		{
+			const XMFLOAT3& p = vertices[a].position;
+			const XMFLOAT3& q = vertices[b].position;
+			if (p.x != q.x) return p.x < q.x;
+			if (p.y != q.y) return p.y < q.y;
+			if (p.z != q.z) return p.z < q.z;
+			return a < b;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		positionRemap.assign(vertexCount, 0);
+		nextWedge.assign(vertexCount, 0);
+		locked.assign(vertexCount, false);
+		for (size_t i = 0; i < vertexCount;)
+		{
+			size_t end = i + 1;
+			while (end < vertexCount && samePosition(order[i], order[end]))
+				end++;
+
+			for (size_t j = i; j < end; j++)
+			{
+				positionRemap[order[j]] = order[i];
+				nextWedge[order[j]] = order[j + 1 < end ? j + 1 : i];
+			}
+			i = end;
+		}
+
+		//a coincident copy of a triangle adds nothing to the surface, but makes every edge it shares
+		//look non-manifold (helix.obj holds its whole mesh twice), so only the first is kept
+		std::vector<std::array<unsigned int, 4>> triangles(indices.size() / 3);
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			unsigned int a = positionRemap[indices[t * 3]], b = positionRemap[indices[t * 3 + 1]], c = positionRemap[indices[t * 3 + 2]];
+			if (b < a && b < c)
+				triangles[t] = { b, c, a, (unsigned int)t };
+			else if (c < a && c < b)
+				triangles[t] = { c, a, b, (unsigned int)t };
+			else
+				triangles[t] = { a, b, c, (unsigned int)t };
+		}
+		std::sort(triangles.begin(), triangles.end());
+
+		std::vector<bool> duplicate(triangles.size(), false);
+		for (size_t t = 1; t < triangles.size(); t++)
+		{
+			const std::array<unsigned int, 4>& x = triangles[t - 1];
+			const std::array<unsigned int, 4>& y = triangles[t];
+			duplicate[y[3]] = x[0] == y[0] && x[1] == y[1] && x[2] == y[2];
+		}
+		size_t write = 0;
+		for (size_t t = 0; t < duplicate.size(); t++)
+		{
+			if (duplicate[t])
+				continue;
+			for (int k = 0; k < 3; k++)
+				indices[write++] = indices[t * 3 + k];
+		}
+		indices.resize(write);
+
+		//every edge of a closed manifold shows up exactly once in each direction
+		std::vector<unsigned long long> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned long long a = positionRemap[indices[i + e]];
+				unsigned long long b = positionRemap[indices[i + (e + 1) % 3]];
+				edges.push_back((a << 32) | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			unsigned long long edge = edges[i];
+			unsigned long long reverse = (edge << 32) | (edge >> 32);
+			bool duplicate = (i > 0 && edges[i - 1] == edge) || (i + 1 < edges.size() && edges[i + 1] == edge);
+			auto range = std::equal_range(edges.begin(), edges.end(), reverse);
+			if (duplicate || range.second - range.first != 1)
+			{
+				locked[(unsigned int)(edge >> 32)] = true;
+				locked[(unsigned int)(edge & 0xFFFFFFFF)] = true;
+			}
+		}
+
+		//edges were keyed on positions, so spread the lock to every wedge
+		for (size_t i = 0; i < vertexCount; i++)
+			locked[i] = locked[positionRemap[i]];
+	}
+}
+
+float SimplifyMesh(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError)
+{
+	size_t vertexCount = vertices.size();
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+		return 0.0f;
+
+	std::vector<unsigned int> positionRemap;
+	std::vector<unsigned int> nextWedge;
+	std::vector<bool> locked;
+	ClassifyVertices(indices, vertices, positionRemap, nextWedge, locked);
+
+	//area weighted plane quadrics, accumulated per position
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[indices[i]].position;
+		XMVECTOR n = TriangleNormal(p0, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+		float length = XMVectorGetX(XMVector3Length(n));
+		if (length <= 0.0f)
+			continue;
+
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVectorScale(n, 1.0f / length));
+		double d = -(normal.x * p0.x + normal.y * p0.y + normal.z * p0.z);
+		for (int k = 0; k < 3; k++)
+			quadrics[positionRemap[indices[i + k]]].AddPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+	}
+
+	//seam and hard edges (no matching reverse edge between the same wedges) get a plane
+	//perpendicular to their face, so sliding a corner along them costs what it distorts
+	std::vector<unsigned long long> wedgeEdges;
+	wedgeEdges.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3)
+		for (int e = 0; e < 3; e++)
+			wedgeEdges.push_back(((unsigned long long)indices[i + e] << 32) | indices[i + (e + 1) % 3]);
+	std::sort(wedgeEdges.begin(), wedgeEdges.end());
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		XMVECTOR faceNormal = XMVector3Normalize(TriangleNormal(
+			vertices[indices[i]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position));
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = indices[i + e];
+			unsigned int b = indices[i + (e + 1) % 3];
+			if (std::binary_search(wedgeEdges.begin(), wedgeEdges.end(), ((unsigned long long)b << 32) | a))
+				continue;
+
+			XMVECTOR pa = XMLoadFloat3(&vertices[a].position);
+			XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&vertices[b].position), pa);
+			float lengthSq = XMVectorGetX(XMVector3LengthSq(edge));
+			if (lengthSq <= 0.0f)
+				continue;
+
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMVector3Cross(edge, faceNormal)));
+			double d = -(normal.x * vertices[a].position.x + normal.y * vertices[a].position.y + normal.z * vertices[a].position.z);
+			quadrics[positionRemap[a]].AddPlane(normal.x, normal.y, normal.z, d, lengthSq * SEAM_WEIGHT);
+			quadrics[positionRemap[b]].AddPlane(normal.x, normal.y, normal.z, d, lengthSq * SEAM_WEIGHT);
+		}
+	}
+
+	auto collapseCost = [&](unsigned int from, unsigned int to)
+	{
+		Quadric q = quadrics[positionRemap[from]];
+		q.Add(quadrics[positionRemap[to]]);
+		return q.weight > 0.0 ? (float)(std::max(q.Evaluate(vertices[to].position), 0.0) / q.weight) : 0.0f;
+	};
+
+	float maxCost = maxError * maxError;
+	float resultCost = 0.0f;
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> wedgeTargets;
+
+	//work in passes: pick the cheapest independent collapses, apply them all, repeat
+	while (indices.size() > targetIndexCount)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		//vertex to triangle adjacency
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (unsigned int index : indices)
+			triangleOffsets[index + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		vertexTriangles.resize(indices.size());
+		{
+			std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		//both directions of every edge, borders only act as targets
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = indices[i + e];
+				unsigned int b = indices[i + (e + 1) % 3];
+				if (!locked[a])
+				{
+					float cost = collapseCost(a, b);
+					if (cost <= maxCost)
+						collapses.push_back({ a, b, cost });
+				}
+				if (!locked[b])
+				{
+					float cost = collapseCost(b, a);
+					if (cost <= maxCost)
+						collapses.push_back({ b, a, cost });
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		//each collapse removes about two triangles, don't overshoot the target by much
+		size_t collapseLimit = (triangleCount - targetIndexCount / 3) / 2 + 1;
+		size_t collapseCount = 0;
+
+		for (size_t i = 0; i < vertexCount; i++)
+			remap[i] = (unsigned int)i;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		for (const Collapse& c : collapses)
+		{
+			if (collapseCount >= collapseLimit)
+				break;
+			unsigned int fromPosition = positionRemap[c.from];
+			unsigned int toPosition = positionRemap[c.to];
+			if (touched[fromPosition] || touched[toPosition])
+				continue;
+
+			//every wedge has to move onto a wedge of the target it already shares a triangle with,
+			//that keeps seams and hard edges on themselves (collapses across them are rejected)
+			bool valid = true;
+			wedgeTargets.clear();
+			unsigned int wedge = c.from;
+			do
+			{
+				unsigned int target = UINT_MAX;
+				for (unsigned int t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1]; t++)
+				{
+					const unsigned int* tri = &indices[vertexTriangles[t] * 3];
+					for (int k = 0; k < 3; k++)
+					{
+						if (positionRemap[tri[k]] != toPosition)
+							continue;
+						if (target != UINT_MAX && target != tri[k])
+							valid = false;
+						target = tri[k];
+					}
+				}
+				valid = valid && (target != UINT_MAX || triangleOffsets[wedge] == triangleOffsets[wedge + 1]);
+				wedgeTargets.push_back(target);
+				wedge = nextWedge[wedge];
+			} while (wedge != c.from && valid);
+			if (!valid)
+				continue;
+
+			//reject collapses that flip (or badly flatten) a surviving triangle
+			bool flips = false;
+			wedge = c.from;
+			do
+			{
+				for (unsigned int t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1] && !flips; t++)
+				{
+					const unsigned int* tri = &indices[vertexTriangles[t] * 3];
+					if (positionRemap[tri[0]] == toPosition || positionRemap[tri[1]] == toPosition || positionRemap[tri[2]] == toPosition)
+						continue;
+
+					XMFLOAT3 p[3];
+					for (int k = 0; k < 3; k++)
+						p[k] = vertices[tri[k]].position;
+					XMVECTOR before = TriangleNormal(p[0], p[1], p[2]);
+					for (int k = 0; k < 3; k++)
+						if (tri[k] == wedge)
+							p[k] = vertices[c.to].position;
+					XMVECTOR after = TriangleNormal(p[0], p[1], p[2]);
+
+					float dot = XMVectorGetX(XMVector3Dot(before, after));
+					float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+					flips = dot <= 0.25f * lengths;
+				}
+				wedge = nextWedge[wedge];
+			} while (wedge != c.from && !flips);
+			if (flips)
+				continue;
+
+			//the whole neighbourhood stays put for the rest of this pass so the flip test stays valid
+			size_t w = 0;
+			wedge = c.from;
+			do
+			{
+				for (unsigned int t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1]; t++)
+				{
+					const unsigned int* tri = &indices[vertexTriangles[t] * 3];
+					for (int k = 0; k < 3; k++)
+						touched[positionRemap[tri[k]]] = 1;
+				}
+				if (wedgeTargets[w] != UINT_MAX)
+					remap[wedge] = wedgeTargets[w];
+				w++;
+				wedge = nextWedge[wedge];
+			} while (wedge != c.from);
+
+			quadrics[toPosition].Add(quadrics[fromPosition]);
+			resultCost = std::max(resultCost, c.cost);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		//rewrite the triangles and drop the ones that collapsed to a line
+		size_t write = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			unsigned int a = remap[indices[i]];
+			unsigned int b = remap[indices[i + 1]];
+			unsigned int c = remap[indices[i + 2]];
+			if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[a] == positionRemap[c])
+				continue;
+
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+	}
+
+	return sqrtf(resultCost);
+}
+
+void BuildLodChain(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const MeshLodSettings& settings, std::vector<MeshLod>& lods)
+{
+	lods.clear();
+	lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+	//errors are relative to the bounding radius so the settings work at any scale
+	XMVECTOR boundsMin = XMVectorReplicate(vertices.empty() ? 0.0f : FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(vertices.empty() ? 0.0f : -FLT_MAX);
+	for (const Vertex& v : vertices)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&v.position));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&v.position));
+	}
+	float radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin)));
+	float maxError = settings.maxError * radius;
+
+	std::vector<unsigned int> level(indices);
+	unsigned int lodLimit = std::min<unsigned int>(settings.maxLods, MESH_MAX_LODS);
+	while (lods.size() < lodLimit)
+	{
+		//keep simplifying the previous level, errors add up along the chain
+		size_t previousCount = level.size();
+		size_t target = (size_t)(previousCount / 3 * settings.reduction) * 3;
+		float error = SimplifyMesh(level, vertices, target, maxError);
+
+		//stop once a level stops paying for itself
+		if (level.empty() || level.size() > previousCount * 0.85f)
+			break;
+
+		OptimizeVertexCache(level, vertices.size());
+
+		MeshLod lod;
+		lod.indexStart = (unsigned int)indices.size();
+		lod.indexCount = (unsigned int)level.size();
+		lod.error = error + lods.back().error;
+		lods.push_back(lod);
+		indices.insert(indices.end(), level.begin(), level.end());
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// Most levels of detail a single mesh can carry (including the full detail one)
+#define MESH_MAX_LODS 8
+
+// --------------------------------------------------------
+// One level of detail inside a mesh's shared index buffer
+//
+// - All levels index the same vertex buffer
+// - error is the object space distance the level may
+//   deviate from the full detail surface
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int indexStart;
+	unsigned int indexCount;
+	float error;
+};
+
+// How a LOD chain is generated at import time
+struct MeshLodSettings
+{
+	unsigned int maxLods = 4;		// Including the full detail level
+	float reduction = 0.5f;			// Triangle count of each level relative to the previous one
+	float maxError = 0.05f;			// Largest allowed error, relative to the mesh's bounding radius
+};
+
+// --------------------------------------------------------
+// Quadric error metric edge collapse (Garland & Heckbert)
+//
+// Collapses edges onto existing vertices (nothing moves, so the
+// vertex buffer is shared) until the index count reaches the
+// target or the next collapse would exceed maxError.  Seams and
+// hard edges only collapse along themselves, open borders are
+// never removed, and duplicated triangles are dropped first.
+// Returns the error of the result in object space units.
+// --------------------------------------------------------
+float SimplifyMesh(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError);
+
+// Appends progressively simpler levels to the (full detail) index list and describes every level in lods
+void BuildLodChain(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const MeshLodSettings& settings, std::vector<MeshLod>& lods);
@@ -0,0 +1,254 @@
+#include "Meshlet.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Clusters whose normals spread further than this from the average (cos of the angle) aren't cone culled
+	const float MIN_CONE_SPREAD = 0.1f;
+
+	// --------------------------------------------------------
+	// Fills in a finished meshlet's bounding sphere and normal
+	// cone from its triangles
+	// --------------------------------------------------------
+	void ComputeMeshletBounds(Meshlet& meshlet, const unsigned int* indices, const std::vector<Vertex>& vertices)
+	{
+		unsigned int indexCount = meshlet.triangleCount * 3;
+
+		//sphere around the centre of the box, big enough for the furthest corner
+		XMVECTOR boxMin = XMLoadFloat3(&vertices[indices[0]].position);
+		XMVECTOR boxMax = boxMin;
+		for (unsigned int i = 1; i < indexCount; i++)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].position);
+			boxMin = XMVectorMin(boxMin, p);
+			boxMax = XMVectorMax(boxMax, p);
+		}
+
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f);
+		XMVECTOR radiusSq = XMVectorZero();
+		for (unsigned int i = 0; i < indexCount; i++)
+			radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&vertices[indices[i]].position), center)));
+
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = sqrtf(XMVectorGetX(radiusSq));
+
+		//average of the unit face normals, then the widest angle any face makes with it
+		std::vector<XMFLOAT3> normals;
+		normals.reserve(meshlet.triangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].position);
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+
+			//degenerate triangles never face anything
+			float length = XMVectorGetX(XMVector3Length(normal));
+			if (length <= 0.0f)
+				continue;
+
+			normal = XMVectorScale(normal, 1.0f / length);
+			axis = XMVectorAdd(axis, normal);
+			normals.emplace_back();
+			XMStoreFloat3(&normals.back(), normal);
+		}
+
+		meshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		meshlet.coneCutoff = 1.0f;
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (normals.empty() || axisLength <= 0.0f)
+			return;
+
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+		float minDot = 1.0f;
+		for (const XMFLOAT3& n : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&n), axis)));
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		if (minDot > MIN_CONE_SPREAD)
+			meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+void BuildMeshlets(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//triangles touching each vertex, so a meshlet can grow into its neighbours
+	std::vector<unsigned int> adjacencyStart(vertices.size() + 1, 0);
+	for (unsigned int index : indices)
+		adjacencyStart[index + 1]++;
+	for (size_t v = 0; v < vertices.size(); v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<unsigned int> vertexMeshlet(vertices.size(), UINT_MAX);
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	unsigned int meshletVertices[MESHLET_MAX_VERTICES];
+	size_t seedCursor = 0;
+
+	while (true)
+	{
+		while (seedCursor < triangleCount && used[seedCursor])
+			seedCursor++;
+		if (seedCursor == triangleCount)
+			break;
+
+		Meshlet meshlet = {};
+		meshlet.indexStart = (unsigned int)result.size();
+		unsigned int id = (unsigned int)meshlets.size();
+
+		size_t best = seedCursor;
+		while (true)
+		{
+			used[best] = true;
+			for (size_t i = best * 3; i < best * 3 + 3; i++)
+			{
+				unsigned int index = indices[i];
+				if (vertexMeshlet[index] != id)
+				{
+					vertexMeshlet[index] = id;
+					meshletVertices[meshlet.vertexCount++] = index;
+				}
+				result.push_back(index);
+			}
+			meshlet.triangleCount++;
+
+			if (meshlet.triangleCount == MESHLET_MAX_TRIANGLES)
+				break;
+
+			// Next is the neighbouring triangle adding the fewest new
+			// vertices, ties going to whichever came first in the input
+			// so the cache order mostly survives.
+			best = triangleCount;
+			unsigned int bestNew = 3;
+			for (unsigned int m = 0; m < meshlet.vertexCount && bestNew > 0; m++)
+			{
+				unsigned int v = meshletVertices[m];
+				for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v + 1]; a++)
+				{
+					unsigned int t = adjacency[a];
+					if (used[t])
+						continue;
+
+					unsigned int newVertices =
+						(vertexMeshlet[indices[t * 3]] != id) +
+						(vertexMeshlet[indices[t * 3 + 1]] != id) +
+						(vertexMeshlet[indices[t * 3 + 2]] != id);
+					if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES)
+						continue;
+
+					if (best == triangleCount || newVertices < bestNew || (newVertices == bestNew && t < best))
+					{
+						best = t;
+						bestNew = newVertices;
+					}
+				}
+			}
+
+			//nothing connected fits, so the meshlet is done
+			if (best == triangleCount)
+				break;
+		}
+
+		// Growth order isn't cache order, so reorder the meshlet on its own
+		// using local indices (the whole vertex range would make every call
+		// as expensive as optimizing the full mesh).
+		std::vector<unsigned int> local(result.begin() + meshlet.indexStart, result.end());
+		for (unsigned int& index : local)
+			index = (unsigned int)(std::find(meshletVertices, meshletVertices + meshlet.vertexCount, index) - meshletVertices);
+		OptimizeVertexCache(local, meshlet.vertexCount);
+		for (size_t i = 0; i < local.size(); i++)
+			result[meshlet.indexStart + i] = meshletVertices[local[i]];
+
+		ComputeMeshletBounds(meshlet, &result[meshlet.indexStart], vertices);
+		meshlets.push_back(meshlet);
+	}
+
+	indices.swap(result);
+}
+
+void ExtractFrustumPlanes(FXMMATRIX worldViewProjection, XMFLOAT4 planes[6])
+{
+	//row vectors, so each clip space coordinate is a column of the matrix (Gribb & Hartmann)
+	XMMATRIX columns = XMMatrixTranspose(worldViewProjection);
+	XMVECTOR x = columns.r[0];
+	XMVECTOR y = columns.r[1];
+	XMVECTOR z = columns.r[2];
+	XMVECTOR w = columns.r[3];
+
+	XMVECTOR unnormalized[6] =
+	{
+		XMVectorAdd(w, x),		//left
+		XMVectorSubtract(w, x),	//right
+		XMVectorAdd(w, y),		//bottom
+		XMVectorSubtract(w, y),	//top
+		z,						//near (D3D clip space depth starts at 0)
+		XMVectorSubtract(w, z),	//far
+	};
+
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(unnormalized[i]));
+}
+
+unsigned int CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const XMFLOAT4 planes[6],
+	const XMFLOAT3& cameraPosition,
+	std::vector<MeshletDrawRange>& ranges)
+{
+	ranges.clear();
+
+	XMVECTOR planeVectors[6];
+	for (int i = 0; i < 6; i++)
+		planeVectors[i] = XMLoadFloat4(&planes[i]);
+	XMVECTOR camera = XMLoadFloat3(&cameraPosition);
+
+	unsigned int visible = 0;
+	for (size_t m = 0; m < meshletCount; m++)
+	{
+		const Meshlet& meshlet = meshlets[m];
+		XMVECTOR center = XMLoadFloat3(&meshlet.center);
+
+		//completely behind any one plane
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; i++)
+			outside = XMVectorGetX(XMPlaneDotCoord(planeVectors[i], center)) < -meshlet.radius;
+		if (outside)
+			continue;
+
+		//every triangle faces away from the camera
+		XMVECTOR toCenter = XMVectorSubtract(center, camera);
+		float facing = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.coneAxis)));
+		if (facing >= meshlet.coneCutoff * XMVectorGetX(XMVector3Length(toCenter)) + meshlet.radius)
+			continue;
+
+		visible++;
+		unsigned int indexCount = meshlet.triangleCount * 3;
+		if (!ranges.empty() && ranges.back().indexStart + ranges.back().indexCount == meshlet.indexStart)
+			ranges.back().indexCount += indexCount;
+		else
+			ranges.push_back({ meshlet.indexStart, indexCount });
+	}
+
+	return visible;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// Limits that keep a meshlet's vertices and triangles small enough to reject (or draw) as one unit
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Meshes with fewer triangles than this aren't split, one draw is cheaper than culling them
+#define MESHLET_MIN_MESH_TRIANGLES (MESHLET_MAX_TRIANGLES * 4)
+
+// --------------------------------------------------------
+// A cluster of neighbouring triangles stored as one
+// contiguous run of the full detail index list
+//
+// - center / radius bound every vertex of the cluster
+// - Every triangle faces away from the camera when
+//   dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius
+//   (a coneCutoff of 1 never passes, for clusters too curved to cone cull)
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int indexStart;
+	unsigned int triangleCount;
+	unsigned int vertexCount;
+
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+// A run of indices to hand to DrawIndexed
+struct MeshletDrawRange
+{
+	unsigned int indexStart;
+	unsigned int indexCount;
+};
+
+// Reorders the triangles into meshlets (each a contiguous run of indices) and describes them.
+// Triangles are grown from the current order, so an already cache-optimized list keeps most of its locality.
+void BuildMeshlets(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets);
+
+// Planes (xyz normal pointing inwards, w distance) in the space the matrix transforms from.
+// Pass world * view * projection to get the frustum in object space.
+void ExtractFrustumPlanes(DirectX::FXMMATRIX worldViewProjection, DirectX::XMFLOAT4 planes[6]);
+
+// Frustum and back-face cone test for every meshlet, all in object space.  Visible meshlets next
+// to each other are merged into one range.  Returns the number of visible meshlets.
+unsigned int CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const DirectX::XMFLOAT4 planes[6],
+	const DirectX::XMFLOAT3& cameraPosition,
+	std::vector<MeshletDrawRange>& ranges);
@@ -0,0 +1,268 @@
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Kaiser filter reach, in texels of the smaller level, and window shape
+	const float KAISER_RADIUS = 2.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	// Rows each filtering task handles
+	const unsigned int ROWS_PER_TASK = 16;
+
+	// Zeroth order modified Bessel function of the first kind (series form)
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		float half = x * 0.5f;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (half / k) * (half / k);
+			sum += term;
+			if (term < sum * 1e-8f)
+				break;
+		}
+		return sum;
+	}
+
+	float Sinc(float x)
+	{
+		if (fabsf(x) < 1e-6f)
+			return 1.0f;
+		return sinf(XM_PI * x) / (XM_PI * x);
+	}
+
+	// Kaiser weight at a distance measured in texels of the smaller level
+	float KaiserWeight(float distance)
+	{
+		distance = fabsf(distance);
+		if (distance >= KAISER_RADIUS)
+			return 0.0f;
+		float t = distance / KAISER_RADIUS;
+		return Sinc(distance) * BesselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+	}
+
+	// --------------------------------------------------------
+	// The source texels (edge clamped) that make up one texel
+	// of the smaller level along one axis, with their weights
+	// --------------------------------------------------------
+	struct FilterTaps
+	{
+		std::vector<unsigned int> first;	// First tap of each destination texel
+		std::vector<unsigned int> count;
+		std::vector<unsigned int> sources;	// Source texel of every tap
+		std::vector<float> weights;
+	};
+
+	void BuildFilterTaps(MipFilter filter, unsigned int sourceSize, unsigned int destinationSize, FilterTaps& taps)
+	{
+		float scale = (float)sourceSize / destinationSize;
+		float radius = filter == MIP_FILTER_BOX ? 0.5f : KAISER_RADIUS;
+
+		taps.first.resize(destinationSize);
+		taps.count.resize(destinationSize);
+		for (unsigned int x = 0; x < destinationSize; x++)
+		{
+			//destination texel center in source texel units
+			float center = (x + 0.5f) * scale;
+			int start = (int)floorf(center - radius * scale);
+			int end = (int)ceilf(center + radius * scale);
+
+			taps.first[x] = (unsigned int)taps.sources.size();
+			float total = 0.0f;
+			for (int j = start; j <= end; j++)
+			{
+				//a box weighs each source texel by how much of it the destination texel covers, which only
+				//differs from a plain average when an odd size leaves texels straddling two destinations
+				float weight = filter == MIP_FILTER_BOX ?
+					std::max(0.0f, std::min(j + 1.0f, center + 0.5f * scale) - std::max((float)j, center - 0.5f * scale)) :
+					KaiserWeight((j + 0.5f - center) / scale);
+				if (weight == 0.0f)
+					continue;
+				taps.sources.push_back((unsigned int)std::min(std::max(j, 0), (int)sourceSize - 1));
+				taps.weights.push_back(weight);
+				total += weight;
+			}
+			taps.count[x] = (unsigned int)taps.sources.size() - taps.first[x];
+
+			for (unsigned int i = taps.first[x]; i < taps.sources.size(); i++)
+				taps.weights[i] /= total;
+		}
+	}
+
+	// Gamma decoding for every 8 bit value, so level 0 doesn't need a pow per channel
+	struct SrgbTable
+	{
+		float values[256];
+
+		SrgbTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	XMVECTOR DecodeTexel(const unsigned char* texel, TextureFormat format, const MipSettings& settings)
+	{
+		static const SrgbTable srgb;
+
+		if (format == TEXTURE_FORMAT_R8)
+			return XMVectorSet(texel[0] / 255.0f, 0.0f, 0.0f, 1.0f);
+
+		XMVECTOR value;
+		if (settings.srgb)
+			value = XMVectorSet(srgb.values[texel[0]], srgb.values[texel[1]], srgb.values[texel[2]], texel[3] / 255.0f);
+		else
+			value = XMVectorScale(XMVectorSet(texel[0], texel[1], texel[2], texel[3]), 1.0f / 255.0f);
+
+		//normals are filtered as vectors, not colors
+		if (settings.normalMap)
+			value = XMVectorSelect(value, XMVectorMultiplyAdd(value, XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f)), g_XMSelect1110);
+		return value;
+	}
+
+	void EncodeTexel(FXMVECTOR value, TextureFormat format, const MipSettings& settings, unsigned char* texel)
+	{
+		XMVECTOR encoded = value;
+		if (settings.normalMap)
+			encoded = XMVectorSelect(encoded, XMVectorMultiplyAdd(encoded, XMVectorReplicate(0.5f), XMVectorReplicate(0.5f)), g_XMSelect1110);
+		else if (settings.srgb)
+			encoded = XMColorRGBToSRGB(encoded);
+
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, XMVectorMultiplyAdd(XMVectorSaturate(encoded), XMVectorReplicate(255.0f), XMVectorReplicate(0.5f)));
+		texel[0] = (unsigned char)c.x;
+		if (format == TEXTURE_FORMAT_R8)
+			return;
+		texel[1] = (unsigned char)c.y;
+		texel[2] = (unsigned char)c.z;
+		texel[3] = (unsigned char)c.w;
+	}
+
+	// Runs task(row) for rows 0 ... rowCount - 1 in groups across the threads
+	template <typename RowTask>
+	void ForEachRow(unsigned int rowCount, RowTask task)
+	{
+		ParallelFor((rowCount + ROWS_PER_TASK - 1) / ROWS_PER_TASK, [&](unsigned int group)
+		{
+			unsigned int last = std::min(rowCount, (group + 1) * ROWS_PER_TASK);
+			for (unsigned int row = group * ROWS_PER_TASK; row < last; row++)
+				task(row);
+		});
+	}
+}
+
+MipSettings::MipSettings() :
+	filter(MIP_FILTER_BOX),
+	srgb(false),
+	normalMap(false)
+{
+}
+
+unsigned int GetFullMipCount(unsigned int width, unsigned int height)
+{
+	unsigned int count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width >> 1);
+		height = std::max(1u, height >> 1);
+		count++;
+	}
+	return count;
+}
+
+bool GenerateMips(TextureData& texture, const MipSettings& mipSettings)
+{
+	if (texture.mips.empty() || IsBlockCompressed(texture.format))
+		return false;
+
+	//a single channel is neither a color nor a vector
+	MipSettings settings = mipSettings;
+	if (texture.format == TEXTURE_FORMAT_R8)
+	{
+		settings.srgb = false;
+		settings.normalMap = false;
+	}
+
+	//level 0 is at the start of the pixels, so growing the chain leaves it untouched
+	TextureFormat format = texture.format;
+	unsigned int texelSize = GetTexelSize(format);
+	texture.Allocate(format, texture.width, texture.height, GetFullMipCount(texture.width, texture.height));
+
+	//level 0 as linear floats
+	unsigned int width = texture.width;
+	unsigned int height = texture.height;
+	std::vector<XMVECTOR> current((size_t)width * height);
+	ForEachRow(height, [&](unsigned int y)
+	{
+		const unsigned char* row = texture.GetMipData(0) + (size_t)y * texture.mips[0].rowPitch;
+		for (unsigned int x = 0; x < width; x++)
+			current[(size_t)y * width + x] = DecodeTexel(row + x * texelSize, format, settings);
+	});
+
+	std::vector<XMVECTOR> horizontal;
+	std::vector<XMVECTOR> next;
+	FilterTaps columnTaps;
+	FilterTaps rowTaps;
+	for (unsigned int mip = 1; mip < texture.mips.size(); mip++)
+	{
+		const TextureMip& level = texture.mips[mip];
+		columnTaps = FilterTaps();
+		rowTaps = FilterTaps();
+		BuildFilterTaps(settings.filter, width, level.width, columnTaps);
+		BuildFilterTaps(settings.filter, height, level.height, rowTaps);
+
+		//separable: narrow every row first, then every column of the narrowed rows
+		horizontal.resize((size_t)level.width * height);
+		ForEachRow(height, [&](unsigned int y)
+		{
+			const XMVECTOR* source = current.data() + (size_t)y * width;
+			XMVECTOR* destination = horizontal.data() + (size_t)y * level.width;
+			for (unsigned int x = 0; x < level.width; x++)
+			{
+				XMVECTOR sum = XMVectorZero();
+				unsigned int last = columnTaps.first[x] + columnTaps.count[x];
+				for (unsigned int i = columnTaps.first[x]; i < last; i++)
+					sum = XMVectorMultiplyAdd(source[columnTaps.sources[i]], XMVectorReplicate(columnTaps.weights[i]), sum);
+				destination[x] = sum;
+			}
+		});
+
+		next.resize((size_t)level.width * level.height);
+		ForEachRow(level.height, [&](unsigned int y)
+		{
+			XMVECTOR* destination = next.data() + (size_t)y * level.width;
+			unsigned char* row = texture.GetMipData(mip) + (size_t)y * level.rowPitch;
+			unsigned int last = rowTaps.first[y] + rowTaps.count[y];
+			for (unsigned int x = 0; x < level.width; x++)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for (unsigned int i = rowTaps.first[y]; i < last; i++)
+					sum = XMVectorMultiplyAdd(horizontal[(size_t)rowTaps.sources[i] * level.width + x], XMVectorReplicate(rowTaps.weights[i]), sum);
+
+				//sharp filters overshoot, and normals have to stay unit length for the next level
+				if (settings.normalMap)
+					sum = XMVectorSelect(sum, XMVector3Normalize(sum), g_XMSelect1110);
+				else
+					sum = XMVectorSaturate(sum);
+
+				destination[x] = sum;
+				EncodeTexel(sum, format, settings, row + x * texelSize);
+			}
+		});
+
+		current.swap(next);
+		width = level.width;
+		height = level.height;
+	}
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "TextureData.h"
+
+// Filters a level can be downsampled with
+enum MipFilter
+{
+	MIP_FILTER_BOX,		// Average of the texels each one covers, soft
+	MIP_FILTER_KAISER	// Kaiser windowed sinc, keeps more detail without aliasing
+};
+
+// --------------------------------------------------------
+// How a texture's mip chain should be built
+// --------------------------------------------------------
+struct MipSettings
+{
+	MipFilter filter;
+	bool srgb;			// RGB holds gamma encoded color, filtered in linear space
+	bool normalMap;		// RGB holds a unit vector, renormalized on every level
+
+	MipSettings();
+};
+
+// Levels in a full chain down to 1x1
+unsigned int GetFullMipCount(unsigned int width, unsigned int height);
+
+// --------------------------------------------------------
+// Builds the rest of a mip chain from level 0 of an R8 or
+// RGBA8 texture, replacing any levels past the first
+//
+// - Every level is filtered from the float result of the
+//   one above, so rounding doesn't pile up down the chain
+// - Texels are filtered as whole RGBA vectors, rows split
+//   across threads; alpha is always linear
+// - Returns false for block compressed or empty textures
+// --------------------------------------------------------
+bool GenerateMips(TextureData& texture, const MipSettings& settings);
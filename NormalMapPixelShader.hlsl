@@ -19,16 +19,21 @@ cbuffer DataFromCPU : register(b0)
     float4 colorTint;
     float3 cameraPos;
     float totalTime;
-    float3 ambientColor;
+    float ambientIntensity; //scales the sky's irradiance
     float roughness;
+    float2 ambientPadding;
     Light lights[MAX_LIGHTS];
     int numLights;
     float3 padding; //maintain 16 byte partitions
+    float4 SurfaceTextureRemap; //uv scale and offset into an atlas (see Material::AddTextureSRV)
+    float4 SurfaceTextureSpecularRemap;
+    float4 SurfaceTextureNormalRemap;
 }
 
 Texture2D SurfaceTexture : register(t0);
 Texture2D SurfaceTextureSpecular : register(t1);
 Texture2D SurfaceTextureNormal : register(t2);
+StructuredBuffer<float4> SkyIrradianceSH : register(t4); //see Sky::GetIrradianceSRV
 
 SamplerState BasicSampler : register(s0);
 
@@ -46,17 +51,17 @@ float4 main(VertexToPixelWithNormalMap input) : SV_TARGET
     //get color from texture with texture.sample(basicsampler, uv)
     
     input.normal = normalize(input.normal);
-    input.tangent = normalize(input.tangent);
-    float3 unpackedNormal = SurfaceTextureNormal.Sample(BasicSampler, input.uv).xyz * 2 - 1;
+    input.tangent.xyz = normalize(input.tangent.xyz);
+    float3 unpackedNormal = UnpackNormalMap(SampleRemapped(SurfaceTextureNormal, BasicSampler, input.uv, SurfaceTextureNormalRemap).xy);
     unpackedNormal = normalize(unpackedNormal);
     
     //normal
     float3 N = input.normal;
     //tangent
-    float3 T = input.tangent;
+    float3 T = input.tangent.xyz;
     T = normalize(T - N * dot(T, N));
-    //bitangent
-    float3 B = cross(T, N);
+    //bitangent, flipped where the UVs are mirrored
+    float3 B = cross(T, N) * (input.tangent.w < 0.0f ? -1.0f : 1.0f);
     
     //rotation matrix for normal from normal map
     float3x3 TBN = float3x3(T, B, N);
@@ -70,12 +75,12 @@ float4 main(VertexToPixelWithNormalMap input) : SV_TARGET
     float specularPower = (1.0f - roughness) * MAX_SPECULAR_EXPONENT;
     float3 viewVector = normalize(cameraPos - input.worldPosition);
 
-    float3 surfaceColor = pow(SurfaceTexture.Sample(BasicSampler, input.uv).xyz, 2.2f) * colorTint.xyz;
-    float3 color = surfaceColor * ambientColor;
+    float3 surfaceColor = pow(SampleRemapped(SurfaceTexture, BasicSampler, input.uv, SurfaceTextureRemap).xyz, 2.2f) * colorTint.xyz;
+    float3 color = surfaceColor * SkyIrradiance(SkyIrradianceSH, normalize(input.normal)) * ambientIntensity;
 
     float3 lightDirection;
 
-    float specularFromMap = SurfaceTextureSpecular.Sample(BasicSampler, input.uv).x;
+    float specularFromMap = SampleRemapped(SurfaceTextureSpecular, BasicSampler, input.uv, SurfaceTextureSpecularRemap).x;
     for (int i = 0; i < numLights; i++)
     {
         if (0 == lights[i].type)
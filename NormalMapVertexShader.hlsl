@@ -7,6 +7,8 @@ cbuffer DataPerEntity : register(b0)
 {
     matrix worldMatrix;
     matrix worldInvTranspose;
+    float3 positionOffset;
+    float3 positionScale;
 }
 
 //change once every draw call
@@ -40,15 +42,17 @@ VertexToPixelWithNormalMap main(VertexShaderInput input)
 	//   a perspective projection matrix, which we'll get to in the future).
 	//output.screenPosition = float4(input.localPosition + offset, 1.0f);
 
+    float3 localPosition = DequantizePosition(input.localPosition, positionOffset, positionScale);
+
     matrix wvp = mul(projectionMatrix, mul(viewMatrix, worldMatrix));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
     output.uv = input.uv;
-    output.normal = mul((float3x3) worldInvTranspose, input.normal);
-    output.tangent = mul((float3x3) worldMatrix, input.tangent);
-	output.worldPosition = mul(worldMatrix, float4(input.localPosition, 1)).xyz;
+    output.normal = mul((float3x3) worldInvTranspose, OctahedralDecode(input.normal));
+    output.tangent = float4(mul((float3x3) worldMatrix, OctahedralDecode(input.tangent)), input.localPosition.w);
+	output.worldPosition = mul(worldMatrix, float4(localPosition, 1)).xyz;
 	
     matrix shadowWVP = mul(lightProjMatrix, mul(lightViewMatrix, worldMatrix));
-    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+    output.shadowMapPos = mul(shadowWVP, float4(localPosition, 1.0f));
 	
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
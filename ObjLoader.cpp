@@ -0,0 +1,399 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Files smaller than this aren't worth splitting any further
+	const size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+	// Marks an unused slot in the vertex welding table
+	const unsigned int EMPTY_SLOT = 0xFFFFFFFF;
+
+	// Everything one thread pulls out of its slice of the file
+	struct ObjChunk
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<ObjCorner> corners;
+
+		// Negative OBJ indices count back from the end of the stream
+		// so far, which a chunk can't know about its predecessors.
+		// Those components are stored relative to the chunk and listed
+		// here as (corner * 3 + component) so the merge can fix them.
+		std::vector<size_t> relativeComponents;
+	};
+
+	const char* SkipSpaces(const char* c, const char* end)
+	{
+		while (c < end && (*c == ' ' || *c == '\t'))
+			c++;
+		return c;
+	}
+
+	const char* SkipToken(const char* c, const char* end)
+	{
+		while (c < end && *c != ' ' && *c != '\t' && *c != '\r')
+			c++;
+		return c;
+	}
+
+	bool IsIndexStart(char c)
+	{
+		return (c >= '0' && c <= '9') || c == '-' || c == '+';
+	}
+
+	const char* ParseFloat(const char* c, const char* end, float& value)
+	{
+		c = SkipSpaces(c, end);
+
+		//from_chars doesn't accept an explicit plus sign
+		if (c < end && *c == '+')
+			c++;
+
+		std::from_chars_result result = std::from_chars(c, end, value);
+		if (result.ec != std::errc())
+		{
+			value = 0.0f;
+			return SkipToken(c, end);
+		}
+		return result.ptr;
+	}
+
+	const char* ParseInt(const char* c, const char* end, int& value)
+	{
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+'))
+		{
+			negative = *c == '-';
+			c++;
+		}
+
+		int result = 0;
+		while (c < end && *c >= '0' && *c <= '9')
+		{
+			result = result * 10 + (*c - '0');
+			c++;
+		}
+
+		value = negative ? -result : result;
+		return c;
+	}
+
+	// Reads "v", "v/vt", "v//vn" or "v/vt/vn", leaving 0 in anything not given
+	const char* ParseCorner(const char* c, const char* end, int (&raw)[3])
+	{
+		raw[0] = raw[1] = raw[2] = 0;
+		for (int component = 0; component < 3; component++)
+		{
+			if (c < end && IsIndexStart(*c))
+				c = ParseInt(c, end, raw[component]);
+
+			if (c < end && *c == '/')
+				c++;
+			else
+				break;
+		}
+		return c;
+	}
+
+	size_t HashCorner(const ObjCorner& corner)
+	{
+		//large odd multipliers spread neighbouring indices across the table
+		size_t h = (size_t)(unsigned int)corner.position * 73856093u;
+		h ^= (size_t)(unsigned int)corner.uv * 19349663u;
+		h ^= (size_t)(unsigned int)corner.normal * 83492791u;
+		return h ^ (h >> 16);
+	}
+
+	void ParseChunk(const char* c, const char* end, ObjChunk& chunk)
+	{
+		//reused between faces to avoid reallocating for every polygon
+		std::vector<ObjCorner> polygon;
+		std::vector<unsigned int> polygonRelative;
+
+		while (c < end)
+		{
+			const char* lineEnd = (const char*)memchr(c, '\n', end - c);
+			if (!lineEnd)
+				lineEnd = end;
+
+			c = SkipSpaces(c, lineEnd);
+
+			if (lineEnd - c > 1 && c[0] == 'v')
+			{
+				if (c[1] == ' ' || c[1] == '\t')
+				{
+					XMFLOAT3 pos;
+					c = ParseFloat(c + 1, lineEnd, pos.x);
+					c = ParseFloat(c, lineEnd, pos.y);
+					c = ParseFloat(c, lineEnd, pos.z);
+					chunk.positions.push_back(pos);
+				}
+				else if (c[1] == 'n')
+				{
+					XMFLOAT3 norm;
+					c = ParseFloat(c + 2, lineEnd, norm.x);
+					c = ParseFloat(c, lineEnd, norm.y);
+					c = ParseFloat(c, lineEnd, norm.z);
+					chunk.normals.push_back(norm);
+				}
+				else if (c[1] == 't')
+				{
+					XMFLOAT2 uv;
+					c = ParseFloat(c + 2, lineEnd, uv.x);
+					c = ParseFloat(c, lineEnd, uv.y);
+					chunk.uvs.push_back(uv);
+				}
+			}
+			else if (lineEnd - c > 1 && c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+			{
+				polygon.clear();
+				polygonRelative.clear();
+
+				int counts[3] =
+				{
+					(int)chunk.positions.size(),
+					(int)chunk.uvs.size(),
+					(int)chunk.normals.size()
+				};
+
+				c = SkipSpaces(c + 1, lineEnd);
+				while (c < lineEnd && IsIndexStart(*c))
+				{
+					int raw[3];
+					c = ParseCorner(c, lineEnd, raw);
+
+					// - Positive indices are 1-based and absolute
+					// - Negative ones are relative to what we've read so far
+					// - Zero means the component wasn't there at all
+					int resolved[3];
+					unsigned int relative = 0;
+					for (int i = 0; i < 3; i++)
+					{
+						if (raw[i] > 0)
+							resolved[i] = raw[i] - 1;
+						else if (raw[i] < 0)
+						{
+							resolved[i] = counts[i] + raw[i];
+							relative |= 1u << i;
+						}
+						else
+							resolved[i] = -1;
+					}
+
+					polygon.push_back({ resolved[0], resolved[1], resolved[2] });
+					polygonRelative.push_back(relative);
+
+					c = SkipSpaces(c, lineEnd);
+				}
+
+				//split polygons into a triangle fan
+				for (size_t k = 1; k + 1 < polygon.size(); k++)
+				{
+					size_t fan[3] = { 0, k, k + 1 };
+					for (size_t corner : fan)
+					{
+						for (int i = 0; i < 3; i++)
+						{
+							if (polygonRelative[corner] & (1u << i))
+								chunk.relativeComponents.push_back(chunk.corners.size() * 3 + i);
+						}
+						chunk.corners.push_back(polygon[corner]);
+					}
+				}
+			}
+
+			c = lineEnd + 1;
+		}
+	}
+}
+
+bool LoadObj(const std::filesystem::path& fileName, ObjData& data)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+
+	ParseObj(file.GetData(), file.GetSize(), data);
+	return true;
+}
+
+void ParseObj(const char* text, size_t size, ObjData& data)
+{
+	data.positions.clear();
+	data.normals.clear();
+	data.uvs.clear();
+	data.corners.clear();
+
+	//split the file into line-aligned slices, a few per thread so uneven slices balance out
+	size_t chunkCount = std::min<size_t>(GetWorkerCount() * 4, std::max<size_t>(1, size / MIN_CHUNK_SIZE));
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = text;
+	bounds[chunkCount] = text + size;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* split = std::max(bounds[i - 1], text + size * i / chunkCount);
+		const char* newline = (const char*)memchr(split, '\n', text + size - split);
+		bounds[i] = newline ? newline + 1 : text + size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		ParseChunk(bounds[i], bounds[i + 1], chunks[i]);
+	});
+
+	//prefix sums tell each chunk where its data lands in the final streams
+	std::vector<size_t> positionStart(chunkCount), uvStart(chunkCount), normalStart(chunkCount), cornerStart(chunkCount);
+	size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		positionStart[i] = positionCount; positionCount += chunks[i].positions.size();
+		uvStart[i] = uvCount; uvCount += chunks[i].uvs.size();
+		normalStart[i] = normalCount; normalCount += chunks[i].normals.size();
+		cornerStart[i] = cornerCount; cornerCount += chunks[i].corners.size();
+	}
+
+	data.positions.resize(positionCount);
+	data.uvs.resize(uvCount);
+	data.normals.resize(normalCount);
+	data.corners.resize(cornerCount);
+
+	//chunks are copied in file order, so the result never depends on thread timing
+	ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + positionStart[i]);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), data.uvs.begin() + uvStart[i]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + normalStart[i]);
+		std::copy(chunk.corners.begin(), chunk.corners.end(), data.corners.begin() + cornerStart[i]);
+
+		int bases[3] = { (int)positionStart[i], (int)uvStart[i], (int)normalStart[i] };
+		for (size_t relative : chunk.relativeComponents)
+		{
+			ObjCorner& corner = data.corners[cornerStart[i] + relative / 3];
+			int* components[3] = { &corner.position, &corner.uv, &corner.normal };
+			*components[relative % 3] += bases[relative % 3];
+		}
+
+		//free each chunk as soon as it's merged to keep the peak memory down
+		chunk = ObjChunk();
+	});
+}
+
+// --------------------------------------------------------
+// Conversion rules adapted from Chris Cascioli's original
+// .OBJ loader (previously inline in Mesh.cpp)
+// --------------------------------------------------------
+void BuildObjVertices(const ObjData& data, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	indices.reserve(data.corners.size());
+
+	int positionCount = (int)data.positions.size();
+	int uvCount = (int)data.uvs.size();
+	int normalCount = (int)data.normals.size();
+
+	//open addressing table from (position, uv, normal) to the welded vertex, kept under half full
+	size_t capacity = 16;
+	while (capacity < data.corners.size() * 2)
+		capacity *= 2;
+	std::vector<unsigned int> weldTable(capacity, EMPTY_SLOT);
+	std::vector<const ObjCorner*> weldKeys;
+	weldKeys.reserve(data.corners.size() / 2);
+	vertices.reserve(data.corners.size() / 2);
+
+	for (size_t t = 0; t + 2 < data.corners.size(); t += 3)
+	{
+		// The model is most likely in a right-handed space,
+		// especially if it came from Maya.  We want to convert
+		// to a left-handed space for DirectX.  This means we 
+		// need to:
+		//  - Invert the Z position
+		//  - Invert the normal's Z
+		//  - Flip the winding order
+		// We also need to flip the UV coordinate since DirectX
+		// defines (0,0) as the top left of the texture, and many
+		// 3D modeling packages use the bottom left as (0,0)
+		const ObjCorner* tri[3] = { &data.corners[t], &data.corners[t + 2], &data.corners[t + 1] };
+
+		//skip triangles pointing outside the file's data rather than crashing
+		bool valid = true;
+		for (const ObjCorner* corner : tri)
+		{
+			valid &= corner->position >= 0 && corner->position < positionCount;
+			valid &= corner->uv < uvCount && corner->normal < normalCount;
+		}
+		if (!valid)
+			continue;
+
+		//files without normals get flat face normals, which can't be shared between faces
+		XMFLOAT3 faceNormal(0, 0, 0);
+		if (tri[0]->normal < 0 || tri[1]->normal < 0 || tri[2]->normal < 0)
+		{
+			XMFLOAT3 p[3];
+			for (int i = 0; i < 3; i++)
+			{
+				p[i] = data.positions[tri[i]->position];
+				p[i].z *= -1.0f;
+			}
+
+			XMVECTOR p0 = XMLoadFloat3(&p[0]);
+			XMStoreFloat3(&faceNormal, XMVector3Normalize(XMVector3Cross(
+				XMVectorSubtract(XMLoadFloat3(&p[1]), p0),
+				XMVectorSubtract(XMLoadFloat3(&p[2]), p0))));
+		}
+
+		for (const ObjCorner* corner : tri)
+		{
+			//corners with the same index triple become one vertex
+			size_t slot = corner->normal >= 0 ? HashCorner(*corner) & (capacity - 1) : capacity;
+			while (slot < capacity && weldTable[slot] != EMPTY_SLOT)
+			{
+				const ObjCorner* key = weldKeys[weldTable[slot]];
+				if (key->position == corner->position && key->uv == corner->uv && key->normal == corner->normal)
+					break;
+				slot = (slot + 1) & (capacity - 1);
+			}
+
+			if (slot < capacity && weldTable[slot] != EMPTY_SLOT)
+			{
+				indices.push_back(weldTable[slot]);
+				continue;
+			}
+
+			Vertex v;
+			v.position = data.positions[corner->position];
+			v.position.z *= -1.0f;
+
+			v.uv = corner->uv >= 0 ? data.uvs[corner->uv] : XMFLOAT2(0, 0);
+			v.uv.y = 1.0f - v.uv.y;
+
+			if (corner->normal >= 0)
+			{
+				v.normal = data.normals[corner->normal];
+				v.normal.z *= -1.0f;
+			}
+			else
+				v.normal = faceNormal;
+
+			v.tangent = XMFLOAT4(0, 0, 0, 0);
+
+			unsigned int index = (unsigned int)vertices.size();
+			if (slot < capacity)
+				weldTable[slot] = index;
+
+			weldKeys.push_back(corner);
+			vertices.push_back(v);
+			indices.push_back(index);
+		}
+	}
+}
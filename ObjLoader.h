@@ -0,0 +1,40 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <filesystem>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// One corner of an OBJ face as 0-based indices into the
+// ObjData streams (-1 when the file left that part out)
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+// --------------------------------------------------------
+// The raw streams of an OBJ file.  Faces are already split
+// into triangles (three corners each), but nothing has been
+// converted to our coordinate system yet.
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<ObjCorner> corners;
+};
+
+// Memory maps and parses an OBJ file, returns false if it can't be opened
+bool LoadObj(const std::filesystem::path& fileName, ObjData& data);
+
+// Parses OBJ text already in memory, splitting the work across threads
+void ParseObj(const char* text, size_t size, ObjData& data);
+
+// Converts parsed OBJ streams into left-handed vertices and indices ready for a Mesh.
+// Corners sharing the same (position, uv, normal) triple are welded into one vertex.
+void BuildObjVertices(const ObjData& data, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
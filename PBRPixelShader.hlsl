@@ -21,17 +21,21 @@ cbuffer DataFromCPU : register(b0)
     float totalTime;
     Light lights[MAX_LIGHTS];
     int numLights;
-    float3 padding;
+    float ambientIntensity; //scales the sky's irradiance
+    float2 padding;
 }
 
 Texture2D Albedo : register(t0);
 Texture2D NormalMap : register(t1);
-Texture2D RoughnessMap : register(t2);
-Texture2D MetalnessMap : register(t3);
-Texture2D ShadowMap : register(t4);
+Texture2D OrmMap : register(t2);     //occlusion, roughness, metalness
+Texture2D ShadowMap : register(t3);
+StructuredBuffer<float4> SkyIrradianceSH : register(t4); //see Sky::GetIrradianceSRV
+TextureCube PrefilteredSky : register(t5);  //see Sky::GetPrefilteredSRV
+Texture2D BrdfLut : register(t6);
 
 SamplerState BasicSampler : register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
+SamplerState EnvironmentSampler : register(s2); //clamps, so the LUT's edges don't wrap
 
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
@@ -47,7 +51,7 @@ float4 main(VertexToPixelWithNormalMap input) : SV_TARGET
     //get color from texture with texture.sample(basicsampler, uv)
 
     input.normal = normalize(input.normal);
-    input.tangent = normalize(input.tangent);
+    input.tangent.xyz = normalize(input.tangent.xyz);
    
     // Perform the perspective divide (divide by W) ourselves
     input.shadowMapPos /= input.shadowMapPos.w;
@@ -64,30 +68,36 @@ float4 main(VertexToPixelWithNormalMap input) : SV_TARGET
     
     
     
-    float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).xyz * 2 - 1;
+    float3 unpackedNormal = UnpackNormalMap(NormalMap.Sample(BasicSampler, input.uv).xy);
     unpackedNormal = normalize(unpackedNormal);
     //normal
     float3 N = input.normal;
     //tangent
-    float3 T = input.tangent;
+    float3 T = input.tangent.xyz;
     T = normalize(T - N * dot(T, N));
-    //bitangent
-    float3 B = cross(T, N);
+    //bitangent, flipped where the UVs are mirrored
+    float3 B = cross(T, N) * (input.tangent.w < 0.0f ? -1.0f : 1.0f);
 
     //rotation matrix for normal from normal map
     float3x3 TBN = float3x3(T, B, N);
 
     input.normal = mul(unpackedNormal, TBN);
     
-    float roughness = RoughnessMap.Sample(BasicSampler, input.uv).x;
-    float metalness = MetalnessMap.Sample(BasicSampler, input.uv).x;
+    float3 orm = OrmMap.Sample(BasicSampler, input.uv).xyz;
+    float occlusion = orm.r;
+    float roughness = orm.g;
+    float metalness = orm.b;
     float3 surfaceColor = pow(Albedo.Sample(BasicSampler, input.uv).xyz, 2.2f) * colorTint.xyz;
     float3 specularColor = lerp(F0_NON_METAL, surfaceColor, metalness);
     
     
     float3 viewVector = normalize(cameraPos - input.worldPosition);
 
-    float3 color;
+    //diffuse sky light, which metals don't have, and the sky's reflection
+    float3 skyNormal = normalize(input.normal);
+    float3 color = surfaceColor * (1.0f - metalness) * SkyIrradiance(SkyIrradianceSH, skyNormal);
+    color += SkySpecular(PrefilteredSky, BrdfLut, EnvironmentSampler, skyNormal, viewVector, roughness, specularColor);
+    color *= occlusion * ambientIntensity;
 
     float3 lightDirection;
     for (int i = 0; i < numLights; i++)
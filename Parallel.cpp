@@ -0,0 +1,151 @@
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+unsigned int GetWorkerCount()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+namespace
+{
+	//set on threads running ParallelFor tasks, whose nested loops run serially (every other worker's busy already)
+	thread_local bool insideParallelFor = false;
+
+	//one loop's progress, shared with the helper jobs (which may only get picked up after the loop is done)
+	struct ParallelLoop
+	{
+		const std::function<void(unsigned int)>* task;
+		unsigned int taskCount;
+		std::atomic<unsigned int> nextTask;
+		std::atomic<unsigned int> finishedTasks;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	//threads pull the next task index until they run out, so uneven tasks balance themselves
+	void RunTasks(ParallelLoop& loop)
+	{
+		bool wasInside = insideParallelFor;
+		insideParallelFor = true;
+		for (unsigned int i = loop.nextTask++; i < loop.taskCount; i = loop.nextTask++)
+		{
+			(*loop.task)(i);
+			if (++loop.finishedTasks == loop.taskCount)
+			{
+				std::lock_guard<std::mutex> lock(loop.mutex);
+				loop.finished.notify_all();
+			}
+		}
+		insideParallelFor = wasInside;
+	}
+
+	// Every ParallelFor shares these threads, one fewer than the worker count (the caller makes up the rest)
+	ThreadPool& GetParallelPool()
+	{
+		static ThreadPool pool(GetWorkerCount() - 1);
+		return pool;
+	}
+}
+
+void ParallelFor(unsigned int taskCount, const std::function<void(unsigned int)>& task)
+{
+	if (taskCount == 0)
+		return;
+
+	if (GetWorkerCount() == 1 || taskCount == 1 || insideParallelFor)
+	{
+		for (unsigned int i = 0; i < taskCount; i++)
+			task(i);
+		return;
+	}
+
+	std::shared_ptr<ParallelLoop> loop = std::make_shared<ParallelLoop>();
+	loop->task = &task;
+	loop->taskCount = taskCount;
+	loop->nextTask = 0;
+	loop->finishedTasks = 0;
+
+	//helpers that start late find nothing left and never touch the task, so only tasks are waited for, not helpers
+	ThreadPool& pool = GetParallelPool();
+	unsigned int helperCount = std::min(pool.GetThreadCount(), taskCount - 1);
+	for (unsigned int i = 0; i < helperCount; i++)
+		pool.Submit([loop]() { RunTasks(*loop); });
+
+	RunTasks(*loop);
+
+	std::unique_lock<std::mutex> lock(loop->mutex);
+	loop->finished.wait(lock, [&]() { return loop->finishedTasks == taskCount; });
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	runningJobs(0),
+	stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, GetWorkerCount() - 1);
+
+	threads.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+
+	for (auto& t : threads)
+		t.join();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return jobs.empty() && runningJobs == 0; });
+}
+
+unsigned int ThreadPool::GetThreadCount()
+{
+	return (unsigned int)threads.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+
+		std::function<void()> job = std::move(jobs.front());
+		jobs.pop_front();
+		runningJobs++;
+
+		//the lock is only for the queue, never held while a job runs
+		lock.unlock();
+		job();
+		lock.lock();
+
+		runningJobs--;
+		if (jobs.empty() && runningJobs == 0)
+			idle.notify_all();
+	}
+}
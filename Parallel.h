@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of threads worth splitting CPU work across (always at least 1)
+unsigned int GetWorkerCount();
+
+// Runs task(0) ... task(taskCount - 1) across the worker threads and
+// returns once every task has finished.  The calling thread helps out.
+// Every call shares one set of threads, made on first use, so it's fine
+// to call from ThreadPool jobs; calls from inside a task run serially.
+void ParallelFor(unsigned int taskCount, const std::function<void(unsigned int)>& task);
+
+// --------------------------------------------------------
+// A fixed set of threads running queued jobs in the order
+// they were submitted
+//
+// - For work that finishes in the background (asset loads)
+//   instead of inside a single call like ParallelFor
+// - Jobs may use ParallelFor themselves
+// - Destruction waits for running jobs, but drops any that
+//   haven't started yet
+// --------------------------------------------------------
+class ThreadPool
+{
+public:
+	// 0 threads means one fewer than the worker count (leaving the
+	// main thread its own core), but always at least 1
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	void operator=(ThreadPool const&) = delete;
+
+	void Submit(std::function<void()> job);
+
+	// Blocks until the queue is empty and no job is running
+	void Wait();
+
+	unsigned int GetThreadCount();
+
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable idle;
+	unsigned int runningJobs;
+	bool stopping;
+
+	void WorkerLoop();
+};
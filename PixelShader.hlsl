@@ -19,12 +19,15 @@ cbuffer DataFromCPU : register(b0)
 	float4 colorTint;
 	float3 cameraPos;
 	float totalTime;
-	float3 ambientColor;
+	float ambientIntensity; //scales the sky's irradiance
 	float roughness;
+	float2 ambientPadding;
 	Light lights[MAX_LIGHTS];
     int numLights;
     float3 padding; //maintain 16 byte partitions
 }
+
+StructuredBuffer<float4> SkyIrradianceSH : register(t4); //see Sky::GetIrradianceSRV
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -48,8 +51,8 @@ float4 main(VertexToPixel input) : SV_TARGET
     float specularPower = (1.0f - roughness) * MAX_SPECULAR_EXPONENT;
     float3 viewVector = normalize(cameraPos - input.worldPosition);
     
-    float3 surfaceColor = colorTint.xyz * ambientColor;
-    float3 color = surfaceColor;
+    float3 surfaceColor = colorTint.xyz;
+    float3 color = surfaceColor * SkyIrradiance(SkyIrradianceSH, input.normal) * ambientIntensity;
 
     float3 lightDirection;
 	for (int i = 0; i < numLights; i++)
@@ -0,0 +1,908 @@
+#include "PngDecoder.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PNG_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define PNG_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Huffman codes up to this length decode with a single table lookup
+	const unsigned int FAST_BITS = 10;
+	const unsigned int FAST_SIZE = 1 << FAST_BITS;
+
+	// --------------------------------------------------------
+	// Canonical Huffman table for one deflate alphabet.  Deflate
+	// stores codes most significant bit first, so the fast table
+	// is indexed by the bit reversed code; longer codes fall back
+	// to a search by length.
+	// --------------------------------------------------------
+	struct HuffmanTable
+	{
+		uint16_t fast[FAST_SIZE];       //(length << 9) | symbol, 0 when the code is longer than FAST_BITS
+		uint16_t firstCode[16];
+		uint16_t firstSymbol[16];
+		uint32_t maxCode[17];
+		uint8_t lengths[288];
+		uint16_t symbols[288];
+	};
+
+	uint32_t ReverseBits(uint32_t value, unsigned int bitCount)
+	{
+		uint32_t reversed = 0;
+		for (unsigned int i = 0; i < bitCount; i++)
+		{
+			reversed = (reversed << 1) | (value & 1);
+			value >>= 1;
+		}
+		return reversed;
+	}
+
+	bool BuildHuffmanTable(HuffmanTable& table, const uint8_t* codeLengths, unsigned int symbolCount)
+	{
+		unsigned int counts[17] = {};
+		for (unsigned int i = 0; i < symbolCount; i++)
+			counts[codeLengths[i]]++;
+		counts[0] = 0;
+
+		memset(table.fast, 0, sizeof(table.fast));
+		memset(table.lengths, 0, sizeof(table.lengths));
+
+		unsigned int nextCode[16] = {};
+		unsigned int code = 0;
+		unsigned int symbol = 0;
+		for (unsigned int length = 1; length < 16; length++)
+		{
+			nextCode[length] = code;
+			table.firstCode[length] = (uint16_t)code;
+			table.firstSymbol[length] = (uint16_t)symbol;
+			code += counts[length];
+
+			//an over-subscribed length can't be a valid prefix code
+			if (counts[length] && code - 1 >= (1u << length))
+				return false;
+
+			table.maxCode[length] = code << (16 - length);
+			code <<= 1;
+			symbol += counts[length];
+		}
+		table.maxCode[16] = 0x10000;
+
+		for (unsigned int i = 0; i < symbolCount; i++)
+		{
+			unsigned int length = codeLengths[i];
+			if (length == 0)
+				continue;
+
+			unsigned int slot = nextCode[length] - table.firstCode[length] + table.firstSymbol[length];
+			table.lengths[slot] = (uint8_t)length;
+			table.symbols[slot] = (uint16_t)i;
+
+			//every FAST_BITS pattern starting with this code maps to it
+			if (length <= FAST_BITS)
+			{
+				uint16_t entry = (uint16_t)((length << 9) | i);
+				for (uint32_t j = ReverseBits(nextCode[length], length); j < FAST_SIZE; j += 1u << length)
+					table.fast[j] = entry;
+			}
+			nextCode[length]++;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Least significant bit first reader over the deflate data.
+	// Past the end it feeds in zero bytes (counted in padding),
+	// and Overrun() reports once any of those were consumed.
+	// Away from the end it refills a whole 64 bit word at once,
+	// keeping only the bytes that fit.
+	// --------------------------------------------------------
+	struct BitReader
+	{
+		const uint8_t* next;
+		const uint8_t* end;
+		uint64_t bits;
+		unsigned int bitCount;
+		unsigned int padding;
+
+		void Refill()
+		{
+			if (end - next >= 8)
+			{
+				uint64_t word;
+				memcpy(&word, next, sizeof(word));
+				bits |= word << bitCount;
+				next += (63 - bitCount) >> 3;
+				bitCount |= 56;
+				return;
+			}
+			while (bitCount <= 56)
+			{
+				if (next < end)
+					bits |= (uint64_t)*next++ << bitCount;
+				else
+					padding++;
+				bitCount += 8;
+			}
+		}
+
+		bool Overrun()
+		{
+			return padding * 8 > bitCount;
+		}
+
+		uint32_t Read(unsigned int count)
+		{
+			if (bitCount < count)
+				Refill();
+			uint32_t value = (uint32_t)(bits & ((1ull << count) - 1));
+			bits >>= count;
+			bitCount -= count;
+			return value;
+		}
+
+		int Decode(const HuffmanTable& table)
+		{
+			if (bitCount < 16)
+				Refill();
+
+			uint16_t entry = table.fast[bits & (FAST_SIZE - 1)];
+			if (entry)
+			{
+				unsigned int length = entry >> 9;
+				bits >>= length;
+				bitCount -= length;
+				return entry & 511;
+			}
+
+			//too long for the fast table, find the length whose range holds the code
+			uint32_t code = ReverseBits((uint32_t)(bits & 0xFFFF), 16);
+			unsigned int length = FAST_BITS + 1;
+			while (code >= table.maxCode[length])
+				length++;
+			if (length >= 16)
+				return -1;
+
+			unsigned int slot = (code >> (16 - length)) - table.firstCode[length] + table.firstSymbol[length];
+			if (slot >= 288 || table.lengths[slot] != length)
+				return -1;
+			bits >>= length;
+			bitCount -= length;
+			return table.symbols[slot];
+		}
+	};
+
+	const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	bool InflateHuffmanBlock(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances, unsigned char* output, size_t outputSize, size_t& position)
+	{
+		while (true)
+		{
+			int symbol = reader.Decode(literals);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 256)
+			{
+				if (position >= outputSize)
+					return false;
+				output[position++] = (unsigned char)symbol;
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LENGTH_BASE[symbol] + reader.Read(LENGTH_EXTRA[symbol]);
+
+			int distanceSymbol = reader.Decode(distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DISTANCE_BASE[distanceSymbol] + reader.Read(DISTANCE_EXTRA[distanceSymbol]);
+
+			if (distance > position || length > outputSize - position)
+				return false;
+
+			//matches may overlap their own output (a run), so they're copied forwards: 8 bytes at a time when every
+			//chunk is already written (overshooting into space written later), a fill for runs of one byte
+			const unsigned char* source = output + position - distance;
+			unsigned char* target = output + position;
+			if (distance >= 8 && outputSize - position >= length + 8)
+			{
+				for (size_t i = 0; i < length; i += 8)
+					memcpy(target + i, source + i, 8);
+			}
+			else if (distance == 1)
+				memset(target, *source, length);
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+					target[i] = source[i];
+			}
+			position += length;
+		}
+	}
+
+	bool ReadDynamicTables(BitReader& reader, HuffmanTable& literals, HuffmanTable& distances)
+	{
+		unsigned int literalCount = reader.Read(5) + 257;
+		unsigned int distanceCount = reader.Read(5) + 1;
+		unsigned int codeLengthCount = reader.Read(4) + 4;
+
+		uint8_t codeLengthLengths[19] = {};
+		for (unsigned int i = 0; i < codeLengthCount; i++)
+			codeLengthLengths[CODE_LENGTH_ORDER[i]] = (uint8_t)reader.Read(3);
+
+		HuffmanTable codeLengthTable;
+		if (!BuildHuffmanTable(codeLengthTable, codeLengthLengths, 19))
+			return false;
+
+		//literal and distance lengths are one run-length coded sequence
+		uint8_t lengths[288 + 32] = {};
+		unsigned int total = literalCount + distanceCount;
+		unsigned int count = 0;
+		while (count < total)
+		{
+			int symbol = reader.Decode(codeLengthTable);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[count++] = (uint8_t)symbol;
+				continue;
+			}
+
+			uint8_t repeated = 0;
+			unsigned int runLength;
+			if (symbol == 16)
+			{
+				if (count == 0)
+					return false;
+				repeated = lengths[count - 1];
+				runLength = 3 + reader.Read(2);
+			}
+			else if (symbol == 17)
+				runLength = 3 + reader.Read(3);
+			else
+				runLength = 11 + reader.Read(7);
+
+			if (runLength > total - count)
+				return false;
+			memset(lengths + count, repeated, runLength);
+			count += runLength;
+		}
+
+		return BuildHuffmanTable(literals, lengths, literalCount) &&
+			BuildHuffmanTable(distances, lengths + literalCount, distanceCount);
+	}
+
+	// Paeth predictor from the PNG specification
+	inline unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return (unsigned char)a;
+		return (unsigned char)(pb <= pc ? b : c);
+	}
+
+	// --------------------------------------------------------
+	// One pixel of up to four bytes in a vector register, for
+	// the filters that have to go a pixel at a time (each one
+	// predicts from the pixel just unfiltered to its left).
+	// SSE2 on x86 and x64, NEON on ARM, plain bytes elsewhere.
+	// --------------------------------------------------------
+#if defined(PNG_SSE2)
+	typedef __m128i Pixel;
+
+	inline Pixel LoadPixel(uint32_t value) { return _mm_cvtsi32_si128((int)value); }
+	inline uint32_t StorePixel(Pixel pixel) { return (uint32_t)_mm_cvtsi128_si32(pixel); }
+	inline Pixel AddPixels(Pixel a, Pixel b) { return _mm_add_epi8(a, b); }
+
+	//the rounding average, minus the bit it rounded up
+	inline Pixel AveragePixels(Pixel a, Pixel b)
+	{
+		return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+	}
+
+	//the predictor's three distances in 16 bits, with ties going to a, then b, as the specification orders them
+	inline Pixel PaethPixels(Pixel a, Pixel b, Pixel c)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i a16 = _mm_unpacklo_epi8(a, zero);
+		__m128i b16 = _mm_unpacklo_epi8(b, zero);
+		__m128i c16 = _mm_unpacklo_epi8(c, zero);
+		__m128i toA = _mm_sub_epi16(b16, c16);
+		__m128i toB = _mm_sub_epi16(a16, c16);
+		__m128i toC = _mm_add_epi16(toA, toB);
+		toA = _mm_max_epi16(toA, _mm_sub_epi16(zero, toA));
+		toB = _mm_max_epi16(toB, _mm_sub_epi16(zero, toB));
+		toC = _mm_max_epi16(toC, _mm_sub_epi16(zero, toC));
+		__m128i smallest = _mm_min_epi16(toC, _mm_min_epi16(toA, toB));
+		__m128i useA = _mm_cmpeq_epi16(smallest, toA);
+		__m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(smallest, toB));
+		__m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+		__m128i result = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a16), _mm_and_si128(useB, b16)), _mm_and_si128(useC, c16));
+		return _mm_packus_epi16(result, result);
+	}
+#elif defined(PNG_NEON)
+	typedef uint8x8_t Pixel;
+
+	inline Pixel LoadPixel(uint32_t value) { return vreinterpret_u8_u32(vdup_n_u32(value)); }
+	inline uint32_t StorePixel(Pixel pixel) { return vget_lane_u32(vreinterpret_u32_u8(pixel), 0); }
+	inline Pixel AddPixels(Pixel a, Pixel b) { return vadd_u8(a, b); }
+	inline Pixel AveragePixels(Pixel a, Pixel b) { return vhadd_u8(a, b); }
+
+	inline Pixel PaethPixels(Pixel a, Pixel b, Pixel c)
+	{
+		int16x8_t a16 = vreinterpretq_s16_u16(vmovl_u8(a));
+		int16x8_t b16 = vreinterpretq_s16_u16(vmovl_u8(b));
+		int16x8_t c16 = vreinterpretq_s16_u16(vmovl_u8(c));
+		int16x8_t toA = vsubq_s16(b16, c16);
+		int16x8_t toB = vsubq_s16(a16, c16);
+		int16x8_t toC = vabsq_s16(vaddq_s16(toA, toB));
+		toA = vabsq_s16(toA);
+		toB = vabsq_s16(toB);
+		int16x8_t smallest = vminq_s16(toC, vminq_s16(toA, toB));
+		int16x8_t result = vbslq_s16(vceqq_s16(smallest, toA), a16, vbslq_s16(vceqq_s16(smallest, toB), b16, c16));
+		return vmovn_u16(vreinterpretq_u16_s16(result));
+	}
+#else
+	typedef uint32_t Pixel;
+
+	inline Pixel LoadPixel(uint32_t value) { return value; }
+	inline uint32_t StorePixel(Pixel pixel) { return pixel; }
+
+	inline Pixel AddPixels(Pixel a, Pixel b)
+	{
+		//bytewise, without carries between them
+		return ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+	}
+
+	inline Pixel AveragePixels(Pixel a, Pixel b)
+	{
+		return (a & b) + (((a ^ b) >> 1) & 0x7F7F7F7F);
+	}
+
+	inline Pixel PaethPixels(Pixel a, Pixel b, Pixel c)
+	{
+		Pixel result = 0;
+		for (unsigned int shift = 0; shift < 32; shift += 8)
+			result |= (Pixel)Paeth((a >> shift) & 255, (b >> shift) & 255, (c >> shift) & 255) << shift;
+		return result;
+	}
+#endif
+
+	// Adds two rows of bytes (the Up filter), 16 at a time where there's vector support
+	void AddRows(const unsigned char* row, const unsigned char* previous, unsigned char* target, size_t size)
+	{
+		size_t i = 0;
+#if defined(PNG_SSE2)
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(row + i)), _mm_loadu_si128((const __m128i*)(previous + i)));
+			_mm_storeu_si128((__m128i*)(target + i), sum);
+		}
+#elif defined(PNG_NEON)
+		for (; i + 16 <= size; i += 16)
+			vst1q_u8(target + i, vaddq_u8(vld1q_u8(row + i), vld1q_u8(previous + i)));
+#endif
+		for (; i < size; i++)
+			target[i] = (unsigned char)(row[i] + previous[i]);
+	}
+
+	// --------------------------------------------------------
+	// Undoes one row's filter in place, for any pixel size.
+	// previous is the already unfiltered row above (zeros for
+	// the first row).  Only the rarer formats come this way.
+	// --------------------------------------------------------
+	bool UnfilterRow(unsigned char filter, unsigned char* row, const unsigned char* previous, size_t rowSize, unsigned int pixelSize)
+	{
+		switch (filter)
+		{
+		case 0:
+			return true;
+		case 1:
+			for (size_t i = pixelSize; i < rowSize; i++)
+				row[i] = (unsigned char)(row[i] + row[i - pixelSize]);
+			return true;
+		case 2:
+			AddRows(row, previous, row, rowSize);
+			return true;
+		case 3:
+			for (size_t i = 0; i < pixelSize; i++)
+				row[i] = (unsigned char)(row[i] + (previous[i] >> 1));
+			for (size_t i = pixelSize; i < rowSize; i++)
+				row[i] = (unsigned char)(row[i] + ((row[i - pixelSize] + previous[i]) >> 1));
+			return true;
+		case 4:
+			for (size_t i = 0; i < pixelSize; i++)
+				row[i] = (unsigned char)(row[i] + previous[i]);
+			for (size_t i = pixelSize; i < rowSize; i++)
+				row[i] = (unsigned char)(row[i] + Paeth(row[i - pixelSize], previous[i], previous[i - pixelSize]));
+			return true;
+		}
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Undoes one row's filter straight into the texture, for
+	// the 8 bit layouts the texture stores as they are (gray
+	// and RGBA), and for RGB, which gains an opaque alpha on
+	// the way.  previous is the texture row above.
+	// --------------------------------------------------------
+	template <unsigned int sourceSize>
+	bool UnfilterPixels(unsigned char filter, const unsigned char* row, const unsigned char* previous, unsigned char* target, unsigned int width)
+	{
+		const uint32_t alpha = sourceSize == 3 ? 0xFF000000 : 0;
+		if (filter == 0 && sourceSize == 4)
+		{
+			memcpy(target, row, (size_t)width * 4);
+			return true;
+		}
+		if (filter == 2 && sourceSize == 4)
+		{
+			AddRows(row, previous, target, (size_t)width * 4);
+			return true;
+		}
+		if (filter > 4)
+			return false;
+
+		Pixel left = LoadPixel(0);
+		Pixel upLeft = LoadPixel(0);
+		for (unsigned int x = 0; x < width; x++, row += sourceSize, previous += 4, target += 4)
+		{
+			uint32_t value = 0;
+			memcpy(&value, row, sourceSize);
+			Pixel pixel = LoadPixel(value);
+			uint32_t upValue;
+			memcpy(&upValue, previous, 4);
+			Pixel up = LoadPixel(upValue);
+
+			switch (filter)
+			{
+			case 1: pixel = AddPixels(pixel, left); break;
+			case 2: pixel = AddPixels(pixel, up); break;
+			case 3: pixel = AddPixels(pixel, AveragePixels(left, up)); break;
+			case 4: pixel = AddPixels(pixel, PaethPixels(left, up, upLeft)); break;
+			}
+
+			value = StorePixel(pixel) | alpha;
+			memcpy(target, &value, 4);
+			left = pixel;
+			upLeft = up;
+		}
+		return true;
+	}
+
+	// Single channel rows have nothing to gain from a pixel at a time in vectors
+	bool UnfilterGray(unsigned char filter, const unsigned char* row, const unsigned char* previous, unsigned char* target, unsigned int width)
+	{
+		if (filter == 0)
+			memcpy(target, row, width);
+		else if (filter == 2)
+			AddRows(row, previous, target, width);
+		else
+		{
+			memcpy(target, row, width);
+			return UnfilterRow(filter, target, previous, width, 1);
+		}
+		return true;
+	}
+
+	uint32_t ReadBigEndian(const unsigned char* bytes)
+	{
+		return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+	}
+
+	const unsigned char PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+
+	enum PngColorType
+	{
+		PNG_GRAY = 0,
+		PNG_RGB = 2,
+		PNG_PALETTE = 3,
+		PNG_GRAY_ALPHA = 4,
+		PNG_RGBA = 6
+	};
+
+	// Where each of Adam7's passes starts and how far apart its pixels are
+	const unsigned int ADAM7_START_X[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	const unsigned int ADAM7_START_Y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	const unsigned int ADAM7_STEP_X[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	const unsigned int ADAM7_STEP_Y[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	// Everything about an image outside its pixels
+	struct PngHeader
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int bitDepth;
+		unsigned int colorType;
+		bool interlaced;
+		unsigned int channels;
+		unsigned char palette[256][4];
+		bool hasKey;             //tRNS for gray and RGB: the one color that's transparent
+		uint16_t key[3];
+	};
+
+	// One sample (palette index, gray level or channel) from a row packed at any bit depth
+	inline unsigned int ReadSample(const unsigned char* row, size_t index, unsigned int bitDepth)
+	{
+		if (bitDepth == 8)
+			return row[index];
+		if (bitDepth == 16)
+			return (row[index * 2] << 8) | row[index * 2 + 1];
+		size_t bit = index * bitDepth;
+		return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1 << bitDepth) - 1);
+	}
+
+	// A sample scaled to 8 bits: low depths are stretched to fill the range, 16 bits are rounded down to it
+	inline unsigned char ScaleSample(unsigned int sample, unsigned int bitDepth)
+	{
+		if (bitDepth == 16)
+			return (unsigned char)((sample * 255 + 32895) >> 16);
+		return (unsigned char)(sample * 255 / ((1 << bitDepth) - 1));
+	}
+
+	// --------------------------------------------------------
+	// Copies an unfiltered row of any format into the texture,
+	// every step'th texel starting at target
+	// --------------------------------------------------------
+	void ExpandRow(const PngHeader& header, const unsigned char* row, unsigned int width, unsigned char* target, unsigned int step, bool toGray)
+	{
+		unsigned int depth = header.bitDepth;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			if (toGray)
+			{
+				target[(size_t)x * step] = ScaleSample(ReadSample(row, x, depth), depth);
+				continue;
+			}
+
+			unsigned char* texel = target + (size_t)x * step * 4;
+			switch (header.colorType)
+			{
+			case PNG_GRAY:
+			{
+				unsigned int gray = ReadSample(row, x, depth);
+				texel[0] = texel[1] = texel[2] = ScaleSample(gray, depth);
+				texel[3] = header.hasKey && gray == header.key[0] ? 0 : 255;
+				break;
+			}
+			case PNG_GRAY_ALPHA:
+				texel[0] = texel[1] = texel[2] = ScaleSample(ReadSample(row, x * 2, depth), depth);
+				texel[3] = ScaleSample(ReadSample(row, x * 2 + 1, depth), depth);
+				break;
+			case PNG_RGB:
+			{
+				unsigned int red = ReadSample(row, x * 3, depth);
+				unsigned int green = ReadSample(row, x * 3 + 1, depth);
+				unsigned int blue = ReadSample(row, x * 3 + 2, depth);
+				texel[0] = ScaleSample(red, depth);
+				texel[1] = ScaleSample(green, depth);
+				texel[2] = ScaleSample(blue, depth);
+				texel[3] = header.hasKey && red == header.key[0] && green == header.key[1] && blue == header.key[2] ? 0 : 255;
+				break;
+			}
+			case PNG_PALETTE:
+				memcpy(texel, header.palette[ReadSample(row, x, depth)], 4);
+				break;
+			case PNG_RGBA:
+				for (unsigned int channel = 0; channel < 4; channel++)
+					texel[channel] = ScaleSample(ReadSample(row, x * 4 + channel, depth), depth);
+				break;
+			}
+		}
+	}
+
+	// Rows of packed pixels, not counting the filter byte
+	size_t GetRowSize(const PngHeader& header, unsigned int width)
+	{
+		return ((size_t)width * header.channels * header.bitDepth + 7) / 8;
+	}
+
+	bool IsValidDepth(unsigned int colorType, unsigned int bitDepth)
+	{
+		switch (colorType)
+		{
+		case PNG_GRAY: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+		case PNG_PALETTE: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+		case PNG_RGB:
+		case PNG_GRAY_ALPHA:
+		case PNG_RGBA: return bitDepth == 8 || bitDepth == 16;
+		}
+		return false;
+	}
+}
+
+bool InflateZlib(const unsigned char* data, size_t size, unsigned char* output, size_t outputSize)
+{
+	//2 byte header: deflate with a window of at most 32KB, no preset dictionary
+	if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32))
+		return false;
+
+	BitReader reader = { data + 2, data + size, 0, 0, 0 };
+	size_t position = 0;
+
+	HuffmanTable literals;
+	HuffmanTable distances;
+	bool succeeded = true;
+	bool finalBlock = false;
+	while (succeeded && !finalBlock)
+	{
+		finalBlock = reader.Read(1) != 0;
+		unsigned int type = reader.Read(2);
+
+		if (type == 0)
+		{
+			//stored blocks start on a byte boundary, drop the partial byte and hand back any whole bytes still buffered
+			reader.Read(reader.bitCount & 7);
+			unsigned int buffered = reader.bitCount / 8;
+			if (buffered < reader.padding)
+			{
+				succeeded = false;
+				break;
+			}
+			reader.next -= buffered - reader.padding;
+			reader.bits = 0;
+			reader.bitCount = 0;
+			reader.padding = 0;
+
+			if (reader.end - reader.next < 4)
+			{
+				succeeded = false;
+				break;
+			}
+			unsigned int length = reader.next[0] | (reader.next[1] << 8);
+			unsigned int inverse = reader.next[2] | (reader.next[3] << 8);
+			reader.next += 4;
+			if ((length ^ 0xFFFF) != inverse || length > (size_t)(reader.end - reader.next) || length > outputSize - position)
+			{
+				succeeded = false;
+				break;
+			}
+			memcpy(output + position, reader.next, length);
+			reader.next += length;
+			position += length;
+		}
+		else if (type == 1)
+		{
+			uint8_t lengths[288 + 32];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 32);
+			succeeded = BuildHuffmanTable(literals, lengths, 288) &&
+				BuildHuffmanTable(distances, lengths + 288, 32) &&
+				InflateHuffmanBlock(reader, literals, distances, output, outputSize, position);
+		}
+		else if (type == 2)
+		{
+			succeeded = ReadDynamicTables(reader, literals, distances) &&
+				InflateHuffmanBlock(reader, literals, distances, output, outputSize, position);
+		}
+		else
+			succeeded = false;
+
+		if (reader.Overrun())
+			succeeded = false;
+	}
+
+	return succeeded && position == outputSize;
+}
+
+bool ReadPngSize(const unsigned char* data, size_t size, unsigned int& width, unsigned int& height)
+{
+	//IHDR is always the first chunk
+	if (size < 24 || memcmp(data, PNG_SIGNATURE, 8) != 0 || memcmp(data + 12, "IHDR", 4) != 0)
+		return false;
+	width = ReadBigEndian(data + 16);
+	height = ReadBigEndian(data + 20);
+	return true;
+}
+
+bool DecodePng(const unsigned char* data, size_t size, TextureData& texture)
+{
+	if (size < 8 || memcmp(data, PNG_SIGNATURE, 8) != 0)
+		return false;
+
+	PngHeader header = {};
+	bool hasHeader = false;
+	const unsigned char* firstData = nullptr;
+	size_t firstDataSize = 0;
+	std::vector<unsigned char> compressed;
+
+	//walk the chunks, gathering the header, palette, transparency and IDATs
+	size_t offset = 8;
+	while (offset + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(data + offset);
+		const unsigned char* type = data + offset + 4;
+		const unsigned char* chunk = data + offset + 8;
+		if (length > size - offset - 12)
+			return false;
+		offset += 12 + (size_t)length;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+				return false;
+			header.width = ReadBigEndian(chunk);
+			header.height = ReadBigEndian(chunk + 4);
+			header.bitDepth = chunk[8];
+			header.colorType = chunk[9];
+			header.interlaced = chunk[12] == 1;
+
+			//deflate, adaptive filtering, no interlacing or Adam7
+			if (!IsValidDepth(header.colorType, header.bitDepth) || chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1)
+				return false;
+			if (header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+				return false;
+			hasHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+			{
+				header.palette[i][0] = chunk[i * 3];
+				header.palette[i][1] = chunk[i * 3 + 1];
+				header.palette[i][2] = chunk[i * 3 + 2];
+				header.palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (header.colorType == PNG_PALETTE)
+			{
+				for (uint32_t i = 0; i < length && i < 256; i++)
+					header.palette[i][3] = chunk[i];
+			}
+			else if ((header.colorType == PNG_GRAY && length >= 2) || (header.colorType == PNG_RGB && length >= 6))
+			{
+				header.hasKey = true;
+				for (unsigned int i = 0; i < (header.colorType == PNG_GRAY ? 1u : 3u); i++)
+					header.key[i] = (uint16_t)((chunk[i * 2] << 8) | chunk[i * 2 + 1]);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			//a lone IDAT (the usual case) inflates from where it lies, only split data is gathered up
+			if (!firstData)
+			{
+				firstData = chunk;
+				firstDataSize = length;
+			}
+			else
+			{
+				if (compressed.empty())
+					compressed.assign(firstData, firstData + firstDataSize);
+				compressed.insert(compressed.end(), chunk, chunk + length);
+			}
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+	}
+
+	if (!hasHeader || !firstData)
+		return false;
+	if (!compressed.empty())
+	{
+		firstData = compressed.data();
+		firstDataSize = compressed.size();
+	}
+
+	switch (header.colorType)
+	{
+	case PNG_RGB: header.channels = 3; break;
+	case PNG_GRAY_ALPHA: header.channels = 2; break;
+	case PNG_RGBA: header.channels = 4; break;
+	default: header.channels = 1; break;
+	}
+	unsigned int width = header.width;
+	unsigned int height = header.height;
+
+	//each row is a filter byte followed by the packed pixels, Adam7's passes are whole images one after another
+	unsigned int passCount = header.interlaced ? 7 : 1;
+	unsigned int passWidths[7] = { width };
+	unsigned int passHeights[7] = { height };
+	size_t filteredSize = 0;
+	for (unsigned int pass = 0; pass < passCount; pass++)
+	{
+		if (header.interlaced)
+		{
+			passWidths[pass] = (width + ADAM7_STEP_X[pass] - 1 - ADAM7_START_X[pass]) / ADAM7_STEP_X[pass];
+			passHeights[pass] = (height + ADAM7_STEP_Y[pass] - 1 - ADAM7_START_Y[pass]) / ADAM7_STEP_Y[pass];
+		}
+		if (passWidths[pass] && passHeights[pass])
+			filteredSize += (GetRowSize(header, passWidths[pass]) + 1) * passHeights[pass];
+	}
+
+	std::vector<unsigned char> filtered(filteredSize);
+	if (!InflateZlib(firstData, firstDataSize, filtered.data(), filtered.size()))
+		return false;
+	compressed.clear();
+
+	//gray stays one channel unless tRNS makes some of it transparent
+	bool toGray = header.colorType == PNG_GRAY && !header.hasKey;
+	texture.Allocate(toGray ? TEXTURE_FORMAT_R8 : TEXTURE_FORMAT_RGBA8, width, height);
+	const TextureMip& level = texture.mips[0];
+	unsigned char* pixels = texture.GetMipData(0);
+
+	//8 bit gray, RGB and RGBA (nearly every texture) unfilter straight into the texture, predicting from its rows
+	bool direct = header.bitDepth == 8 && !header.interlaced &&
+		(toGray || (header.colorType == PNG_RGB && !header.hasKey) || header.colorType == PNG_RGBA);
+	if (direct)
+	{
+		size_t rowSize = GetRowSize(header, width);
+		std::vector<unsigned char> zeroRow(level.rowPitch, 0);
+		const unsigned char* previous = zeroRow.data();
+		for (unsigned int y = 0; y < height; y++)
+		{
+			const unsigned char* row = filtered.data() + y * (rowSize + 1);
+			unsigned char* target = pixels + (size_t)y * level.rowPitch;
+			bool unfiltered = toGray ? UnfilterGray(row[0], row + 1, previous, target, width) :
+				header.channels == 3 ? UnfilterPixels<3>(row[0], row + 1, previous, target, width) :
+				UnfilterPixels<4>(row[0], row + 1, previous, target, width);
+			if (!unfiltered)
+				return false;
+			previous = target;
+		}
+		return true;
+	}
+
+	//everything else unfilters in place, then spreads each pass's pixels out to where they belong
+	unsigned int texelSize = GetTexelSize(texture.format);
+	unsigned int pixelSize = (header.channels * header.bitDepth + 7) / 8;
+	unsigned char* row = filtered.data();
+	for (unsigned int pass = 0; pass < passCount; pass++)
+	{
+		if (!passWidths[pass] || !passHeights[pass])
+			continue;
+
+		size_t rowSize = GetRowSize(header, passWidths[pass]);
+		std::vector<unsigned char> zeroRow(rowSize, 0);
+		const unsigned char* previous = zeroRow.data();
+		unsigned int startX = header.interlaced ? ADAM7_START_X[pass] : 0;
+		unsigned int startY = header.interlaced ? ADAM7_START_Y[pass] : 0;
+		unsigned int stepX = header.interlaced ? ADAM7_STEP_X[pass] : 1;
+		unsigned int stepY = header.interlaced ? ADAM7_STEP_Y[pass] : 1;
+		for (unsigned int y = 0; y < passHeights[pass]; y++, row += rowSize + 1)
+		{
+			if (!UnfilterRow(row[0], row + 1, previous, rowSize, pixelSize))
+				return false;
+			previous = row + 1;
+
+			unsigned char* target = pixels + (size_t)(startY + y * stepY) * level.rowPitch + (size_t)startX * texelSize;
+			ExpandRow(header, row + 1, passWidths[pass], target, stepX, toGray);
+		}
+	}
+
+	return true;
+}
+
+bool LoadPng(const std::filesystem::path& fileName, TextureData& texture)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+	return DecodePng((const unsigned char*)file.GetData(), file.GetSize(), texture);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// Portable PNG decoding (no WIC), so textures can be decoded
+// on worker threads and on any platform
+//
+// - Handles every standard PNG: all color types and bit
+//   depths, palettes, tRNS transparency and Adam7 interlacing
+// - Grayscale becomes TEXTURE_FORMAT_R8 (RGBA8 if tRNS makes
+//   some of it transparent), the rest RGBA8; 16 bit channels
+//   are rounded to 8 bits and low bit depths stretched to 8
+// - 8 bit gray, RGB and RGBA (nearly every asset) unfilter
+//   straight into the texture's rows, with SSE2 (or NEON)
+//   doing the per pixel filters four channels at a time
+// - Returns false on corrupt or truncated files
+// --------------------------------------------------------
+
+// Decodes a PNG already in memory into a single mip level
+bool DecodePng(const unsigned char* data, size_t size, TextureData& texture);
+
+// Reads just the size from a PNG's header, returns false if it isn't a PNG
+bool ReadPngSize(const unsigned char* data, size_t size, unsigned int& width, unsigned int& height);
+
+// Memory maps and decodes a PNG file, returns false if it can't be opened or decoded
+bool LoadPng(const std::filesystem::path& fileName, TextureData& texture);
+
+// Inflates a zlib stream into exactly outputSize bytes, returns false on corrupt or short data
+bool InflateZlib(const unsigned char* data, size_t size, unsigned char* output, size_t outputSize);
@@ -11,6 +11,7 @@ static const float MIN_ROUGHNESS = 0.0000001f; // 6 zeros after decimal
 // Handy to have this as a constant
 static const float PI = 3.14159265359f;
 
+// Matches PackedVertex in Vertex.h (see Mesh::CreateInputLayout for the formats)
 struct VertexShaderInput
 {
 	// Data type
@@ -18,10 +19,10 @@ struct VertexShaderInput
 	//  |   Name          Semantic
 	//  |    |                |
 	//  v    v                v
-    float3 localPosition : POSITION; // XYZ position
-    float3 normal : NORMAL;
+    float4 localPosition : POSITION; // XYZ quantized to the mesh bounds, W bitangent sign
+    float2 normal : NORMAL; // Octahedral encoded
     float2 uv : TEXCOORD;
-    float3 tangent : TANGENT;
+    float2 tangent : TANGENT; // Octahedral encoded
 };
 
 struct VertexToPixel
@@ -49,7 +50,7 @@ struct VertexToPixelWithNormalMap
     float3 worldPosition : POSITION; // XYZ position
     float3 normal : NORMAL;
     float2 uv : TEXCOORD;
-    float3 tangent : TANGENT;
+    float4 tangent : TANGENT; // W bitangent sign
     float4 shadowMapPos : SHADOW_POSITION;
 };
 
@@ -65,6 +66,72 @@ struct Light
     float3 padding;
 };
 
+// Maps a quantized position back to mesh space using the mesh's positionOffset / positionScale
+float3 DequantizePosition(float4 position, float3 positionOffset, float3 positionScale)
+{
+    return positionOffset + position.xyz * positionScale;
+}
+
+// Expands an octahedral encoded unit vector
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0 ? -t : t;
+    return normalize(n);
+}
+
+// Tangent space normal from a normal map's red and green channels, z is rebuilt
+// from them (BC5 normal maps only store two channels)
+float3 UnpackNormalMap(float2 xy)
+{
+    float3 n = float3(xy * 2 - 1, 0);
+    n.z = sqrt(saturate(1 - dot(n.xy, n.xy)));
+    return n;
+}
+
+// Samples a texture that may be packed in an atlas, remap holding its UV scale (xy) and
+// offset (zw) in it.  UVs wrap inside the texture's own region, and the gradients come
+// from the unwrapped UVs so the wrap doesn't show up as a seam of blurry texels.
+float4 SampleRemapped(Texture2D map, SamplerState samp, float2 uv, float4 remap)
+{
+    return map.SampleGrad(samp, frac(uv) * remap.xy + remap.zw, ddx(uv) * remap.xy, ddy(uv) * remap.xy);
+}
+
+// Irradiance over pi from the sky in a direction (unit length), out of the nine spherical harmonic
+// coefficients Sky projects from its cubemap on the CPU (see ConvolveIrradianceSH9).  It's what a
+// white diffuse surface facing that way reflects, so it just multiplies the albedo.
+float3 SkyIrradiance(StructuredBuffer<float4> sh, float3 n)
+{
+    float3 irradiance =
+        sh[0].rgb * 0.282095f +
+        sh[1].rgb * (0.488603f * n.y) +
+        sh[2].rgb * (0.488603f * n.z) +
+        sh[3].rgb * (0.488603f * n.x) +
+        sh[4].rgb * (1.092548f * n.x * n.y) +
+        sh[5].rgb * (1.092548f * n.y * n.z) +
+        sh[6].rgb * (0.315392f * (3.0f * n.z * n.z - 1.0f)) +
+        sh[7].rgb * (1.092548f * n.x * n.z) +
+        sh[8].rgb * (0.546274f * (n.x * n.x - n.y * n.y));
+
+    //nine coefficients can ring slightly negative opposite a very bright spot
+    return max(irradiance, 0.0f);
+}
+
+// Specular light from the sky with the split sum approximation: the sky prefiltered on the CPU for
+// every roughness (see PrefilterEnvironment), times the BRDF integrated over it for that roughness
+// and view angle (see IntegrateBrdfLut).  Both are read with a clamping linear sampler.
+float3 SkySpecular(TextureCube prefiltered, Texture2D brdfLut, SamplerState samp, float3 n, float3 v, float roughness, float3 specularColor)
+{
+    //roughness steps evenly through the levels, from a mirror at the first to fully rough at the last
+    uint width, height, levels;
+    prefiltered.GetDimensions(0, width, height, levels);
+    float3 radiance = prefiltered.SampleLevel(samp, reflect(-v, n), roughness * (levels - 1.0f)).rgb;
+
+    float2 brdf = brdfLut.SampleLevel(samp, float2(saturate(dot(n, v)), roughness), 0).rg;
+    return radiance * (specularColor * brdf.x + brdf.y);
+}
+
 float Lambert(float3 normal, float3 lightDirection)
 {
     //get the opposite direction of the light to get the direction to the light
@@ -6,6 +6,8 @@ cbuffer externalData : register(b0)
     matrix world;
     matrix view;
     matrix projection;
+    float3 positionOffset;
+    float3 positionScale;
 };
 // --------------------------------------------------------
 // A simplified vertex shader for rendering to a shadow map
@@ -13,5 +15,5 @@ cbuffer externalData : register(b0)
 float4 main(VertexShaderInput input) : SV_POSITION
 {
     matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+    return mul(wvp, float4(DequantizePosition(input.localPosition, positionOffset, positionScale), 1.0f));
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Sky.h"
+#include <chrono>
 
 Sky::Sky(std::shared_ptr<Mesh> mesh, 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler, 
@@ -7,6 +8,9 @@ Sky::Sky(std::shared_ptr<Mesh> mesh,
 	std::shared_ptr<SimplePixelShader> pixelShader):
 	mesh(mesh),
 	sampler(sampler),
+	device(device),
+	irradiance(),
+	projectionMilliseconds(0.0f),
 	vs(vertexShader),
 	ps(pixelShader)
 {
@@ -28,9 +32,77 @@ Sky::~Sky()
 
 }
 
-void Sky::SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+void Sky::SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, const TextureData* const faces[6])
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SH9Color radiance;
+	SH9Color projected = {};
+	if (ProjectCubemapSH9(faces, radiance))
+		projected = ConvolveIrradianceSH9(radiance);
+	projectionMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	SetShaderResourceView(srv, projected);
+}
+
+void Sky::SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, const SH9Color& irradiance)
 {
 	this->srv = srv;
+	this->irradiance = irradiance;
+
+	//uploaded once here, every surface shader then reads the same buffer
+	DirectX::XMFLOAT4 coefficients[9];
+	for (int i = 0; i < 9; i++)
+	{
+		const DirectX::XMFLOAT3& coefficient = irradiance.coefficients[i];
+		coefficients[i] = DirectX::XMFLOAT4(coefficient.x, coefficient.y, coefficient.z, 0.0f);
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(coefficients);
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4);
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = coefficients;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	device->CreateBuffer(&bufferDesc, &initialData, buffer.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = 9;
+
+	irradianceSRV.Reset();
+	device->CreateShaderResourceView(buffer.Get(), &srvDesc, irradianceSRV.GetAddressOf());
+}
+
+const SH9Color& Sky::GetIrradiance()
+{
+	return irradiance;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::GetIrradianceSRV()
+{
+	return irradianceSRV;
+}
+
+float Sky::GetProjectionMilliseconds()
+{
+	return projectionMilliseconds;
+}
+
+void Sky::SetPrefilteredSRV(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> prefilteredSRV)
+{
+	this->prefilteredSRV = prefilteredSRV;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::GetPrefilteredSRV()
+{
+	return prefilteredSRV;
 }
 
 void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
@@ -46,6 +118,8 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 
 	vs->SetMatrix4x4("viewMatrix", camera->GetView());
 	vs->SetMatrix4x4("projectionMatrix", camera->GetProjection());
+	vs->SetFloat3("positionOffset", mesh->GetQuantization().positionOffset);
+	vs->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
 
 	vs->CopyAllBufferData();
 	ps->CopyAllBufferData();
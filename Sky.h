@@ -5,6 +5,8 @@
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "SphericalHarmonics.h"
+#include "TextureData.h"
 
 class Sky
 {
@@ -17,7 +19,26 @@ public:
 		std::shared_ptr<SimplePixelShader> pixelShader);
 	~Sky();
 	
-	void SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	//sets the cubemap along with the faces it was made from (+X -X +Y -Y +Z -Z), projecting them
+	//into the irradiance surfaces use for ambient light (black if the faces can't be projected)
+	void SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, const TextureData* const faces[6]);
+
+	//same, with irradiance already projected from this cubemap (see GetIrradiance), so there's no CPU work
+	void SetShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, const SH9Color& irradiance);
+
+	//irradiance over pi as nine spherical harmonic coefficients (see ConvolveIrradianceSH9)
+	const SH9Color& GetIrradiance();
+
+	//the same coefficients as a structured buffer of nine float4s, created once per cubemap (see SkyIrradiance)
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetIrradianceSRV();
+
+	//how long the last projection from faces took
+	float GetProjectionMilliseconds();
+
+	//the cubemap prefiltered for specular light, roughness rising evenly from 0 at its first level to 1 at its last
+	//(see PrefilterEnvironment), or null for no specular sky light
+	void SetPrefilteredSRV(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> prefilteredSRV);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetPrefilteredSRV();
 
 	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
 
@@ -26,6 +47,12 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+
+	SH9Color irradiance;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> irradianceSRV;
+	float projectionMilliseconds;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> prefilteredSRV;
 
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<SimpleVertexShader> vs;
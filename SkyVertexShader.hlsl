@@ -1,36 +1,33 @@
+#include "ShaderIncludes.hlsli"
+
 cbuffer DataPerEntity : register(b0)
 {
     matrix viewMatrix;
     matrix projectionMatrix;
+    float3 positionOffset;
+    float3 positionScale;
 }
 
-struct VertexShaderInput
-{
-    float3 position : POSITION; // XYZ position
-    float3 normal : NORMAL;
-    float2 uv : TEXCOORD;
-    float3 tangent : TANGENT;
-};
-
-struct VertexToPixel
+struct SkyVertexToPixel
 {
     float4 position : SV_POSITION;
     float3 sampleDir : DIRECTION;
 };
 
-VertexToPixel main(VertexShaderInput input)
+SkyVertexToPixel main(VertexShaderInput input)
 {
-    VertexToPixel output;
+    SkyVertexToPixel output;
+    float3 position = DequantizePosition(input.localPosition, positionOffset, positionScale);
     
     matrix viewMatrixNoTranslation = viewMatrix;
     viewMatrixNoTranslation._14 = 0;
     viewMatrixNoTranslation._24 = 0;
     viewMatrixNoTranslation._34 = 0;
     
-    output.position = mul(projectionMatrix, mul(viewMatrixNoTranslation, float4(input.position,1)));
+    output.position = mul(projectionMatrix, mul(viewMatrixNoTranslation, float4(position,1)));
     output.position.z = output.position.w;
     
-    output.sampleDir = input.position;
+    output.sampleDir = position;
     
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "SphericalHarmonics.h"
+#include "CubeMap.h"
+#include "Parallel.h"
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Blocks along each side of a face.  Band 2 barely changes across a block this small
+	// (under a degree), so a block's texels are summed first and share one basis evaluation.
+	const unsigned int BLOCKS_PER_SIDE = 128;
+
+	// Gamma decoding for every 8 bit value, light only adds up linearly
+	struct SrgbTable
+	{
+		float values[256];
+
+		SrgbTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	};
+
+	// The nine basis functions in a (unit) direction
+	void EvaluateBasis(float x, float y, float z, float basis[9])
+	{
+		basis[0] = 0.282095f;
+		basis[1] = 0.488603f * y;
+		basis[2] = 0.488603f * z;
+		basis[3] = 0.488603f * x;
+		basis[4] = 1.092548f * x * y;
+		basis[5] = 1.092548f * y * z;
+		basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+		basis[7] = 1.092548f * x * z;
+		basis[8] = 0.546274f * (x * x - y * y);
+	}
+
+	// What one task adds up, summed across tasks afterwards (in a fixed order, so results repeat exactly)
+	struct ProjectionSums
+	{
+		XMFLOAT4 coefficients[9];
+		float weight;
+	};
+}
+
+bool ProjectCubemapSH9(const TextureData* const faces[6], SH9Color& radiance)
+{
+	radiance = SH9Color();
+	for (int face = 0; face < 6; face++)
+	{
+		const TextureData* data = faces[face];
+		if (!data || data->mips.empty() || data->width != data->height || data->width != faces[0]->width ||
+			(data->format != TEXTURE_FORMAT_RGBA8 && data->format != TEXTURE_FORMAT_R8))
+			return false;
+	}
+
+	static const SrgbTable srgb;
+	unsigned int size = faces[0]->width;
+	unsigned int blockSize = (size + BLOCKS_PER_SIDE - 1) / BLOCKS_PER_SIDE;
+	unsigned int blocksPerSide = (size + blockSize - 1) / blockSize;
+
+	//one task per row of blocks
+	std::vector<ProjectionSums> partials(6 * blocksPerSide);
+	ParallelFor((unsigned int)partials.size(), [&](unsigned int task)
+	{
+		unsigned int face = task / blocksPerSide;
+		unsigned int firstRow = (task % blocksPerSide) * blockSize;
+		unsigned int lastRow = firstRow + blockSize < size ? firstRow + blockSize : size;
+
+		const TextureData& data = *faces[face];
+		unsigned int texelSize = GetTexelSize(data.format);
+
+		//linear color of every block in the row, just added up
+		std::vector<XMVECTOR> blockColors(blocksPerSide, XMVectorZero());
+		for (unsigned int y = firstRow; y < lastRow; y++)
+		{
+			const unsigned char* texel = data.GetMipData(0) + (size_t)y * data.mips[0].rowPitch;
+			for (unsigned int block = 0; block < blocksPerSide; block++)
+			{
+				unsigned int end = (block + 1) * blockSize < size ? (block + 1) * blockSize : size;
+				XMVECTOR sum = blockColors[block];
+				for (unsigned int x = block * blockSize; x < end; x++, texel += texelSize)
+				{
+					sum = XMVectorAdd(sum, texelSize == 1 ?
+						XMVectorReplicate(srgb.values[texel[0]]) :
+						XMVectorSet(srgb.values[texel[0]], srgb.values[texel[1]], srgb.values[texel[2]], 0.0f));
+				}
+				blockColors[block] = sum;
+			}
+		}
+
+		XMVECTOR center = XMLoadFloat3(&CUBE_FACE_AXES[face].center);
+		XMVECTOR uAxis = XMLoadFloat3(&CUBE_FACE_AXES[face].u);
+		XMVECTOR vAxis = XMLoadFloat3(&CUBE_FACE_AXES[face].v);
+		float texelStep = 2.0f / size;
+		float v = (firstRow + lastRow) * 0.5f * texelStep - 1.0f;
+		XMVECTOR rowCenter = XMVectorMultiplyAdd(vAxis, XMVectorReplicate(v), center);
+
+		XMVECTOR sums[9];
+		for (int i = 0; i < 9; i++)
+			sums[i] = XMVectorZero();
+		float weightSum = 0.0f;
+
+		float basis[9];
+		for (unsigned int block = 0; block < blocksPerSide; block++)
+		{
+			unsigned int firstColumn = block * blockSize;
+			unsigned int lastColumn = firstColumn + blockSize < size ? firstColumn + blockSize : size;
+			float u = (firstColumn + lastColumn) * 0.5f * texelStep - 1.0f;
+
+			//the solid angle of a texel on a unit cube face falls off as 1 / distance^3
+			float inverseLength = 1.0f / sqrtf(1.0f + u * u + v * v);
+			float texelWeight = inverseLength * inverseLength * inverseLength;
+			weightSum += texelWeight * (lastColumn - firstColumn) * (lastRow - firstRow);
+
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVectorScale(XMVectorMultiplyAdd(uAxis, XMVectorReplicate(u), rowCenter), inverseLength));
+			EvaluateBasis(direction.x, direction.y, direction.z, basis);
+
+			XMVECTOR color = XMVectorScale(blockColors[block], texelWeight);
+			for (int i = 0; i < 9; i++)
+				sums[i] = XMVectorMultiplyAdd(color, XMVectorReplicate(basis[i]), sums[i]);
+		}
+
+		ProjectionSums& partial = partials[task];
+		for (int i = 0; i < 9; i++)
+			XMStoreFloat4(&partial.coefficients[i], sums[i]);
+		partial.weight = weightSum;
+	});
+
+	//the weights only need to be right relative to each other, together they cover the whole sphere
+	double totals[9][3] = {};
+	double weightTotal = 0.0;
+	for (const ProjectionSums& partial : partials)
+	{
+		for (int i = 0; i < 9; i++)
+		{
+			totals[i][0] += partial.coefficients[i].x;
+			totals[i][1] += partial.coefficients[i].y;
+			totals[i][2] += partial.coefficients[i].z;
+		}
+		weightTotal += partial.weight;
+	}
+	double scale = 4.0 * XM_PI / weightTotal;
+	for (int i = 0; i < 9; i++)
+		radiance.coefficients[i] = XMFLOAT3((float)(totals[i][0] * scale), (float)(totals[i][1] * scale), (float)(totals[i][2] * scale));
+	return true;
+}
+
+SH9Color ConvolveIrradianceSH9(const SH9Color& radiance)
+{
+	//the clamped cosine's bands are pi, 2pi/3 and pi/4, divided by pi for a Lambertian surface
+	const float bandScales[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+	SH9Color irradiance;
+	for (int i = 0; i < 9; i++)
+	{
+		float scale = bandScales[i == 0 ? 0 : i < 4 ? 1 : 2];
+		XMStoreFloat3(&irradiance.coefficients[i], XMVectorScale(XMLoadFloat3(&radiance.coefficients[i]), scale));
+	}
+	return irradiance;
+}
+
+XMFLOAT3 EvaluateSH9(const SH9Color& sh, XMFLOAT3 direction)
+{
+	float basis[9];
+	EvaluateBasis(direction.x, direction.y, direction.z, basis);
+
+	XMVECTOR sum = XMVectorZero();
+	for (int i = 0; i < 9; i++)
+		sum = XMVectorMultiplyAdd(XMLoadFloat3(&sh.coefficients[i]), XMVectorReplicate(basis[i]), sum);
+
+	XMFLOAT3 value;
+	XMStoreFloat3(&value, sum);
+	return value;
+}
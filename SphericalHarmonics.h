@@ -0,0 +1,41 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// The first nine real spherical harmonics (bands 0 - 2) of
+// an RGB function on the sphere, in the usual order:
+// Y00, Y1-1, Y10, Y11, Y2-2, Y2-1, Y20, Y21, Y22
+//
+// Nine are enough for irradiance: the cosine lobe it's
+// convolved with has almost nothing above band 2
+// (Ramamoorthi & Hanrahan, "An Efficient Representation
+// for Irradiance Environment Maps")
+// --------------------------------------------------------
+struct SH9Color
+{
+	DirectX::XMFLOAT3 coefficients[9];
+};
+
+// --------------------------------------------------------
+// Projects the linear radiance of a cubemap's faces onto
+// the first nine spherical harmonics
+//
+// - Faces are in D3D order (+X, -X, +Y, -Y, +Z, -Z), square,
+//   all one size, gamma encoded RGBA8 (or R8)
+// - Every texel is weighted by the solid angle it covers,
+//   so the crowded corners of a face don't count extra
+// - Texels are summed in small blocks (with DirectXMath
+//   vectors) that each evaluate the basis once, and rows of
+//   blocks are split across the worker threads
+// - Device free.  Returns false if the faces don't match.
+// --------------------------------------------------------
+bool ProjectCubemapSH9(const TextureData* const faces[6], SH9Color& radiance);
+
+// Irradiance over pi from projected radiance (the cosine lobe convolution), so evaluating it at a
+// normal gives what a white Lambertian surface reflects, ready to multiply by albedo
+SH9Color ConvolveIrradianceSH9(const SH9Color& radiance);
+
+// The projected function in a direction (unit length)
+DirectX::XMFLOAT3 EvaluateSH9(const SH9Color& sh, DirectX::XMFLOAT3 direction);
@@ -0,0 +1,141 @@
+#include "TangentSpace.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many triangles a task isn't worth its own accumulation arrays
+	const size_t MIN_TRIANGLES_PER_TASK = 32768;
+
+	// Vertices handled per task when summing and orthonormalizing
+	const size_t VERTICES_PER_TASK = 16384;
+
+	// --------------------------------------------------------
+	// Adds the UV space tangent of triangles [first, last) to
+	// every vertex they touch (weighted by area, as Lengyel's
+	// method naturally does).  Instead of a full bitangent, w
+	// collects each triangle's area signed by its handedness
+	// (the sign of the UV determinant), which is all the
+	// bitangent sign needs.
+	// --------------------------------------------------------
+	void AccumulateTriangles(const Vertex* vertices, const unsigned int* indices, size_t first, size_t last, XMFLOAT4A* sums)
+	{
+		XMVECTOR epsilon = XMVectorReplicate(FLT_EPSILON);
+
+		for (size_t t = first; t < last; t += 4)
+		{
+			size_t count = std::min<size_t>(4, last - t);
+
+			// Edges and UV deltas of 4 triangles, one triangle per row
+			// (missing rows stay zero and fail the degenerate test below)
+			XMMATRIX edge1 = {}, edge2 = {}, uvDeltas = {};
+			for (size_t l = 0; l < count; l++)
+			{
+				const Vertex& v1 = vertices[indices[(t + l) * 3]];
+				const Vertex& v2 = vertices[indices[(t + l) * 3 + 1]];
+				const Vertex& v3 = vertices[indices[(t + l) * 3 + 2]];
+
+				XMVECTOR p1 = XMLoadFloat3(&v1.position);
+				edge1.r[l] = XMVectorSubtract(XMLoadFloat3(&v2.position), p1);
+				edge2.r[l] = XMVectorSubtract(XMLoadFloat3(&v3.position), p1);
+				uvDeltas.r[l] = XMVectorSubtract(
+					XMVectorSet(v2.uv.x, v2.uv.y, v3.uv.x, v3.uv.y),
+					XMVectorSet(v1.uv.x, v1.uv.y, v1.uv.x, v1.uv.y));
+			}
+
+			//transpose so each vector holds one component of all 4 triangles
+			edge1 = XMMatrixTranspose(edge1);
+			edge2 = XMMatrixTranspose(edge2);
+			uvDeltas = XMMatrixTranspose(uvDeltas);
+			XMVECTOR s1 = uvDeltas.r[0], t1 = uvDeltas.r[1];
+			XMVECTOR s2 = uvDeltas.r[2], t2 = uvDeltas.r[3];
+
+			//a determinant lost in the rounding of its own terms means the UVs are degenerate
+			XMVECTOR a = XMVectorMultiply(s1, t2);
+			XMVECTOR b = XMVectorMultiply(s2, t1);
+			XMVECTOR determinant = XMVectorSubtract(a, b);
+			XMVECTOR valid = XMVectorGreater(XMVectorAbs(determinant), XMVectorMultiply(XMVectorAdd(XMVectorAbs(a), XMVectorAbs(b)), epsilon));
+			XMVECTOR r = XMVectorSelect(XMVectorZero(), XMVectorReciprocal(determinant), valid);
+
+			XMMATRIX tangents;
+			for (int c = 0; c < 3; c++)
+				tangents.r[c] = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(t2, edge1.r[c]), XMVectorMultiply(t1, edge2.r[c])), r);
+
+			//twice the area from the edge cross product, negated for mirrored UVs
+			XMVECTOR nx = XMVectorSubtract(XMVectorMultiply(edge1.r[1], edge2.r[2]), XMVectorMultiply(edge1.r[2], edge2.r[1]));
+			XMVECTOR ny = XMVectorSubtract(XMVectorMultiply(edge1.r[2], edge2.r[0]), XMVectorMultiply(edge1.r[0], edge2.r[2]));
+			XMVECTOR nz = XMVectorSubtract(XMVectorMultiply(edge1.r[0], edge2.r[1]), XMVectorMultiply(edge1.r[1], edge2.r[0]));
+			XMVECTOR area = XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(nx, nx), XMVectorMultiply(ny, ny)), XMVectorMultiply(nz, nz)));
+			XMVECTOR handedness = XMVectorSelect(XMVectorNegate(area), area, XMVectorGreater(determinant, XMVectorZero()));
+			tangents.r[3] = XMVectorSelect(XMVectorZero(), handedness, valid);
+
+			//back to one triangle per row, then scatter to each triangle's three vertices
+			tangents = XMMatrixTranspose(tangents);
+			for (size_t l = 0; l < count; l++)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					XMFLOAT4A& sum = sums[indices[(t + l) * 3 + k]];
+					XMStoreFloat4A(&sum, XMVectorAdd(XMLoadFloat4A(&sum), tangents.r[l]));
+				}
+			}
+		}
+	}
+}
+
+void GenerateTangents(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	size_t triangleCount = indexCount / 3;
+	size_t taskCount = std::min<size_t>(GetWorkerCount(), std::max<size_t>(1, triangleCount / MIN_TRIANGLES_PER_TASK));
+	size_t trianglesPerTask = (triangleCount + taskCount - 1) / taskCount;
+
+	std::vector<std::vector<XMFLOAT4A>> sums(taskCount);
+	ParallelFor((unsigned int)taskCount, [&](unsigned int task)
+	{
+		sums[task].assign(vertexCount, XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f));
+		size_t first = std::min(triangleCount, task * trianglesPerTask);
+		size_t last = std::min(triangleCount, first + trianglesPerTask);
+		AccumulateTriangles(vertices, indices, first, last, sums[task].data());
+	});
+
+	// Sum the tasks (always in the same order, so results don't depend on
+	// thread timing), then make each tangent orthogonal to its normal.
+	size_t vertexTaskCount = (vertexCount + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+	ParallelFor((unsigned int)vertexTaskCount, [&](unsigned int task)
+	{
+		size_t first = task * VERTICES_PER_TASK;
+		size_t last = std::min(vertexCount, first + VERTICES_PER_TASK);
+		for (size_t v = first; v < last; v++)
+		{
+			XMVECTOR sum = XMVectorZero();
+			for (const std::vector<XMFLOAT4A>& taskSums : sums)
+				sum = XMVectorAdd(sum, XMLoadFloat4A(&taskSums[v]));
+			float handedness = XMVectorGetW(sum);
+			XMVECTOR tangent = XMVectorSetW(sum, 0.0f);
+
+			//Gram-Schmidt against the normal
+			XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&vertices[v].normal));
+			tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+			//nothing usable accumulated, so any direction in the tangent plane will do
+			if (XMVectorGetX(XMVector3LengthSq(tangent)) <= FLT_MIN)
+			{
+				XMVECTOR axis = fabsf(XMVectorGetX(normal)) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+				tangent = XMVector3Cross(axis, normal);
+			}
+			tangent = XMVector3Normalize(tangent);
+
+			//the shaders' cross(T, N) already matches unmirrored UVs (our winding and flipped v), so only mirrored ones flip
+			float sign = handedness < 0.0f ? -1.0f : 1.0f;
+			XMStoreFloat4(&vertices[v].tangent, XMVectorSetW(tangent, sign));
+		}
+	});
+}
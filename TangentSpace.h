@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Generates per-vertex tangent frames from a triangle list
+//
+// - tangent.xyz is the unit tangent, orthogonal to the normal
+// - tangent.w is the bitangent sign (+1 or -1), so shaders
+//   rebuild the bitangent as cross(T, N) * tangent.w and
+//   mirrored UVs get a correctly flipped normal map
+// - Triangles with degenerate UVs don't contribute, and
+//   vertices left without a tangent get an arbitrary one
+//   perpendicular to their normal
+//
+// Triangles are processed 4 at a time with DirectXMath and
+// split across the worker threads, each accumulating into
+// its own arrays that are summed once at the end.
+//
+// Based on Lengyel's method, listing 7.4 of
+// http://foundationsofgameenginedev.com/FGED2-sample.pdf
+// --------------------------------------------------------
+void GenerateTangents(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
@@ -0,0 +1,82 @@
+#include "BlockCompression.h"
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+// --------------------------------------------------------
+// Compresses every PNG under Assets/PBR and Assets/Textures
+// to BC1, BC4, BC5 and BC7, expands each back and checks
+// its PSNR over the channels the format keeps against a
+// floor, then prints the worst texture and the MB/s of
+// source each format encodes.  --files limits how many
+// textures are compressed.
+// --------------------------------------------------------
+
+struct FormatTest
+{
+	TextureFormat format;
+	const char* name;
+	unsigned int channels;
+	float floor;			// dB every bundled texture has to reach
+	float worst;
+	double milliseconds;
+	double sourceBytes;
+};
+
+int main(int argc, char** argv)
+{
+	size_t fileCount = (size_t)GetArgument(argc, argv, "files", 1000);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::filesystem::path> files;
+	for (const char* directory : { "Assets/PBR", "Assets/Textures" })
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory))
+		{
+			if (entry.path().extension() == ".png")
+				files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	files.resize(std::min(files.size(), fileCount));
+
+	//the floors sit a few dB under the worst bundled texture, so a regression shows but noise doesn't
+	FormatTest formats[] =
+	{
+		{ TEXTURE_FORMAT_BC1, "BC1", 3, 26, HUGE_VALF, 0, 0 },
+		{ TEXTURE_FORMAT_BC4, "BC4", 1, 32, HUGE_VALF, 0, 0 },
+		{ TEXTURE_FORMAT_BC5, "BC5", 2, 32, HUGE_VALF, 0, 0 },
+		{ TEXTURE_FORMAT_BC7, "BC7", 4, 30, HUGE_VALF, 0, 0 },
+	};
+
+	for (const std::filesystem::path& file : files)
+	{
+		TextureData source;
+		CHECK(LoadPng(file, source));
+		printf("%-28s %4ux%-4u", file.filename().string().c_str(), source.width, source.height);
+		for (FormatTest& test : formats)
+		{
+			TextureData compressed, decompressed;
+			test.milliseconds += TimeMilliseconds(runs, [&]() { CHECK(CompressTexture(source, test.format, compressed)); });
+			test.sourceBytes += (double)source.pixels.size();
+			CHECK(compressed.format == test.format && compressed.pixels.size() == GetTextureBytes(test.format, source.width, source.height, 1));
+			CHECK(DecompressTexture(compressed, decompressed));
+
+			float psnr = ComputePsnr(source, decompressed, test.channels);
+			CHECK(psnr >= test.floor);
+			test.worst = std::min(test.worst, psnr);
+			printf("  %s %5.1f dB", test.name, psnr);
+		}
+		printf("\n");
+	}
+
+	for (const FormatTest& test : formats)
+	{
+		printf("%s over %u channel(s): worst %.1f dB (floor %.0f), %.1f MB/s of source\n",
+			test.name, test.channels, test.worst, test.floor, test.sourceBytes / 1048576.0 / test.milliseconds * 1000.0);
+	}
+
+	return GetFailureCount();
+}
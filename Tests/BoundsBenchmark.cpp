@@ -0,0 +1,132 @@
+#include "Bounds.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times ComputeBounds over 10M positions (unless --millions
+// says otherwise), packed and read out of a vertex array,
+// next to a plain scalar loop, and checks the box is exact
+// and the sphere holds every point, for the bundled models
+// too.  The request's bar is a few milliseconds for 10M.
+// --------------------------------------------------------
+
+// Box and box centered sphere the way a straightforward loader would, one point at a time
+static Bounds ComputeBoundsScalar(const XMFLOAT3* positions, size_t count, size_t stride)
+{
+	Bounds bounds = {};
+	const unsigned char* bytes = (const unsigned char*)positions;
+	bounds.boxMin = bounds.boxMax = positions[0];
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = *(const XMFLOAT3*)(bytes + i * stride);
+		bounds.boxMin = XMFLOAT3(std::min(bounds.boxMin.x, p.x), std::min(bounds.boxMin.y, p.y), std::min(bounds.boxMin.z, p.z));
+		bounds.boxMax = XMFLOAT3(std::max(bounds.boxMax.x, p.x), std::max(bounds.boxMax.y, p.y), std::max(bounds.boxMax.z, p.z));
+	}
+
+	XMFLOAT3 center((bounds.boxMin.x + bounds.boxMax.x) * 0.5f, (bounds.boxMin.y + bounds.boxMax.y) * 0.5f, (bounds.boxMin.z + bounds.boxMax.z) * 0.5f);
+	float radiusSq = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = *(const XMFLOAT3*)(bytes + i * stride);
+		float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+		radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+	}
+	bounds.sphereCenter = center;
+	bounds.sphereRadius = sqrtf(radiusSq);
+	return bounds;
+}
+
+// Whether the bounds hold every point, with the box matching the scalar one exactly
+static bool IsValid(const Bounds& bounds, const Bounds& scalar, const XMFLOAT3* positions, size_t count, size_t stride)
+{
+	if (memcmp(&bounds.boxMin, &scalar.boxMin, sizeof(XMFLOAT3)) != 0 || memcmp(&bounds.boxMax, &scalar.boxMax, sizeof(XMFLOAT3)) != 0)
+		return false;
+
+	const unsigned char* bytes = (const unsigned char*)positions;
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = *(const XMFLOAT3*)(bytes + i * stride);
+		float dx = p.x - bounds.sphereCenter.x, dy = p.y - bounds.sphereCenter.y, dz = p.z - bounds.sphereCenter.z;
+		if (sqrtf(dx * dx + dy * dy + dz * dz) > bounds.sphereRadius * 1.00001f)
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = (size_t)(GetArgument(argc, argv, "millions", 10) * 1000000);
+	int runs = (int)GetArgument(argc, argv, "runs", 5);
+	printf("%.1fM positions, %u worker thread(s)\n", count / 1000000.0, GetWorkerCount());
+
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models)
+	{
+		ObjData data;
+		bool loaded = LoadObj(std::filesystem::path("Assets/Models") / model, data);
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		BuildObjVertices(data, vertices, indices);
+		Bounds bounds = ComputeBounds(&vertices[0].position, vertices.size(), sizeof(Vertex));
+		Bounds scalar = ComputeBoundsScalar(&vertices[0].position, vertices.size(), sizeof(Vertex));
+		CHECK(IsValid(bounds, scalar, &vertices[0].position, vertices.size(), sizeof(Vertex)));
+		printf("%-22s sphere radius %.4f (box centered %.4f)\n", model, bounds.sphereRadius, scalar.sphereRadius);
+	}
+
+	//a stretched gaussian cloud, so the box centered sphere isn't already the best one
+	std::mt19937 random(3);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+	std::vector<XMFLOAT3> positions(count);
+	for (XMFLOAT3& p : positions)
+		p = XMFLOAT3(gaussian(random), gaussian(random) * 0.5f, gaussian(random) * 2.0f);
+
+	std::vector<Vertex> vertices(count);
+	for (size_t i = 0; i < count; i++)
+		vertices[i].position = positions[i];
+
+	Bounds bounds = {}, scalar = {};
+	double scalarTime = TimeMilliseconds(runs, [&]() { scalar = ComputeBoundsScalar(positions.data(), count, sizeof(XMFLOAT3)); });
+	double packedTime = TimeMilliseconds(runs, [&]() { bounds = ComputeBounds(positions.data(), count); });
+	CHECK(IsValid(bounds, scalar, positions.data(), count, sizeof(XMFLOAT3)));
+
+	//ranges are bounded on their own and merged, so the sphere may be a little looser than the two pass one
+	CHECK(bounds.sphereRadius <= scalar.sphereRadius * 1.02f);
+
+	Bounds strided = {};
+	double stridedTime = TimeMilliseconds(runs, [&]() { strided = ComputeBounds(&vertices[0].position, count, sizeof(Vertex)); });
+	CHECK(memcmp(&strided, &bounds, sizeof(Bounds)) == 0);
+
+	printf("scalar loop (two passes):  %8.2f ms  %6.2f ns/position  radius %.3f\n", scalarTime, scalarTime * 1e6 / count, scalar.sphereRadius);
+	printf("ComputeBounds, packed:     %8.2f ms  %6.2f ns/position  radius %.3f  (%.1fx)\n", packedTime, packedTime * 1e6 / count, bounds.sphereRadius, scalarTime / packedTime);
+	printf("ComputeBounds, in Vertex:  %8.2f ms  %6.2f ns/position\n", stridedTime, stridedTime * 1e6 / count);
+
+	//world bounds still hold the transformed points
+	XMMATRIX world = XMMatrixScaling(2, 1, 1) * XMMatrixRotationRollPitchYaw(0.3f, 0.5f, 0.1f) * XMMatrixTranslation(5, 0, 0);
+	size_t sample = std::min<size_t>(count, 100000);
+	Bounds local = ComputeBounds(positions.data(), sample);
+	Bounds worldBounds = TransformBounds(world, local);
+	bool contained = true;
+	for (size_t i = 0; i < sample; i++)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&positions[i]), world));
+		float dx = p.x - worldBounds.sphereCenter.x, dy = p.y - worldBounds.sphereCenter.y, dz = p.z - worldBounds.sphereCenter.z;
+		contained = contained && sqrtf(dx * dx + dy * dy + dz * dz) <= worldBounds.sphereRadius * 1.00001f &&
+			p.x >= worldBounds.boxMin.x - 1e-4f && p.y >= worldBounds.boxMin.y - 1e-4f && p.z >= worldBounds.boxMin.z - 1e-4f &&
+			p.x <= worldBounds.boxMax.x + 1e-4f && p.y <= worldBounds.boxMax.y + 1e-4f && p.z <= worldBounds.boxMax.z + 1e-4f;
+	}
+	CHECK(contained);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,248 @@
+#include "EntityStore.h"
+#include "TestHelpers.h"
+#include "Transform.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Checks EntityStore's ids, archetype moves, queries and
+// transform bookkeeping, then spawns, iterates and destroys
+// 1M entities (unless --millions says otherwise) next to
+// the shared_ptr<GameEntity> array Game used to keep,
+// rebuilt here without its device parts.
+// --------------------------------------------------------
+
+// What a mesh contributed to an entity's per frame work
+struct BenchmarkMesh
+{
+	Bounds bounds;
+	unsigned int version;
+};
+
+// The old GameEntity: a transform, shared mesh and material, and cached world bounds and lod
+struct LegacyEntity
+{
+	Transform transform;
+	std::shared_ptr<BenchmarkMesh> mesh;
+	std::shared_ptr<int> material;
+	unsigned int lod = 0;
+	float projectedSize = 0;
+	Bounds worldBounds = {};
+	unsigned int worldBoundsVersion = 0;
+	unsigned int worldBoundsMeshVersion = 0;
+	bool worldBoundsValid = false;
+	std::vector<int> visibleRanges;
+
+	LegacyEntity(std::shared_ptr<BenchmarkMesh> mesh, std::shared_ptr<int> material) : mesh(mesh), material(material) {}
+
+	Bounds GetWorldBounds()
+	{
+		unsigned int version = transform.GetMatrixVersion();
+		if (!worldBoundsValid || version != worldBoundsVersion || mesh->version != worldBoundsMeshVersion)
+		{
+			XMFLOAT4X4 world = transform.GetWorldMatrix();
+			worldBounds = TransformBounds(XMLoadFloat4x4(&world), mesh->bounds);
+			worldBoundsVersion = version;
+			worldBoundsMeshVersion = mesh->version;
+			worldBoundsValid = true;
+		}
+		return worldBounds;
+	}
+};
+
+static const unsigned int DRAWN = ENTITY_TRANSFORM | ENTITY_MESH | ENTITY_MATERIAL | ENTITY_BOUNDS | ENTITY_LOD;
+
+static void TestStore()
+{
+	TransformStore transforms;
+	TransformHierarchy hierarchy(&transforms);
+	{
+		EntityStore entities(&transforms, &hierarchy);
+
+		//a destroyed id stays dead once its slot is handed out again
+		EntityId a = entities.Create(DRAWN);
+		EntityId b = entities.Create(DRAWN);
+		entities.Destroy(a);
+		EntityId c = entities.Create(ENTITY_TRANSFORM);
+		CHECK(c.index == a.index && c.generation != a.generation);
+		CHECK(!entities.IsAlive(a) && entities.IsAlive(b) && entities.IsAlive(c));
+		CHECK(!entities.IsAlive(EntityId{ 0, 0 }));
+		entities.Destroy(a);
+		CHECK(entities.GetCount() == 2 && transforms.GetCount() == 2);
+
+		//destroying moves the last row into the hole, without mixing up whose data is whose
+		std::vector<EntityId> ids;
+		for (unsigned int i = 0; i < 10; i++)
+		{
+			ids.push_back(entities.Create(DRAWN));
+			entities.SetMesh(ids.back(), i);
+			entities.SetMaterial(ids.back(), 100 + i);
+		}
+		entities.Destroy(ids[3]);
+		entities.Destroy(ids[0]);
+		bool kept = true;
+		for (unsigned int i = 0; i < 10; i++)
+		{
+			if (i != 0 && i != 3)
+				kept = kept && entities.GetMesh(ids[i]) == i && entities.GetMaterial(ids[i]) == 100 + i;
+		}
+		CHECK(kept);
+
+		//changing components keeps the ones the old and new sets share, and the transform slot
+		unsigned int transform = entities.GetTransform(ids[5]);
+		entities.AddComponents(ids[5], ENTITY_MOTION);
+		CHECK(entities.GetComponents(ids[5]) == (DRAWN | ENTITY_MOTION));
+		entities.RemoveComponents(ids[5], ENTITY_MATERIAL);
+		CHECK(entities.GetComponents(ids[5]) == ((DRAWN | ENTITY_MOTION) & ~ENTITY_MATERIAL));
+		CHECK(entities.GetMesh(ids[5]) == 5 && entities.GetTransform(ids[5]) == transform);
+
+		//a query sees every archetype with at least those components, including ones made after it was cached
+		unsigned int before = 0, after = 0;
+		for (EntityArchetype* archetype : entities.Query(ENTITY_TRANSFORM | ENTITY_MESH))
+			before += archetype->GetCount();
+		entities.Create(ENTITY_TRANSFORM | ENTITY_MESH | ENTITY_LOD);
+		for (EntityArchetype* archetype : entities.Query(ENTITY_TRANSFORM | ENTITY_MESH))
+			after += archetype->GetCount();
+		CHECK(before == 9 && after == 10);
+
+		//losing the transform component hands the slot back
+		unsigned int live = transforms.GetCount();
+		entities.RemoveComponents(ids[6], ENTITY_TRANSFORM);
+		CHECK(transforms.GetCount() == live - 1);
+	}
+
+	//so does the store going away
+	CHECK(transforms.GetCount() == 0);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = (unsigned int)(GetArgument(argc, argv, "millions", 1) * 1000000);
+	TestStore();
+
+	std::mt19937 random(3);
+	std::vector<std::shared_ptr<BenchmarkMesh>> meshes;
+	std::vector<std::shared_ptr<int>> materials;
+	for (int i = 0; i < 8; i++)
+	{
+		meshes.push_back(std::make_shared<BenchmarkMesh>(BenchmarkMesh{ { XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1), XMFLOAT3(0, 0, 0), 1.7f }, 1 }));
+		materials.push_back(std::make_shared<int>(i));
+	}
+	std::vector<unsigned int> order(count);
+	for (unsigned int i = 0; i < count; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), random);
+	unsigned long long sink = 0;
+
+	//the old arrays: spawn, bounds and lod, a pass over just materials and lods, destroy in random order
+	{
+		std::vector<std::shared_ptr<LegacyEntity>> entities(count);
+		double spawn = TimeMilliseconds(1, [&]()
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				entities[i] = std::make_shared<LegacyEntity>(meshes[i & 7], materials[i % 5]);
+				entities[i]->transform.SetPosition((float)(i % 1000), 0, (float)(i / 1000));
+			}
+			TransformHierarchy::GetDefault().UpdateMatrices();
+		});
+		double iterate = TimeMilliseconds(5, [&]()
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				Bounds bounds = entities[i]->GetWorldBounds();
+				entities[i]->lod = bounds.sphereRadius > 1.0f;
+				sink += *entities[i]->material + entities[i]->lod;
+			}
+		});
+		double columns = TimeMilliseconds(5, [&]()
+		{
+			for (unsigned int i = 0; i < count; i++)
+				sink += *entities[i]->material + (unsigned long long)entities[i]->projectedSize + entities[i]->lod;
+		});
+		double destroy = TimeMilliseconds(1, [&]()
+		{
+			for (unsigned int i : order)
+				entities[i].reset();
+		});
+		printf("%u entities\n", count);
+		printf("shared_ptr<GameEntity>  spawn %8.1f ms  iterate %7.2f ms  material+lod %7.2f ms  destroy %8.1f ms\n", spawn, iterate, columns, destroy);
+	}
+
+	//the store, the same passes over query results, then a full respawn into reused slots
+	TransformStore transforms;
+	TransformHierarchy hierarchy(&transforms);
+	EntityStore entities(&transforms, &hierarchy);
+	std::vector<EntityId> ids(count);
+	auto spawnAll = [&]()
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			ids[i] = entities.Create(DRAWN);
+			entities.SetMesh(ids[i], i & 7);
+			entities.SetMaterial(ids[i], i % 5);
+			transforms.SetPosition(entities.GetTransform(ids[i]), XMFLOAT3((float)(i % 1000), 0, (float)(i / 1000)));
+		}
+		hierarchy.UpdateMatrices();
+	};
+	auto boundsPass = [&]()
+	{
+		for (EntityArchetype* archetype : entities.Query(DRAWN))
+		{
+			for (unsigned int i = 0, n = archetype->GetCount(); i < n; i++)
+			{
+				EntityBounds& bounds = archetype->bounds[i];
+				unsigned int transform = archetype->transforms[i];
+				BenchmarkMesh* mesh = meshes[archetype->meshes[i]].get();
+				unsigned int version = hierarchy.GetWorldVersion(transform);
+				if (!bounds.valid || version != bounds.transformVersion || mesh->version != bounds.meshVersion)
+				{
+					bounds.world = TransformBounds(XMLoadFloat4x4(&hierarchy.GetWorldMatrix(transform)), mesh->bounds);
+					bounds.transformVersion = version;
+					bounds.meshVersion = mesh->version;
+					bounds.valid = true;
+				}
+				archetype->lods[i].lod = bounds.world.sphereRadius > 1.0f;
+				sink += *materials[archetype->materials[i]] + archetype->lods[i].lod;
+			}
+		}
+	};
+
+	double spawn = TimeMilliseconds(1, spawnAll);
+	boundsPass();
+	double iterate = TimeMilliseconds(5, boundsPass);
+	double columns = TimeMilliseconds(5, [&]()
+	{
+		for (EntityArchetype* archetype : entities.Query(ENTITY_MATERIAL | ENTITY_LOD))
+		{
+			for (unsigned int i = 0, n = archetype->GetCount(); i < n; i++)
+				sink += *materials[archetype->materials[i]] + (unsigned long long)archetype->lods[i].projectedSize + archetype->lods[i].lod;
+		}
+	});
+	double destroy = TimeMilliseconds(1, [&]()
+	{
+		for (unsigned int i : order)
+			entities.Destroy(ids[i]);
+	});
+	CHECK(entities.GetCount() == 0 && transforms.GetCount() == 0);
+	printf("EntityStore             spawn %8.1f ms  iterate %7.2f ms  material+lod %7.2f ms  destroy %8.1f ms\n", spawn, iterate, columns, destroy);
+
+	//slots come back lowest first, so after a random order destroy the columns still walk the transforms in order
+	double respawn = TimeMilliseconds(1, spawnAll);
+	boundsPass();
+	double reused = TimeMilliseconds(5, boundsPass);
+	bool inOrder = true;
+	for (EntityArchetype* archetype : entities.Query(DRAWN))
+	{
+		for (unsigned int i = 1; i < archetype->GetCount(); i++)
+			inOrder = inOrder && archetype->transforms[i] > archetype->transforms[i - 1];
+	}
+	CHECK(inOrder);
+	printf("after a full respawn    spawn %8.1f ms  iterate %7.2f ms%s\n", respawn, reused, sink == 1 ? " " : "");
+
+	return GetFailureCount();
+}
@@ -0,0 +1,283 @@
+#include "CubeMap.h"
+#include "EnvironmentBaker.h"
+#include "Parallel.h"
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include "TextureCooker.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+// --------------------------------------------------------
+// Bakes every sky in Assets/Skies (or the first --skies of
+// them) and the BRDF LUT, timing both, and compares them
+// with brute force references: each prefiltered texel
+// against the GGX lobe summed over every texel of the
+// first level, and LUT texels against a dense quadrature
+// instead of 512 samples (1024 cells squared unless
+// --quadrature says otherwise).  --texels texels of each
+// level are compared, picked at random.  Also checks the
+// asset cache hands back the same bytes.
+// --------------------------------------------------------
+
+static const char* FACE_NAMES[6] = { "right.png", "left.png", "up.png", "down.png", "front.png", "back.png" };
+
+// Solid angle of the part of a cube face from its center to (u, v), times 4 (Driscoll's area element)
+static double GetAreaElement(double u, double v)
+{
+	return atan2(u * v, sqrt(u * u + v * v + 1.0));
+}
+
+// The first level read back in doubles, with each texel's direction and solid angle
+struct ReferenceTexel
+{
+	double direction[3];
+	double solidAngle;
+	double radiance[3];
+};
+
+static std::vector<ReferenceTexel> GetReferenceTexels(const TextureData prefiltered[6])
+{
+	std::vector<ReferenceTexel> texels;
+	unsigned int size = prefiltered[0].width;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+		for (unsigned int y = 0; y < size; y++)
+		{
+			const XMHALF4* row = (const XMHALF4*)(prefiltered[face].GetMipData(0) + (size_t)y * prefiltered[face].mips[0].rowPitch);
+			for (unsigned int x = 0; x < size; x++)
+			{
+				double u0 = x * 2.0 / size - 1.0, u1 = (x + 1) * 2.0 / size - 1.0;
+				double v0 = y * 2.0 / size - 1.0, v1 = (y + 1) * 2.0 / size - 1.0;
+				double u = (u0 + u1) * 0.5, v = (v0 + v1) * 0.5;
+
+				ReferenceTexel texel;
+				double length = 0;
+				for (int i = 0; i < 3; i++)
+				{
+					const float* center = &axes.center.x;
+					const float* uAxis = &axes.u.x;
+					const float* vAxis = &axes.v.x;
+					texel.direction[i] = center[i] + uAxis[i] * u + vAxis[i] * v;
+					length += texel.direction[i] * texel.direction[i];
+				}
+				for (int i = 0; i < 3; i++)
+					texel.direction[i] /= sqrt(length);
+				texel.solidAngle = GetAreaElement(u0, v0) - GetAreaElement(u0, v1) - GetAreaElement(u1, v0) + GetAreaElement(u1, v1);
+				texel.radiance[0] = XMConvertHalfToFloat(row[x].x);
+				texel.radiance[1] = XMConvertHalfToFloat(row[x].y);
+				texel.radiance[2] = XMConvertHalfToFloat(row[x].z);
+				texels.push_back(texel);
+			}
+		}
+	}
+	return texels;
+}
+
+// The sky convolved with the GGX lobe around normal, view along the normal, weighted by n dot l as the baker
+// does: every texel's radiance times D(h) / 4 (the pdf of l) times n dot l, over the sum of the weights
+static void ConvolveReference(const std::vector<ReferenceTexel>& texels, const double normal[3], double roughness, double result[3])
+{
+	double alpha2 = roughness * roughness * roughness * roughness;
+	double sum[3] = {}, weightSum = 0;
+	for (const ReferenceTexel& texel : texels)
+	{
+		double NdotL = normal[0] * texel.direction[0] + normal[1] * texel.direction[1] + normal[2] * texel.direction[2];
+		if (NdotL <= 0)
+			continue;
+
+		//with v along n, n dot h is the cosine of half the angle between n and l
+		double NdotH2 = (1.0 + NdotL) * 0.5;
+		double denominator = NdotH2 * (alpha2 - 1.0) + 1.0;
+		double weight = alpha2 / (denominator * denominator) * NdotL * texel.solidAngle;
+		for (int c = 0; c < 3; c++)
+			sum[c] += texel.radiance[c] * weight;
+		weightSum += weight;
+	}
+	for (int c = 0; c < 3; c++)
+		result[c] = sum[c] / weightSum;
+}
+
+// Largest and mean difference over count random texels of each level past the first, as a share of the
+// brightest texel of the sky
+static void ComparePrefiltered(const TextureData prefiltered[6], const EnvironmentSettings& settings, unsigned int count, double& largest, double& mean)
+{
+	std::vector<ReferenceTexel> texels = GetReferenceTexels(prefiltered);
+	double peak = 0;
+	for (const ReferenceTexel& texel : texels)
+		peak = std::max({ peak, texel.radiance[0], texel.radiance[1], texel.radiance[2] });
+
+	std::vector<double> differences((settings.mipCount - 1) * (size_t)count);
+	ParallelFor((unsigned int)differences.size(), [&](unsigned int task)
+	{
+		unsigned int mip = 1 + task / count;
+		unsigned int mipSize = prefiltered[0].mips[mip].width;
+		unsigned int pick = (task * 2654435761u) ^ 0x9e3779b9u;
+		unsigned int face = pick % 6, x = (pick / 6) % mipSize, y = (pick / 6 / mipSize) % mipSize;
+
+		const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+		double u = (x + 0.5) * 2.0 / mipSize - 1.0, v = (y + 0.5) * 2.0 / mipSize - 1.0;
+		double normal[3] = { axes.center.x + axes.u.x * u + axes.v.x * v, axes.center.y + axes.u.y * u + axes.v.y * v, axes.center.z + axes.u.z * u + axes.v.z * v };
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (double& n : normal)
+			n /= length;
+
+		double reference[3];
+		ConvolveReference(texels, normal, GetPrefilteredRoughness(mip, settings.mipCount), reference);
+		const XMHALF4& baked = ((const XMHALF4*)(prefiltered[face].GetMipData(mip) + (size_t)y * prefiltered[face].mips[mip].rowPitch))[x];
+		differences[task] = std::max({ fabs(XMConvertHalfToFloat(baked.x) - reference[0]),
+			fabs(XMConvertHalfToFloat(baked.y) - reference[1]), fabs(XMConvertHalfToFloat(baked.z) - reference[2]) }) / peak;
+	});
+
+	largest = 0;
+	mean = 0;
+	for (double difference : differences)
+	{
+		largest = std::max(largest, difference);
+		mean += difference / differences.size();
+	}
+}
+
+// --------------------------------------------------------
+// The split sum's scale and bias for one n dot v and
+// roughness, by the midpoint rule over side x side cells of
+// the GGX half vector distribution's own coordinates (the
+// cosine from its CDF, and the angle around n), where
+// D(h) (n dot h) dh is already uniform
+// --------------------------------------------------------
+static void IntegrateReference(double NdotV, double roughness, unsigned int side, double& scale, double& bias)
+{
+	double alpha2 = roughness * roughness * roughness * roughness;
+	double k = roughness * roughness * 0.5;
+	double view[3] = { sqrt(1.0 - NdotV * NdotV), 0.0, NdotV };
+	scale = 0;
+	bias = 0;
+	for (unsigned int i = 0; i < side; i++)
+	{
+		double e = (i + 0.5) / side;
+		double cosTheta = sqrt((1.0 - e) / (1.0 + (alpha2 - 1.0) * e));
+		double sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+		for (unsigned int j = 0; j < side; j++)
+		{
+			double phi = 2.0 * 3.14159265358979323846 * (j + 0.5) / side;
+			double h[3] = { sinTheta * cos(phi), sinTheta * sin(phi), cosTheta };
+			double VdotH = view[0] * h[0] + view[2] * h[2];
+			double NdotL = 2.0 * VdotH * h[2] - NdotV;
+			if (NdotL <= 0 || VdotH <= 0)
+				continue;
+
+			double G = NdotV / (NdotV * (1.0 - k) + k) * NdotL / (NdotL * (1.0 - k) + k);
+			double visibility = G * VdotH / (h[2] * NdotV);
+			double fresnel = pow(1.0 - VdotH, 5.0);
+			scale += (1.0 - fresnel) * visibility;
+			bias += fresnel * visibility;
+		}
+	}
+	scale /= (double)side * side;
+	bias /= (double)side * side;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int skyCount = (unsigned int)GetArgument(argc, argv, "skies", 4);
+	unsigned int texelCount = (unsigned int)GetArgument(argc, argv, "texels", 200);
+	unsigned int quadrature = (unsigned int)GetArgument(argc, argv, "quadrature", 1024);
+	EnvironmentSettings settings;
+	settings.size = (unsigned int)GetArgument(argc, argv, "size", settings.size);
+	printf("%u worker thread(s), %u^2 faces, %u levels, %u samples a texel\n", GetWorkerCount(), settings.size, settings.mipCount, settings.sampleCount);
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "EnvironmentBakerTest";
+	std::filesystem::remove_all(directory);
+
+	std::vector<std::filesystem::path> skies;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/Skies"))
+		skies.push_back(entry.path());
+	std::sort(skies.begin(), skies.end());
+	skies.resize(std::min<size_t>(skies.size(), skyCount));
+	CHECK(!skies.empty());
+
+	for (const std::filesystem::path& sky : skies)
+	{
+		//Clouds_Pink ships without its up face, the game lists it as missing too
+		std::filesystem::path fileNames[6];
+		bool complete = true;
+		for (int face = 0; face < 6; face++)
+		{
+			fileNames[face] = sky / FACE_NAMES[face];
+			complete = complete && std::filesystem::exists(fileNames[face]);
+		}
+		if (!complete)
+		{
+			printf("%-12s is missing faces\n", sky.filename().string().c_str());
+			continue;
+		}
+
+		TextureData faces[6];
+		const TextureData* facePointers[6];
+		bool loaded = true;
+		for (int face = 0; face < 6; face++)
+		{
+			loaded = loaded && LoadPng(fileNames[face], faces[face]);
+			facePointers[face] = &faces[face];
+		}
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		TextureData prefiltered[6];
+		bool baked = false;
+		double bakeTime = TimeMilliseconds(1, [&]() { baked = PrefilterEnvironment(facePointers, settings, prefiltered); });
+		CHECK(baked);
+		if (!baked)
+			continue;
+
+		double largest = 0, mean = 0;
+		ComparePrefiltered(prefiltered, settings, texelCount, largest, mean);
+		CHECK(largest < 0.05);
+
+		//a cold cook bakes and stores, a warm one reads back exactly what was baked
+		TextureData cold[6], warm[6];
+		TextureCookInfo coldInfo, warmInfo;
+		double warmTime = 0;
+		{
+			AssetCache cache(directory);
+			CHECK(CookEnvironment(fileNames, facePointers, settings, &cache, cold, &coldInfo));
+		}
+		{
+			AssetCache cache(directory);
+			warmTime = TimeMilliseconds(1, [&]() { CHECK(CookEnvironment(fileNames, facePointers, settings, &cache, warm, &warmInfo)); });
+		}
+		CHECK(!coldInfo.cacheHit && warmInfo.cacheHit);
+		for (int face = 0; face < 6; face++)
+			CHECK(warm[face].pixels == prefiltered[face].pixels && cold[face].pixels == prefiltered[face].pixels);
+
+		printf("%-12s bake %8.1f ms  warm cache %6.2f ms  largest difference %.2f%% of peak, mean %.3f%%\n",
+			sky.filename().string().c_str(), bakeTime, warmTime, largest * 100.0, mean * 100.0);
+	}
+
+	//the LUT, against quadrature over that many cells squared at an even spread of its texels
+	TextureData lut;
+	double lutTime = TimeMilliseconds(1, [&]() { IntegrateBrdfLut(settings, lut); });
+	unsigned int step = std::max(1u, settings.lutSize / 16);
+	double lutLargest = 0;
+	for (unsigned int y = step / 2; y < settings.lutSize; y += step)
+	{
+		for (unsigned int x = step / 2; x < settings.lutSize; x += step)
+		{
+			double scale, bias;
+			IntegrateReference((x + 0.5) / settings.lutSize, (y + 0.5) / settings.lutSize, quadrature, scale, bias);
+			const XMHALF2& texel = ((const XMHALF2*)(lut.GetMipData(0) + (size_t)y * lut.mips[0].rowPitch))[x];
+			lutLargest = std::max({ lutLargest, fabs(XMConvertHalfToFloat(texel.x) - scale), fabs(XMConvertHalfToFloat(texel.y) - bias) });
+		}
+	}
+	CHECK(lutLargest < 0.01);
+	printf("BRDF LUT     %u^2 bake %8.1f ms  largest difference %.4f\n", settings.lutSize, lutTime, lutLargest);
+
+	std::filesystem::remove_all(directory);
+	return GetFailureCount();
+}
@@ -0,0 +1,306 @@
+#include "EntityStore.h"
+#include "FrameScheduler.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Runs a headless scene of 100k entities (unless --entities
+// says otherwise) through the systems Game declares, plus
+// a material pass and a bounds and lod pass, on 1, 2, 4 and
+// 8 threads.  Every thread count has to leave the scene
+// exactly as a plain loop calling the systems in order
+// does, and the best frame times show how far it scales.
+// Also checks the dependencies, and that threads parked on
+// a long chain of one chunk systems wake for each one.
+// --------------------------------------------------------
+
+static const unsigned int DRAWN = ENTITY_TRANSFORM | ENTITY_MESH | ENTITY_MATERIAL | ENTITY_BOUNDS | ENTITY_LOD;
+
+struct Scene
+{
+	TransformStore transforms;
+	TransformHierarchy hierarchy;
+	EntityStore entities;
+	std::vector<EntityId> ids;
+	unsigned int camera;
+	XMFLOAT3 cameraPosition;
+	float time;
+
+	Scene(unsigned int count) : hierarchy(&transforms), entities(&transforms, &hierarchy), cameraPosition(0, 0, -10), time(0)
+	{
+		//every fifth one stands still
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> around(-50.0f, 50.0f);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int components = i % 5 ? DRAWN | ENTITY_MOTION : DRAWN;
+			EntityId id = entities.Create(components);
+			entities.SetMesh(id, i % 7);
+			entities.SetMaterial(id, i % 11);
+			XMFLOAT3 position(around(random), around(random), around(random));
+			transforms.SetPosition(entities.GetTransform(id), position);
+			if (components & ENTITY_MOTION)
+				entities.SetMotion(id, { position, XMFLOAT3(0, (i % 3) * 0.5f, 0), XMFLOAT3(0, (i % 4) * 0.3f, (i % 2) * 0.2f) });
+			ids.push_back(id);
+		}
+		camera = transforms.Create();
+		hierarchy.UpdateMatrices();
+	}
+
+	// Rows begin ... end - 1 of everything with these components, counted across archetypes
+	template <typename Function> void ForRows(unsigned int components, unsigned int begin, unsigned int end, Function function)
+	{
+		unsigned int first = 0;
+		for (EntityArchetype* archetype : entities.Query(components))
+		{
+			unsigned int count = archetype->GetCount();
+			for (unsigned int i = begin > first ? begin - first : 0; i < count && first + i < end; i++)
+				function(archetype, i);
+			first += count;
+			if (first >= end)
+				break;
+		}
+	}
+
+	unsigned int GetRowCount(unsigned int components)
+	{
+		unsigned int count = 0;
+		for (EntityArchetype* archetype : entities.Query(components))
+			count += archetype->GetCount();
+		return count;
+	}
+
+	void AddSystems(FrameScheduler& scheduler)
+	{
+		//only its own slot of the store, which may be set while motion sets others
+		FrameSystem cameraSystem = {};
+		cameraSystem.name = "Camera";
+		cameraSystem.writes = FRAME_RESOURCE_CAMERA;
+		cameraSystem.run = [this](unsigned int, unsigned int)
+		{
+			cameraPosition.z += 0.01f;
+			transforms.SetPosition(camera, cameraPosition);
+		};
+		scheduler.AddSystem(cameraSystem);
+
+		FrameSystem motion = {};
+		motion.name = "Motion";
+		motion.reads = ENTITY_MOTION;
+		motion.writes = ENTITY_TRANSFORM;
+		motion.count = [this]() { return GetRowCount(ENTITY_TRANSFORM | ENTITY_MOTION); };
+		motion.chunkSize = 1024;
+		motion.run = [this](unsigned int begin, unsigned int end)
+		{
+			float wave = sinf(time);
+			ForRows(ENTITY_TRANSFORM | ENTITY_MOTION, begin, end, [&](EntityArchetype* archetype, unsigned int i)
+			{
+				const EntityMotion& motion = archetype->motions[i];
+				unsigned int transform = archetype->transforms[i];
+				if (motion.bob.y != 0)
+				{
+					XMFLOAT3 position = transforms.GetPosition(transform);
+					position.y = motion.origin.y + motion.bob.y * wave;
+					transforms.SetPosition(transform, position);
+				}
+				if (motion.spin.y != 0 || motion.spin.z != 0)
+					transforms.SetPitchYawRoll(transform, XMFLOAT3(0, motion.spin.y * time, motion.spin.z * time));
+			});
+		};
+		scheduler.AddSystem(motion);
+
+		//touches nothing the transforms do, so it overlaps with everything before the bounds
+		FrameSystem material = {};
+		material.name = "Material";
+		material.reads = ENTITY_MESH;
+		material.writes = ENTITY_MATERIAL;
+		material.count = [this]() { return GetRowCount(ENTITY_MESH | ENTITY_MATERIAL); };
+		material.chunkSize = 4096;
+		material.run = [this](unsigned int begin, unsigned int end)
+		{
+			ForRows(ENTITY_MESH | ENTITY_MATERIAL, begin, end, [&](EntityArchetype* archetype, unsigned int i)
+			{
+				archetype->materials[i] = (archetype->materials[i] * 31 + archetype->meshes[i] + 1) % 11;
+			});
+		};
+		scheduler.AddSystem(material);
+
+		FrameSystem matrices = {};
+		matrices.name = "Transform matrices";
+		matrices.writes = ENTITY_TRANSFORM | FRAME_RESOURCE_CAMERA;
+		matrices.run = [this](unsigned int, unsigned int) { hierarchy.UpdateMatrices(); };
+		scheduler.AddSystem(matrices);
+
+		FrameSystem bounds = {};
+		bounds.name = "Bounds and lod";
+		bounds.reads = ENTITY_TRANSFORM | ENTITY_MESH | FRAME_RESOURCE_CAMERA;
+		bounds.writes = ENTITY_BOUNDS | ENTITY_LOD;
+		bounds.count = [this]() { return GetRowCount(DRAWN); };
+		bounds.chunkSize = 1024;
+		bounds.run = [this](unsigned int begin, unsigned int end)
+		{
+			Bounds local = { XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1), XMFLOAT3(0, 0, 0), 1.7320508f };
+			ForRows(DRAWN, begin, end, [&](EntityArchetype* archetype, unsigned int i)
+			{
+				unsigned int transform = archetype->transforms[i];
+				unsigned int version = hierarchy.GetWorldVersion(transform);
+				EntityBounds& entityBounds = archetype->bounds[i];
+				if (!entityBounds.valid || entityBounds.transformVersion != version)
+				{
+					entityBounds.world = TransformBounds(XMLoadFloat4x4(&hierarchy.GetWorldMatrix(transform)), local);
+					entityBounds.transformVersion = version;
+					entityBounds.valid = true;
+				}
+				XMFLOAT3 center = entityBounds.world.sphereCenter;
+				float distance = sqrtf((center.x - cameraPosition.x) * (center.x - cameraPosition.x) +
+					(center.y - cameraPosition.y) * (center.y - cameraPosition.y) + (center.z - cameraPosition.z) * (center.z - cameraPosition.z));
+				EntityLod& lod = archetype->lods[i];
+				lod.projectedSize = entityBounds.world.sphereRadius * 720.0f / std::max(distance, 0.01f);
+				lod.lod = lod.projectedSize > 40 ? 0 : lod.projectedSize > 10 ? 1 : 2;
+			});
+		};
+		scheduler.AddSystem(bounds);
+	}
+
+	// FNV-1a over every world matrix, material, lod and world bounds
+	unsigned long long Hash()
+	{
+		unsigned long long hash = 1469598103934665603ull;
+		auto mix = [&](const void* data, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= ((const unsigned char*)data)[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		for (EntityId id : ids)
+		{
+			mix(&hierarchy.GetWorldMatrix(entities.GetTransform(id)), sizeof(XMFLOAT4X4));
+			unsigned int material = entities.GetMaterial(id);
+			mix(&material, sizeof(material));
+		}
+		for (EntityArchetype* archetype : entities.Query(DRAWN))
+		{
+			for (unsigned int i = 0; i < archetype->GetCount(); i++)
+			{
+				mix(&archetype->lods[i].lod, sizeof(archetype->lods[i].lod));
+				mix(&archetype->lods[i].projectedSize, sizeof(archetype->lods[i].projectedSize));
+				mix(&archetype->bounds[i].world, sizeof(Bounds));
+			}
+		}
+		return hash;
+	}
+};
+
+// A chain where each system waits on the last, some of them slow enough that the other threads park
+static void TestChain(unsigned int threadCount)
+{
+	FrameScheduler scheduler(threadCount);
+	std::vector<unsigned int> order;
+	for (unsigned int i = 0; i < 40; i++)
+	{
+		FrameSystem link = {};
+		link.name = "Link";
+		link.writes = ENTITY_TRANSFORM;
+		link.run = [&order, i](unsigned int, unsigned int)
+		{
+			if (i % 8 == 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			order.push_back(i);
+		};
+		scheduler.AddSystem(link);
+	}
+
+	//a wide system after it, whose chunks have to reach the parked threads
+	std::atomic<unsigned int> items(0);
+	FrameSystem wide = {};
+	wide.name = "Wide";
+	wide.reads = ENTITY_TRANSFORM;
+	wide.count = []() { return 64u; };
+	wide.chunkSize = 1;
+	wide.run = [&items](unsigned int begin, unsigned int end) { items += end - begin; };
+	scheduler.AddSystem(wide);
+
+	for (int frame = 0; frame < 3; frame++)
+	{
+		order.clear();
+		items = 0;
+		scheduler.Run();
+		bool inOrder = order.size() == 40;
+		for (unsigned int i = 0; inOrder && i < 40; i++)
+			inOrder = order[i] == i;
+		CHECK(inOrder && items == 64);
+	}
+	CHECK(scheduler.GetDependencies(40).size() == 40);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int entityCount = (unsigned int)GetArgument(argc, argv, "entities", 100000);
+	int frames = (int)GetArgument(argc, argv, "frames", 30);
+
+	//what waits for what: the camera, motion and the material pass on their own, the matrices after the
+	//camera and motion, bounds after all but the material pass
+	{
+		Scene scene(10);
+		FrameScheduler scheduler(1);
+		scene.AddSystems(scheduler);
+		CHECK(scheduler.GetDependencies(0).empty());
+		CHECK(scheduler.GetDependencies(1).empty());
+		CHECK(scheduler.GetDependencies(2).empty());
+		CHECK(scheduler.GetDependencies(3) == std::vector<unsigned int>({ 0, 1 }));
+		CHECK(scheduler.GetDependencies(4) == std::vector<unsigned int>({ 0, 1, 3 }));
+	}
+	for (unsigned int threads : { 2u, 4u })
+		TestChain(threads);
+
+	//the systems called one after another, no scheduler
+	unsigned long long reference;
+	double serial;
+	{
+		Scene scene(entityCount);
+		FrameScheduler unused(1);
+		scene.AddSystems(unused);
+		serial = TimeMilliseconds(frames, [&]()
+		{
+			for (unsigned int i = 0; i < unused.GetSystemCount(); i++)
+			{
+				const FrameSystem& system = unused.GetSystem(i);
+				system.run(0, system.count ? system.count() : 1);
+			}
+			scene.time += 1.0f / 60.0f;
+		});
+		reference = scene.Hash();
+	}
+	printf("%u entities on %u core(s), plain loop best frame %.2f ms\n", entityCount, std::thread::hardware_concurrency(), serial);
+
+	for (unsigned int threads : { 1u, 2u, 4u, 8u })
+	{
+		Scene scene(entityCount);
+		FrameScheduler scheduler(threads);
+		scene.AddSystems(scheduler);
+		double time = TimeMilliseconds(frames, [&]()
+		{
+			scheduler.Run();
+			scene.time += 1.0f / 60.0f;
+		});
+		unsigned long long hash = scene.Hash();
+		CHECK(hash == reference);
+
+		const FrameReport& report = scheduler.GetReport();
+		printf("%u thread(s): best frame %7.2f ms (%.2fx)  %s  last frame %.2f ms, %.2f ms of work, critical path ",
+			threads, time, serial / time, hash == reference ? "same scene" : "DIFFERENT SCENE", report.frameTime, report.workTime);
+		for (size_t i = 0; i < report.criticalPath.size(); i++)
+			printf("%s%s", i ? " > " : "", scheduler.GetSystem(report.criticalPath[i]).name);
+		printf("\n");
+	}
+
+	return GetFailureCount();
+}
@@ -0,0 +1,104 @@
+#include "AssetCache.h"
+#include "MeshImporter.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Times importing a mesh three ways: from the OBJ text with
+// no cache, into an empty cache (import plus write), and
+// from a warm cache opened fresh, the way the next run of
+// the game sees it.  Covers the bundled models and a
+// generated OBJ (16 MB unless --megabytes says otherwise),
+// and checks a cache hit hands back exactly what the
+// import built.
+// --------------------------------------------------------
+
+// Whether two imports hold the same GPU data and LOD chain
+static bool IsSameMesh(const MeshData& a, const MeshData& b)
+{
+	if (a.vertexCount != b.vertexCount || a.indexCount != b.indexCount || a.indexStride != b.indexStride ||
+		a.lods.size() != b.lods.size() || a.meshlets.size() != b.meshlets.size())
+		return false;
+
+	for (size_t i = 0; i < a.lods.size(); i++)
+	{
+		if (a.lods[i].indexStart != b.lods[i].indexStart || a.lods[i].indexCount != b.lods[i].indexCount)
+			return false;
+	}
+
+	return memcmp(a.vertices, b.vertices, a.vertexCount * sizeof(PackedVertex)) == 0 &&
+		memcmp(a.indices, b.indices, (size_t)a.indexCount * a.indexStride) == 0 &&
+		(a.meshlets.empty() || memcmp(a.meshlets.data(), b.meshlets.data(), a.meshlets.size() * sizeof(Meshlet)) == 0);
+}
+
+static void BenchmarkMesh(const std::filesystem::path& fileName, int runs)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "MeshCacheBenchmark";
+	std::filesystem::remove_all(directory);
+	std::wstring name = fileName.wstring();
+	MeshLodSettings lodSettings;
+
+	//MeshData isn't copyable or movable, so each run gets a new one
+	std::unique_ptr<MeshData> text;
+	double textTime = TimeMilliseconds(runs, [&]()
+	{
+		text = std::make_unique<MeshData>();
+		CHECK(ImportMesh(name.c_str(), nullptr, true, lodSettings, *text));
+	});
+
+	//one cook, since a second one into the same cache would hit
+	MeshData cold;
+	double coldTime = TimeMilliseconds(1, [&]()
+	{
+		AssetCache cache(directory);
+		CHECK(ImportMesh(name.c_str(), &cache, true, lodSettings, cold));
+		CHECK(cache.GetStats().misses == 1);
+	});
+
+	//a new cache each run, which finds the source unchanged from the index and the payload stored
+	std::unique_ptr<MeshData> warm;
+	double warmTime = TimeMilliseconds(runs, [&]()
+	{
+		warm = std::make_unique<MeshData>();
+		AssetCache cache(directory);
+		CHECK(ImportMesh(name.c_str(), &cache, true, lodSettings, *warm));
+		AssetCacheStats stats = cache.GetStats();
+		CHECK(stats.hits == 1 && stats.misses == 0 && stats.sourcesUnchanged == 1 && stats.sourcesHashed == 0);
+	});
+
+	CHECK(IsSameMesh(*text, cold));
+	CHECK(IsSameMesh(*text, *warm));
+	CHECK(warm->packedVertices.empty());
+
+	printf("%-28s %8u verts %9u indices  text %9.2f ms  cold cache %9.2f ms  warm cache %7.3f ms  (%.1fx)\n",
+		fileName.filename().string().c_str(), text->vertexCount, text->indexCount, textTime, coldTime, warmTime, textTime / warmTime);
+
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char** argv)
+{
+	double megabytes = GetArgument(argc, argv, "megabytes", 16);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::filesystem::path> models;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/Models"))
+	{
+		if (entry.path().extension() == ".obj")
+			models.push_back(entry.path());
+	}
+	std::sort(models.begin(), models.end());
+	for (const std::filesystem::path& model : models)
+		BenchmarkMesh(model, runs);
+
+	std::filesystem::path fileName = std::filesystem::temp_directory_path() / "MeshCacheBenchmark.obj";
+	CHECK(WriteObjGrid(fileName, megabytes) > 0);
+	BenchmarkMesh(fileName, 1);
+	std::filesystem::remove(fileName);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,103 @@
+#include "AssetCache.h"
+#include "MeshImporter.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Runs ImportMesh on every bundled model and on a generated
+// OBJ (16 MB unless --megabytes says otherwise), printing
+// where the time goes stage by stage: without a cache,
+// cooking into an empty one, and from a warm one opened
+// fresh, the way the game's next start sees it
+// --------------------------------------------------------
+
+static float GetTotal(const MeshImportTimings& t)
+{
+	return t.cache + t.parse + t.weld + t.optimize + t.simplify + t.tangents + t.pack;
+}
+
+static void PrintTimings(const char* label, const MeshImportTimings& t)
+{
+	printf("  %-11s total %9.3f ms  cache %8.3f  parse %8.3f  weld %8.3f  optimize %8.3f  simplify %8.3f  tangents %8.3f  pack %8.3f\n",
+		label, GetTotal(t), t.cache, t.parse, t.weld, t.optimize, t.simplify, t.tangents, t.pack);
+}
+
+// Imports runs times and keeps the timings of the fastest
+template <typename Import>
+static MeshImportTimings GetFastest(int runs, Import import)
+{
+	MeshImportTimings fastest = {};
+	for (int i = 0; i < runs; i++)
+	{
+		//MeshData isn't copyable or movable, so each run gets a new one
+		std::unique_ptr<MeshData> data = std::make_unique<MeshData>();
+		CHECK(import(*data));
+		if (i == 0 || GetTotal(data->timings) < GetTotal(fastest))
+			fastest = data->timings;
+	}
+	return fastest;
+}
+
+static void BenchmarkMesh(const std::filesystem::path& fileName, int runs)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "MeshImportBenchmark";
+	std::filesystem::remove_all(directory);
+	std::wstring name = fileName.wstring();
+	MeshLodSettings lodSettings;
+
+	MeshData text;
+	CHECK(ImportMesh(name.c_str(), nullptr, true, lodSettings, text));
+	printf("%s: %u vertices, %u indices, %zu levels, %zu meshlets\n",
+		fileName.filename().string().c_str(), text.vertexCount, text.indexCount, text.lods.size(), text.meshlets.size());
+
+	MeshImportTimings noCache = GetFastest(runs, [&](MeshData& data) { return ImportMesh(name.c_str(), nullptr, true, lodSettings, data); });
+	MeshImportTimings cold = GetFastest(1, [&](MeshData& data)
+	{
+		AssetCache cache(directory);
+		return ImportMesh(name.c_str(), &cache, true, lodSettings, data);
+	});
+	MeshImportTimings warm = GetFastest(runs, [&](MeshData& data)
+	{
+		AssetCache cache(directory);
+		bool imported = ImportMesh(name.c_str(), &cache, true, lodSettings, data);
+		CHECK(cache.GetStats().hits == 1);
+		return imported;
+	});
+
+	//a hit skips every stage but the lookup
+	CHECK(warm.parse == 0 && warm.weld == 0 && warm.optimize == 0 && warm.simplify == 0 && warm.tangents == 0 && warm.pack == 0);
+	CHECK(noCache.cache == 0 && cold.cache > 0);
+
+	PrintTimings("no cache", noCache);
+	PrintTimings("cold cache", cold);
+	PrintTimings("warm cache", warm);
+
+	std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char** argv)
+{
+	double megabytes = GetArgument(argc, argv, "megabytes", 16);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::filesystem::path> models;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/Models"))
+	{
+		if (entry.path().extension() == ".obj")
+			models.push_back(entry.path());
+	}
+	std::sort(models.begin(), models.end());
+	for (const std::filesystem::path& model : models)
+		BenchmarkMesh(model, runs);
+
+	std::filesystem::path fileName = std::filesystem::temp_directory_path() / "MeshImportBenchmark.obj";
+	CHECK(WriteObjGrid(fileName, megabytes) > 0);
+	BenchmarkMesh(fileName, 1);
+	std::filesystem::remove(fileName);
+
+	return GetFailureCount();
+}
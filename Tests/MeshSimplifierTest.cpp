@@ -0,0 +1,188 @@
+#include "Bounds.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <cfloat>
+#include <filesystem>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Builds the LOD chain of every bundled model and of a
+// generated wavy grid (300 quads a side unless --grid says
+// otherwise), timing it and checking each level: shrinking
+// triangle counts, growing reported errors under the
+// limit, valid indices, and a measured error (how far the
+// full detail vertices are from the level's surface) that
+// stays near the limit
+// --------------------------------------------------------
+
+// Closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5), as a distance
+static float GetDistanceToTriangle(XMVECTOR p, XMVECTOR a, XMVECTOR b, XMVECTOR c)
+{
+	XMVECTOR ab = b - a, ac = c - a, ap = p - a;
+	float d1 = XMVectorGetX(XMVector3Dot(ab, ap)), d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+	if (d1 <= 0 && d2 <= 0)
+		return XMVectorGetX(XMVector3Length(p - a));
+
+	XMVECTOR bp = p - b;
+	float d3 = XMVectorGetX(XMVector3Dot(ab, bp)), d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+	if (d3 >= 0 && d4 <= d3)
+		return XMVectorGetX(XMVector3Length(bp));
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		return XMVectorGetX(XMVector3Length(p - (a + ab * (d1 / (d1 - d3)))));
+
+	XMVECTOR cp = p - c;
+	float d5 = XMVectorGetX(XMVector3Dot(ab, cp)), d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+	if (d6 >= 0 && d5 <= d6)
+		return XMVectorGetX(XMVector3Length(cp));
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		return XMVectorGetX(XMVector3Length(p - (a + ac * (d2 / (d2 - d6)))));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+		return XMVectorGetX(XMVector3Length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))));
+
+	float denominator = 1.0f / (va + vb + vc);
+	return XMVectorGetX(XMVector3Length(p - (a + ab * (vb * denominator) + ac * (vc * denominator))));
+}
+
+// Largest distance from (up to about samples of) the full detail vertices to the level's triangles
+static float MeasureError(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const MeshLod& full, const MeshLod& level, unsigned int samples)
+{
+	unsigned int step = std::max(1u, full.indexCount / samples);
+	float largest = 0;
+	for (unsigned int i = full.indexStart; i < full.indexStart + full.indexCount; i += step)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].position);
+		float closest = FLT_MAX;
+		for (unsigned int t = level.indexStart; t < level.indexStart + level.indexCount; t += 3)
+		{
+			closest = std::min(closest, GetDistanceToTriangle(p,
+				XMLoadFloat3(&vertices[indices[t]].position),
+				XMLoadFloat3(&vertices[indices[t + 1]].position),
+				XMLoadFloat3(&vertices[indices[t + 2]].position)));
+		}
+		largest = std::max(largest, closest);
+	}
+	return largest;
+}
+
+// Returns how many levels the chain got
+static size_t TestMesh(const char* name, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, unsigned int samples)
+{
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeVertexFetch(vertices, indices);
+	Bounds bounds = ComputeBounds(&vertices[0].position, vertices.size(), sizeof(Vertex));
+
+	MeshLodSettings settings;
+	std::vector<MeshLod> lods;
+	unsigned int fullCount = (unsigned int)indices.size();
+	double time = TimeMilliseconds(1, [&]() { BuildLodChain(indices, vertices, settings, lods); });
+
+	//the limit BuildLodChain works to, relative to the same radius it uses
+	XMVECTOR extent = XMLoadFloat3(&bounds.boxMax) - XMLoadFloat3(&bounds.boxMin);
+	float limit = settings.maxError * 0.5f * XMVectorGetX(XMVector3Length(extent));
+
+	printf("%-20s %7u tris  %8.2f ms  limit %.4f:", name, fullCount / 3, time, limit);
+	CHECK(!lods.empty() && lods.size() <= settings.maxLods);
+	CHECK(lods[0].indexStart == 0 && lods[0].indexCount == fullCount && lods[0].error == 0);
+
+	for (size_t l = 0; l < lods.size(); l++)
+	{
+		const MeshLod& lod = lods[l];
+		float measured = l > 0 ? MeasureError(vertices, indices, lods[0], lod, samples) : 0.0f;
+		printf("  [%u tris, error %.4f, measured %.4f]", lod.indexCount / 3, lod.error, measured);
+
+		CHECK(lod.indexCount % 3 == 0 && lod.indexCount > 0);
+		CHECK(lod.indexStart + lod.indexCount <= indices.size());
+		bool valid = true;
+		for (unsigned int t = lod.indexStart; t < lod.indexStart + lod.indexCount; t += 3)
+		{
+			unsigned int a = indices[t], b = indices[t + 1], c = indices[t + 2];
+			valid = valid && a < vertices.size() && b < vertices.size() && c < vertices.size() && a != b && b != c && a != c;
+		}
+		CHECK(valid);
+
+		if (l == 0)
+			continue;
+
+		//levels follow one another, each one smaller and no more accurate than the last
+		CHECK(lod.indexStart == lods[l - 1].indexStart + lods[l - 1].indexCount);
+		CHECK(lod.indexCount < lods[l - 1].indexCount);
+		CHECK(lod.error >= lods[l - 1].error);
+
+		//each step is held to the limit and errors add up along the chain
+		CHECK(lod.error <= limit * l + 0.0001f);
+
+		//the quadric error is an area weighted estimate, not a bound, so the measured distance gets some room
+		CHECK(measured <= limit * l * 2.0f + 0.0001f);
+	}
+	printf("\n");
+	return lods.size();
+}
+
+// A wavy grid of side x side quads, an open surface whose border has to survive
+static void BuildGrid(unsigned int side, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	for (unsigned int y = 0; y <= side; y++)
+	{
+		for (unsigned int x = 0; x <= side; x++)
+		{
+			float u = x / (float)side, v = y / (float)side;
+			Vertex vertex = {};
+			vertex.position = XMFLOAT3(u * 10.0f, sinf(u * 6.0f) * cosf(v * 5.0f) * 0.5f, v * 10.0f);
+			vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			vertex.uv = XMFLOAT2(u, v);
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			unsigned int a = y * (side + 1) + x, b = a + 1, c = a + side + 1, d = c + 1;
+			unsigned int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int side = (unsigned int)GetArgument(argc, argv, "grid", 300);
+	unsigned int samples = (unsigned int)GetArgument(argc, argv, "samples", 2000);
+
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models)
+	{
+		ObjData data;
+		bool loaded = LoadObj(std::filesystem::path("Assets/Models") / model, data);
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		BuildObjVertices(data, vertices, indices);
+		size_t levels = TestMesh(model, vertices, indices, samples);
+
+		//only the quads are already as simple as they get (helix and cube hold their mesh twice, so they get at least that back)
+		CHECK(levels > 1 || strncmp(model, "quad", 4) == 0);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BuildGrid(side, vertices, indices);
+	TestMesh("grid", vertices, indices, samples / 4);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,251 @@
+#include "Meshlet.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Splits the bundled models, a generated sphere (512
+// segments around unless --segments says otherwise) and a
+// flat grid into meshlets and checks them: limits, exact
+// vertex counts, bounding spheres, and cones and frustum
+// culling that never drop a triangle that could be seen.
+// Also times building and culling.
+// --------------------------------------------------------
+
+// Whether the triangle at t faces the camera (cross(b - a, c - a) points out, the winding the importer produces)
+static bool IsFrontFacing(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int t, XMVECTOR camera)
+{
+	XMVECTOR a = XMLoadFloat3(&vertices[indices[t]].position);
+	XMVECTOR b = XMLoadFloat3(&vertices[indices[t + 1]].position);
+	XMVECTOR c = XMLoadFloat3(&vertices[indices[t + 2]].position);
+	XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+	return XMVectorGetX(XMVector3Dot(XMVectorSubtract(a, camera), normal)) < 0;
+}
+
+// Whether any corner of the triangle at t is inside the frustum
+static bool IsInFrustum(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int t, FXMMATRIX viewProjection)
+{
+	for (unsigned int i = t; i < t + 3; i++)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&vertices[indices[i]].position), viewProjection));
+		if (fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w)
+			return true;
+	}
+	return false;
+}
+
+// Each triangle's indices rotated to start from the smallest, so the set survives reordering
+static std::multiset<std::array<unsigned int, 3>> GetTriangles(const std::vector<unsigned int>& indices)
+{
+	std::multiset<std::array<unsigned int, 3>> triangles;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		std::array<unsigned int, 3> triangle = { indices[t], indices[t + 1], indices[t + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.insert(triangle);
+	}
+	return triangles;
+}
+
+static void TestMesh(const char* name, const std::vector<Vertex>& vertices, std::vector<unsigned int> indices, unsigned int cameras)
+{
+	OptimizeVertexCache(indices, vertices.size());
+	std::multiset<std::array<unsigned int, 3>> before = GetTriangles(indices);
+
+	std::vector<Meshlet> meshlets;
+	double buildTime = TimeMilliseconds(1, [&]() { BuildMeshlets(indices, vertices, meshlets); });
+	CHECK(GetTriangles(indices) == before);
+
+	//back to back runs covering every index, within the limits, with exact vertex counts and bounds
+	unsigned int next = 0;
+	size_t meshletVertices = 0;
+	bool valid = true;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		valid = valid && meshlet.indexStart == next && meshlet.triangleCount > 0 &&
+			meshlet.triangleCount <= MESHLET_MAX_TRIANGLES && meshlet.vertexCount <= MESHLET_MAX_VERTICES;
+		next += meshlet.triangleCount * 3;
+
+		std::set<unsigned int> used(indices.begin() + meshlet.indexStart, indices.begin() + meshlet.indexStart + meshlet.triangleCount * 3);
+		valid = valid && used.size() == meshlet.vertexCount;
+		meshletVertices += meshlet.vertexCount;
+		for (unsigned int index : used)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertices[index].position), XMLoadFloat3(&meshlet.center))));
+			valid = valid && distance <= meshlet.radius * 1.0001f + 1e-6f;
+		}
+	}
+	CHECK(valid);
+	CHECK(next == indices.size());
+
+	//cameras all around the mesh: every triangle that faces one and has a corner in view has to be drawn
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> around(-1.0f, 1.0f);
+	XMVECTOR center = XMVectorZero();
+	for (const Vertex& v : vertices)
+		center = XMVectorAdd(center, XMLoadFloat3(&v.position));
+	center = XMVectorScale(center, 1.0f / vertices.size());
+
+	unsigned int missed = 0;
+	size_t drawn = 0;
+	std::vector<MeshletDrawRange> ranges;
+	std::vector<bool> isDrawn(indices.size() / 3);
+	for (unsigned int c = 0; c < cameras; c++)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMVectorSet(around(random), around(random), around(random), 0));
+		XMVECTOR camera = XMVectorAdd(center, XMVectorScale(direction, 4.0f));
+		XMVECTOR target = XMVectorAdd(center, XMVectorSet(around(random), around(random), around(random), 0));
+		XMMATRIX viewProjection = XMMatrixMultiply(
+			XMMatrixLookAtLH(camera, target, XMVectorSet(0, 1, 0, 0)),
+			XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+
+		XMFLOAT4 planes[6];
+		ExtractFrustumPlanes(viewProjection, planes);
+		XMFLOAT3 cameraPosition;
+		XMStoreFloat3(&cameraPosition, camera);
+		CullMeshlets(meshlets.data(), meshlets.size(), planes, cameraPosition, ranges);
+
+		std::fill(isDrawn.begin(), isDrawn.end(), false);
+		for (const MeshletDrawRange& range : ranges)
+		{
+			std::fill(isDrawn.begin() + range.indexStart / 3, isDrawn.begin() + (range.indexStart + range.indexCount) / 3, true);
+			drawn += range.indexCount / 3;
+		}
+		for (unsigned int t = 0; t < indices.size(); t += 3)
+		{
+			if (!isDrawn[t / 3] && IsFrontFacing(vertices, indices, t, camera) && IsInFrustum(vertices, indices, t, viewProjection))
+				missed++;
+		}
+	}
+	CHECK(missed == 0);
+
+	//time culling from one of them
+	XMMATRIX viewProjection = XMMatrixMultiply(
+		XMMatrixLookAtLH(XMVectorAdd(center, XMVectorSet(0, 0, -4, 0)), center, XMVectorSet(0, 1, 0, 0)),
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+	XMFLOAT4 planes[6];
+	ExtractFrustumPlanes(viewProjection, planes);
+	XMFLOAT3 cameraPosition;
+	XMStoreFloat3(&cameraPosition, XMVectorAdd(center, XMVectorSet(0, 0, -4, 0)));
+	unsigned int visible = 0;
+	double cullTime = TimeMilliseconds(10, [&]() { visible = CullMeshlets(meshlets.data(), meshlets.size(), planes, cameraPosition, ranges); });
+
+	printf("%-22s %7zu tris  %5zu meshlets (%.0f tris, %.0f verts each)  build %7.2f ms  cull %7.2f us (%u visible, %zu ranges)  drawn %.0f%%\n",
+		name, indices.size() / 3, meshlets.size(),
+		indices.size() / 3.0 / std::max<size_t>(1, meshlets.size()), meshletVertices / (double)std::max<size_t>(1, meshlets.size()), buildTime, cullTime * 1000.0, visible, ranges.size(),
+		cameras ? 100.0 * drawn / ((double)cameras * indices.size() / 3) : 0.0);
+}
+
+// A unit sphere with segments around and segments / 2 rings
+static void BuildSphere(unsigned int segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	unsigned int rings = segments / 2;
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float phi = XM_PI * r / rings, theta = XM_2PI * s / segments;
+			Vertex v = {};
+			v.position = XMFLOAT3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			v.normal = v.position;
+			v.uv = XMFLOAT2(s / (float)segments, r / (float)rings);
+			vertices.push_back(v);
+		}
+	}
+
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			unsigned int a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+			if (r > 0)
+				indices.insert(indices.end(), { a, b, c });
+			if (r + 1 < rings)
+				indices.insert(indices.end(), { b, d, c });
+		}
+	}
+}
+
+// A flat side x side grid in the xz plane, facing up
+static void BuildGrid(unsigned int side, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	for (unsigned int y = 0; y <= side; y++)
+	{
+		for (unsigned int x = 0; x <= side; x++)
+		{
+			Vertex v = {};
+			v.position = XMFLOAT3(x / (float)side - 0.5f, 0.0f, y / (float)side - 0.5f);
+			v.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			v.uv = XMFLOAT2(x / (float)side, y / (float)side);
+			vertices.push_back(v);
+		}
+	}
+
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			unsigned int a = y * (side + 1) + x, b = a + 1, c = a + side + 1, d = c + 1;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int segments = (unsigned int)GetArgument(argc, argv, "segments", 512);
+	unsigned int cameras = (unsigned int)GetArgument(argc, argv, "cameras", 20);
+
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models)
+	{
+		ObjData data;
+		bool loaded = LoadObj(std::filesystem::path("Assets/Models") / model, data);
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		BuildObjVertices(data, vertices, indices);
+		TestMesh(model, vertices, indices, cameras);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BuildSphere(segments, vertices, indices);
+	TestMesh("generated sphere", vertices, indices, cameras);
+
+	//a flat sheet seen from below is culled whole by its cones, and from above drawn whole
+	vertices.clear();
+	indices.clear();
+	BuildGrid(64, vertices, indices);
+	std::vector<Meshlet> meshlets;
+	BuildMeshlets(indices, vertices, meshlets);
+	for (float height : { -2.0f, 2.0f })
+	{
+		XMVECTOR camera = XMVectorSet(0.0f, height, 0.01f, 1.0f);
+		XMMATRIX viewProjection = XMMatrixMultiply(
+			XMMatrixLookAtLH(camera, XMVectorZero(), XMVectorSet(0, 0, 1, 0)),
+			XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f));
+		XMFLOAT4 planes[6];
+		ExtractFrustumPlanes(viewProjection, planes);
+		XMFLOAT3 cameraPosition;
+		XMStoreFloat3(&cameraPosition, camera);
+		std::vector<MeshletDrawRange> ranges;
+		unsigned int visible = CullMeshlets(meshlets.data(), meshlets.size(), planes, cameraPosition, ranges);
+		CHECK(visible == (height < 0 ? 0 : meshlets.size()));
+		CHECK(ranges.size() == (height < 0 ? 0u : 1u));
+	}
+
+	return GetFailureCount();
+}
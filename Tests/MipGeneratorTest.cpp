@@ -0,0 +1,270 @@
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------------
+// Compares GenerateMips with a plain double precision
+// reference (the filters written out from their
+// definitions, applied in 2D without separating them) on
+// bundled textures and synthetic ones with odd sizes, for
+// the box and Kaiser filters, sRGB, linear and normal map
+// settings.  Every texel of every level has to be within
+// one step.  Also checks a few known answers and times a
+// 2048x2048 chain (unless --size says otherwise).
+// --------------------------------------------------------
+
+// Matches the filter's reach and window in MipGenerator.cpp
+static const double KAISER_RADIUS = 2.0;
+static const double KAISER_ALPHA = 4.0;
+
+static const double PI = 3.14159265358979323846;
+
+static double ToLinear(double c)
+{
+	return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double ToSrgb(double c)
+{
+	return c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1.0 / 2.4) - 0.055;
+}
+
+// How much source texel j adds to a destination texel centered at center (in source texels),
+// where each destination texel spans scale source texels
+static double GetReferenceWeight(MipFilter filter, int j, double center, double scale)
+{
+	//the part of the source texel the destination texel covers
+	if (filter == MIP_FILTER_BOX)
+		return std::max(0.0, std::min(j + 1.0, center + scale * 0.5) - std::max((double)j, center - scale * 0.5));
+
+	double distance = fabs(j + 0.5 - center) / scale;
+	if (distance >= KAISER_RADIUS)
+		return 0.0;
+	double sinc = distance < 1e-9 ? 1.0 : sin(PI * distance) / (PI * distance);
+	double t = distance / KAISER_RADIUS;
+	return sinc * std::cyl_bessel_i(0.0, KAISER_ALPHA * sqrt(1.0 - t * t)) / std::cyl_bessel_i(0.0, KAISER_ALPHA);
+}
+
+// Builds the whole chain in doubles and compares every level of texture with it.  Returns the largest difference.
+static int CompareWithReference(const TextureData& texture, const MipSettings& settings, double& meanDifference)
+{
+	bool single = texture.format == TEXTURE_FORMAT_R8;
+	bool srgb = settings.srgb && !single, normalMap = settings.normalMap && !single;
+	unsigned int channels = single ? 1 : 4;
+
+	unsigned int width = texture.width, height = texture.height;
+	std::vector<double> current((size_t)width * height * channels);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* row = texture.GetMipData(0) + (size_t)y * texture.mips[0].rowPitch;
+		for (unsigned int i = 0; i < width * channels; i++)
+		{
+			double c = row[i] / 255.0;
+			if (i % 4 < 3 && srgb)
+				c = ToLinear(c);
+			else if (i % 4 < 3 && normalMap)
+				c = c * 2.0 - 1.0;
+			current[(size_t)y * width * channels + i] = c;
+		}
+	}
+
+	int largest = 0;
+	size_t total = 0, count = 0;
+	for (unsigned int mip = 1; mip < texture.mips.size(); mip++)
+	{
+		const TextureMip& level = texture.mips[mip];
+		double scaleX = (double)width / level.width, scaleY = (double)height / level.height;
+		double reach = settings.filter == MIP_FILTER_BOX ? 1.0 : KAISER_RADIUS + 1.0;
+		std::vector<double> next((size_t)level.width * level.height * channels);
+
+		for (unsigned int y = 0; y < level.height; y++)
+		{
+			double centerY = (y + 0.5) * scaleY;
+			for (unsigned int x = 0; x < level.width; x++)
+			{
+				double centerX = (x + 0.5) * scaleX;
+				double sum[4] = {}, weightSum = 0;
+				for (int sy = (int)floor(centerY - reach * scaleY); sy <= (int)ceil(centerY + reach * scaleY); sy++)
+				{
+					double weightY = GetReferenceWeight(settings.filter, sy, centerY, scaleY);
+					if (weightY == 0)
+						continue;
+					for (int sx = (int)floor(centerX - reach * scaleX); sx <= (int)ceil(centerX + reach * scaleX); sx++)
+					{
+						double weight = weightY * GetReferenceWeight(settings.filter, sx, centerX, scaleX);
+						if (weight == 0)
+							continue;
+
+						//edges clamp
+						size_t source = ((size_t)std::min(std::max(sy, 0), (int)height - 1) * width + std::min(std::max(sx, 0), (int)width - 1)) * channels;
+						for (unsigned int c = 0; c < channels; c++)
+							sum[c] += current[source + c] * weight;
+						weightSum += weight;
+					}
+				}
+
+				double* texel = &next[((size_t)y * level.width + x) * channels];
+				for (unsigned int c = 0; c < channels; c++)
+					texel[c] = sum[c] / weightSum;
+				if (normalMap)
+				{
+					double length = sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+					for (unsigned int c = 0; c < 3; c++)
+						texel[c] = length > 0 ? texel[c] / length : 0;
+					texel[3] = std::min(1.0, std::max(0.0, texel[3]));
+				}
+				else
+				{
+					for (unsigned int c = 0; c < channels; c++)
+						texel[c] = std::min(1.0, std::max(0.0, texel[c]));
+				}
+
+				const unsigned char* generated = texture.GetMipData(mip) + (size_t)y * level.rowPitch + x * channels;
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					double encoded = texel[c];
+					if (c < 3 && normalMap)
+						encoded = encoded * 0.5 + 0.5;
+					else if (c < 3 && srgb)
+						encoded = ToSrgb(encoded);
+					int difference = abs((int)generated[c] - (int)floor(encoded * 255.0 + 0.5));
+					largest = std::max(largest, difference);
+					total += difference;
+					count++;
+				}
+			}
+		}
+
+		current.swap(next);
+		width = level.width;
+		height = level.height;
+	}
+
+	meanDifference = count ? total / (double)count : 0;
+	return largest;
+}
+
+static void TestTexture(const char* name, const TextureData& source, MipSettings settings)
+{
+	for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+	{
+		TextureData texture = source;
+		settings.filter = filter;
+		double time = TimeMilliseconds(1, [&]() { CHECK(GenerateMips(texture, settings)); });
+		CHECK(texture.mips.size() == GetFullMipCount(texture.width, texture.height));
+		CHECK(memcmp(texture.GetMipData(0), source.GetMipData(0), source.pixels.size()) == 0);
+
+		double mean = 0;
+		int largest = CompareWithReference(texture, settings, mean);
+		CHECK(largest <= 1);
+		printf("%-34s %4ux%-4u %-6s %-6s %2zu mips  %8.2f ms  largest difference %d, mean %.4f\n", name, texture.width, texture.height,
+			filter == MIP_FILTER_BOX ? "box" : "kaiser", settings.normalMap ? "normal" : settings.srgb ? "srgb" : "linear", texture.mips.size(), time, largest, mean);
+	}
+}
+
+static TextureData MakeNoise(TextureFormat format, unsigned int width, unsigned int height, unsigned int seed)
+{
+	TextureData texture;
+	texture.Allocate(format, width, height);
+	std::mt19937 random(seed);
+	for (unsigned char& value : texture.pixels)
+		value = (unsigned char)(random() & 255);
+	return texture;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int size = (unsigned int)GetArgument(argc, argv, "size", 2048);
+	bool bundled = GetArgument(argc, argv, "bundled", 1) != 0;
+	printf("%u worker thread(s)\n", GetWorkerCount());
+
+	MipSettings srgb, linear, normal;
+	srgb.srgb = true;
+	normal.normalMap = true;
+
+	//known answers: a black and white checkerboard averages to half the light, not half the sRGB value
+	TextureData checker;
+	checker.Allocate(TEXTURE_FORMAT_RGBA8, 4, 4);
+	for (unsigned int i = 0; i < 16; i++)
+		memset(&checker.pixels[i * 4], ((i + i / 4) & 1) ? 255 : 0, 4);
+	TextureData linearChecker = checker;
+	CHECK(GenerateMips(checker, srgb) && GenerateMips(linearChecker, linear));
+	CHECK(checker.GetMipData(1)[0] == 188 && checker.GetMipData(1)[3] == 128);
+	CHECK(linearChecker.GetMipData(1)[0] == 128);
+
+	//a flat color stays flat on every level, whatever the filter and size
+	for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+	{
+		TextureData flat;
+		flat.Allocate(TEXTURE_FORMAT_RGBA8, 37, 11);
+		for (size_t i = 0; i < flat.pixels.size(); i++)
+			flat.pixels[i] = (unsigned char)(i % 4 * 60 + 20);
+		srgb.filter = filter;
+		CHECK(GenerateMips(flat, srgb));
+		bool same = true;
+		for (unsigned int mip = 1; mip < flat.mips.size(); mip++)
+		{
+			for (unsigned int i = 0; i < flat.mips[mip].width * flat.mips[mip].height * 4; i++)
+				same = same && flat.GetMipData(mip)[i] == flat.pixels[i % 4];
+		}
+		CHECK(same);
+	}
+	srgb.filter = MIP_FILTER_BOX;
+
+	//odd sizes, where each texel of the smaller level covers parts of source texels
+	TestTexture("noise", MakeNoise(TEXTURE_FORMAT_RGBA8, 37, 23, 1), srgb);
+	TestTexture("noise", MakeNoise(TEXTURE_FORMAT_RGBA8, 61, 1, 2), linear);
+	TestTexture("noise", MakeNoise(TEXTURE_FORMAT_R8, 45, 30, 3), linear);
+	TestTexture("noise", MakeNoise(TEXTURE_FORMAT_RGBA8, 33, 17, 4), normal);
+
+	if (bundled)
+	{
+		struct Bundled { const char* fileName; MipSettings settings; };
+		Bundled textures[] =
+		{
+			{ "Assets/PBR/Albedo/cobblestone_albedo.png", srgb },
+			{ "Assets/PBR/Normal/bronze_normals.png", normal },
+			{ "Assets/PBR/Roughness/bronze_roughness.png", linear },
+			{ "Assets/Textures/cushion.png", srgb },
+		};
+		for (const Bundled& bundledTexture : textures)
+		{
+			TextureData texture;
+			bool loaded = LoadPng(bundledTexture.fileName, texture);
+			CHECK(loaded);
+			if (loaded)
+				TestTexture(strrchr(bundledTexture.fileName, '/') + 1, texture, bundledTexture.settings);
+		}
+	}
+
+	//normal map levels stay unit length once decoded
+	TextureData normals = MakeNoise(TEXTURE_FORMAT_RGBA8, 64, 64, 5);
+	CHECK(GenerateMips(normals, normal));
+	double worst = 0;
+	for (unsigned int mip = 1; mip < normals.mips.size(); mip++)
+	{
+		const unsigned char* texel = normals.GetMipData(mip);
+		for (unsigned int i = 0; i < normals.mips[mip].width * normals.mips[mip].height; i++, texel += 4)
+		{
+			double x = texel[0] / 127.5 - 1, y = texel[1] / 127.5 - 1, z = texel[2] / 127.5 - 1;
+			worst = std::max(worst, fabs(sqrt(x * x + y * y + z * z) - 1));
+		}
+	}
+	CHECK(worst < 0.02);
+
+	//speed, on a texture too big to compare against the slow reference
+	TextureData big = MakeNoise(TEXTURE_FORMAT_RGBA8, size, size, 6);
+	for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+	{
+		srgb.filter = filter;
+		TextureData texture = big;
+		double time = TimeMilliseconds(1, [&]() { GenerateMips(texture, srgb); });
+		printf("%ux%u srgb %-6s  %8.1f ms  %6.1f Mtexel/s of level 0\n", size, size, filter == MIP_FILTER_BOX ? "box" : "kaiser", time, size * (double)size / time / 1000.0);
+	}
+
+	return GetFailureCount();
+}
@@ -0,0 +1,142 @@
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "TestHelpers.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _MSC_VER
+#define sscanf_s sscanf
+#endif
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Parses a generated OBJ file (128 MB unless --megabytes
+// says otherwise) with the memory mapped, multithreaded
+// loader and with the getline/sscanf_s loop Mesh used to
+// have, and reports both in MB/s
+// --------------------------------------------------------
+
+// The old Mesh(device, fileName) loop, minus tangents and buffers: one vertex per face corner
+static void LoadObjLegacy(const std::filesystem::path& fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::ifstream obj(fileName);
+	if (!obj.is_open())
+		return;
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	unsigned int indexCounter = 0;
+	char chars[100];
+
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv;
+			sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos;
+			sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[12];
+			int numbersRead = sscanf_s(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+			Vertex v[4];
+			for (int corner = 0; corner < (numbersRead == 12 ? 4 : 3); corner++)
+			{
+				v[corner] = {};
+				v[corner].position = positions[i[corner * 3] - 1];
+				v[corner].uv = uvs[i[corner * 3 + 1] - 1];
+				v[corner].normal = normals[i[corner * 3 + 2] - 1];
+				v[corner].uv.y = 1.0f - v[corner].uv.y;
+				v[corner].position.z *= -1.0f;
+				v[corner].normal.z *= -1.0f;
+			}
+
+			verts.push_back(v[0]);
+			verts.push_back(v[2]);
+			verts.push_back(v[1]);
+			for (int n = 0; n < 3; n++)
+				indices.push_back(indexCounter++);
+
+			if (numbersRead == 12)
+			{
+				verts.push_back(v[0]);
+				verts.push_back(v[3]);
+				verts.push_back(v[2]);
+				for (int n = 0; n < 3; n++)
+					indices.push_back(indexCounter++);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double megabytes = GetArgument(argc, argv, "megabytes", 128);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::filesystem::path fileName = std::filesystem::temp_directory_path() / "ObjLoaderBenchmark.obj";
+	size_t triangles = WriteObjGrid(fileName, megabytes);
+	CHECK(triangles > 0);
+	double fileMegabytes = std::filesystem::file_size(fileName) / (1024.0 * 1024.0);
+	printf("%.1f MB, %zu triangles, %u worker thread(s)\n", fileMegabytes, triangles, GetWorkerCount());
+
+	//first read warms the page cache, so every path below reads from memory
+	ObjData data;
+	LoadObj(fileName, data);
+
+	double parse = TimeMilliseconds(runs, [&]() { data = ObjData(); LoadObj(fileName, data); });
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	double weld = TimeMilliseconds(runs, [&]() { BuildObjVertices(data, vertices, indices); });
+
+	std::vector<Vertex> legacyVertices;
+	std::vector<unsigned int> legacyIndices;
+	double legacy = TimeMilliseconds(1, [&]()
+	{
+		legacyVertices.clear();
+		legacyIndices.clear();
+		LoadObjLegacy(fileName, legacyVertices, legacyIndices);
+	});
+
+	printf("getline/sscanf_s:        %8.1f ms  %7.1f MB/s\n", legacy, fileMegabytes / legacy * 1000.0);
+	printf("mapped parallel parse:   %8.1f ms  %7.1f MB/s  (%.1fx)\n", parse, fileMegabytes / parse * 1000.0, legacy / parse);
+	printf("  + weld and convert:    %8.1f ms  %7.1f MB/s  (%.1fx)\n", parse + weld, fileMegabytes / (parse + weld) * 1000.0, legacy / (parse + weld));
+
+	//same triangles, corner for corner, and every corner of the grid is shared, so welding must find them all
+	CHECK(data.corners.size() == triangles * 3);
+	CHECK(indices.size() == legacyIndices.size());
+	CHECK(vertices.size() == data.positions.size());
+	bool same = indices.size() == legacyIndices.size();
+	for (size_t i = 0; same && i < indices.size(); i++)
+	{
+		const Vertex& a = vertices[indices[i]];
+		const Vertex& b = legacyVertices[legacyIndices[i]];
+		same = a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z &&
+			a.uv.x == b.uv.x && a.uv.y == b.uv.y && a.normal.z == b.normal.z;
+	}
+	CHECK(same);
+
+	std::filesystem::remove(fileName);
+	return GetFailureCount();
+}
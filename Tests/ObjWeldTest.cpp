@@ -0,0 +1,105 @@
+#include "ObjLoader.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Loads every bundled model welded by BuildObjVertices and
+// as the plain triangle soup of one vertex per corner Mesh
+// used to build, checks every welded triangle reproduces
+// the soup's positions, normals and uvs, and reports how
+// many fewer vertices welding leaves.  Also checks corners
+// without normals are never welded.
+// --------------------------------------------------------
+
+// One vertex per face corner, converted the same way as BuildObjVertices but never shared
+static void BuildSoup(const ObjData& data, std::vector<Vertex>& vertices)
+{
+	vertices.clear();
+	for (size_t t = 0; t + 2 < data.corners.size(); t += 3)
+	{
+		//same left-handed flip: z negated, winding reversed, v flipped
+		for (size_t k : { t, t + 2, t + 1 })
+		{
+			const ObjCorner& corner = data.corners[k];
+			Vertex v = {};
+			v.position = data.positions[corner.position];
+			v.position.z *= -1.0f;
+			v.uv = corner.uv >= 0 ? data.uvs[corner.uv] : XMFLOAT2(0, 0);
+			v.uv.y = 1.0f - v.uv.y;
+			if (corner.normal >= 0)
+			{
+				v.normal = data.normals[corner.normal];
+				v.normal.z *= -1.0f;
+			}
+			vertices.push_back(v);
+		}
+	}
+}
+
+static bool IsSame(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Welds a model and compares it corner for corner with its soup, returning soup vertices / welded vertices
+static double CompareModel(const std::filesystem::path& fileName, int runs)
+{
+	ObjData data;
+	CHECK(LoadObj(fileName, data));
+
+	std::vector<Vertex> soup, vertices;
+	std::vector<unsigned int> indices;
+	double soupTime = TimeMilliseconds(runs, [&]() { BuildSoup(data, soup); });
+	double weldTime = TimeMilliseconds(runs, [&]() { BuildObjVertices(data, vertices, indices); });
+
+	CHECK(indices.size() == soup.size());
+	bool same = indices.size() == soup.size();
+	for (size_t i = 0; same && i < indices.size(); i++)
+	{
+		const Vertex& a = vertices[indices[i]];
+		const Vertex& b = soup[i];
+		same = IsSame(a.position, b.position) && IsSame(a.normal, b.normal) && a.uv.x == b.uv.x && a.uv.y == b.uv.y;
+	}
+	CHECK(same);
+
+	//one vertex per distinct index triple, so nothing the file shared was left unwelded
+	std::set<std::tuple<int, int, int>> triples;
+	for (const ObjCorner& corner : data.corners)
+		triples.insert(std::make_tuple(corner.position, corner.uv, corner.normal));
+	CHECK(vertices.size() == triples.size());
+	double ratio = soup.size() / (double)std::max<size_t>(1, vertices.size());
+	printf("%-22s %5zu triangles  soup %6zu vertices  welded %5zu  (%.1fx fewer)  soup %.3f ms, weld %.3f ms\n",
+		fileName.filename().string().c_str(), indices.size() / 3, soup.size(), vertices.size(), ratio, soupTime, weldTime);
+	return ratio;
+}
+
+int main(int argc, char** argv)
+{
+	int runs = (int)GetArgument(argc, argv, "runs", 20);
+
+	//the smooth models share nearly every corner between four to six triangles
+	double sphere = CompareModel("Assets/Models/sphere.obj", runs);
+	double torus = CompareModel("Assets/Models/torus.obj", runs);
+	CHECK(sphere > 4.0 && torus > 4.0);
+	for (const char* model : { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj" })
+		CompareModel(std::filesystem::path("Assets/Models") / model, runs);
+
+	//without normals every face gets its own flat normal, so no corner is shared
+	const char* text = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf 1 2 3\nf 2 4 3\n";
+	ObjData flat;
+	ParseObj(text, strlen(text), flat);
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(flat, vertices, indices);
+	CHECK(vertices.size() == 6 && indices.size() == 6);
+	CHECK(vertices.size() == 6 && vertices[0].normal.z == -1.0f && vertices[3].normal.z == -1.0f);
+	printf("no normals: %zu corners, %zu vertices\n", indices.size(), vertices.size());
+
+	return GetFailureCount();
+}
@@ -0,0 +1,117 @@
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include "TextureCooker.h"
+#include "TexturePacker.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Packs every Assets/PBR set's roughness and metal maps
+// into an ORM texture and checks each channel against the
+// map it came from: occlusion white (no set ships one),
+// roughness in green, metalness in blue, exact where the
+// sizes match and within the texels around it where the
+// smaller map was resampled.  Then cooks each set packed
+// and separately and prints the bytes packing saves.
+// --------------------------------------------------------
+
+// Whether every texel of a channel of the packed texture came from the first channel of source,
+// exactly at the same size, or between the texels bilinear filtering reads around it when resampled
+static bool MatchesSource(const TextureData& packed, unsigned int channel, const TextureData& source)
+{
+	unsigned int texelSize = GetTexelSize(source.format);
+	const unsigned char* data = source.GetMipData(0);
+	unsigned int pitch = source.mips[0].rowPitch;
+	for (unsigned int y = 0; y < packed.height; y++)
+	{
+		const unsigned char* row = packed.GetMipData(0) + (size_t)y * packed.mips[0].rowPitch;
+		for (unsigned int x = 0; x < packed.width; x++)
+		{
+			unsigned char value = row[x * 4 + channel];
+			if (source.width == packed.width && source.height == packed.height)
+			{
+				if (value != data[(size_t)y * pitch + x * texelSize])
+					return false;
+				continue;
+			}
+
+			float u = std::min(std::max((x + 0.5f) * source.width / packed.width - 0.5f, 0.0f), (float)(source.width - 1));
+			float v = std::min(std::max((y + 0.5f) * source.height / packed.height - 0.5f, 0.0f), (float)(source.height - 1));
+			unsigned int x0 = (unsigned int)u, y0 = (unsigned int)v;
+			unsigned int x1 = std::min(x0 + 1, source.width - 1), y1 = std::min(y0 + 1, source.height - 1);
+			unsigned char around[4] = { data[(size_t)y0 * pitch + x0 * texelSize], data[(size_t)y0 * pitch + x1 * texelSize],
+				data[(size_t)y1 * pitch + x0 * texelSize], data[(size_t)y1 * pitch + x1 * texelSize] };
+			if (value < *std::min_element(around, around + 4) || value > *std::max_element(around, around + 4))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool IsConstant(const TextureData& packed, unsigned int channel, unsigned char expected)
+{
+	for (unsigned int y = 0; y < packed.height; y++)
+	{
+		const unsigned char* row = packed.GetMipData(0) + (size_t)y * packed.mips[0].rowPitch;
+		for (unsigned int x = 0; x < packed.width; x++)
+		{
+			if (row[x * 4 + channel] != expected)
+				return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::string> sets;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/PBR/Roughness"))
+	{
+		std::string name = entry.path().stem().string();
+		name = name.substr(0, name.rfind('_'));
+		if (std::filesystem::exists("Assets/PBR/Metal/" + name + "_metal.png"))
+			sets.push_back(name);
+	}
+	std::sort(sets.begin(), sets.end());
+	CHECK(!sets.empty());
+
+	size_t separateTotal = 0, packedTotal = 0;
+	for (const std::string& name : sets)
+	{
+		OrmSources sources;
+		sources.roughness = "Assets/PBR/Roughness/" + name + "_roughness.png";
+		sources.metalness = "Assets/PBR/Metal/" + name + "_metal.png";
+
+		TextureData roughness, metalness, packed;
+		CHECK(LoadPng(sources.roughness, roughness) && LoadPng(sources.metalness, metalness));
+		double packTime = TimeMilliseconds(runs, [&]() { CHECK(PackOrmTexture(nullptr, roughness, metalness, packed)); });
+		CHECK(packed.width == std::max(roughness.width, metalness.width) && packed.height == std::max(roughness.height, metalness.height));
+		CHECK(IsConstant(packed, 0, 255) && IsConstant(packed, 3, 255));
+		CHECK(MatchesSource(packed, 1, roughness));
+		CHECK(MatchesSource(packed, 2, metalness));
+
+		//an occlusion map goes to red; none ships, so the roughness map stands in for one
+		TextureData occluded;
+		CHECK(PackOrmTexture(&roughness, roughness, metalness, occluded));
+		CHECK(MatchesSource(occluded, 0, roughness));
+
+		TextureData cooked;
+		TextureCookInfo info;
+		CHECK(CookOrmTexture(sources, nullptr, cooked, &info));
+		size_t packedBytes = cooked.pixels.size();
+		CHECK(packedBytes < info.separateBytes);
+		separateTotal += info.separateBytes;
+		packedTotal += packedBytes;
+
+		printf("%-12s roughness %4ux%-4u metal %4ux%-4u  pack %7.2f ms  cooked separately %8zu bytes, packed %8zu (%zu saved)\n",
+			name.c_str(), roughness.width, roughness.height, metalness.width, metalness.height, packTime, info.separateBytes, packedBytes, info.separateBytes - packedBytes);
+	}
+	printf("%zu sets: %zu bytes cooked separately, %zu packed, %zu saved (%.0f%%)\n",
+		sets.size(), separateTotal, packedTotal, separateTotal - packedTotal, 100.0 * (separateTotal - packedTotal) / std::max<size_t>(1, separateTotal));
+
+	return GetFailureCount();
+}
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include <png.h>
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+// --------------------------------------------------------
+// Decodes every PNG under Assets (or the first --files of
+// them) from memory with DecodePng and with libpng, checks
+// every texel matches libpng's in the texture's layout, and
+// prints both times.  libpng stands in for WIC, the library
+// decoder the loader used to fall back to, which only runs
+// on Windows.
+// --------------------------------------------------------
+
+struct PngSource
+{
+	const unsigned char* data;
+	size_t size;
+	size_t offset;
+};
+
+static void ReadFromMemory(png_structp png, png_bytep target, png_size_t length)
+{
+	PngSource* source = (PngSource*)png_get_io_ptr(png);
+	if (length > source->size - source->offset)
+		png_error(png, "read past the end");
+	memcpy(target, source->data + source->offset, length);
+	source->offset += length;
+}
+
+// libpng's decode in the layout DecodePng gives: R8 for gray without transparency, RGBA8 otherwise
+static bool DecodeReference(const unsigned char* data, size_t size, TextureData& texture)
+{
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info = png_create_info_struct(png);
+	std::vector<png_bytep> rows;
+	if (setjmp(png_jmpbuf(png)))
+	{
+		png_destroy_read_struct(&png, &info, nullptr);
+		return false;
+	}
+
+	PngSource source = { data, size, 0 };
+	png_set_read_fn(png, &source, ReadFromMemory);
+	png_read_info(png, info);
+
+	int colorType = png_get_color_type(png, info);
+	bool transparent = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+	bool gray = (colorType == PNG_COLOR_TYPE_GRAY) && !transparent;
+	png_set_expand(png);
+	png_set_strip_16(png);
+	png_set_interlace_handling(png);
+	if (!gray)
+	{
+		if (!(colorType & PNG_COLOR_MASK_COLOR))
+			png_set_gray_to_rgb(png);
+		if (!(colorType & PNG_COLOR_MASK_ALPHA) && !transparent)
+			png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+	}
+	png_read_update_info(png, info);
+
+	texture.Allocate(gray ? TEXTURE_FORMAT_R8 : TEXTURE_FORMAT_RGBA8, png_get_image_width(png, info), png_get_image_height(png, info));
+	rows.resize(texture.height);
+	for (unsigned int y = 0; y < texture.height; y++)
+		rows[y] = texture.GetMipData(0) + (size_t)y * texture.mips[0].rowPitch;
+	png_read_image(png, rows.data());
+	png_read_end(png, nullptr);
+	png_destroy_read_struct(&png, &info, nullptr);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	size_t fileCount = (size_t)GetArgument(argc, argv, "files", 1000);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator("Assets"))
+	{
+		if (entry.path().extension() == ".png")
+			files.push_back(entry.path());
+	}
+	std::sort(files.begin(), files.end());
+	files.resize(std::min(files.size(), fileCount));
+
+	double referenceTotal = 0, decoderTotal = 0;
+	size_t sourceBytes = 0, texelBytes = 0;
+	unsigned int mismatches = 0;
+	for (const std::filesystem::path& file : files)
+	{
+		//both decode from the same mapping, so only decoding is timed
+		MappedFile mapped;
+		CHECK(mapped.Open(file));
+		const unsigned char* data = (const unsigned char*)mapped.GetData();
+		TextureData reference, decoded;
+		double referenceTime = TimeMilliseconds(runs, [&]() { CHECK(DecodeReference(data, mapped.GetSize(), reference)); });
+		double decoderTime = TimeMilliseconds(runs, [&]() { CHECK(DecodePng(data, mapped.GetSize(), decoded)); });
+
+		bool same = reference.format == decoded.format && reference.width == decoded.width && reference.height == decoded.height &&
+			reference.pixels == decoded.pixels;
+		CHECK(same);
+		mismatches += !same;
+
+		referenceTotal += referenceTime;
+		decoderTotal += decoderTime;
+		sourceBytes += mapped.GetSize();
+		texelBytes += decoded.pixels.size();
+		printf("%-40s %4ux%-4u %-5s libpng %7.2f ms  DecodePng %7.2f ms (%.2fx)  %s\n",
+			file.lexically_relative("Assets").generic_string().c_str(), decoded.width, decoded.height, decoded.format == TEXTURE_FORMAT_R8 ? "R8" : "RGBA8",
+			referenceTime, decoderTime, referenceTime / decoderTime, same ? "same texels" : "DIFFERENT TEXELS");
+	}
+
+	printf("%zu files, %.1f MB of PNG to %.1f MB of texels: libpng %.1f ms, DecodePng %.1f ms (%.2fx, %.0f MB/s of texels), %u mismatch(es)\n",
+		files.size(), sourceBytes / 1048576.0, texelBytes / 1048576.0, referenceTotal, decoderTotal, referenceTotal / decoderTotal,
+		texelBytes / 1048576.0 / decoderTotal * 1000.0, mismatches);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,206 @@
+#include "CubeMap.h"
+#include "PngDecoder.h"
+#include "SphericalHarmonics.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Projects cubemaps whose radiance nine coefficients hold
+// exactly (constant in red, a cosine lobe in green and a
+// band 2 lobe in blue) and checks both the radiance and
+// its irradiance against the analytic values, at 512
+// texels a side (unless --size says otherwise) and at an
+// odd size that leaves partial blocks.  Then compares the
+// first sky in Assets/Skies with a brute force projection
+// in doubles, and times the projection.
+// --------------------------------------------------------
+
+static const char* FACE_NAMES[6] = { "right.png", "left.png", "up.png", "down.png", "front.png", "back.png" };
+
+// The linear radiance of the test cubemap in a (unit) direction, and its irradiance over pi:
+// the clamped cosine scales band 1 by 2/3 and band 2 by 1/4
+static XMFLOAT3 GetRadiance(XMFLOAT3 d)
+{
+	return XMFLOAT3(0.5f, 0.5f + 0.4f * d.y, 0.5f + 0.15f * (3.0f * d.z * d.z - 1.0f));
+}
+
+static XMFLOAT3 GetIrradiance(XMFLOAT3 d)
+{
+	return XMFLOAT3(0.5f, 0.5f + 0.4f * d.y * 2.0f / 3.0f, 0.5f + 0.15f * (3.0f * d.z * d.z - 1.0f) * 0.25f);
+}
+
+static unsigned char EncodeSrgb(float linear)
+{
+	float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+	return (unsigned char)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static float DecodeSrgb(unsigned char value)
+{
+	float c = value / 255.0f;
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// The direction through the center of a face's texel
+static XMFLOAT3 GetTexelDirection(unsigned int face, unsigned int x, unsigned int y, unsigned int size)
+{
+	const CubeFaceAxes& axes = CUBE_FACE_AXES[face];
+	float u = (x + 0.5f) * 2.0f / size - 1.0f;
+	float v = (y + 0.5f) * 2.0f / size - 1.0f;
+	XMFLOAT3 direction;
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&axes.center),
+		XMVectorAdd(XMVectorScale(XMLoadFloat3(&axes.u), u), XMVectorScale(XMLoadFloat3(&axes.v), v)))));
+	return direction;
+}
+
+static void BuildFaces(unsigned int size, TextureData faces[6])
+{
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		faces[face].Allocate(TEXTURE_FORMAT_RGBA8, size, size);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			unsigned char* texel = faces[face].GetMipData(0) + (size_t)y * faces[face].mips[0].rowPitch;
+			for (unsigned int x = 0; x < size; x++, texel += 4)
+			{
+				XMFLOAT3 radiance = GetRadiance(GetTexelDirection(face, x, y, size));
+				texel[0] = EncodeSrgb(radiance.x);
+				texel[1] = EncodeSrgb(radiance.y);
+				texel[2] = EncodeSrgb(radiance.z);
+				texel[3] = 255;
+			}
+		}
+	}
+}
+
+static float GetError(XMFLOAT3 a, XMFLOAT3 b)
+{
+	return std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+}
+
+// Largest error of the projected radiance and irradiance over a spread of directions
+static void TestAnalytic(unsigned int size)
+{
+	TextureData faces[6];
+	BuildFaces(size, faces);
+	const TextureData* facePointers[6] = { &faces[0], &faces[1], &faces[2], &faces[3], &faces[4], &faces[5] };
+	SH9Color radiance;
+	CHECK(ProjectCubemapSH9(facePointers, radiance));
+	SH9Color irradiance = ConvolveIrradianceSH9(radiance);
+
+	float radianceError = 0, irradianceError = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		//a Fibonacci spiral, evenly spread over the sphere
+		float z = 1.0f - (i + 0.5f) * 2.0f / 1000.0f;
+		float r = sqrtf(1.0f - z * z);
+		float angle = i * 2.39996323f;
+		XMFLOAT3 d(r * cosf(angle), r * sinf(angle), z);
+		radianceError = std::max(radianceError, GetError(EvaluateSH9(radiance, d), GetRadiance(d)));
+		irradianceError = std::max(irradianceError, GetError(EvaluateSH9(irradiance, d), GetIrradiance(d)));
+	}
+
+	//8 bit sRGB steps are about 0.004 apart around 0.5, so the faces themselves are up to half that off
+	CHECK(radianceError < 0.005f && irradianceError < 0.005f);
+	printf("%4u texels a side: largest radiance error %.2e, irradiance error %.2e\n", size, radianceError, irradianceError);
+}
+
+// Driscoll's area element: 4 times the solid angle of a cube face from its center to (u, v)
+static double GetAreaElement(double u, double v)
+{
+	return atan2(u * v, sqrt(u * u + v * v + 1.0));
+}
+
+// Every texel of a sky projected in doubles with its exact solid angle, one basis evaluation per texel
+static void ProjectReference(const TextureData* const faces[6], double result[9][3])
+{
+	memset(result, 0, sizeof(double) * 27);
+	unsigned int size = faces[0]->width;
+	unsigned int texelSize = GetTexelSize(faces[0]->format);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int y = 0; y < size; y++)
+		{
+			const unsigned char* texel = faces[face]->GetMipData(0) + (size_t)y * faces[face]->mips[0].rowPitch;
+			for (unsigned int x = 0; x < size; x++, texel += texelSize)
+			{
+				double u0 = x * 2.0 / size - 1.0, u1 = (x + 1) * 2.0 / size - 1.0;
+				double v0 = y * 2.0 / size - 1.0, v1 = (y + 1) * 2.0 / size - 1.0;
+				double solidAngle = GetAreaElement(u0, v0) - GetAreaElement(u0, v1) - GetAreaElement(u1, v0) + GetAreaElement(u1, v1);
+
+				XMFLOAT3 d = GetTexelDirection(face, x, y, size);
+				double basis[9] =
+				{
+					0.282095, 0.488603 * d.y, 0.488603 * d.z, 0.488603 * d.x, 1.092548 * d.x * d.y, 1.092548 * d.y * d.z,
+					0.315392 * (3.0 * d.z * d.z - 1.0), 1.092548 * d.x * d.z, 0.546274 * (d.x * d.x - d.y * d.y)
+				};
+				double color[3] = { DecodeSrgb(texel[0]), DecodeSrgb(texel[texelSize > 1 ? 1 : 0]), DecodeSrgb(texel[texelSize > 1 ? 2 : 0]) };
+				for (int i = 0; i < 9; i++)
+				{
+					for (int c = 0; c < 3; c++)
+						result[i][c] += color[c] * basis[i] * solidAngle;
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int size = (unsigned int)GetArgument(argc, argv, "size", 512);
+	int runs = (int)GetArgument(argc, argv, "runs", 5);
+
+	TestAnalytic(size);
+	TestAnalytic(129);
+
+	std::vector<std::filesystem::path> skies;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/Skies"))
+	{
+		if (entry.is_directory())
+			skies.push_back(entry.path());
+	}
+	std::sort(skies.begin(), skies.end());
+	CHECK(!skies.empty());
+	if (skies.empty())
+		return GetFailureCount();
+
+	TextureData sky[6];
+	const TextureData* skyPointers[6];
+	for (int face = 0; face < 6; face++)
+	{
+		CHECK(LoadPng(skies[0] / FACE_NAMES[face], sky[face]));
+		skyPointers[face] = &sky[face];
+	}
+
+	SH9Color radiance;
+	double projectTime = TimeMilliseconds(runs, [&]() { CHECK(ProjectCubemapSH9(skyPointers, radiance)); });
+	double reference[9][3];
+	double referenceTime = TimeMilliseconds(1, [&]() { ProjectReference(skyPointers, reference); });
+
+	//blocks share one direction and a texel's weight comes from its center, both small next to band 0
+	float largest = 0;
+	for (int i = 0; i < 9; i++)
+	{
+		const XMFLOAT3& c = radiance.coefficients[i];
+		largest = std::max(largest, (float)std::max(fabs(c.x - reference[i][0]), std::max(fabs(c.y - reference[i][1]), fabs(c.z - reference[i][2]))));
+	}
+	float scale = (float)std::max(reference[0][0], std::max(reference[0][1], reference[0][2]));
+	CHECK(largest < scale * 0.005f);
+
+	double texels = 6.0 * sky[0].width * sky[0].height;
+	printf("%s, %u texels a side: largest coefficient error %.2e (band 0 is %.3f), projected in %.2f ms (%.0f Mtexels/s), brute force %.1f ms\n",
+		skies[0].filename().string().c_str(), sky[0].width, largest, scale, projectTime, texels / projectTime / 1000.0, referenceTime);
+
+	//the faces the baker's default size would give, made up so the time doesn't depend on the sky
+	TextureData faces[6];
+	BuildFaces(size, faces);
+	const TextureData* facePointers[6] = { &faces[0], &faces[1], &faces[2], &faces[3], &faces[4], &faces[5] };
+	double syntheticTime = TimeMilliseconds(runs, [&]() { CHECK(ProjectCubemapSH9(facePointers, radiance)); });
+	printf("%u texels a side: projected in %.2f ms (%.0f Mtexels/s)\n", size, syntheticTime, 6.0 * size * size / syntheticTime / 1000.0);
+
+	return GetFailureCount();
+}
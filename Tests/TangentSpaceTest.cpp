@@ -0,0 +1,190 @@
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "TangentSpace.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Compares GenerateTangents with the CalculateTangents
+// Mesh used to have, on every bundled model and on a
+// generated grid (1200 quads a side unless --grid says
+// otherwise) whose right half has mirrored UVs and which
+// has a row of degenerate UVs.  Checks the new tangents are
+// unit length, orthogonal, signed and repeatable, match
+// the old ones wherever the old ones were usable, and
+// times both.
+// --------------------------------------------------------
+
+// The old Mesh::CalculateTangents, as it was
+static void CalculateTangentsLegacy(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	for (int i = 0; i < numVerts; i++)
+		verts[i].tangent = XMFLOAT4(0, 0, 0, 0);
+
+	for (int i = 0; i < numIndices;)
+	{
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		float x1 = v2->position.x - v1->position.x;
+		float y1 = v2->position.y - v1->position.y;
+		float z1 = v2->position.z - v1->position.z;
+
+		float x2 = v3->position.x - v1->position.x;
+		float y2 = v3->position.y - v1->position.y;
+		float z2 = v3->position.z - v1->position.z;
+
+		float s1 = v2->uv.x - v1->uv.x;
+		float t1 = v2->uv.y - v1->uv.y;
+
+		float s2 = v3->uv.x - v1->uv.x;
+		float t2 = v3->uv.y - v1->uv.y;
+
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		v1->tangent.x += tx;
+		v1->tangent.y += ty;
+		v1->tangent.z += tz;
+
+		v2->tangent.x += tx;
+		v2->tangent.y += ty;
+		v2->tangent.z += tz;
+
+		v3->tangent.x += tx;
+		v3->tangent.y += ty;
+		v3->tangent.z += tz;
+	}
+
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+		XMVECTOR tangent = XMLoadFloat4(&verts[i].tangent);
+		tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent))));
+		XMStoreFloat4(&verts[i].tangent, tangent);
+	}
+}
+
+static bool IsFinite(const XMFLOAT4& v)
+{
+	return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+// Runs both, checks the new frames, and returns the largest component difference over the vertices
+// compare accepts (and where the old tangent came out finite)
+template <typename Compare>
+static float TestTangents(const char* name, const std::vector<Vertex>& source, std::vector<unsigned int>& indices, int runs, Compare compare)
+{
+	std::vector<Vertex> legacy = source, generated = source, again = source;
+	double legacyTime = TimeMilliseconds(runs, [&]() { CalculateTangentsLegacy(legacy.data(), (int)legacy.size(), indices.data(), (int)indices.size()); });
+	double generatedTime = TimeMilliseconds(runs, [&]() { GenerateTangents(generated.data(), generated.size(), indices.data(), indices.size()); });
+	GenerateTangents(again.data(), again.size(), indices.data(), indices.size());
+
+	size_t bad = 0, legacyNonFinite = 0, compared = 0, mirrored = 0;
+	float largest = 0;
+	for (size_t v = 0; v < source.size(); v++)
+	{
+		const XMFLOAT4& tangent = generated[v].tangent;
+		XMVECTOR t = XMLoadFloat4(&tangent);
+		float length = XMVectorGetX(XMVector3Length(t));
+		float dot = XMVectorGetX(XMVector3Dot(t, XMVector3Normalize(XMLoadFloat3(&source[v].normal))));
+		if (!IsFinite(tangent) || fabsf(length - 1.0f) > 1e-4f || fabsf(dot) > 1e-4f || (tangent.w != 1.0f && tangent.w != -1.0f))
+			bad++;
+		mirrored += tangent.w < 0;
+
+		if (!IsFinite(legacy[v].tangent))
+		{
+			legacyNonFinite++;
+			continue;
+		}
+		if (!compare(v))
+			continue;
+
+		compared++;
+		const XMFLOAT4& old = legacy[v].tangent;
+		largest = std::max({ largest, fabsf(old.x - tangent.x), fabsf(old.y - tangent.y), fabsf(old.z - tangent.z) });
+	}
+
+	//sums are added in a fixed order, so a second run is bit for bit the same
+	CHECK(memcmp(generated.data(), again.data(), generated.size() * sizeof(Vertex)) == 0);
+	CHECK(bad == 0);
+
+	printf("%-20s %8zu verts %8zu tris  legacy %8.2f ms  new %8.2f ms  max diff %.2e over %zu verts  mirrored %zu  legacy non-finite %zu\n",
+		name, source.size(), indices.size() / 3, legacyTime, generatedTime, largest, compared, mirrored, legacyNonFinite);
+	return largest;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int side = (unsigned int)GetArgument(argc, argv, "grid", 1200);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+	printf("%u worker thread(s)\n", GetWorkerCount());
+
+	//no degenerate UVs in the models, so every vertex has to agree (mirrored ones only differ in w)
+	const char* models[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* model : models)
+	{
+		ObjData data;
+		bool loaded = LoadObj(std::filesystem::path("Assets/Models") / model, data);
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		BuildObjVertices(data, vertices, indices);
+		CHECK(TestTangents(model, vertices, indices, runs, [](size_t) { return true; }) <= 1e-5f);
+	}
+
+	//u runs back down across the right half, and one row repeats the v of the row below
+	unsigned int mirror = side / 2, degenerate = side / 3;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int y = 0; y <= side; y++)
+	{
+		for (unsigned int x = 0; x <= side; x++)
+		{
+			Vertex v = {};
+			v.position = XMFLOAT3(x / (float)side, y / (float)side, 0.1f * sinf(x * 0.05f));
+			v.normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+			float u = x / (float)side;
+			v.uv = XMFLOAT2(x > mirror ? 1.0f - u : u, (y == degenerate ? y - 1 : y) / (float)side);
+			vertices.push_back(v);
+		}
+	}
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			unsigned int a = y * (side + 1) + x, b = a + 1, c = a + side + 1, d = c + 1;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+	}
+
+	//away from the mirror seam and the degenerate rows both methods see the same triangles
+	float largest = TestTangents("grid", vertices, indices, runs, [&](size_t v)
+	{
+		unsigned int x = (unsigned int)(v % (side + 1)), y = (unsigned int)(v / (side + 1));
+		return (x + 1 < mirror || x > mirror + 1) && (y + 1 < degenerate || y > degenerate + 1);
+	});
+	CHECK(largest <= 1e-5f);
+
+	//the two halves get opposite signs
+	std::vector<Vertex> generated = vertices;
+	GenerateTangents(generated.data(), generated.size(), indices.data(), indices.size());
+	unsigned int row = side / 2 * (side + 1);
+	CHECK(generated[row + side / 4].tangent.w == -generated[row + side * 3 / 4].tangent.w);
+
+	return GetFailureCount();
+}
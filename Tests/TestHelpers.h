@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+// --------------------------------------------------------
+// What every harness shares
+//
+// - CHECK prints a failed condition and counts it, and main
+//   returns GetFailureCount() so ctest sees the failure
+// - Timings are the best of a few runs, in milliseconds
+// - Sizes come from the command line ("--name value"), so
+//   ctest can run a harness small and a person full size
+// - WriteObjGrid makes an OBJ file of any size to load
+// --------------------------------------------------------
+
+inline int& GetFailureCount()
+{
+	static int count = 0;
+	return count;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			GetFailureCount()++; \
+		} \
+	} while (0)
+
+// The value after --name, or fallback if it wasn't given
+inline double GetArgument(int argc, char** argv, const char* name, double fallback)
+{
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (argv[i][0] == '-' && argv[i][1] == '-' && strcmp(argv[i] + 2, name) == 0)
+			return atof(argv[i + 1]);
+	}
+	return fallback;
+}
+
+// Whether --name was given at all
+inline bool HasArgument(int argc, char** argv, const char* name)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (argv[i][0] == '-' && argv[i][1] == '-' && strcmp(argv[i] + 2, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Fastest of runs calls of work, in milliseconds
+template <typename Work>
+double TimeMilliseconds(int runs, Work work)
+{
+	double best = HUGE_VAL;
+	for (int i = 0; i < runs; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		work();
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+// A wavy grid with positions, uvs and normals, as triangles, about megabytes large.  Lines stay short
+// enough for the 100 character buffer of the getline loop Mesh used to have.  Returns the triangle count.
+inline size_t WriteObjGrid(const std::filesystem::path& fileName, double megabytes)
+{
+	//a grid vertex is about 90 bytes of v/vt/vn lines plus its two triangles, about 60 bytes each
+	unsigned int side = (unsigned int)sqrt(megabytes * 1024 * 1024 / 210.0) + 2;
+
+	FILE* file = fopen(fileName.string().c_str(), "wb");
+	if (!file)
+		return 0;
+
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			float u = x / (float)(side - 1), v = y / (float)(side - 1);
+			fprintf(file, "v %f %f %f\n", u * 100.0f, sinf(u * 20.0f) * cosf(v * 17.0f), v * 100.0f);
+			fprintf(file, "vt %f %f\n", u, v);
+			fprintf(file, "vn %f %f %f\n", 0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	size_t triangles = 0;
+	for (unsigned int y = 0; y + 1 < side; y++)
+	{
+		for (unsigned int x = 0; x + 1 < side; x++)
+		{
+			unsigned int a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+			fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, b, b, b);
+			fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", b, b, b, c, c, c, d, d, d);
+			triangles += 2;
+		}
+	}
+
+	fclose(file);
+	return triangles;
+}
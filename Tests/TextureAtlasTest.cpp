@@ -0,0 +1,114 @@
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include "TextureAtlas.h"
+#include "TextureCooker.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------------
+// Plans and builds the three atlases Game loads, then packs
+// 500 random sizes (unless --textures says otherwise),
+// checking no two padded textures overlap or leave their
+// atlas and every UV remap lands on its region, and prints
+// how much of each atlas is texture and how long packing
+// and building took.
+// --------------------------------------------------------
+
+// Whether every region, gutter included, is inside its atlas, on the mip grid and clear of every other one, with a UV remap onto it
+static bool IsValid(const AtlasLayout& layout)
+{
+	unsigned int gutter = layout.gutter;
+	unsigned int cell = 4u << (layout.mipCount - 1);
+	for (size_t i = 0; i < layout.regions.size(); i++)
+	{
+		const AtlasRegion& a = layout.regions[i];
+		if (a.atlas >= layout.atlases.size() || a.x < gutter || a.y < gutter || (a.x - gutter) % cell != 0 || (a.y - gutter) % cell != 0)
+			return false;
+		const AtlasSize& atlas = layout.atlases[a.atlas];
+		if (a.x + a.width + gutter > atlas.width || a.y + a.height + gutter > atlas.height)
+			return false;
+
+		//uv 0 has to be the region's corner and uv 1 its far one
+		const DirectX::XMFLOAT4& remap = a.uvRemap;
+		if (fabsf(remap.z - (float)a.x / atlas.width) > 1e-6f || fabsf(remap.w - (float)a.y / atlas.height) > 1e-6f ||
+			fabsf(remap.x + remap.z - (float)(a.x + a.width) / atlas.width) > 1e-6f || fabsf(remap.y + remap.w - (float)(a.y + a.height) / atlas.height) > 1e-6f)
+			return false;
+
+		for (size_t j = i + 1; j < layout.regions.size(); j++)
+		{
+			const AtlasRegion& b = layout.regions[j];
+			if (a.atlas == b.atlas &&
+				a.x - gutter < b.x + b.width + gutter && b.x - gutter < a.x + a.width + gutter &&
+				a.y - gutter < b.y + b.height + gutter && b.y - gutter < a.y + a.height + gutter)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void PrintAtlases(const AtlasLayout& layout)
+{
+	for (unsigned int i = 0; i < layout.atlases.size(); i++)
+		printf("  atlas %u: %4ux%-4u %3.0f%% texture\n", i, layout.atlases[i].width, layout.atlases[i].height, layout.GetEfficiency(i) * 100.0f);
+}
+
+// Plans an atlas of PNGs the way TextureLoader::LoadAtlas does, then decodes and builds it
+static void TestBundled(const char* name, const std::vector<std::filesystem::path>& fileNames, int runs)
+{
+	AtlasLayout layout;
+	double planTime = TimeMilliseconds(runs, [&]() { CHECK(PlanAtlasTextures(fileNames, layout)); });
+	CHECK(layout.regions.size() == fileNames.size() && IsValid(layout));
+
+	std::vector<TextureData> decoded(fileNames.size());
+	std::vector<const TextureData*> textures;
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		CHECK(LoadPng(fileNames[i], decoded[i]));
+		CHECK(decoded[i].width == layout.regions[i].width && decoded[i].height == layout.regions[i].height);
+		textures.push_back(&decoded[i]);
+	}
+
+	TextureData atlas;
+	double buildTime = TimeMilliseconds(runs, [&]()
+	{
+		for (unsigned int i = 0; i < layout.atlases.size(); i++)
+			CHECK(BuildAtlas(textures, layout, i, MipSettings(), atlas));
+	});
+	CHECK(atlas.mips.size() == layout.mipCount);
+
+	printf("%s: %zu textures, plan %.3f ms, build %.2f ms, %u levels\n", name, fileNames.size(), planTime, buildTime, layout.mipCount);
+	PrintAtlases(layout);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = (unsigned int)GetArgument(argc, argv, "textures", 500);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	TestBundled("specular", { "Assets/Specular_Maps/fully_specular.png", "Assets/Specular_Maps/brokentiles_specular.png" }, runs);
+	TestBundled("normal", { "Assets/Normal_Maps/flat_normals.png", "Assets/Normal_Maps/cushion_normals.png" }, runs);
+	TestBundled("albedo", { "Assets/Textures/brokentiles.png", "Assets/Textures/cushion.png" }, runs);
+
+	//the mix of small sizes an atlas is meant for, squares and strips
+	std::mt19937 random(3);
+	std::uniform_int_distribution<unsigned int> power(3, 8);
+	std::vector<AtlasSize> sizes(count);
+	for (AtlasSize& size : sizes)
+		size = { 1u << power(random), 1u << power(random) };
+
+	AtlasLayout layout;
+	double packTime = TimeMilliseconds(runs, [&]() { CHECK(PackAtlases(sizes, TEXTURE_ATLAS_MAX_SIZE, TEXTURE_ATLAS_GUTTER, layout)); });
+	CHECK(layout.regions.size() == sizes.size() && IsValid(layout));
+
+	size_t used = 0, total = 0;
+	for (const AtlasRegion& region : layout.regions)
+		used += (size_t)region.width * region.height;
+	for (const AtlasSize& atlas : layout.atlases)
+		total += (size_t)atlas.width * atlas.height;
+	printf("%u random sizes: %zu atlases, %.0f%% texture overall, packed in %.2f ms\n", count, layout.atlases.size(), 100.0 * used / total, packTime);
+	PrintAtlases(layout);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,122 @@
+#include "AssetCache.h"
+#include "TestHelpers.h"
+#include "TextureCooker.h"
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// Cooks every bundled texture for the role its directory
+// gives it three ways: with no cache, into an empty cache
+// (cook plus write), and from a warm cache opened fresh,
+// the way the next run of the game sees it.  Checks all
+// three hand back the same bytes and that the warm pass
+// cooks nothing, and prints each pass's time.  --files
+// limits how many textures are cooked.
+// --------------------------------------------------------
+
+typedef std::vector<std::pair<std::filesystem::path, TextureRole>> TextureList;
+
+// Whether two cooks hold the same format, size and bytes, level for level
+static bool IsSameTexture(const TextureData& a, const TextureData& b)
+{
+	if (a.format != b.format || a.width != b.width || a.height != b.height || a.mips.size() != b.mips.size())
+		return false;
+
+	for (size_t i = 0; i < a.mips.size(); i++)
+	{
+		if (a.mips[i].width != b.mips[i].width || a.mips[i].height != b.mips[i].height || a.mips[i].rowPitch != b.mips[i].rowPitch)
+			return false;
+	}
+	return a.pixels == b.pixels;
+}
+
+// Cooks the list once through cache (which may be null), keeping every result
+static void CookAll(const TextureList& textures, AssetCache* cache, std::vector<TextureData>& cooked)
+{
+	cooked.clear();
+	cooked.resize(textures.size());
+	for (size_t i = 0; i < textures.size(); i++)
+		CHECK(CookTexture(textures[i].first, cache, textures[i].second, cooked[i]));
+}
+
+int main(int argc, char** argv)
+{
+	size_t fileCount = (size_t)GetArgument(argc, argv, "files", 1000);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	const std::pair<const char*, TextureRole> directories[] =
+	{
+		{ "Assets/PBR/Albedo", TEXTURE_ROLE_ALBEDO },
+		{ "Assets/PBR/Normal", TEXTURE_ROLE_NORMAL },
+		{ "Assets/PBR/Roughness", TEXTURE_ROLE_ROUGHNESS },
+		{ "Assets/PBR/Metal", TEXTURE_ROLE_METAL },
+		{ "Assets/Textures", TEXTURE_ROLE_ALBEDO },
+		{ "Assets/Normal_Maps", TEXTURE_ROLE_NORMAL },
+		{ "Assets/Specular_Maps", TEXTURE_ROLE_SPECULAR },
+	};
+	TextureList textures;
+	size_t sourceBytes = 0;
+	for (const std::pair<const char*, TextureRole>& directory : directories)
+	{
+		std::vector<std::filesystem::path> files;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory.first))
+		{
+			if (entry.path().extension() == ".png")
+				files.push_back(entry.path());
+		}
+		std::sort(files.begin(), files.end());
+		for (const std::filesystem::path& file : files)
+		{
+			if (textures.size() < fileCount)
+			{
+				textures.push_back(std::make_pair(file, directory.second));
+				sourceBytes += std::filesystem::file_size(file);
+			}
+		}
+	}
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "TextureCookBenchmark";
+	std::filesystem::remove_all(directory);
+
+	std::vector<TextureData> uncached, cold, warm;
+	double noCacheTime = TimeMilliseconds(runs, [&]() { CookAll(textures, nullptr, uncached); });
+
+	//the cache is opened and saved inside the timing, as the game pays for both
+	AssetCacheStats coldStats = {};
+	double coldTime = TimeMilliseconds(1, [&]()
+	{
+		AssetCache cache(directory);
+		CookAll(textures, &cache, cold);
+		coldStats = cache.GetStats();
+	});
+	//sources with the same contents and role share a key, so only their first cook misses
+	CHECK(coldStats.misses > 0 && coldStats.hits + coldStats.misses == textures.size());
+	double warmTime = TimeMilliseconds(runs, [&]()
+	{
+		AssetCache cache(directory);
+		CookAll(textures, &cache, warm);
+		CHECK(cache.GetStats().hits == textures.size() && cache.GetStats().misses == 0);
+	});
+
+	bool same = true;
+	size_t cookedBytes = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		bool identical = IsSameTexture(uncached[i], cold[i]) && IsSameTexture(cold[i], warm[i]);
+		if (!identical)
+			printf("%s cooked differently from the cache\n", textures[i].first.string().c_str());
+		same = same && identical;
+		cookedBytes += cold[i].pixels.size();
+	}
+	CHECK(same);
+
+	printf("%zu textures (%u cooked, the rest repeat an identical source), %.1f MB of PNG cooked to %.1f MB\n",
+		textures.size(), coldStats.misses, sourceBytes / 1048576.0, cookedBytes / 1048576.0);
+	printf("no cache %.1f ms, cold cache %.1f ms, warm cache %.1f ms (%.0fx faster than cold), %s\n",
+		noCacheTime, coldTime, warmTime, coldTime / warmTime, same ? "byte identical" : "NOT IDENTICAL");
+
+	std::filesystem::remove_all(directory);
+	return GetFailureCount();
+}
@@ -0,0 +1,107 @@
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include "PngDecoder.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Decodes every PNG under Assets/PBR and Assets/Textures
+// the way TextureLoader's jobs do (LoadPng, then the mip
+// chain), one job per file on a pool of 1, 2, 4 ... up to
+// the worker count (the machine's, unless --workers says
+// otherwise), and prints how the batch time scales.  Every
+// pool size has to decode the same texels as one worker.
+// --files limits how many textures are decoded.
+// --------------------------------------------------------
+
+// FNV-1a over every level of every texture
+static unsigned long long Hash(const std::vector<TextureData>& textures)
+{
+	unsigned long long hash = 1469598103934665603ull;
+	for (const TextureData& texture : textures)
+	{
+		for (unsigned char c : texture.pixels)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int workerCount = (unsigned int)GetArgument(argc, argv, "workers", GetWorkerCount());
+	size_t fileCount = (size_t)GetArgument(argc, argv, "files", 1000);
+	int runs = (int)GetArgument(argc, argv, "runs", 3);
+
+	std::vector<std::filesystem::path> files;
+	for (const char* directory : { "Assets/PBR", "Assets/Textures" })
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory))
+		{
+			if (entry.path().extension() == ".png")
+				files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	files.resize(std::min(files.size(), fileCount));
+
+	size_t sourceBytes = 0;
+	for (const std::filesystem::path& file : files)
+		sourceBytes += std::filesystem::file_size(file);
+	printf("%zu textures, %.1f MB of PNG, %u core(s)\n", files.size(), sourceBytes / 1048576.0, std::thread::hardware_concurrency());
+
+	//1, 2, 4 ... and the worker count itself if it isn't a power of two
+	std::vector<unsigned int> poolSizes;
+	for (unsigned int workers = 1; workers < workerCount; workers *= 2)
+		poolSizes.push_back(workers);
+	poolSizes.push_back(std::max(1u, workerCount));
+
+	unsigned long long reference = 0;
+	double single = 0;
+	for (unsigned int workers : poolSizes)
+	{
+		std::vector<TextureData> textures(files.size());
+		std::unique_ptr<bool[]> decoded(new bool[files.size()]);
+		ThreadPool pool(workers);
+		double time = TimeMilliseconds(runs, [&]()
+		{
+			for (size_t i = 0; i < files.size(); i++)
+			{
+				pool.Submit([&, i]()
+				{
+					decoded[i] = LoadPng(files[i], textures[i]) && GenerateMips(textures[i], MipSettings());
+				});
+			}
+			pool.Wait();
+		});
+
+		bool allDecoded = true;
+		size_t texelBytes = 0;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			allDecoded = allDecoded && decoded[i];
+			texelBytes += textures[i].pixels.size();
+		}
+		CHECK(allDecoded);
+
+		unsigned long long hash = Hash(textures);
+		if (workers == 1)
+		{
+			reference = hash;
+			single = time;
+		}
+		CHECK(hash == reference);
+
+		printf("%2u worker(s): %8.2f ms (%.2fx)  %6.1f MB/s of PNG, %6.1f MB/s of texels  %s\n",
+			workers, time, single / time, sourceBytes / 1048576.0 / time * 1000.0, texelBytes / 1048576.0 / time * 1000.0,
+			hash == reference ? "same texels" : "DIFFERENT TEXELS");
+	}
+
+	return GetFailureCount();
+}
@@ -0,0 +1,250 @@
+#include "MipGenerator.h"
+#include "TextureResidency.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------------
+// Unit tests for the residency planner: mip estimates,
+// tails, hysteresis, least recently used eviction, change
+// limits, pending and cancelled changes, and budgets that
+// can't be met.  Then a synthetic scene (2000 textures
+// unless --textures says otherwise) flown through with
+// streaming that takes a few frames, under a roomy budget
+// and a tight one, checking the budget holds and measuring
+// how often visible textures have the detail they asked
+// for, and how long planning takes.
+// --------------------------------------------------------
+
+// Starts every change and completes it straight away
+static void RunFrame(TextureResidency& residency, unsigned int maxChanges = 64)
+{
+	std::vector<ResidencyChange> changes;
+	residency.EndFrame(changes, maxChanges);
+	for (const ResidencyChange& change : changes)
+		residency.CompleteChange(change.texture, change.mip);
+}
+
+static void TestEstimates()
+{
+	CHECK(EstimateMipLevel(1024, 1024, 2048.0f) == 0.0f);
+	CHECK(EstimateMipLevel(1024, 1024, 1024.0f) == 0.0f);
+	CHECK(EstimateMipLevel(1024, 1024, 512.0f) == 1.0f);
+	CHECK(EstimateMipLevel(1024, 512, 256.0f) == 2.0f);
+	CHECK(EstimateMipLevel(1024, 1024, 0.5f) == 10.0f);
+
+	//tails stop at 64 texels, and at whole blocks for block compressed textures
+	TextureResidency residency(0);
+	CHECK(residency.GetTexture(residency.AddTexture(TEXTURE_FORMAT_RGBA8, 1024, 1024, 11)).tailMip == 4);
+	CHECK(residency.GetTexture(residency.AddTexture(TEXTURE_FORMAT_RGBA8, 32, 32, 6)).tailMip == 0);
+	CHECK(residency.GetTexture(residency.AddTexture(TEXTURE_FORMAT_BC7, 1024, 256, 11)).tailMip == 4);
+	CHECK(residency.GetTexture(residency.AddTexture(TEXTURE_FORMAT_BC7, 200, 200, 8)).tailMip == 1);
+
+	//a texture's bytes are its levels from mip down
+	unsigned int texture = residency.AddTexture(TEXTURE_FORMAT_RGBA8, 256, 256, 9);
+	CHECK(residency.GetTextureBytes(texture, 0) == GetTextureBytes(TEXTURE_FORMAT_RGBA8, 256, 256, 9));
+	CHECK(residency.GetTextureBytes(texture, 2) == GetTextureBytes(TEXTURE_FORMAT_RGBA8, 64, 64, 7));
+}
+
+static void TestHysteresis()
+{
+	TextureResidency residency(1 << 30);
+	unsigned int texture = residency.AddTexture(TEXTURE_FORMAT_RGBA8, 1024, 1024, 11, 1);
+
+	//one level coarser than resident isn't worth dropping, two is
+	residency.RequestMip(texture, 2.5f);
+	RunFrame(residency);
+	CHECK(residency.GetTexture(texture).residentMip == 1);
+	residency.RequestMip(texture, 3.0f);
+	RunFrame(residency);
+	CHECK(residency.GetTexture(texture).residentMip == 3);
+
+	//more detail always streams in, and the most detailed request of a frame wins
+	residency.RequestMip(texture, 2.0f);
+	residency.RequestMip(texture, 0.4f);
+	RunFrame(residency);
+	CHECK(residency.GetTexture(texture).residentMip == 0);
+
+	//nothing below the tail is ever asked for
+	residency.RequestMip(texture, 9.0f);
+	RunFrame(residency);
+	CHECK(residency.GetTexture(texture).residentMip == residency.GetTexture(texture).tailMip);
+
+	//a texture nobody asks for keeps what it has while there's room
+	RunFrame(residency);
+	CHECK(residency.GetTexture(texture).residentMip == residency.GetTexture(texture).tailMip);
+}
+
+static void TestEviction()
+{
+	//room for two textures at full detail and one at its tail
+	TextureResidency residency(0);
+	unsigned int a = residency.AddTexture(TEXTURE_FORMAT_RGBA8, 512, 512, 10);
+	unsigned int b = residency.AddTexture(TEXTURE_FORMAT_RGBA8, 512, 512, 10);
+	unsigned int c = residency.AddTexture(TEXTURE_FORMAT_RGBA8, 512, 512, 10);
+	residency.SetBudget(residency.GetTextureBytes(a, 0) * 2 + residency.GetTextureBytes(c, residency.GetTexture(c).tailMip));
+
+	//c was used longest ago, so it's the one to go down to its tail
+	residency.RequestMip(c, 0);
+	RunFrame(residency);
+	for (int frame = 0; frame < 3; frame++)
+	{
+		residency.RequestMip(a, 0);
+		residency.RequestMip(b, 0);
+		RunFrame(residency);
+	}
+	CHECK(residency.GetTexture(a).residentMip == 0);
+	CHECK(residency.GetTexture(b).residentMip == 0);
+	CHECK(residency.GetTexture(c).residentMip == residency.GetTexture(c).tailMip);
+	CHECK(residency.GetResidentBytes() <= residency.GetBudget());
+
+	//everything in use and too little room: the largest give up a level at a time, evictions first
+	residency.SetBudget(residency.GetTextureBytes(a, 1) * 3);
+	residency.RequestMip(a, 0);
+	residency.RequestMip(b, 0);
+	residency.RequestMip(c, 0);
+	std::vector<ResidencyChange> changes;
+	residency.EndFrame(changes, 8);
+	CHECK(changes.size() == 3);
+	CHECK(changes.size() == 3 && changes[0].mip == 1 && changes[1].mip == 1 && changes[2].texture == c && changes[2].mip == 1);
+	for (const ResidencyChange& change : changes)
+		residency.CompleteChange(change.texture, change.mip);
+	CHECK(residency.GetResidentBytes() <= residency.GetBudget());
+
+	//a budget nothing fits in leaves everything at its tail instead of looping forever
+	residency.SetBudget(1);
+	for (unsigned int texture : { a, b, c })
+		residency.RequestMip(texture, 0);
+	RunFrame(residency);
+	for (unsigned int texture : { a, b, c })
+		CHECK(residency.GetTexture(texture).residentMip == residency.GetTexture(texture).tailMip);
+}
+
+static void TestChanges()
+{
+	TextureResidency residency(1 << 30);
+	std::vector<unsigned int> textures;
+	for (int i = 0; i < 10; i++)
+		textures.push_back(residency.AddTexture(TEXTURE_FORMAT_RGBA8, 256, 256, 9, 8));
+
+	//only maxChanges start per frame, and a pending texture isn't asked again
+	for (unsigned int texture : textures)
+		residency.RequestMip(texture, 0);
+	std::vector<ResidencyChange> changes;
+	residency.EndFrame(changes, 4);
+	CHECK(changes.size() == 4);
+	for (unsigned int texture : textures)
+		residency.RequestMip(texture, 0);
+	std::vector<ResidencyChange> more;
+	residency.EndFrame(more, 10);
+	CHECK(more.size() == 6);
+	for (const ResidencyChange& change : more)
+	{
+		for (const ResidencyChange& earlier : changes)
+			CHECK(change.texture != earlier.texture);
+	}
+
+	//a cancelled change keeps the old level and is planned again next frame
+	residency.CancelChange(changes[0].texture);
+	CHECK(residency.GetTexture(changes[0].texture).residentMip == 8);
+	CHECK(!residency.GetTexture(changes[0].texture).pending);
+	residency.RequestMip(changes[0].texture, 0);
+	std::vector<ResidencyChange> retry;
+	residency.EndFrame(retry, 10);
+	CHECK(retry.size() == 1 && retry[0].texture == changes[0].texture && retry[0].mip == 0);
+}
+
+// --------------------------------------------------------
+// A row of objects, each with its own texture, that a
+// camera flies along and back.  Changes take a few frames
+// to stream and only so many run at once.  The budget is
+// a share of every texture at full detail.
+// --------------------------------------------------------
+static void SimulateScene(unsigned int textureCount, unsigned int frames, unsigned int budgetShare)
+{
+	std::mt19937 random(11);
+	std::uniform_int_distribution<int> sizes(7, 11);
+	TextureResidency residency(0);
+	std::vector<float> positions;
+	for (unsigned int i = 0; i < textureCount; i++)
+	{
+		//everything starts out at its 64 texel tail
+		int sizeLog2 = sizes(random);
+		unsigned int size = 1u << sizeLog2;
+		residency.AddTexture(i % 3 ? TEXTURE_FORMAT_BC7 : TEXTURE_FORMAT_RGBA8, size, size, GetFullMipCount(size, size), sizeLog2 - 6);
+		positions.push_back(i * 2.0f);
+	}
+
+	size_t full = 0;
+	for (unsigned int i = 0; i < textureCount; i++)
+		full += residency.GetTextureBytes(i, 0);
+	residency.SetBudget(full / budgetShare);
+
+	struct Streaming { ResidencyChange change; unsigned int doneFrame; };
+	std::deque<Streaming> streaming;
+	size_t requests = 0, satisfied = 0, overBudgetFrames = 0, changeCount = 0;
+	double planTime = 0;
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		//a quarter of a unit a frame along the row and back again, seeing 40 units ahead
+		float length = textureCount * 2.0f;
+		float travelled = fmodf(frame * 0.25f, length * 2.0f);
+		float camera = travelled < length ? travelled : length * 2.0f - travelled;
+		for (unsigned int i = 0; i < textureCount; i++)
+		{
+			float distance = positions[i] - camera;
+			if (distance < 0.5f || distance > 40.0f)
+				continue;
+
+			const ResidencyTexture& texture = residency.GetTexture(i);
+			float mip = EstimateMipLevel(texture.width, texture.height, 1400.0f / distance);
+			residency.RequestMip(i, mip);
+			requests++;
+			satisfied += texture.residentMip <= std::min((unsigned int)mip, texture.tailMip);
+		}
+
+		std::vector<ResidencyChange> changes;
+		planTime += TimeMilliseconds(1, [&]() { residency.EndFrame(changes, 8); });
+		changeCount += changes.size();
+		for (const ResidencyChange& change : changes)
+			streaming.push_back({ change, frame + 3 });
+		while (!streaming.empty() && streaming.front().doneFrame <= frame)
+		{
+			residency.CompleteChange(streaming.front().change.texture, streaming.front().change.mip);
+			streaming.pop_front();
+		}
+
+		//uploads can land before the evictions that make room for them, but only briefly
+		overBudgetFrames += residency.GetResidentBytes() > residency.GetBudget();
+	}
+	while (!streaming.empty())
+	{
+		residency.CompleteChange(streaming.front().change.texture, streaming.front().change.mip);
+		streaming.pop_front();
+	}
+	RunFrame(residency, textureCount);
+
+	CHECK(residency.GetResidentBytes() <= residency.GetBudget());
+	CHECK(overBudgetFrames < frames / 20);
+	CHECK(budgetShare > 4 || satisfied > requests * 0.9);
+	printf("%u textures, %u frames, budget %.1f MB of %.1f MB: %.1f%% of requests had their detail, %zu changes, over budget %zu frames, plan %.3f ms/frame\n",
+		textureCount, frames, residency.GetBudget() / 1048576.0, full / 1048576.0, 100.0 * satisfied / std::max<size_t>(1, requests),
+		changeCount, overBudgetFrames, planTime / frames);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int textureCount = (unsigned int)GetArgument(argc, argv, "textures", 2000);
+	unsigned int frames = (unsigned int)GetArgument(argc, argv, "frames", 2000);
+
+	TestEstimates();
+	TestHysteresis();
+	TestEviction();
+	TestChanges();
+	SimulateScene(textureCount, frames, 4);
+	SimulateScene(textureCount, frames, 50);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,246 @@
+#include "TestHelpers.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Checks TransformHierarchy against a plain product of each
+// transform's ancestors through random moves, reparents and
+// removals, and checks its world versions and cycle refusal.
+// Then times frames of 1000 trees of 100 nodes (unless
+// --trees says otherwise) with 1%, 3%, 5% and all of them
+// moving, against a full recursive update over nodes
+// allocated one by one, as a pointer based scene graph
+// would do it.
+// --------------------------------------------------------
+
+// A transform's matrix relative to its parent, straight from its values
+static XMMATRIX GetLocalMatrix(TransformStore& store, unsigned int transform)
+{
+	XMFLOAT3 position = store.GetPosition(transform), scale = store.GetScale(transform);
+	XMFLOAT4 rotation = store.GetRotation(transform);
+	return XMMatrixScaling(scale.x, scale.y, scale.z) * XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) * XMMatrixTranslation(position.x, position.y, position.z);
+}
+
+// Largest difference between two matrices' upper rows (all of them, or just the 3x3), relative to b's elements
+static float GetDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b, int size)
+{
+	float largest = 0;
+	for (int r = 0; r < size; r++)
+	{
+		for (int c = 0; c < size; c++)
+			largest = std::max(largest, fabsf(a.m[r][c] - b.m[r][c]) / (1.0f + fabsf(b.m[r][c])));
+	}
+	return largest;
+}
+
+// Updates, then compares every transform's world and inverse transpose with its ancestors multiplied out
+static void Compare(TransformStore& store, TransformHierarchy& hierarchy, const std::vector<unsigned int>& transforms, float& world, float& inverseTranspose)
+{
+	hierarchy.UpdateMatrices();
+	for (unsigned int transform : transforms)
+	{
+		XMMATRIX matrix = GetLocalMatrix(store, transform);
+		for (unsigned int parent = hierarchy.GetParent(transform); parent != TransformHierarchy::NoParent; parent = hierarchy.GetParent(parent))
+			matrix = matrix * GetLocalMatrix(store, parent);
+
+		XMFLOAT4X4 reference, referenceInverseTranspose;
+		XMStoreFloat4x4(&reference, matrix);
+		XMStoreFloat4x4(&referenceInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, matrix)));
+		world = std::max(world, GetDifference(hierarchy.GetWorldMatrix(transform), reference, 4));
+		inverseTranspose = std::max(inverseTranspose, GetDifference(hierarchy.GetWorldInverseTransposeMatrix(transform), referenceInverseTranspose, 3));
+	}
+}
+
+// A node of the pointer based scene graph the hierarchy is timed against
+struct SceneNode
+{
+	XMFLOAT4X4 world;
+	XMFLOAT4X4 inverseTranspose;
+	unsigned int transform;
+	std::vector<SceneNode*> children;
+};
+
+static void UpdateRecursive(TransformStore& store, SceneNode* node, FXMMATRIX parent, CXMMATRIX parentInverseTranspose)
+{
+	XMMATRIX world = XMLoadFloat4x4(&store.GetWorldMatrix(node->transform)) * parent;
+	XMMATRIX inverseTranspose = XMLoadFloat4x4(&store.GetWorldInverseTransposeMatrix(node->transform)) * parentInverseTranspose;
+	XMStoreFloat4x4(&node->world, world);
+	XMStoreFloat4x4(&node->inverseTranspose, inverseTranspose);
+	for (SceneNode* child : node->children)
+		UpdateRecursive(store, child, world, inverseTranspose);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int treeCount = (unsigned int)GetArgument(argc, argv, "trees", 1000);
+	unsigned int frameCount = (unsigned int)GetArgument(argc, argv, "frames", 20);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> around(-1.0f, 1.0f);
+	auto randomize = [&](TransformStore& store, unsigned int transform)
+	{
+		store.SetPosition(transform, XMFLOAT3(around(random) * 3, around(random) * 3, around(random) * 3));
+		store.SetRotation(transform, XMFLOAT4(around(random), around(random), around(random), around(random) + 1.5f));
+		store.SetScale(transform, XMFLOAT3(1 + 0.3f * around(random), 1 + 0.3f * around(random), 1 + 0.3f * around(random)));
+	};
+
+	//a random forest of 2000, moved, rearranged and pruned for 50 frames
+	{
+		TransformStore store;
+		TransformHierarchy hierarchy(&store);
+		std::vector<unsigned int> transforms;
+		for (int i = 0; i < 2000; i++)
+		{
+			transforms.push_back(store.Create());
+			randomize(store, transforms.back());
+		}
+		for (int i = 1; i < 2000; i++)
+		{
+			if (random() % 4)
+				hierarchy.SetParent(transforms[i], transforms[random() % i]);
+		}
+
+		float world = 0, inverseTranspose = 0;
+		bool refusedWrongly = false;
+		Compare(store, hierarchy, transforms, world, inverseTranspose);
+		for (int frame = 0; frame < 50; frame++)
+		{
+			for (int k = 0; k < 40; k++)
+				randomize(store, transforms[random() % transforms.size()]);
+
+			//a refused parent has to have been the transform itself or one of its descendants
+			if (frame % 5 == 0)
+			{
+				for (int k = 0; k < 10; k++)
+				{
+					unsigned int transform = transforms[random() % transforms.size()], parent = transforms[random() % transforms.size()];
+					if (hierarchy.SetParent(transform, parent))
+						continue;
+					bool below = false;
+					for (unsigned int p = parent; p != TransformHierarchy::NoParent; p = hierarchy.GetParent(p))
+						below = below || p == transform;
+					refusedWrongly = refusedWrongly || !below;
+				}
+			}
+			if (frame % 7 == 0)
+				hierarchy.SetParent(transforms[random() % transforms.size()], TransformHierarchy::NoParent);
+			if (frame % 11 == 0)
+			{
+				size_t k = random() % transforms.size();
+				hierarchy.Remove(transforms[k]);
+				store.Destroy(transforms[k]);
+				transforms.erase(transforms.begin() + k);
+				transforms.push_back(store.Create());
+				randomize(store, transforms.back());
+				hierarchy.SetParent(transforms.back(), transforms[random() % (transforms.size() - 1)]);
+			}
+			Compare(store, hierarchy, transforms, world, inverseTranspose);
+		}
+		CHECK(!refusedWrongly);
+		CHECK(world < 1e-4f && inverseTranspose < 1e-4f);
+		printf("2000 transforms, 50 frames of changes: worlds within %.1e of the reference, inverse transposes %.1e\n", world, inverseTranspose);
+
+		//versions go up with every change that moves the world: linking, the parent moving, unlinking
+		unsigned int a = transforms[5], b = transforms[6];
+		hierarchy.Remove(a);
+		hierarchy.Remove(b);
+		hierarchy.UpdateMatrices();
+		unsigned int versions[4];
+		versions[0] = hierarchy.GetWorldVersion(a);
+		hierarchy.SetParent(a, b);
+		hierarchy.UpdateMatrices();
+		versions[1] = hierarchy.GetWorldVersion(a);
+		store.SetPosition(b, XMFLOAT3(1, 2, 3));
+		hierarchy.UpdateMatrices();
+		versions[2] = hierarchy.GetWorldVersion(a);
+		hierarchy.SetParent(a, TransformHierarchy::NoParent);
+		versions[3] = hierarchy.GetWorldVersion(a);
+		CHECK(versions[0] < versions[1] && versions[1] < versions[2] && versions[2] < versions[3]);
+
+		//no cycles
+		hierarchy.SetParent(a, b);
+		CHECK(!hierarchy.SetParent(b, a) && !hierarchy.SetParent(a, a));
+	}
+
+	//bushy trees a few levels deep, each node hanging off one of the few before it
+	const unsigned int treeSize = 100, count = treeCount * treeSize;
+	TransformStore store;
+	TransformHierarchy hierarchy(&store);
+	std::vector<unsigned int> transforms(count);
+	std::vector<std::unique_ptr<SceneNode>> nodes(count);
+	std::vector<SceneNode*> roots;
+
+	//scene nodes allocated in a shuffled order between other allocations, like a long running game's heap
+	std::vector<unsigned int> order(count);
+	for (unsigned int i = 0; i < count; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), random);
+	std::vector<std::unique_ptr<char[]>> padding;
+	for (unsigned int i : order)
+	{
+		nodes[i] = std::make_unique<SceneNode>();
+		padding.emplace_back(new char[48 + random() % 200]);
+	}
+	for (unsigned int i = 0; i < count; i++)
+	{
+		transforms[i] = store.Create();
+		randomize(store, transforms[i]);
+		nodes[i]->transform = transforms[i];
+	}
+	for (unsigned int t = 0; t < treeCount; t++)
+	{
+		roots.push_back(nodes[t * treeSize].get());
+		for (unsigned int k = 1; k < treeSize; k++)
+		{
+			unsigned int parent = t * treeSize + (k - 1) / 3;
+			hierarchy.SetParent(transforms[t * treeSize + k], transforms[parent]);
+			nodes[parent]->children.push_back(nodes[t * treeSize + k].get());
+		}
+	}
+	hierarchy.UpdateMatrices();
+
+	printf("%u nodes in %u trees of %u\n", count, treeCount, treeSize);
+	for (unsigned int moving : { count / 100, count * 3 / 100, count / 20, count })
+	{
+		std::vector<std::vector<unsigned int>> frames(frameCount);
+		for (std::vector<unsigned int>& frame : frames)
+		{
+			for (unsigned int k = 0; k < moving; k++)
+				frame.push_back(random() % count);
+		}
+
+		double incremental = 0, recursive = 0;
+		for (const std::vector<unsigned int>& frame : frames)
+		{
+			for (unsigned int i : frame)
+				store.SetPosition(transforms[i], XMFLOAT3(around(random), around(random), around(random)));
+			incremental += TimeMilliseconds(1, [&]() { hierarchy.UpdateMatrices(); });
+
+			for (unsigned int i : frame)
+				store.SetPosition(transforms[i], XMFLOAT3(around(random), around(random), around(random)));
+			recursive += TimeMilliseconds(1, [&]()
+			{
+				store.UpdateMatrices();
+				for (SceneNode* root : roots)
+					UpdateRecursive(store, root, XMMatrixIdentity(), XMMatrixIdentity());
+			});
+			hierarchy.UpdateMatrices();
+		}
+
+		//both end up with the same worlds
+		float difference = 0;
+		for (unsigned int i = 0; i < count; i += 97)
+			difference = std::max(difference, GetDifference(hierarchy.GetWorldMatrix(transforms[i]), nodes[i]->world, 4));
+		CHECK(difference < 1e-4f);
+
+		printf("%6u moving:  incremental %8.3f ms/frame  full recursive %8.3f ms/frame  (%.1fx)\n",
+			moving, incremental / frameCount, recursive / frameCount, recursive / incremental);
+	}
+
+	return GetFailureCount();
+}
@@ -0,0 +1,358 @@
+#include "TestHelpers.h"
+#include "Transform.h"
+#include "TransformStore.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times TransformStore against the per-object Transform
+// it replaced, over 100k transforms (unless --count says
+// otherwise), each one on its own in the heap with other
+// allocations between them, the way entities left them.
+// Checks the batched matrices match the old ones and that
+// the closed form inverse transposes stay close to a double
+// precision inverse of their own world matrices.  Then
+// times Transform's per call work (forward vector, local
+// moves, mouse look) against the euler angle version it
+// had before rotations became quaternions.
+// --------------------------------------------------------
+
+// The old Transform, as it was: euler angles, rebuilt on the first get after a change, general inverse
+struct LegacyTransform
+{
+	XMFLOAT3 translation = XMFLOAT3(0, 0, 0);
+	XMFLOAT3 pitchYawRoll = XMFLOAT3(0, 0, 0);
+	XMFLOAT3 scale = XMFLOAT3(1, 1, 1);
+	XMFLOAT4X4 worldMatrix;
+	XMFLOAT4X4 worldInverseTranspose;
+	bool matrixDirty = true;
+
+	void UpdateWorldMatrix()
+	{
+		if (!matrixDirty)
+			return;
+
+		XMMATRIX t = XMMatrixTranslationFromVector(XMLoadFloat3(&translation));
+		XMMATRIX s = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
+		XMMATRIX r = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+		XMMATRIX worldMat = (s * r) * t;
+
+		XMStoreFloat4x4(&worldMatrix, worldMat);
+		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
+		matrixDirty = false;
+	}
+
+	XMFLOAT4X4 GetWorldMatrix()
+	{
+		UpdateWorldMatrix();
+		return worldMatrix;
+	}
+
+	XMFLOAT4X4 GetWorldInverseTransposeMatrix()
+	{
+		UpdateWorldMatrix();
+		return worldInverseTranspose;
+	}
+};
+
+// Transform's per call work as it was with euler angles: a quaternion rebuilt from the angles every call.
+// Positions go through a store as they did; the angles are kept here, so setting them skips the dirty bit
+// the old store paid for (which only flatters this side).
+struct EulerTransform
+{
+	TransformStore* store;
+	unsigned int index;
+	XMFLOAT3 pitchYawRoll = XMFLOAT3(0, 0, 0);
+
+	XMFLOAT3 GetForwardVector()
+	{
+		XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+		XMFLOAT3 forwardVector;
+		XMStoreFloat3(&forwardVector, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotQuat));
+		return forwardVector;
+	}
+
+	void MoveLocal(float x, float y, float z)
+	{
+		XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+		XMVECTOR dir = XMVector3Rotate(XMVectorSet(x, y, z, 0), rotQuat);
+		XMFLOAT3 translation = store->GetPosition(index);
+		XMStoreFloat3(&translation, XMLoadFloat3(&translation) + dir);
+		store->SetPosition(index, translation);
+	}
+
+	void Rotate(float p, float y, float r)
+	{
+		pitchYawRoll = XMFLOAT3(pitchYawRoll.x + p, pitchYawRoll.y + y, pitchYawRoll.z + r);
+	}
+};
+
+// Largest difference between two vectors
+static float GetDifference(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+}
+
+// Nanoseconds per call of each kind of work, euler against quaternion, over count transforms
+static void TimePerCall(unsigned int count, int runs)
+{
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> angle(-1.5f, 1.5f);
+	TransformStore eulerStore;
+	std::vector<EulerTransform> euler(count);
+	std::vector<Transform> transforms(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 angles(angle(random), angle(random), 0);
+		euler[i].store = &eulerStore;
+		euler[i].index = eulerStore.Create();
+		euler[i].pitchYawRoll = angles;
+		transforms[i].SetRotation(angles);
+	}
+	TransformStore::GetDefault().UpdateMatrices();
+
+	//both give the same answers before anything is timed
+	float difference = 0;
+	for (unsigned int i = 0; i < count; i++)
+		difference = std::max(difference, GetDifference(euler[i].GetForwardVector(), transforms[i].GetForwardVector()));
+	CHECK(difference < 1e-5f);
+
+	float sink = 0;
+	auto report = [&](const char* name, double eulerTime, double quaternionTime)
+	{
+		printf("  %-40s euler %6.1f ns  quaternion %6.1f ns  (%.2fx)%s\n",
+			name, eulerTime * 1e6 / count, quaternionTime * 1e6 / count, eulerTime / quaternionTime, sink == 12345.0f ? " " : "");
+	};
+	printf("%u transforms, per call:\n", count);
+
+	report("GetForwardVector, clean",
+		TimeMilliseconds(runs, [&]() { for (EulerTransform& t : euler) sink += t.GetForwardVector().z; }),
+		TimeMilliseconds(runs, [&]() { for (Transform& t : transforms) sink += t.GetForwardVector().z; }));
+	report("MoveLocal",
+		TimeMilliseconds(runs, [&]() { for (EulerTransform& t : euler) t.MoveLocal(0.01f, 0, 0.02f); }),
+		TimeMilliseconds(runs, [&]() { for (Transform& t : transforms) t.MoveLocal(0.01f, 0, 0.02f); }));
+
+	//what the camera did every frame: move, then read the position and forward for its view matrix
+	report("camera frame (move, position, forward)",
+		TimeMilliseconds(runs, [&]()
+		{
+			for (EulerTransform& t : euler)
+			{
+				t.MoveLocal(0, 0, 0.01f);
+				sink += t.store->GetPosition(t.index).x + t.GetForwardVector().z;
+			}
+		}),
+		TimeMilliseconds(runs, [&]()
+		{
+			for (Transform& t : transforms)
+			{
+				t.MoveLocal(0, 0, 0.01f);
+				sink += t.GetPosition().x + t.GetForwardVector().z;
+			}
+		}));
+
+	//mouse look leaves the transform dirty, so its forward is worked out from the quaternion
+	report("mouse look (Rotate, then forward)",
+		TimeMilliseconds(runs, [&]()
+		{
+			for (EulerTransform& t : euler)
+			{
+				t.Rotate(0.001f, 0.002f, 0);
+				sink += t.GetForwardVector().z;
+			}
+		}),
+		TimeMilliseconds(runs, [&]()
+		{
+			for (Transform& t : transforms)
+			{
+				t.Rotate(0.001f, 0.002f, 0);
+				sink += t.GetForwardVector().z;
+			}
+		}));
+
+	TransformStore::GetDefault().UpdateMatrices();
+	difference = 0;
+	for (unsigned int i = 0; i < count; i++)
+		difference = std::max(difference, GetDifference(euler[i].GetForwardVector(), transforms[i].GetForwardVector()));
+	CHECK(difference < 1e-3f);
+	printf("  forward vectors within %.1e of each other after %d mouse looks\n", difference, runs);
+}
+
+// Largest difference between two matrices, relative to the size of b's elements
+static float GetDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+	float largest = 0;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+			largest = std::max(largest, fabsf(a.m[r][c] - b.m[r][c]) / (1.0f + fabsf(b.m[r][c])));
+	}
+	return largest;
+}
+
+// How far the upper 3x3 of an inverse transpose is from world's, inverted in doubles (Gauss-Jordan)
+static double GetInverseTransposeError(const XMFLOAT4X4& world, const XMFLOAT4X4& inverseTranspose)
+{
+	//[world^T | identity], reduced to [identity | world^T^-1]
+	double a[4][8];
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 8; c++)
+			a[r][c] = c < 4 ? world.m[c][r] : (c - 4 == r);
+	}
+	for (int c = 0; c < 4; c++)
+	{
+		int pivot = c;
+		for (int r = c + 1; r < 4; r++)
+		{
+			if (fabs(a[r][c]) > fabs(a[pivot][c]))
+				pivot = r;
+		}
+		for (int j = 0; j < 8; j++)
+			std::swap(a[c][j], a[pivot][j]);
+		double d = a[c][c];
+		for (int j = 0; j < 8; j++)
+			a[c][j] /= d;
+		for (int r = 0; r < 4; r++)
+		{
+			if (r == c)
+				continue;
+			double f = a[r][c];
+			for (int j = 0; j < 8; j++)
+				a[r][j] -= f * a[c][j];
+		}
+	}
+
+	double largest = 0;
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 3; c++)
+			largest = std::max(largest, fabs(inverseTranspose.m[r][c] - a[r][c + 4]) / (1.0 + fabs(a[r][c + 4])));
+	}
+	return largest;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = (unsigned int)GetArgument(argc, argv, "count", 100000);
+	int runs = (int)GetArgument(argc, argv, "runs", 5);
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> angle(-7.0f, 7.0f), position(-100.0f, 100.0f), scale(0.2f, 5.0f);
+
+	//one heap object per transform with a stray allocation after each, so they're spread out like entities
+	std::vector<std::unique_ptr<LegacyTransform>> legacy;
+	std::vector<std::unique_ptr<int[]>> padding;
+	TransformStore store;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		legacy.push_back(std::make_unique<LegacyTransform>());
+		padding.emplace_back(new int[random() % 64 + 1]);
+		CHECK(store.Create() == i);
+	}
+
+	std::vector<XMFLOAT3> angles(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 p(position(random), position(random), position(random)), s(scale(random), scale(random), scale(random));
+		angles[i] = XMFLOAT3(angle(random), angle(random), angle(random));
+		legacy[i]->translation = p;
+		legacy[i]->pitchYawRoll = angles[i];
+		legacy[i]->scale = s;
+		legacy[i]->matrixDirty = true;
+		store.SetPosition(i, p);
+		store.SetPitchYawRoll(i, angles[i]);
+		store.SetScale(i, s);
+	}
+	CHECK(store.GetDirtyCount() == count);
+	store.UpdateMatrices();
+	CHECK(store.GetDirtyCount() == 0);
+
+	//same matrices, and inverse transposes a few float roundings from the real thing: the closed form inverts
+	//the ideal rotation, not the slightly unorthogonal one stored in the world matrix, so it can't match the
+	//general inverse's error exactly
+	float worldDifference = 0;
+	double legacyError = 0, storeError = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		worldDifference = std::max(worldDifference, GetDifference(store.GetWorldMatrix(i), legacy[i]->GetWorldMatrix()));
+		legacyError = std::max(legacyError, GetInverseTransposeError(legacy[i]->GetWorldMatrix(), legacy[i]->GetWorldInverseTransposeMatrix()));
+		storeError = std::max(storeError, GetInverseTransposeError(store.GetWorldMatrix(i), store.GetWorldInverseTransposeMatrix(i)));
+		CHECK(store.GetMatrixVersion(i) == 1);
+	}
+	CHECK(worldDifference < 1e-4f);
+	CHECK(storeError < 1e-5);
+	printf("%u transforms: worlds within %.1e of the old ones, inverse transpose error %.1e (general inverse %.1e)\n", count, worldDifference, storeError, legacyError);
+
+	//a destroyed slot is the next one handed out, and starts over as a clean identity
+	store.Destroy(count / 2);
+	CHECK(store.Create() == count / 2 && store.GetCapacity() >= count && store.GetCount() == count);
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	CHECK(!store.IsDirty(count / 2) && GetDifference(store.GetWorldMatrix(count / 2), identity) == 0);
+	store.SetPitchYawRoll(count / 2, angles[count / 2]);
+	store.SetPosition(count / 2, legacy[count / 2]->translation);
+	store.SetScale(count / 2, legacy[count / 2]->scale);
+	store.UpdateMatrices();
+
+	//a frame: set what moves, then read every world and inverse transpose the way drawing does
+	for (double fraction : { 1.0, 0.05 })
+	{
+		std::vector<unsigned int> moving(count);
+		for (unsigned int i = 0; i < count; i++)
+			moving[i] = i;
+		std::shuffle(moving.begin(), moving.end(), random);
+		moving.resize((size_t)(count * fraction));
+
+		std::vector<XMFLOAT4> rotations(moving.size());
+		for (size_t k = 0; k < moving.size(); k++)
+		{
+			angles[k] = XMFLOAT3(angle(random), angle(random), angle(random));
+			XMStoreFloat4(&rotations[k], XMQuaternionRotationRollPitchYaw(angles[k].x, angles[k].y, angles[k].z));
+		}
+
+		float sink = 0;
+		double legacyTime = TimeMilliseconds(runs, [&]()
+		{
+			for (size_t k = 0; k < moving.size(); k++)
+			{
+				legacy[moving[k]]->pitchYawRoll = angles[k];
+				legacy[moving[k]]->matrixDirty = true;
+			}
+			for (unsigned int i = 0; i < count; i++)
+			{
+				XMFLOAT4X4 world = legacy[i]->GetWorldMatrix(), inverseTranspose = legacy[i]->GetWorldInverseTransposeMatrix();
+				sink += world._41 + inverseTranspose._11;
+			}
+		});
+		double storeTime = TimeMilliseconds(runs, [&]()
+		{
+			for (size_t k = 0; k < moving.size(); k++)
+				store.SetRotation(moving[k], rotations[k]);
+			store.UpdateMatrices();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				const XMFLOAT4X4& world = store.GetWorldMatrix(i);
+				const XMFLOAT4X4& inverseTranspose = store.GetWorldInverseTransposeMatrix(i);
+				sink += world._41 + inverseTranspose._11;
+			}
+		});
+
+		//the last run of each left the same rotations behind
+		float difference = 0;
+		for (unsigned int i : moving)
+			difference = std::max(difference, GetDifference(store.GetWorldMatrix(i), legacy[i]->GetWorldMatrix()));
+		CHECK(difference < 1e-4f);
+
+		printf("%6zu moving:  per-object GetWorldMatrix %8.2f ms  store %8.2f ms  (%.1fx)%s\n",
+			moving.size(), legacyTime, storeTime, legacyTime / storeTime, sink == 12345.0f ? " " : "");
+	}
+
+	TimePerCall(count, runs);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,182 @@
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Regression test for the vertex cache simulator and the
+// cache, overdraw and fetch optimizations: known answers
+// for tiny index buffers, then every model in
+// Assets/Models and a generated grid (256 quads a side
+// unless --grid says otherwise) through the whole pipeline
+// --------------------------------------------------------
+
+// Each triangle as the bytes of its three vertices, starting from the smallest rotation so winding
+// is kept, sorted so two index buffers can be compared as sets of triangles
+static std::vector<std::string> GetTriangleKeys(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	std::vector<std::string> keys;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		std::string best;
+		for (int rotation = 0; rotation < 3; rotation++)
+		{
+			std::string key;
+			for (int corner = 0; corner < 3; corner++)
+				key.append((const char*)&vertices[indices[t + (rotation + corner) % 3]], sizeof(Vertex));
+			if (rotation == 0 || key < best)
+				best = key;
+		}
+		keys.push_back(best);
+	}
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+// Whether every vertex is first used in order, which is what OptimizeVertexFetch promises
+static bool IsInFirstUseOrder(const std::vector<unsigned int>& indices)
+{
+	unsigned int next = 0;
+	for (unsigned int index : indices)
+	{
+		if (index > next)
+			return false;
+		if (index == next)
+			next++;
+	}
+	return true;
+}
+
+// Known answers, worked out by hand
+static void TestSimulator()
+{
+	std::vector<unsigned int> triangle = { 0, 1, 2 };
+	CHECK(AnalyzeVertexCache(triangle, 3).acmr == 3.0f);
+	CHECK(AnalyzeVertexCache(triangle, 3).atvr == 1.0f);
+
+	//a quad: the second triangle only misses on its new corner
+	std::vector<unsigned int> quad = { 0, 1, 2, 2, 1, 3 };
+	CHECK(AnalyzeVertexCache(quad, 4).acmr == 2.0f);
+	CHECK(AnalyzeVertexCache(quad, 4).atvr == 1.0f);
+
+	//the first triangle drawn again after three misses is gone from a 3 entry FIFO but not from a 16 entry one
+	std::vector<unsigned int> again = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	CHECK(AnalyzeVertexCache(again, 6, 3).acmr == 3.0f);
+	CHECK(AnalyzeVertexCache(again, 6, 3).atvr == 1.5f);
+	CHECK(AnalyzeVertexCache(again, 6).acmr == 2.0f);
+
+	//a hit doesn't move a vertex to the front: 0 was pushed first, so the miss on 3 evicts it
+	std::vector<unsigned int> fifo = { 0, 1, 2, 0, 1, 2, 3, 1, 2, 0, 1, 2 };
+	CHECK(AnalyzeVertexCache(fifo, 4, 3).acmr == 1.75f);
+
+	//every vertex of a 64 byte vertex read once, in order, reads the buffer once
+	std::vector<unsigned int> linear;
+	for (unsigned int i = 0; i < 300; i++)
+		linear.push_back(i);
+	CHECK(fabsf(AnalyzeVertexFetch(linear, 300, 64) - 1.0f) < 0.01f);
+}
+
+// A flat grid of side x side quads in row order
+static void BuildGrid(unsigned int side, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	for (unsigned int y = 0; y <= side; y++)
+	{
+		for (unsigned int x = 0; x <= side; x++)
+		{
+			Vertex v = {};
+			v.position = DirectX::XMFLOAT3((float)x, 0.0f, (float)y);
+			v.normal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+			v.uv = DirectX::XMFLOAT2(x / (float)side, y / (float)side);
+			vertices.push_back(v);
+		}
+	}
+
+	for (unsigned int y = 0; y < side; y++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			unsigned int a = y * (side + 1) + x, b = a + 1, c = a + side + 1, d = c + 1;
+			unsigned int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Runs one mesh through the pipeline the importer uses, checks it and prints what changed.
+// maxAcmr is where this mesh ends up today, with a little room; 0 skips that check.
+static void TestMesh(const char* name, std::vector<Vertex> vertices, std::vector<unsigned int> indices, float maxAcmr)
+{
+	std::vector<std::string> before = GetTriangleKeys(vertices, indices);
+	VertexCacheStats original = AnalyzeVertexCache(indices, vertices.size());
+	float originalFetch = AnalyzeVertexFetch(indices, vertices.size(), sizeof(Vertex));
+
+	VertexCacheStats cache = {}, overdraw = {};
+	double time = TimeMilliseconds(1, [&]()
+	{
+		OptimizeVertexCache(indices, vertices.size());
+		cache = AnalyzeVertexCache(indices, vertices.size());
+		OptimizeOverdraw(indices, vertices, 1.05f);
+		overdraw = AnalyzeVertexCache(indices, vertices.size());
+		OptimizeVertexFetch(vertices, indices);
+	});
+	VertexCacheStats final = AnalyzeVertexCache(indices, vertices.size());
+	float finalFetch = AnalyzeVertexFetch(indices, vertices.size(), sizeof(Vertex));
+
+	printf("%-20s %7zu tris  acmr %.3f -> cache %.3f -> overdraw %.3f -> fetch %.3f  atvr %.3f -> %.3f  overfetch %.2f -> %.2f  %.2f ms\n",
+		name, indices.size() / 3, original.acmr, cache.acmr, overdraw.acmr, final.acmr, original.atvr, final.atvr, originalFetch, finalFetch, time);
+
+	CHECK(cache.acmr <= original.acmr);
+	//the last run of each hard cluster isn't held to the 1.05 threshold, so a little more than 5% is fine
+	CHECK(overdraw.acmr <= cache.acmr * 1.1f);
+	CHECK(final.acmr == overdraw.acmr);
+	CHECK(final.atvr >= 1.0f);
+	CHECK(maxAcmr == 0 || final.acmr <= maxAcmr);
+	CHECK(IsInFirstUseOrder(indices));
+	CHECK(GetTriangleKeys(vertices, indices) == before);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int side = (unsigned int)GetArgument(argc, argv, "grid", 256);
+
+	TestSimulator();
+
+	//today's results with about 3% room, so a change that makes the optimizer worse fails here
+	struct Model { const char* name; float maxAcmr; };
+	Model models[] =
+	{
+		{ "cube.obj", 2.0f },
+		{ "cylinder.obj", 1.16f },
+		{ "helix.obj", 1.09f },
+		{ "quad.obj", 2.0f },
+		{ "quad_double_sided.obj", 2.0f },
+		{ "sphere.obj", 0.8f },
+		{ "torus.obj", 0.73f },
+	};
+
+	for (const Model& model : models)
+	{
+		std::filesystem::path fileName = std::filesystem::path("Assets/Models") / model.name;
+		ObjData data;
+		bool loaded = LoadObj(fileName, data);
+		CHECK(loaded);
+		if (!loaded)
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		BuildObjVertices(data, vertices, indices);
+		TestMesh(model.name, vertices, indices, model.maxAcmr);
+	}
+
+	//row order already reuses the row above, so the grid shows how much more a real ordering gets
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BuildGrid(side, vertices, indices);
+	TestMesh("grid", vertices, indices, 0.72f);
+
+	return GetFailureCount();
+}
@@ -0,0 +1,143 @@
+#include "Bounds.h"
+#include "ObjLoader.h"
+#include "TangentSpace.h"
+#include "TestHelpers.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Packs every bundled model the way ImportMesh does and
+// checks the largest position, normal, tangent and uv
+// error against what 16 bit snorm, octahedral and half
+// float storage can promise, plus uvs tiled far past 1,
+// where half floats get coarse.  Then times PackVertices
+// over 4M vertices (unless --millions says otherwise).
+// --------------------------------------------------------
+
+// Half floats keep 11 significant bits, so rounding is off by at most half of 2^-10 of the value's power of two
+static float GetHalfError(float value)
+{
+	int exponent;
+	frexpf(std::max(fabsf(value), 6.1e-5f), &exponent);
+	return ldexpf(1.0f, exponent - 12);
+}
+
+// Quantization covering the vertices' box
+static VertexQuantization GetQuantization(const std::vector<Vertex>& vertices)
+{
+	Bounds bounds = ComputeBounds(&vertices[0].position, vertices.size(), sizeof(Vertex));
+	return ComputeVertexQuantization(bounds.boxMin, bounds.boxMax);
+}
+
+static void TestModel(const std::filesystem::path& fileName)
+{
+	ObjData data;
+	CHECK(LoadObj(fileName, data));
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(data, vertices, indices);
+	GenerateTangents(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	VertexQuantization quantization = GetQuantization(vertices);
+	std::vector<PackedVertex> packed(vertices.size());
+	PackVertices(vertices.data(), vertices.size(), quantization, packed.data());
+	VertexPackingError error = AnalyzeVertexPacking(vertices, packed, quantization);
+
+	//half a snorm step on each axis, an octahedral cell's diagonal (about 0.005 degrees at 16 bits), half a half float step
+	XMFLOAT3 scale = quantization.positionScale;
+	float positionBound = 0.5f / 32767.0f * sqrtf(scale.x * scale.x + scale.y * scale.y + scale.z * scale.z) * 1.01f;
+	float uvBound = 0;
+	for (const Vertex& v : vertices)
+		uvBound = std::max(uvBound, std::max(GetHalfError(v.uv.x), GetHalfError(v.uv.y)));
+	CHECK(error.position <= positionBound);
+	CHECK(error.normalDegrees < 0.01f && error.tangentDegrees < 0.01f);
+	CHECK(error.uv <= uvBound);
+
+	//the bitangent sign rides in position.w
+	std::vector<Vertex> unpacked(packed.size());
+	UnpackVertices(packed.data(), packed.size(), quantization, unpacked.data());
+	bool signs = true;
+	for (size_t i = 0; i < vertices.size(); i++)
+		signs = signs && (vertices[i].tangent.w < 0) == (unpacked[i].tangent.w < 0);
+	CHECK(signs);
+
+	printf("%-22s %5zu vertices  position %.2e (bound %.2e)  normal %.4f deg  tangent %.4f deg  uv %.2e\n",
+		fileName.filename().string().c_str(), vertices.size(), error.position, positionBound, error.normalDegrees, error.tangentDegrees, error.uv);
+}
+
+// Uvs repeating a texture up to 64 times: still within half a half float step, which at 1024 texels is whole texels
+static void TestTiledUvs()
+{
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> tiled(-64.0f, 64.0f);
+	std::vector<Vertex> vertices(10000);
+	for (Vertex& v : vertices)
+	{
+		v = {};
+		v.normal = XMFLOAT3(0, 1, 0);
+		v.tangent = XMFLOAT4(1, 0, 0, 1);
+		v.uv = XMFLOAT2(tiled(random), tiled(random));
+		v.position = XMFLOAT3(v.uv.x, 0, v.uv.y);
+	}
+
+	VertexQuantization quantization = GetQuantization(vertices);
+	std::vector<PackedVertex> packed(vertices.size());
+	std::vector<Vertex> unpacked(vertices.size());
+	PackVertices(vertices.data(), vertices.size(), quantization, packed.data());
+	UnpackVertices(packed.data(), packed.size(), quantization, unpacked.data());
+
+	bool withinBound = true;
+	float largest[2] = { 0, 0 };
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const XMFLOAT2& a = vertices[i].uv;
+		const XMFLOAT2& b = unpacked[i].uv;
+		float error = std::max(fabsf(a.x - b.x), fabsf(a.y - b.y));
+		withinBound = withinBound && fabsf(a.x - b.x) <= GetHalfError(a.x) && fabsf(a.y - b.y) <= GetHalfError(a.y);
+		int band = std::max(fabsf(a.x), fabsf(a.y)) > 8.0f;
+		largest[band] = std::max(largest[band], error);
+	}
+	CHECK(withinBound);
+	printf("tiled uvs: largest error %.2e with |uv| <= 8, %.2e past 8 (%.1f texels of a 1024 texture)\n",
+		largest[0], largest[1], largest[1] * 1024.0f);
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = (size_t)(GetArgument(argc, argv, "millions", 4) * 1000000);
+	int runs = (int)GetArgument(argc, argv, "runs", 5);
+
+	std::vector<std::filesystem::path> models;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("Assets/Models"))
+		models.push_back(entry.path());
+	std::sort(models.begin(), models.end());
+	for (const std::filesystem::path& model : models)
+		TestModel(model);
+	TestTiledUvs();
+
+	//the largest model repeated, so the source streams through memory like a big import
+	ObjData data;
+	LoadObj("Assets/Models/helix.obj", data);
+	std::vector<Vertex> model;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(data, model, indices);
+	GenerateTangents(model.data(), model.size(), indices.data(), indices.size());
+	std::vector<Vertex> vertices(count);
+	for (size_t i = 0; i < count; i++)
+		vertices[i] = model[i % model.size()];
+
+	VertexQuantization quantization = GetQuantization(model);
+	std::vector<PackedVertex> packed(count);
+	double pack = TimeMilliseconds(runs, [&]() { PackVertices(vertices.data(), count, quantization, packed.data()); });
+	std::vector<Vertex> unpacked(count);
+	double unpack = TimeMilliseconds(runs, [&]() { UnpackVertices(packed.data(), count, quantization, unpacked.data()); });
+	printf("%zu vertices, %zu bytes each packed (from %zu): pack %.2f ms per million (%.0f MB/s of source), unpack %.2f ms per million\n",
+		count, sizeof(PackedVertex), sizeof(Vertex), pack / (count / 1e6), count * sizeof(Vertex) / 1048576.0 / pack * 1000.0, unpack / (count / 1e6));
+
+	return GetFailureCount();
+}
@@ -0,0 +1,182 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "ImGui/imstb_rectpack.h"
+
+namespace
+{
+	// Grid padded textures are placed on, so every level keeps them in whole 4x4 blocks
+	unsigned int GetCellSize(unsigned int mipCount)
+	{
+		return 4u << (mipCount - 1);
+	}
+
+	unsigned int RoundUp(unsigned int value, unsigned int multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+}
+
+float AtlasLayout::GetEfficiency(unsigned int atlas) const
+{
+	size_t used = 0;
+	for (const AtlasRegion& region : regions)
+	{
+		if (region.atlas == atlas)
+			used += (size_t)region.width * region.height;
+	}
+	size_t total = (size_t)atlases[atlas].width * atlases[atlas].height;
+	return total > 0 ? (float)used / total : 0.0f;
+}
+
+bool PackAtlases(const std::vector<AtlasSize>& sizes, unsigned int maxSize, unsigned int gutter, AtlasLayout& layout)
+{
+	layout = AtlasLayout();
+	if (sizes.empty() || gutter < 4 || (gutter & (gutter - 1)) != 0)
+		return false;
+
+	//enough levels that the last one still has a texel of gutter
+	layout.gutter = gutter;
+	layout.mipCount = 1;
+	while ((1u << (layout.mipCount - 1)) < gutter)
+		layout.mipCount++;
+
+	//packed in grid cells rather than texels, which keeps every position aligned (and the packer's work small)
+	unsigned int cell = GetCellSize(layout.mipCount);
+	int gridSize = (int)(maxSize / cell);
+	std::vector<stbrp_rect> remaining(sizes.size());
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		remaining[i] = {};
+		remaining[i].id = (int)i;
+		remaining[i].w = (stbrp_coord)(RoundUp(sizes[i].width + 2 * gutter, cell) / cell);
+		remaining[i].h = (stbrp_coord)(RoundUp(sizes[i].height + 2 * gutter, cell) / cell);
+		if (sizes[i].width == 0 || sizes[i].height == 0 || remaining[i].w > gridSize || remaining[i].h > gridSize)
+			return false;
+	}
+
+	//whatever doesn't fit goes on to a new atlas; anything fits an empty one, so every pass places something
+	layout.regions.resize(sizes.size());
+	std::vector<stbrp_node> nodes(gridSize);
+	std::vector<stbrp_rect> unpacked;
+	while (!remaining.empty())
+	{
+		stbrp_context context;
+		stbrp_init_target(&context, gridSize, gridSize, nodes.data(), (int)nodes.size());
+		stbrp_pack_rects(&context, remaining.data(), (int)remaining.size());
+
+		unsigned int atlas = (unsigned int)layout.atlases.size();
+		AtlasSize extent = { 0, 0 };
+		unpacked.clear();
+		for (const stbrp_rect& rect : remaining)
+		{
+			if (!rect.was_packed)
+			{
+				unpacked.push_back(rect);
+				continue;
+			}
+
+			AtlasRegion& region = layout.regions[rect.id];
+			region.atlas = atlas;
+			region.x = rect.x * cell + gutter;
+			region.y = rect.y * cell + gutter;
+			region.width = sizes[rect.id].width;
+			region.height = sizes[rect.id].height;
+			extent.width = std::max(extent.width, (unsigned int)(rect.x + rect.w) * cell);
+			extent.height = std::max(extent.height, (unsigned int)(rect.y + rect.h) * cell);
+		}
+		layout.atlases.push_back(extent);
+		remaining.swap(unpacked);
+	}
+
+	//remaps need the trimmed atlas sizes
+	for (AtlasRegion& region : layout.regions)
+	{
+		const AtlasSize& atlas = layout.atlases[region.atlas];
+		region.uvRemap = DirectX::XMFLOAT4(
+			(float)region.width / atlas.width,
+			(float)region.height / atlas.height,
+			(float)region.x / atlas.width,
+			(float)region.y / atlas.height);
+	}
+	return true;
+}
+
+bool BuildAtlas(const std::vector<const TextureData*>& textures, const AtlasLayout& layout, unsigned int atlas, const MipSettings& settings, TextureData& data)
+{
+	if (atlas >= layout.atlases.size() || textures.size() != layout.regions.size())
+		return false;
+
+	//one channel only if every texture in the atlas has just the one
+	TextureFormat format = TEXTURE_FORMAT_R8;
+	for (size_t i = 0; i < layout.regions.size(); i++)
+	{
+		const AtlasRegion& region = layout.regions[i];
+		if (region.atlas != atlas)
+			continue;
+
+		const TextureData* texture = textures[i];
+		if (!texture || texture->mips.empty() || IsBlockCompressed(texture->format) ||
+			texture->width != region.width || texture->height != region.height)
+			return false;
+		if (texture->format != TEXTURE_FORMAT_R8)
+			format = TEXTURE_FORMAT_RGBA8;
+	}
+
+	const AtlasSize& size = layout.atlases[atlas];
+	unsigned int texelSize = GetTexelSize(format);
+	unsigned int cell = GetCellSize(layout.mipCount);
+	data.Allocate(format, size.width, size.height, layout.mipCount);
+	std::fill(data.pixels.begin(), data.pixels.end(), (unsigned char)0);
+
+	TextureData tile;
+	for (size_t i = 0; i < layout.regions.size(); i++)
+	{
+		const AtlasRegion& region = layout.regions[i];
+		if (region.atlas != atlas)
+			continue;
+
+		//the padded texture, gutters (and the slack up to the grid) wrapped around its edges
+		const TextureData& source = *textures[i];
+		unsigned int sourceTexelSize = GetTexelSize(source.format);
+		unsigned int left = region.x - layout.gutter;
+		unsigned int top = region.y - layout.gutter;
+		tile.Allocate(format, RoundUp(region.width + 2 * layout.gutter, cell), RoundUp(region.height + 2 * layout.gutter, cell));
+		for (unsigned int y = 0; y < tile.height; y++)
+		{
+			unsigned int sourceY = (y + region.height - layout.gutter % region.height) % region.height;
+			const unsigned char* sourceRow = source.GetMipData(0) + (size_t)sourceY * source.mips[0].rowPitch;
+			unsigned char* row = tile.GetMipData(0) + (size_t)y * tile.mips[0].rowPitch;
+			for (unsigned int x = 0; x < tile.width; x++)
+			{
+				unsigned int sourceX = (x + region.width - layout.gutter % region.width) % region.width;
+				const unsigned char* texel = sourceRow + sourceX * sourceTexelSize;
+				unsigned char* destination = row + x * texelSize;
+				if (sourceTexelSize == texelSize)
+					memcpy(destination, texel, texelSize);
+				else
+				{
+					destination[0] = destination[1] = destination[2] = texel[0];
+					destination[3] = 255;
+				}
+			}
+		}
+
+		//mipped alone, then each level copied to where the tile sits in that level of the atlas
+		GenerateMips(tile, settings);
+		for (unsigned int mip = 0; mip < layout.mipCount; mip++)
+		{
+			const TextureMip& level = tile.mips[mip];
+			for (unsigned int y = 0; y < level.height; y++)
+			{
+				const unsigned char* row = tile.GetMipData(mip) + (size_t)y * level.rowPitch;
+				unsigned char* destination = data.GetMipData(mip) + (size_t)((top >> mip) + y) * data.mips[mip].rowPitch + (left >> mip) * texelSize;
+				memcpy(destination, row, (size_t)level.width * texelSize);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "MipGenerator.h"
+#include "TextureData.h"
+
+// Largest atlas side, in texels
+#define TEXTURE_ATLAS_MAX_SIZE 2048
+
+// Texels of padding around every texture in an atlas (a power of two, at least 4).
+// Atlases get log2(gutter) + 1 levels, so even the last one has a texel of padding.
+#define TEXTURE_ATLAS_GUTTER 8
+
+// Width and height of a texture or an atlas
+struct AtlasSize
+{
+	unsigned int width;
+	unsigned int height;
+};
+
+// --------------------------------------------------------
+// Where one texture landed in an atlas
+// --------------------------------------------------------
+struct AtlasRegion
+{
+	unsigned int atlas;				// Index of the atlas it's in
+	unsigned int x;					// Level 0 texel position of the texture itself, inside its gutter
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+	DirectX::XMFLOAT4 uvRemap;		// Scale (xy) and offset (zw) from the texture's UVs to the atlas's
+};
+
+// --------------------------------------------------------
+// How a set of textures is split across atlases
+// --------------------------------------------------------
+struct AtlasLayout
+{
+	std::vector<AtlasRegion> regions;	// One per texture, in the order they were packed
+	std::vector<AtlasSize> atlases;
+	unsigned int gutter;
+	unsigned int mipCount;				// Levels of every atlas
+
+	// Texels of the textures in one atlas over the atlas's own, gutters and gaps count as waste
+	float GetEfficiency(unsigned int atlas) const;
+};
+
+// --------------------------------------------------------
+// Packs textures into as few atlases of at most maxSize
+// texels a side as it can (stb_rect_pack's skyline packer)
+//
+// - Each texture gets a gutter of its own texels, wrapped
+//   around its edges, so bilinear filtering across a UV
+//   seam reads what a wrapping sampler would
+// - Padded textures are placed on a grid of 4 << (levels
+//   - 1) texels, so every level keeps them whole 4x4
+//   blocks apart and a box filter never mixes two of them
+// - Atlases are trimmed to the space actually used
+// - Only sizes are needed, so the layout is known before
+//   anything is decoded.  Returns false for an empty set
+//   or a texture that doesn't fit in one atlas.
+// --------------------------------------------------------
+bool PackAtlases(const std::vector<AtlasSize>& sizes, unsigned int maxSize, unsigned int gutter, AtlasLayout& layout);
+
+// --------------------------------------------------------
+// Fills one atlas of a layout with level 0 of its textures
+// (textures[i] for regions[i], the ones in other atlases
+// may be null) and its mip chain
+//
+// - Every padded texture is mipped on its own with
+//   settings, so filters never reach into a neighbor
+// - The atlas is RGBA8, or R8 when every texture is (gray
+//   textures are expanded to RGBA otherwise)
+// - Device free, like the rest of the cooking
+// --------------------------------------------------------
+bool BuildAtlas(const std::vector<const TextureData*>& textures, const AtlasLayout& layout, unsigned int atlas, const MipSettings& settings, TextureData& data);
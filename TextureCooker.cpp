@@ -0,0 +1,334 @@
+#include "TextureCooker.h"
+#include "BlockCompression.h"
+#include "DdsFile.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "TexturePacker.h"
+#include <string>
+
+TextureFormat GetCookedFormat(TextureRole role)
+{
+	switch (role)
+	{
+	case TEXTURE_ROLE_ALBEDO: return TEXTURE_FORMAT_BC7;
+	case TEXTURE_ROLE_NORMAL: return TEXTURE_FORMAT_BC5;
+	case TEXTURE_ROLE_ROUGHNESS: return TEXTURE_FORMAT_BC4;
+	case TEXTURE_ROLE_METAL: return TEXTURE_FORMAT_BC4;
+	case TEXTURE_ROLE_SPECULAR: return TEXTURE_FORMAT_BC1;
+	case TEXTURE_ROLE_ORM: return TEXTURE_FORMAT_BC1;
+	}
+	return TEXTURE_FORMAT_RGBA8;
+}
+
+MipSettings GetMipSettings(TextureRole role)
+{
+	MipSettings settings;
+	if (role == TEXTURE_ROLE_ALBEDO)
+	{
+		settings.filter = MIP_FILTER_KAISER;
+		settings.srgb = true;
+	}
+	settings.normalMap = role == TEXTURE_ROLE_NORMAL;
+	return settings;
+}
+
+namespace
+{
+	// Key of a cook: the cooker version, role and every source's hash, in order
+	unsigned long long GetCookKey(const char* importer, TextureRole role, const unsigned long long* sourceHashes, size_t sourceCount)
+	{
+		AssetKey key(importer, TEXTURE_COOKER_VERSION);
+		key.Add(&role, sizeof(role));
+		for (size_t i = 0; i < sourceCount; i++)
+			key.Add(sourceHashes[i]);
+		return key.GetValue();
+	}
+
+	// Reads the payload stored for key, if there is one
+	bool ReadCachedTexture(AssetCache* cache, unsigned long long key, TextureFormat format, TextureData& data, TextureCookInfo* info)
+	{
+		//either the cooked format or the uncompressed fallback counts, as long as the tag matches
+		std::filesystem::path payload;
+		DdsCookTag tag;
+		if (!cache || !cache->Find(key, payload) || !ReadDds(payload, data, tag) ||
+			tag.version != TEXTURE_COOKER_VERSION || tag.sourceHash != key ||
+			(data.format != format && IsBlockCompressed(data.format)))
+			return false;
+
+		if (info)
+		{
+			info->cacheHit = true;
+			info->cachedFileName = payload;
+		}
+		return true;
+	}
+
+	// Compresses a freshly decoded texture, mips and all, and stores it under key
+	void FinishTexture(TextureData& decoded, TextureRole role, AssetCache* cache, unsigned long long key, TextureData& data, TextureCookInfo* info)
+	{
+		if (decoded.width % 4 == 0 && decoded.height % 4 == 0)
+			CompressTexture(decoded, GetCookedFormat(role), data);
+		else
+			data = std::move(decoded);
+
+		if (!cache)
+			return;
+		std::filesystem::path cooked = cache->GetTemporaryFileName(L".dds");
+		std::filesystem::path payload;
+		if (WriteDds(cooked, data, { TEXTURE_COOKER_VERSION, key }) && cache->Store(key, cooked, payload) && info)
+			info->cachedFileName = payload;
+	}
+
+	// Bytes a PNG would take cooked on its own for role, 0 if it isn't one
+	size_t GetCookedBytes(const std::filesystem::path& fileName, TextureRole role)
+	{
+		MappedFile source;
+		unsigned int width, height;
+		if (!source.Open(fileName) || !ReadPngSize((const unsigned char*)source.GetData(), source.GetSize(), width, height))
+			return 0;
+		TextureFormat format = width % 4 == 0 && height % 4 == 0 ? GetCookedFormat(role) : TEXTURE_FORMAT_R8;
+		return GetTextureBytes(format, width, height, GetFullMipCount(width, height));
+	}
+
+	bool DecodePngFile(const std::filesystem::path& fileName, TextureData& data)
+	{
+		MappedFile source;
+		return source.Open(fileName) && DecodePng((const unsigned char*)source.GetData(), source.GetSize(), data);
+	}
+}
+
+TextureCookInfo::TextureCookInfo() :
+	cacheHit(false),
+	separateBytes(0)
+{
+}
+
+bool CookTexture(
+	const std::filesystem::path& fileName,
+	AssetCache* cache,
+	TextureRole role,
+	TextureData& data,
+	TextureCookInfo* info)
+{
+	if (info)
+		*info = TextureCookInfo();
+
+	//an unchanged source isn't even read when its cook is stored
+	unsigned long long key = 0;
+	if (cache)
+	{
+		unsigned long long sourceHash;
+		if (!cache->HashSource(fileName, sourceHash))
+			return false;
+		key = GetCookKey("texture", role, &sourceHash, 1);
+		if (ReadCachedTexture(cache, key, GetCookedFormat(role), data, info))
+			return true;
+	}
+
+	TextureData decoded;
+	if (!DecodePngFile(fileName, decoded))
+		return false;
+
+	GenerateMips(decoded, GetMipSettings(role));
+	FinishTexture(decoded, role, cache, key, data, info);
+	return true;
+}
+
+bool CookOrmTexture(
+	const OrmSources& sources,
+	AssetCache* cache,
+	TextureData& data,
+	TextureCookInfo* info)
+{
+	if (info)
+	{
+		*info = TextureCookInfo();
+		info->separateBytes = GetCookedBytes(sources.roughness, TEXTURE_ROLE_ROUGHNESS) + GetCookedBytes(sources.metalness, TEXTURE_ROLE_METAL);
+		if (!sources.occlusion.empty())
+			info->separateBytes += GetCookedBytes(sources.occlusion, TEXTURE_ROLE_ROUGHNESS);
+	}
+
+	//swapping two maps changes the key, and a missing occlusion map hashes as 0
+	bool hasOcclusion = !sources.occlusion.empty();
+	unsigned long long key = 0;
+	if (cache)
+	{
+		unsigned long long sourceHashes[3] = {};
+		if (!cache->HashSource(sources.roughness, sourceHashes[0]) || !cache->HashSource(sources.metalness, sourceHashes[1]) ||
+			(hasOcclusion && !cache->HashSource(sources.occlusion, sourceHashes[2])))
+			return false;
+		key = GetCookKey("orm", TEXTURE_ROLE_ORM, sourceHashes, 3);
+		if (ReadCachedTexture(cache, key, GetCookedFormat(TEXTURE_ROLE_ORM), data, info))
+			return true;
+	}
+
+	TextureData occlusion;
+	TextureData roughness;
+	TextureData metalness;
+	if ((hasOcclusion && !DecodePngFile(sources.occlusion, occlusion)) ||
+		!DecodePngFile(sources.roughness, roughness) || !DecodePngFile(sources.metalness, metalness))
+		return false;
+
+	TextureData packed;
+	if (!PackOrmTexture(hasOcclusion ? &occlusion : nullptr, roughness, metalness, packed))
+		return false;
+
+	GenerateMips(packed, GetMipSettings(TEXTURE_ROLE_ORM));
+	FinishTexture(packed, TEXTURE_ROLE_ORM, cache, key, data, info);
+	return true;
+}
+
+bool PlanAtlasTextures(const std::vector<std::filesystem::path>& fileNames, AtlasLayout& layout)
+{
+	std::vector<AtlasSize> sizes(fileNames.size());
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		MappedFile source;
+		if (!source.Open(fileNames[i]) ||
+			!ReadPngSize((const unsigned char*)source.GetData(), source.GetSize(), sizes[i].width, sizes[i].height))
+			return false;
+	}
+	return PackAtlases(sizes, TEXTURE_ATLAS_MAX_SIZE, TEXTURE_ATLAS_GUTTER, layout);
+}
+
+bool CookAtlasTexture(
+	const std::vector<std::filesystem::path>& fileNames,
+	const AtlasLayout& layout,
+	unsigned int atlas,
+	TextureRole role,
+	AssetCache* cache,
+	TextureData& data,
+	TextureCookInfo* info)
+{
+	if (info)
+		*info = TextureCookInfo();
+	if (fileNames.size() != layout.regions.size() || atlas >= layout.atlases.size())
+		return false;
+
+	//the atlas's own sources, plus where they sit, since moving one changes the result too
+	std::vector<unsigned long long> sourceHashes;
+	sourceHashes.push_back(HashBytes(&layout.atlases[atlas], sizeof(AtlasSize), layout.gutter));
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		const AtlasRegion& region = layout.regions[i];
+		if (region.atlas != atlas)
+			continue;
+		if (info)
+			info->separateBytes += GetCookedBytes(fileNames[i], role);
+
+		unsigned long long sourceHash = 0;
+		if (cache && !cache->HashSource(fileNames[i], sourceHash))
+			return false;
+		unsigned int position[2] = { region.x, region.y };
+		sourceHashes.push_back(HashBytes(position, sizeof(position), sourceHash));
+	}
+
+	unsigned long long key = GetCookKey("atlas", role, sourceHashes.data(), sourceHashes.size());
+	if (ReadCachedTexture(cache, key, GetCookedFormat(role), data, info))
+		return true;
+
+	std::vector<TextureData> decoded(fileNames.size());
+	std::vector<const TextureData*> textures(fileNames.size(), nullptr);
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		if (layout.regions[i].atlas != atlas)
+			continue;
+		if (!DecodePngFile(fileNames[i], decoded[i]))
+			return false;
+		textures[i] = &decoded[i];
+	}
+
+	TextureData built;
+	if (!BuildAtlas(textures, layout, atlas, GetMipSettings(role), built))
+		return false;
+
+	FinishTexture(built, role, cache, key, data, info);
+	return true;
+}
+
+bool CookEnvironment(
+	const std::filesystem::path fileNames[6],
+	const TextureData* const faces[6],
+	const EnvironmentSettings& settings,
+	AssetCache* cache,
+	TextureData prefiltered[6],
+	TextureCookInfo* info)
+{
+	if (info)
+		*info = TextureCookInfo();
+
+	//the LUT's settings are left out, they don't change the cube
+	AssetKey key("environment", ENVIRONMENT_BAKER_VERSION);
+	unsigned int cubeSettings[3] = { settings.size, settings.mipCount, settings.sampleCount };
+	key.Add(cubeSettings, sizeof(cubeSettings));
+	for (int i = 0; cache && i < 6; i++)
+	{
+		unsigned long long sourceHash;
+		if (!cache->HashSource(fileNames[i], sourceHash))
+			return false;
+		key.Add(sourceHash);
+	}
+
+	std::filesystem::path payload;
+	DdsCookTag tag;
+	if (cache && cache->Find(key.GetValue(), payload) && ReadDdsCube(payload, prefiltered, tag) &&
+		tag.version == ENVIRONMENT_BAKER_VERSION && tag.sourceHash == key.GetValue() &&
+		prefiltered[0].format == TEXTURE_FORMAT_RGBA16F && prefiltered[0].mips.size() == settings.mipCount)
+	{
+		if (info)
+		{
+			info->cacheHit = true;
+			info->cachedFileName = payload;
+		}
+		return true;
+	}
+
+	if (!PrefilterEnvironment(faces, settings, prefiltered))
+		return false;
+
+	if (!cache)
+		return true;
+	std::filesystem::path baked = cache->GetTemporaryFileName(L".dds");
+	if (WriteDdsCube(baked, prefiltered, { ENVIRONMENT_BAKER_VERSION, key.GetValue() }) && cache->Store(key.GetValue(), baked, payload) && info)
+		info->cachedFileName = payload;
+	return true;
+}
+
+bool CookBrdfLut(
+	const EnvironmentSettings& settings,
+	AssetCache* cache,
+	TextureData& lut,
+	TextureCookInfo* info)
+{
+	if (info)
+		*info = TextureCookInfo();
+
+	AssetKey key("brdf-lut", ENVIRONMENT_BAKER_VERSION);
+	unsigned int lutSettings[2] = { settings.lutSize, settings.lutSampleCount };
+	key.Add(lutSettings, sizeof(lutSettings));
+
+	std::filesystem::path payload;
+	DdsCookTag tag;
+	if (cache && cache->Find(key.GetValue(), payload) && ReadDds(payload, lut, tag) &&
+		tag.version == ENVIRONMENT_BAKER_VERSION && tag.sourceHash == key.GetValue() && lut.format == TEXTURE_FORMAT_RG16F)
+	{
+		if (info)
+		{
+			info->cacheHit = true;
+			info->cachedFileName = payload;
+		}
+		return true;
+	}
+
+	if (settings.lutSize == 0 || settings.lutSampleCount == 0)
+		return false;
+	IntegrateBrdfLut(settings, lut);
+
+	if (!cache)
+		return true;
+	std::filesystem::path baked = cache->GetTemporaryFileName(L".dds");
+	if (WriteDds(baked, lut, { ENVIRONMENT_BAKER_VERSION, key.GetValue() }) && cache->Store(key.GetValue(), baked, payload) && info)
+		info->cachedFileName = payload;
+	return true;
+}
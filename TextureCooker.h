@@ -0,0 +1,141 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include "AssetCache.h"
+#include "EnvironmentBaker.h"
+#include "MipGenerator.h"
+#include "TextureAtlas.h"
+#include "TextureData.h"
+
+// Bump whenever decoding or compression changes its output, so old cooks get rebuilt
+#define TEXTURE_COOKER_VERSION 3
+
+// --------------------------------------------------------
+// What a texture is used for, which picks its block format
+//
+// - Albedo: BC7, full RGBA quality
+// - Normal: BC5, X and Y only (the shaders rebuild Z)
+// - Roughness, metal: BC4, one channel
+// - Specular: BC1, opaque RGB
+// - ORM (packed occlusion, roughness, metal): BC1, half the
+//   size of two BC4 maps, with roughness in the 6 bit green
+// --------------------------------------------------------
+enum TextureRole
+{
+	TEXTURE_ROLE_ALBEDO,
+	TEXTURE_ROLE_NORMAL,
+	TEXTURE_ROLE_ROUGHNESS,
+	TEXTURE_ROLE_METAL,
+	TEXTURE_ROLE_SPECULAR,
+	TEXTURE_ROLE_ORM
+};
+
+TextureFormat GetCookedFormat(TextureRole role);
+
+// Albedo is gamma encoded and sharpened with a Kaiser filter, normals
+// are renormalized, the data maps get a plain linear box filter
+MipSettings GetMipSettings(TextureRole role);
+
+// --------------------------------------------------------
+// What a cook did, besides filling in its texture
+// --------------------------------------------------------
+struct TextureCookInfo
+{
+	bool cacheHit;							// Read from the asset cache, nothing was decoded
+	size_t separateBytes;					// Packed textures and atlases: what their maps would take cooked on their own
+	std::filesystem::path cachedFileName;	// The stored DDS, empty without a cache
+
+	TextureCookInfo();
+};
+
+// --------------------------------------------------------
+// Loads a PNG compressed for its role, through an asset
+// cache (see AssetCache)
+//
+// - The cook's key covers the source's contents, the role
+//   and the cooker version; a stored DDS for it is read as
+//   is, without touching the source when it's unchanged
+// - Otherwise the PNG is decoded, given a full mip chain,
+//   compressed, and the result stored (a null cache skips
+//   caching entirely)
+// - Textures whose size isn't a multiple of 4 can't be block
+//   compressed on the device, so they stay uncompressed
+// - Device free, so it can run on any thread
+// --------------------------------------------------------
+bool CookTexture(
+	const std::filesystem::path& fileName,
+	AssetCache* cache,
+	TextureRole role,
+	TextureData& data,
+	TextureCookInfo* info = nullptr);
+
+// The PNGs that make up a packed ORM texture (an empty occlusion means none)
+struct OrmSources
+{
+	std::filesystem::path occlusion;
+	std::filesystem::path roughness;
+	std::filesystem::path metalness;
+};
+
+// --------------------------------------------------------
+// Same as CookTexture, for an ORM texture packed from its
+// separate maps (see PackOrmTexture)
+//
+// - The key covers every source, in their channel order
+// - info->separateBytes is what the maps would take cooked
+//   on their own, to measure what packing saves
+// --------------------------------------------------------
+bool CookOrmTexture(
+	const OrmSources& sources,
+	AssetCache* cache,
+	TextureData& data,
+	TextureCookInfo* info = nullptr);
+
+// Reads just the size of each PNG and packs them into atlases (see PackAtlases), so the
+// layout, and every texture's UV remap, is known before anything is decoded
+bool PlanAtlasTextures(const std::vector<std::filesystem::path>& fileNames, AtlasLayout& layout);
+
+// --------------------------------------------------------
+// Same as CookTexture, for one atlas of a planned layout
+// (see BuildAtlas)
+//
+// - The key covers the atlas's sources and where each one
+//   sits
+// - info->separateBytes is what its textures would take
+//   cooked on their own, full mip chains included
+// --------------------------------------------------------
+bool CookAtlasTexture(
+	const std::vector<std::filesystem::path>& fileNames,
+	const AtlasLayout& layout,
+	unsigned int atlas,
+	TextureRole role,
+	AssetCache* cache,
+	TextureData& data,
+	TextureCookInfo* info = nullptr);
+
+// --------------------------------------------------------
+// Prefilters a sky for specular image based lighting (see
+// PrefilterEnvironment), through an asset cache
+//
+// - The key covers the six face PNGs (+X, -X, +Y, -Y, +Z,
+//   -Z), the prefiltering settings and the baker version;
+//   the six prefiltered faces are stored together, as one
+//   cube DDS
+// - faces are those PNGs already decoded (the sky needs them
+//   anyway), only read when no bake is stored
+// --------------------------------------------------------
+bool CookEnvironment(
+	const std::filesystem::path fileNames[6],
+	const TextureData* const faces[6],
+	const EnvironmentSettings& settings,
+	AssetCache* cache,
+	TextureData prefiltered[6],
+	TextureCookInfo* info = nullptr);
+
+// The BRDF LUT (see IntegrateBrdfLut) through an asset cache, keyed on just its settings
+bool CookBrdfLut(
+	const EnvironmentSettings& settings,
+	AssetCache* cache,
+	TextureData& lut,
+	TextureCookInfo* info = nullptr);
@@ -0,0 +1,104 @@
+#include "TextureData.h"
+#include <algorithm>
+
+unsigned int GetTexelSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_R8: return 1;
+	case TEXTURE_FORMAT_RGBA8: return 4;
+	case TEXTURE_FORMAT_RGBA16F: return 8;
+	case TEXTURE_FORMAT_RG16F: return 4;
+	default: return 0;
+	}
+}
+
+unsigned int GetBlockSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_BC1: return 8;
+	case TEXTURE_FORMAT_BC4: return 8;
+	case TEXTURE_FORMAT_BC5: return 16;
+	case TEXTURE_FORMAT_BC7: return 16;
+	default: return 0;
+	}
+}
+
+bool IsBlockCompressed(TextureFormat format)
+{
+	return GetBlockSize(format) != 0;
+}
+
+unsigned int GetRowPitch(TextureFormat format, unsigned int width)
+{
+	if (IsBlockCompressed(format))
+		return (width + 3) / 4 * GetBlockSize(format);
+	return width * GetTexelSize(format);
+}
+
+const char* GetTextureFormatName(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_R8: return "R8";
+	case TEXTURE_FORMAT_RGBA8: return "RGBA8";
+	case TEXTURE_FORMAT_BC1: return "BC1";
+	case TEXTURE_FORMAT_BC4: return "BC4";
+	case TEXTURE_FORMAT_BC5: return "BC5";
+	case TEXTURE_FORMAT_BC7: return "BC7";
+	case TEXTURE_FORMAT_RGBA16F: return "RGBA16F";
+	case TEXTURE_FORMAT_RG16F: return "RG16F";
+	default: return "unknown";
+	}
+}
+
+unsigned int GetRowCount(TextureFormat format, unsigned int height)
+{
+	return IsBlockCompressed(format) ? (height + 3) / 4 : height;
+}
+
+size_t GetTextureBytes(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	size_t size = 0;
+	for (unsigned int i = 0; i < mipCount; i++)
+		size += (size_t)GetRowPitch(format, std::max(1u, width >> i)) * GetRowCount(format, std::max(1u, height >> i));
+	return size;
+}
+
+TextureData::TextureData() :
+	format(TEXTURE_FORMAT_RGBA8),
+	width(0),
+	height(0)
+{
+}
+
+void TextureData::Allocate(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	this->format = format;
+	this->width = width;
+	this->height = height;
+
+	mips.resize(mipCount);
+	size_t size = 0;
+	for (unsigned int i = 0; i < mipCount; i++)
+	{
+		TextureMip& level = mips[i];
+		level.width = std::max(1u, width >> i);
+		level.height = std::max(1u, height >> i);
+		level.rowPitch = GetRowPitch(format, level.width);
+		level.offset = size;
+		size += (size_t)level.rowPitch * GetRowCount(format, level.height);
+	}
+	pixels.resize(size);
+}
+
+unsigned char* TextureData::GetMipData(unsigned int mip)
+{
+	return pixels.data() + mips[mip].offset;
+}
+
+const unsigned char* TextureData::GetMipData(unsigned int mip) const
+{
+	return pixels.data() + mips[mip].offset;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Texel layouts a TextureData can hold.  Decoded PNGs keep
+// grayscale as one channel and make everything else RGBA
+// (as the WIC loader did); the BC formats are what the
+// texture cooker stores in 4x4 blocks.  The half float ones
+// hold baked lighting, which doesn't fit 8 bits.
+// --------------------------------------------------------
+enum TextureFormat
+{
+	TEXTURE_FORMAT_R8,
+	TEXTURE_FORMAT_RGBA8,
+	TEXTURE_FORMAT_BC1,
+	TEXTURE_FORMAT_BC4,
+	TEXTURE_FORMAT_BC5,
+	TEXTURE_FORMAT_BC7,
+	TEXTURE_FORMAT_RGBA16F,
+	TEXTURE_FORMAT_RG16F
+};
+
+// Bytes per texel of an uncompressed format (0 for block compressed ones)
+unsigned int GetTexelSize(TextureFormat format);
+
+// Bytes per 4x4 block of a block compressed format (0 for uncompressed ones)
+unsigned int GetBlockSize(TextureFormat format);
+
+bool IsBlockCompressed(TextureFormat format);
+
+// Short name of a format for stats and logs ("BC7", "RGBA16F" ...)
+const char* GetTextureFormatName(TextureFormat format);
+
+// Bytes in one row of texels (or of blocks) of a level that many texels wide
+unsigned int GetRowPitch(TextureFormat format, unsigned int width);
+
+// Rows of texels (or of blocks) in a level that many texels high
+unsigned int GetRowCount(TextureFormat format, unsigned int height);
+
+// Bytes of mipCount tightly packed levels of a texture that size (see TextureData::Allocate)
+size_t GetTextureBytes(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount);
+
+// --------------------------------------------------------
+// One level of a mip chain, as a byte range of
+// TextureData::pixels
+// --------------------------------------------------------
+struct TextureMip
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowPitch;
+	size_t offset;
+};
+
+// --------------------------------------------------------
+// A decoded texture on the CPU, laid out the way the
+// device wants its initial data
+//
+// - Every mip level lives in the one pixel array, level 0
+//   first, so more levels can be appended later without
+//   touching the ones already there
+// - Built without a device, so decoding can run on any
+//   thread (and be benchmarked off Windows)
+// --------------------------------------------------------
+struct TextureData
+{
+	TextureFormat format;
+	unsigned int width;
+	unsigned int height;
+	std::vector<TextureMip> mips;
+	std::vector<unsigned char> pixels;
+
+	TextureData();
+
+	// Sizes the texture to mipCount tightly packed levels, each half the size of
+	// the one before (never below 1 texel), contents undefined
+	void Allocate(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount = 1);
+
+	unsigned char* GetMipData(unsigned int mip);
+	const unsigned char* GetMipData(unsigned int mip) const;
+};
@@ -0,0 +1,301 @@
+#include "TextureLoader.h"
+#include "PngDecoder.h"
+
+namespace
+{
+	float MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	DXGI_FORMAT GetDxgiFormat(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TEXTURE_FORMAT_R8: return DXGI_FORMAT_R8_UNORM;
+		case TEXTURE_FORMAT_RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case TEXTURE_FORMAT_BC1: return DXGI_FORMAT_BC1_UNORM;
+		case TEXTURE_FORMAT_BC4: return DXGI_FORMAT_BC4_UNORM;
+		case TEXTURE_FORMAT_BC5: return DXGI_FORMAT_BC5_UNORM;
+		case TEXTURE_FORMAT_BC7: return DXGI_FORMAT_BC7_UNORM;
+		case TEXTURE_FORMAT_RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		case TEXTURE_FORMAT_RG16F: return DXGI_FORMAT_R16G16_FLOAT;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+HRESULT CreateTextureFromData(Microsoft::WRL::ComPtr<ID3D11Device> device, const TextureData& data, ID3D11ShaderResourceView** view)
+{
+	if (data.mips.empty())
+		return E_INVALIDARG;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = data.width;
+	desc.Height = data.height;
+	desc.MipLevels = (UINT)data.mips.size();
+	desc.ArraySize = 1;
+	desc.Format = GetDxgiFormat(data.format);
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+
+	//one initial data entry per mip, all pointing into the one pixel array
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(data.mips.size());
+	for (size_t i = 0; i < data.mips.size(); i++)
+	{
+		initialData[i].pSysMem = data.GetMipData((unsigned int)i);
+		initialData[i].SysMemPitch = data.mips[i].rowPitch;
+		initialData[i].SysMemSlicePitch = 0;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	HRESULT result = device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf());
+	if (FAILED(result))
+		return result;
+
+	// A null description gives a view of the whole texture
+	return device->CreateShaderResourceView(texture.Get(), 0, view);
+}
+
+HRESULT CreateCubeTextureFromData(Microsoft::WRL::ComPtr<ID3D11Device> device, const TextureData faces[6], ID3D11ShaderResourceView** view)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (faces[i].mips.empty() || faces[i].format != faces[0].format || faces[i].width != faces[0].width ||
+			faces[i].height != faces[0].height || faces[i].mips.size() != faces[0].mips.size())
+			return E_INVALIDARG;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = faces[0].width;
+	desc.Height = faces[0].height;
+	desc.MipLevels = (UINT)faces[0].mips.size();
+	desc.ArraySize = 6;
+	desc.Format = GetDxgiFormat(faces[0].format);
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	//subresources go face by face, every level of a face before the next one
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	for (int i = 0; i < 6; i++)
+	{
+		for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+		{
+			D3D11_SUBRESOURCE_DATA level = {};
+			level.pSysMem = faces[i].GetMipData(mip);
+			level.SysMemPitch = faces[i].mips[mip].rowPitch;
+			initialData.push_back(level);
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	HRESULT result = device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf());
+	if (FAILED(result))
+		return result;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+	viewDesc.Format = desc.Format;
+	viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	viewDesc.TextureCube.MostDetailedMip = 0;
+	viewDesc.TextureCube.MipLevels = desc.MipLevels;
+	return device->CreateShaderResourceView(texture.Get(), &viewDesc, view);
+}
+
+TextureLoader::TextureLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int threadCount) :
+	device(device),
+	pendingCount(0),
+	totalMilliseconds(0.0f),
+	pool(threadCount)
+{
+}
+
+void TextureLoader::Load(const wchar_t* fileName, ID3D11ShaderResourceView** target)
+{
+	std::unique_ptr<Request> request = std::make_unique<Request>();
+	request->fileName = fileName;
+	request->target = target;
+	request->cook = false;
+	request->role = TEXTURE_ROLE_ALBEDO;
+	Queue(std::move(request));
+}
+
+void TextureLoader::Load(const wchar_t* fileName, ID3D11ShaderResourceView** target, TextureRole role)
+{
+	std::unique_ptr<Request> request = std::make_unique<Request>();
+	request->fileName = fileName;
+	request->target = target;
+	request->cook = true;
+	request->role = role;
+	Queue(std::move(request));
+}
+
+void TextureLoader::LoadOrm(const OrmSources& sources, ID3D11ShaderResourceView** target)
+{
+	std::unique_ptr<Request> request = std::make_unique<Request>();
+	request->fileName = sources.roughness.wstring();
+	request->target = target;
+	request->cook = true;
+	request->role = TEXTURE_ROLE_ORM;
+	request->ormSources = sources;
+	Queue(std::move(request));
+}
+
+void TextureLoader::LoadAtlas(const std::vector<AtlasTexture>& textures, TextureRole role)
+{
+	std::shared_ptr<AtlasBatch> batch = std::make_shared<AtlasBatch>();
+	for (const AtlasTexture& texture : textures)
+		batch->fileNames.push_back(texture.fileName);
+
+	//a missing file or one too big for an atlas: every texture on its own
+	if (!PlanAtlasTextures(batch->fileNames, batch->layout))
+	{
+		for (const AtlasTexture& texture : textures)
+		{
+			*texture.uvRemap = DirectX::XMFLOAT4(1.0f, 1.0f, 0.0f, 0.0f);
+			Load(texture.fileName.wstring().c_str(), texture.target, role);
+		}
+		return;
+	}
+
+	for (unsigned int atlas = 0; atlas < batch->layout.atlases.size(); atlas++)
+	{
+		std::unique_ptr<Request> request = std::make_unique<Request>();
+		request->target = nullptr;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			const AtlasRegion& region = batch->layout.regions[i];
+			if (region.atlas != atlas)
+				continue;
+
+			*textures[i].uvRemap = region.uvRemap;
+			if (request->target)
+				request->sharedTargets.push_back(textures[i].target);
+			else
+			{
+				//named after its first texture, for the stats
+				request->target = textures[i].target;
+				request->fileName = L"atlas of " + textures[i].fileName.filename().wstring();
+			}
+		}
+
+		request->cook = true;
+		request->role = role;
+		request->atlasBatch = batch;
+		request->atlas = atlas;
+		Queue(std::move(request));
+	}
+}
+
+void TextureLoader::Queue(std::unique_ptr<Request> request)
+{
+	if (pendingCount == 0)
+		batchStart = std::chrono::steady_clock::now();
+	pendingCount++;
+
+	request->decoded = false;
+	request->cache = cache;
+	request->decodeMilliseconds = 0.0f;
+
+	//requests are heap allocated, so the job's pointer stays valid as the list grows
+	Request* job = request.get();
+	size_t index = requests.size();
+	requests.push_back(std::move(request));
+
+	pool.Submit([this, job, index]()
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (job->atlasBatch)
+			job->decoded = CookAtlasTexture(job->atlasBatch->fileNames, job->atlasBatch->layout, job->atlas, job->role, job->cache.get(), job->data, &job->info);
+		else if (job->role == TEXTURE_ROLE_ORM)
+			job->decoded = CookOrmTexture(job->ormSources, job->cache.get(), job->data, &job->info);
+		else if (job->cook)
+			job->decoded = CookTexture(job->fileName, job->cache.get(), job->role, job->data, &job->info);
+		else if (LoadPng(job->fileName, job->data))
+			job->decoded = GenerateMips(job->data, MipSettings());
+		job->decodeMilliseconds = MillisecondsSince(start);
+
+		{
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finished.push_back(index);
+		}
+		decodeFinished.notify_one();
+	});
+}
+
+void TextureLoader::SetAssetCache(std::shared_ptr<AssetCache> cache)
+{
+	this->cache = cache;
+}
+
+void TextureLoader::SetStreamer(std::shared_ptr<TextureStreamer> streamer)
+{
+	this->streamer = streamer;
+}
+
+void TextureLoader::Finish()
+{
+	stats.resize(requests.size());
+
+	while (pendingCount > 0)
+	{
+		size_t index;
+		{
+			std::unique_lock<std::mutex> lock(finishedMutex);
+			decodeFinished.wait(lock, [this]() { return !finished.empty(); });
+			index = finished.back();
+			finished.pop_back();
+		}
+
+		Request& request = *requests[index];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool created = request.decoded && SUCCEEDED(CreateTextureFromData(device, request.data, request.target));
+		if (created && request.atlasBatch)
+		{
+			//every texture in the atlas holds its own reference to the one view (atlases aren't streamed)
+			for (ID3D11ShaderResourceView** shared : request.sharedTargets)
+			{
+				*shared = *request.target;
+				(*shared)->AddRef();
+			}
+		}
+		else if (created && streamer && !request.info.cachedFileName.empty())
+			streamer->Add(request.target, request.data, request.info.cachedFileName.wstring().c_str());
+
+		TextureLoadStats& entry = stats[index];
+		entry.fileName = request.fileName;
+		entry.width = request.data.width;
+		entry.height = request.data.height;
+		entry.decodeMilliseconds = request.decodeMilliseconds;
+		entry.uploadMilliseconds = MillisecondsSince(start);
+		entry.format = request.data.format;
+		entry.bytes = request.data.pixels.size();
+		entry.separateBytes = request.role == TEXTURE_ROLE_ORM || request.atlasBatch ? request.info.separateBytes : entry.bytes;
+		entry.decoded = request.decoded;
+		entry.cached = request.info.cacheHit;
+		entry.atlasEfficiency = request.atlasBatch ? request.atlasBatch->layout.GetEfficiency(request.atlas) : 0.0f;
+
+		//the pixels are on the GPU now
+		requests[index].reset();
+		pendingCount--;
+	}
+
+	totalMilliseconds = MillisecondsSince(batchStart);
+}
+
+const std::vector<TextureLoadStats>& TextureLoader::GetStats()
+{
+	return stats;
+}
+
+float TextureLoader::GetTotalMilliseconds()
+{
+	return totalMilliseconds;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <wrl/client.h>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Parallel.h"
+#include "TextureCooker.h"
+#include "TextureData.h"
+#include "TextureStreamer.h"
+
+// --------------------------------------------------------
+// How long one texture took to load
+// --------------------------------------------------------
+struct TextureLoadStats
+{
+	std::wstring fileName;
+	unsigned int width;
+	unsigned int height;
+	float decodeMilliseconds;   //on a worker thread
+	float uploadMilliseconds;   //on the thread that owns the device
+	TextureFormat format;
+	size_t bytes;               //every mip level, as uploaded
+	size_t separateBytes;       //what a packed texture's maps would take on their own (bytes otherwise)
+	bool decoded;               //false when the file couldn't be read or decoded (no texture was made)
+	bool cached;                //true when it came straight from the asset cache
+	float atlasEfficiency;      //texels of an atlas's textures over its own, 0 when it isn't one
+};
+
+// --------------------------------------------------------
+// One texture going into an atlas: its PNG, the view that
+// ends up holding the atlas, and where its UV remap goes
+// --------------------------------------------------------
+struct AtlasTexture
+{
+	std::filesystem::path fileName;
+	ID3D11ShaderResourceView** target;
+	DirectX::XMFLOAT4* uvRemap;
+};
+
+// Creates an immutable texture holding every mip level of data, plus a view of all of them
+HRESULT CreateTextureFromData(Microsoft::WRL::ComPtr<ID3D11Device> device, const TextureData& data, ID3D11ShaderResourceView** view);
+
+// Same, for a cube from its six faces (+X, -X, +Y, -Y, +Z, -Z), which must match in format, size and levels
+HRESULT CreateCubeTextureFromData(Microsoft::WRL::ComPtr<ID3D11Device> device, const TextureData faces[6], ID3D11ShaderResourceView** view);
+
+// --------------------------------------------------------
+// Loads a batch of textures
+//
+// - Load queues a file and its decode (and mip chain)
+//   starts right away on the thread pool
+// - Finish creates each texture on the calling thread as
+//   soon as its decode is done, so uploads overlap the
+//   decodes still running
+// - Textures loaded with a role are cooked (block
+//   compressed through the DDS cache) on the pool as well
+// - Files the PNG decoder can't read leave their view null
+// --------------------------------------------------------
+class TextureLoader
+{
+public:
+	explicit TextureLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int threadCount = 0);
+
+	// target (an empty view's GetAddressOf) is filled in by Finish, so it has to outlive the batch
+	void Load(const wchar_t* fileName, ID3D11ShaderResourceView** target);
+
+	// Same, but compressed for role through the asset cache (see CookTexture)
+	void Load(const wchar_t* fileName, ID3D11ShaderResourceView** target, TextureRole role);
+
+	// Packs separate occlusion/roughness/metal maps into one cooked ORM texture (see CookOrmTexture)
+	void LoadOrm(const OrmSources& sources, ID3D11ShaderResourceView** target);
+
+	// Packs small textures of one role into shared atlases (see PackAtlases), one cooked texture
+	// each.  Every uvRemap is filled in right away; each target gets the atlas its texture is in
+	// (so several share a view).  If the textures can't be packed, each is loaded on its own
+	// with an identity remap.
+	void LoadAtlas(const std::vector<AtlasTexture>& textures, TextureRole role);
+
+	// Cooked textures queued from here on go through cache (without one nothing is cached)
+	void SetAssetCache(std::shared_ptr<AssetCache> cache);
+
+	// Textures cooked through the asset cache from here on are handed to streamer once they're created
+	void SetStreamer(std::shared_ptr<TextureStreamer> streamer);
+
+	// Blocks until every queued texture has been created
+	void Finish();
+
+	// One entry per Load (across batches), in the order they were queued
+	const std::vector<TextureLoadStats>& GetStats();
+
+	// Wall clock time from the first Load of the batch to the end of Finish
+	float GetTotalMilliseconds();
+
+private:
+	//what every atlas of one LoadAtlas shares
+	struct AtlasBatch
+	{
+		std::vector<std::filesystem::path> fileNames;
+		AtlasLayout layout;
+	};
+
+	struct Request
+	{
+		std::wstring fileName;
+		ID3D11ShaderResourceView** target;
+		bool cook;
+		TextureRole role;
+		OrmSources ormSources;
+		std::shared_ptr<AtlasBatch> atlasBatch;		//null unless it's an atlas
+		unsigned int atlas;
+		std::vector<ID3D11ShaderResourceView**> sharedTargets;	//the atlas's other textures
+		std::shared_ptr<AssetCache> cache;
+		TextureData data;
+		bool decoded;
+		TextureCookInfo info;
+		float decodeMilliseconds;
+	};
+
+	void Queue(std::unique_ptr<Request> request);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::shared_ptr<TextureStreamer> streamer;
+	std::shared_ptr<AssetCache> cache;
+	std::vector<std::unique_ptr<Request>> requests;
+	std::vector<TextureLoadStats> stats;
+	size_t pendingCount;
+	std::chrono::steady_clock::time_point batchStart;
+	float totalMilliseconds;
+
+	//indices of requests whose decode is done, filled by the pool
+	std::mutex finishedMutex;
+	std::condition_variable decodeFinished;
+	std::vector<size_t> finished;
+
+	//last, so it's destroyed (and its jobs stopped) before anything they touch
+	ThreadPool pool;
+};
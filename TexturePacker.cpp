@@ -0,0 +1,71 @@
+#include "TexturePacker.h"
+#include "Parallel.h"
+#include <algorithm>
+
+namespace
+{
+	bool IsPackable(const TextureData* texture)
+	{
+		return !texture || (!texture->mips.empty() && !IsBlockCompressed(texture->format));
+	}
+
+	// --------------------------------------------------------
+	// Bilinear sample of a texture's first channel at a point
+	// given in texels of the packed texture, edge clamped
+	// --------------------------------------------------------
+	unsigned char SampleChannel(const TextureData& texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+	{
+		unsigned int texelSize = GetTexelSize(texture.format);
+		const unsigned char* data = texture.GetMipData(0);
+		unsigned int pitch = texture.mips[0].rowPitch;
+
+		//same size is by far the common case
+		if (texture.width == width && texture.height == height)
+			return data[(size_t)y * pitch + x * texelSize];
+
+		float u = (x + 0.5f) * texture.width / width - 0.5f;
+		float v = (y + 0.5f) * texture.height / height - 0.5f;
+		u = std::min(std::max(u, 0.0f), (float)(texture.width - 1));
+		v = std::min(std::max(v, 0.0f), (float)(texture.height - 1));
+
+		unsigned int x0 = (unsigned int)u;
+		unsigned int y0 = (unsigned int)v;
+		unsigned int x1 = std::min(x0 + 1, texture.width - 1);
+		unsigned int y1 = std::min(y0 + 1, texture.height - 1);
+		float fx = u - x0;
+		float fy = v - y0;
+
+		auto texel = [&](unsigned int tx, unsigned int ty) { return (float)data[(size_t)ty * pitch + tx * texelSize]; };
+		float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fx;
+		float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fx;
+		return (unsigned char)(top + (bottom - top) * fy + 0.5f);
+	}
+}
+
+bool PackOrmTexture(const TextureData* occlusion, const TextureData& roughness, const TextureData& metalness, TextureData& packed)
+{
+	if (!IsPackable(occlusion) || !IsPackable(&roughness) || !IsPackable(&metalness))
+		return false;
+
+	unsigned int width = std::max(roughness.width, metalness.width);
+	unsigned int height = std::max(roughness.height, metalness.height);
+	if (occlusion)
+	{
+		width = std::max(width, occlusion->width);
+		height = std::max(height, occlusion->height);
+	}
+
+	packed.Allocate(TEXTURE_FORMAT_RGBA8, width, height);
+	ParallelFor(height, [&](unsigned int y)
+	{
+		unsigned char* row = packed.GetMipData(0) + (size_t)y * packed.mips[0].rowPitch;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			row[x * 4 + 0] = occlusion ? SampleChannel(*occlusion, x, y, width, height) : 255;
+			row[x * 4 + 1] = SampleChannel(roughness, x, y, width, height);
+			row[x * 4 + 2] = SampleChannel(metalness, x, y, width, height);
+			row[x * 4 + 3] = 255;
+		}
+	});
+	return true;
+}
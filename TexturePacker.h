@@ -0,0 +1,19 @@
+#pragma once
+
+#include "TextureData.h"
+
+// --------------------------------------------------------
+// Channel packing for PBR data maps
+//
+// - ORM: ambient occlusion in red, roughness in green and
+//   metalness in blue, so one sample gives all three
+// - Only the first channel of each input is used, so gray
+//   and RGBA sources both work
+// - The result is the size of the largest input; smaller
+//   inputs are resampled bilinearly
+// - Device free, so it can be run (and checked) anywhere
+// --------------------------------------------------------
+
+// Packs level 0 of each input into a single level RGBA8 texture.  A null occlusion
+// fills red with 1 (unoccluded).  Returns false for empty or block compressed inputs.
+bool PackOrmTexture(const TextureData* occlusion, const TextureData& roughness, const TextureData& metalness, TextureData& packed);
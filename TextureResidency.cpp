@@ -0,0 +1,216 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+namespace
+{
+	// Least detailed level a texture may shrink to.  Block compressed textures
+	// need their most detailed level to be a whole number of blocks.
+	unsigned int GetTailMip(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount)
+	{
+		unsigned int tail = 0;
+		while (tail + 1 < mipCount && std::max(width >> tail, height >> tail) > TEXTURE_RESIDENCY_TAIL_SIZE)
+			tail++;
+
+		if (IsBlockCompressed(format))
+		{
+			while (tail > 0 && ((width >> tail) % 4 != 0 || (height >> tail) % 4 != 0))
+				tail--;
+		}
+		return tail;
+	}
+}
+
+float EstimateMipLevel(unsigned int width, unsigned int height, float projectedSize)
+{
+	float size = (float)std::max(width, height);
+	if (projectedSize >= size)
+		return 0.0f;
+	if (projectedSize <= 1.0f)
+		return log2f(size);
+	return log2f(size / projectedSize);
+}
+
+TextureResidency::TextureResidency(size_t budgetBytes) :
+	budget(budgetBytes),
+	frame(0)
+{
+}
+
+unsigned int TextureResidency::AddTexture(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount, unsigned int residentMip)
+{
+	ResidencyTexture texture = {};
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+	texture.mipCount = std::max(1u, mipCount);
+	texture.tailMip = GetTailMip(format, width, height, texture.mipCount);
+	texture.residentMip = std::min(residentMip, texture.mipCount - 1);
+	texture.requestedMip = texture.mipCount;
+	texture.lastUsedFrame = frame;
+	texture.pending = false;
+
+	textures.push_back(texture);
+	return (unsigned int)textures.size() - 1;
+}
+
+void TextureResidency::SetBudget(size_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+size_t TextureResidency::GetBudget()
+{
+	return budget;
+}
+
+size_t TextureResidency::GetResidentBytes()
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < textures.size(); i++)
+		total += GetTextureBytes(i, textures[i].residentMip);
+	return total;
+}
+
+size_t TextureResidency::GetTextureBytes(unsigned int texture, unsigned int mip)
+{
+	const ResidencyTexture& t = textures[texture];
+	return ::GetTextureBytes(t.format, std::max(1u, t.width >> mip), std::max(1u, t.height >> mip), t.mipCount - mip);
+}
+
+unsigned int TextureResidency::GetTextureCount()
+{
+	return (unsigned int)textures.size();
+}
+
+const ResidencyTexture& TextureResidency::GetTexture(unsigned int texture)
+{
+	return textures[texture];
+}
+
+void TextureResidency::RequestMip(unsigned int texture, float mip)
+{
+	ResidencyTexture& t = textures[texture];
+	unsigned int level = (unsigned int)std::min(std::max(mip, 0.0f), (float)(t.mipCount - 1));
+	t.requestedMip = std::min(t.requestedMip, level);
+	t.lastUsedFrame = frame;
+}
+
+void TextureResidency::EndFrame(std::vector<ResidencyChange>& changes, unsigned int maxChanges)
+{
+	//what each texture would like, before the budget
+	targets.resize(textures.size());
+	size_t total = 0;
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		const ResidencyTexture& t = textures[i];
+		unsigned int target = t.residentMip;
+		if (t.requestedMip < t.mipCount)
+		{
+			unsigned int wanted = std::min(t.requestedMip, t.tailMip);
+			if (wanted < t.residentMip || wanted >= t.residentMip + 2)
+				target = wanted;
+		}
+		targets[i] = target;
+		total += GetTextureBytes(i, targets[i]);
+	}
+
+	//over budget: textures unused for longest go down to their tails first
+	if (total > budget)
+	{
+		order.clear();
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			if (textures[i].lastUsedFrame != frame)
+				order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+		{
+			return textures[a].lastUsedFrame < textures[b].lastUsedFrame;
+		});
+
+		for (unsigned int i = 0; i < order.size() && total > budget; i++)
+		{
+			unsigned int index = order[i];
+			unsigned int tail = std::max(targets[index], textures[index].tailMip);
+			total -= GetTextureBytes(index, targets[index]) - GetTextureBytes(index, tail);
+			targets[index] = tail;
+		}
+	}
+
+	//then textures in use give up detail they kept only to avoid thrashing
+	for (unsigned int i = 0; i < textures.size() && total > budget; i++)
+	{
+		const ResidencyTexture& t = textures[i];
+		unsigned int wanted = std::min(t.requestedMip, t.tailMip);
+		if (t.requestedMip < t.mipCount && targets[i] < wanted)
+		{
+			total -= GetTextureBytes(i, targets[i]) - GetTextureBytes(i, wanted);
+			targets[i] = wanted;
+		}
+	}
+
+	//still over: the biggest texture in use gives up its finest level, until everything fits
+	while (total > budget)
+	{
+		unsigned int largest = UINT32_MAX;
+		size_t largestBytes = 0;
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			size_t bytes = GetTextureBytes(i, targets[i]);
+			if (targets[i] < textures[i].tailMip && bytes > largestBytes)
+			{
+				largest = i;
+				largestBytes = bytes;
+			}
+		}
+
+		//every texture is at its tail, so the budget can't be met
+		if (largest == UINT32_MAX)
+			break;
+
+		total -= largestBytes - GetTextureBytes(largest, targets[largest] + 1);
+		targets[largest]++;
+	}
+
+	//evictions free memory, so they go first; then uploads, most recently used and furthest from their target first
+	order.clear();
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		if (!textures[i].pending && targets[i] != textures[i].residentMip)
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+	{
+		bool evictA = targets[a] > textures[a].residentMip;
+		bool evictB = targets[b] > textures[b].residentMip;
+		if (evictA != evictB)
+			return evictA;
+		if (textures[a].lastUsedFrame != textures[b].lastUsedFrame)
+			return textures[a].lastUsedFrame > textures[b].lastUsedFrame;
+		return std::abs((int)targets[a] - (int)textures[a].residentMip) > std::abs((int)targets[b] - (int)textures[b].residentMip);
+	});
+
+	for (unsigned int i = 0; i < order.size() && i < maxChanges; i++)
+	{
+		textures[order[i]].pending = true;
+		changes.push_back({ order[i], targets[order[i]] });
+	}
+
+	for (ResidencyTexture& t : textures)
+		t.requestedMip = t.mipCount;
+	frame++;
+}
+
+void TextureResidency::CompleteChange(unsigned int texture, unsigned int mip)
+{
+	textures[texture].residentMip = mip;
+	textures[texture].pending = false;
+}
+
+void TextureResidency::CancelChange(unsigned int texture)
+{
+	textures[texture].pending = false;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "TextureData.h"
+
+// Streamed textures never shrink below this many texels on their longer side,
+// so there's always something to sample while detail streams back in
+#define TEXTURE_RESIDENCY_TAIL_SIZE 64
+
+// --------------------------------------------------------
+// Residency of one streamed texture, by the index of its
+// most detailed level (every coarser level is resident too)
+// --------------------------------------------------------
+struct ResidencyTexture
+{
+	TextureFormat format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mipCount;
+
+	unsigned int residentMip;		// Most detailed level on the device
+	unsigned int tailMip;			// Least detailed level it may shrink to
+	unsigned int requestedMip;		// Most detailed level asked for this frame, mipCount when none was
+	unsigned long long lastUsedFrame;
+	bool pending;					// A change is being streamed
+};
+
+// Asks for a texture's most detailed resident level to become mip
+struct ResidencyChange
+{
+	unsigned int texture;
+	unsigned int mip;
+};
+
+// Mip level (fractional) a texture that size needs to cover an object projectedSize pixels
+// across on screen, assuming its UVs span the object once.  0 means full detail.
+float EstimateMipLevel(unsigned int width, unsigned int height, float projectedSize);
+
+// --------------------------------------------------------
+// Decides which mip levels of a set of textures should be
+// resident within a memory budget
+//
+// - Users report the level they'd like each frame with
+//   RequestMip; EndFrame turns that into changes to stream
+// - Requested detail is kept when it fits; under pressure
+//   textures unused for longest lose their detail first,
+//   then detail kept past what was asked for, then the
+//   largest of the ones in use lose one level at a time
+// - Detail is only dropped unasked once a texture is two
+//   levels finer than needed, so textures at a level
+//   boundary don't stream in and out every frame
+// - Device free: the caller does the streaming and reports
+//   back, so scenes can be simulated without a GPU
+// --------------------------------------------------------
+class TextureResidency
+{
+public:
+	explicit TextureResidency(size_t budgetBytes);
+
+	// Returns the texture's id.  residentMip is the level it starts with.
+	unsigned int AddTexture(TextureFormat format, unsigned int width, unsigned int height, unsigned int mipCount, unsigned int residentMip = 0);
+
+	void SetBudget(size_t budgetBytes);
+	size_t GetBudget();
+
+	// Bytes of every texture's resident levels (a change counts once it's complete)
+	size_t GetResidentBytes();
+
+	// Bytes one texture takes with mip as its most detailed level
+	size_t GetTextureBytes(unsigned int texture, unsigned int mip);
+
+	unsigned int GetTextureCount();
+	const ResidencyTexture& GetTexture(unsigned int texture);
+
+	// The most detailed (lowest) request of the frame wins
+	void RequestMip(unsigned int texture, float mip);
+
+	// Plans every texture's level for the frame's requests and the budget, then appends
+	// up to maxChanges changes to start (evictions before uploads) and clears the requests
+	void EndFrame(std::vector<ResidencyChange>& changes, unsigned int maxChanges);
+
+	// Reports a change as streamed
+	void CompleteChange(unsigned int texture, unsigned int mip);
+
+	// Reports a change that couldn't be streamed, the texture keeps its current levels
+	void CancelChange(unsigned int texture);
+
+private:
+	size_t budget;
+	unsigned long long frame;
+	std::vector<ResidencyTexture> textures;
+
+	//scratch space for EndFrame, kept so planning doesn't allocate
+	std::vector<unsigned int> targets;
+	std::vector<unsigned int> order;
+};
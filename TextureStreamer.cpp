@@ -0,0 +1,122 @@
+#include "TextureStreamer.h"
+#include "DdsFile.h"
+#include "TextureLoader.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+
+void StreamedTexture::Request(float projectedSize)
+{
+	if (residencyId != UINT_MAX)
+		requestedMip = std::min(requestedMip, EstimateMipLevel(width, height, projectedSize));
+}
+
+TextureStreamer::TextureStreamer(Microsoft::WRL::ComPtr<ID3D11Device> device, size_t budgetBytes, unsigned int threadCount) :
+	device(device),
+	residency(budgetBytes),
+	pendingCount(0),
+	pool(threadCount)
+{
+}
+
+void TextureStreamer::Add(ID3D11ShaderResourceView** target, const TextureData& data, const wchar_t* cacheFileName)
+{
+	std::shared_ptr<StreamedTexture> texture = std::make_shared<StreamedTexture>();
+	texture->view = *target;
+	texture->residencyId = residency.AddTexture(data.format, data.width, data.height, (unsigned int)data.mips.size());
+	texture->width = data.width;
+	texture->height = data.height;
+	texture->requestedMip = FLT_MAX;
+
+	textures.push_back(texture);
+	cacheFileNames.push_back(cacheFileName);
+	targets.push_back(target);
+	handles[*target] = texture;
+}
+
+std::shared_ptr<StreamedTexture> TextureStreamer::GetTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view)
+{
+	auto found = handles.find(view.Get());
+	if (found != handles.end())
+		return found->second;
+
+	std::shared_ptr<StreamedTexture> texture = std::make_shared<StreamedTexture>();
+	texture->view = view;
+	texture->residencyId = UINT_MAX;
+	texture->width = 0;
+	texture->height = 0;
+	texture->requestedMip = FLT_MAX;
+	handles[view.Get()] = texture;
+	return texture;
+}
+
+void TextureStreamer::Update(unsigned int maxChanges)
+{
+	for (const std::shared_ptr<StreamedTexture>& texture : textures)
+	{
+		if (texture->requestedMip != FLT_MAX)
+			residency.RequestMip(texture->residencyId, texture->requestedMip);
+		texture->requestedMip = FLT_MAX;
+	}
+
+	//swap in whatever finished since last frame
+	std::vector<std::unique_ptr<StreamRead>> reads;
+	{
+		std::lock_guard<std::mutex> lock(finishedMutex);
+		reads.swap(finished);
+	}
+	for (std::unique_ptr<StreamRead>& read : reads)
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+		if (read->succeeded && SUCCEEDED(CreateTextureFromData(device, read->data, view.GetAddressOf())))
+		{
+			//the old texture goes away with its last reference, once nothing binds it
+			std::shared_ptr<StreamedTexture>& texture = textures[read->texture];
+			ID3D11ShaderResourceView*& target = *targets[read->texture];
+			handles.erase(texture->view.Get());
+			handles[view.Get()] = texture;
+			texture->view = view;
+
+			//the owner's slot holds a reference of its own
+			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> reference = view;
+			if (target)
+				target->Release();
+			target = reference.Detach();
+
+			residency.CompleteChange(read->texture, read->mip);
+		}
+		else
+			residency.CancelChange(read->texture);
+		pendingCount--;
+	}
+
+	changes.clear();
+	residency.EndFrame(changes, maxChanges);
+	for (const ResidencyChange& change : changes)
+	{
+		pendingCount++;
+		std::wstring cacheFileName = cacheFileNames[change.texture];
+		pool.Submit([this, change, cacheFileName]()
+		{
+			std::unique_ptr<StreamRead> read = std::make_unique<StreamRead>();
+			read->texture = change.texture;
+			read->mip = change.mip;
+
+			DdsCookTag tag;
+			read->succeeded = ReadDds(cacheFileName, read->data, tag, change.mip);
+
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finished.push_back(std::move(read));
+		});
+	}
+}
+
+TextureResidency& TextureStreamer::GetResidency()
+{
+	return residency;
+}
+
+unsigned int TextureStreamer::GetPendingCount()
+{
+	return pendingCount;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <wrl/client.h>
+#include <d3d11.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Parallel.h"
+#include "TextureData.h"
+#include "TextureResidency.h"
+
+// --------------------------------------------------------
+// What a material binds in place of a plain view, so the
+// streamer can swap the view as levels come and go
+// --------------------------------------------------------
+struct StreamedTexture
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+	unsigned int residencyId;	// UINT_MAX for a view that isn't streamed
+	unsigned int width;
+	unsigned int height;
+	float requestedMip;			// Most detailed level asked for this frame
+
+	// Asks for enough detail this frame to cover an object projectedSize pixels across
+	void Request(float projectedSize);
+};
+
+// --------------------------------------------------------
+// Streams mip levels of cooked textures in and out under a
+// memory budget (see TextureResidency for the policy)
+//
+// - Levels are reread from the texture's DDS cache file on
+//   the thread pool, then the texture is recreated with
+//   just those levels on the calling thread, which swaps
+//   the handle's (and the owner's) view
+// - Every handle's requests are collected in Update, so
+//   materials just report sizes as they're drawn
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	TextureStreamer(Microsoft::WRL::ComPtr<ID3D11Device> device, size_t budgetBytes, unsigned int threadCount = 1);
+
+	// Streams the texture in target (an owner's GetAddressOf), created from every level of data,
+	// which can be reread from cacheFileName.  target is kept pointing at the current view, so
+	// the owner never holds on to levels that were evicted; it has to stay valid across Updates.
+	void Add(ID3D11ShaderResourceView** target, const TextureData& data, const wchar_t* cacheFileName);
+
+	// The handle to bind for a view.  Views that were never added get one that never changes.
+	std::shared_ptr<StreamedTexture> GetTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view);
+
+	// Once per frame, after the frame's requests: swaps in finished levels, then starts up to maxChanges more
+	void Update(unsigned int maxChanges = 4);
+
+	TextureResidency& GetResidency();
+
+	// Changes being read right now
+	unsigned int GetPendingCount();
+
+private:
+	struct StreamRead
+	{
+		unsigned int texture;
+		unsigned int mip;
+		TextureData data;
+		bool succeeded;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	TextureResidency residency;
+	std::vector<std::shared_ptr<StreamedTexture>> textures;		// By residency id
+	std::vector<std::wstring> cacheFileNames;					// By residency id
+	std::vector<ID3D11ShaderResourceView**> targets;			// By residency id
+	std::unordered_map<ID3D11ShaderResourceView*, std::shared_ptr<StreamedTexture>> handles;
+	std::vector<ResidencyChange> changes;
+	unsigned int pendingCount;
+
+	//reads done on the pool, waiting for Update to create their textures
+	std::mutex finishedMutex;
+	std::vector<std::unique_ptr<StreamRead>> finished;
+
+	//last, so it's destroyed (and its jobs stopped) before anything they touch
+	ThreadPool pool;
+};
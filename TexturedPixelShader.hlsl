@@ -19,15 +19,19 @@ cbuffer DataFromCPU : register(b0)
     float4 colorTint;
     float3 cameraPos;
     float totalTime;
-    float3 ambientColor;
+    float ambientIntensity; //scales the sky's irradiance
     float roughness;
+    float2 ambientPadding;
     Light lights[MAX_LIGHTS];
     int numLights;
     float3 padding; //maintain 16 byte partitions
+    float4 SurfaceTextureRemap; //uv scale and offset into an atlas (see Material::AddTextureSRV)
+    float4 SurfaceTextureSpecularRemap;
 }
 
 Texture2D SurfaceTexture : register(t0);
 Texture2D SurfaceTextureSpecular : register(t1);
+StructuredBuffer<float4> SkyIrradianceSH : register(t4); //see Sky::GetIrradianceSRV
 
 SamplerState BasicSampler : register(s0);
 
@@ -54,8 +58,11 @@ float4 main(VertexToPixel input) : SV_TARGET
     float specularPower = (1.0f - roughness) * MAX_SPECULAR_EXPONENT;
     float3 viewVector = normalize(cameraPos - input.worldPosition);
 
-    float3 surfaceColor = SurfaceTexture.Sample(BasicSampler, input.uv).xyz * colorTint.xyz;
-    float3 color = surfaceColor * ambientColor;
+    float3 surfaceColor = SampleRemapped(SurfaceTexture, BasicSampler, input.uv, SurfaceTextureRemap).xyz * colorTint.xyz;
+    float3 color = surfaceColor * SkyIrradiance(SkyIrradianceSH, input.normal) * ambientIntensity;
+
+    //sampled once up front, since atlas sampling needs gradients
+    float specularFromMap = SampleRemapped(SurfaceTextureSpecular, BasicSampler, input.uv, SurfaceTextureSpecularRemap).x;
 
     float3 lightDirection;
     for (int i = 0; i < numLights; i++)
@@ -69,7 +76,7 @@ float4 main(VertexToPixel input) : SV_TARGET
             
             color += lights[i].intensity *
             (saturate(diffuse) +
-            (spec * any(diffuse)) * SurfaceTextureSpecular.Sample(BasicSampler, input.uv).x) * lights[i].color * surfaceColor;
+            (spec * any(diffuse)) * specularFromMap) * lights[i].color * surfaceColor;
         }
         else if (1 == lights[i].type)
         {
@@ -80,7 +87,7 @@ float4 main(VertexToPixel input) : SV_TARGET
             
             color += lights[i].intensity * Attenuate(lights[i], input.worldPosition) *
             (saturate(diffuse) + (spec * any(diffuse))
-            * SurfaceTextureSpecular.Sample(BasicSampler, input.uv).x) * lights[i].color * surfaceColor;
+            * specularFromMap) * lights[i].color * surfaceColor;
         }
         else if (2 == lights[i].type)
         {
@@ -2,190 +2,187 @@
 using namespace DirectX;
 
 Transform::Transform() :
-	translation(0, 0, 0),
-	pitchYawRoll(0, 0, 0),
-	scale(1, 1, 1),
-	matrixDirty(false)
+	store(&TransformStore::GetDefault()),
+	hierarchy(&TransformHierarchy::GetDefault())
 {
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+	index = store->Create();
+}
+
+Transform::Transform(const Transform& other) :
+	Transform()
+{
+	*this = other;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	//copies the values into this transform's own slot
+	store->SetPosition(index, other.store->GetPosition(other.index));
+	store->SetRotation(index, other.store->GetRotation(other.index));
+	store->SetScale(index, other.store->GetScale(other.index));
+	return *this;
+}
+
+Transform::~Transform()
+{
+	hierarchy->Remove(index);
+	store->Destroy(index);
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition()
 {
-	return translation;
+	return store->GetPosition(index);
 }
 
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll()
+DirectX::XMFLOAT4 Transform::GetRotation()
 {
-	return pitchYawRoll;
+	return store->GetRotation(index);
 }
 
 DirectX::XMFLOAT3 Transform::GetScale()
 {
-	return scale;
+	return store->GetScale(index);
 }
 
 DirectX::XMFLOAT3 Transform::GetForwardVector()
 {
-	//local forward vector
-	XMVECTOR fwd = XMVectorSet(0, 0, 1, 0);
-
-	//quaternion for current rotation in world space
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-
-	//rotate default forward by the actual rotation
-	XMFLOAT3 forwardVector;
-	XMStoreFloat3(&forwardVector, XMVector3Rotate(fwd, rotQuat));
-	return forwardVector;
+	return store->GetForwardVector(index);
 }
 
 DirectX::XMFLOAT3 Transform::GetUpVector()
 {
-	return DirectX::XMFLOAT3();
+	return store->GetUpVector(index);
 }
 
 DirectX::XMFLOAT3 Transform::GetRightVector()
 {
-	return DirectX::XMFLOAT3();
+	return store->GetRightVector(index);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	UpdateWorldMatrix();
-
-	return worldMatrix;
+	return hierarchy->GetWorldMatrix(index);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	return worldInverseTranspose;
+	return hierarchy->GetWorldInverseTransposeMatrix(index);
 }
 
-void Transform::SetPosition(float x, float y, float z)
+unsigned int Transform::GetMatrixVersion()
 {
-	translation.x = x;
-	translation.y = y;
-	translation.z = z;
-	matrixDirty = true;
+	return hierarchy->GetWorldVersion(index);
 }
 
-void Transform::SetPosition(DirectX::XMFLOAT3 position)
+void Transform::SetPosition(float x, float y, float z)
 {
-	translation = position;
-	matrixDirty = true;
+	store->SetPosition(index, XMFLOAT3(x, y, z));
 }
 
-void Transform::SetRotation(float pitch, float yaw, float roll)
+void Transform::SetPosition(DirectX::XMFLOAT3 position)
 {
-	pitchYawRoll.x = pitch;
-	pitchYawRoll.y = yaw;
-	pitchYawRoll.z = roll;
-	matrixDirty = true;
+	store->SetPosition(index, position);
 }
 
-void Transform::SetRotation(DirectX::XMFLOAT3 pitchYawRoll)
+void Transform::SetRotation(DirectX::XMFLOAT4 rotationQuaternion)
 {
-	this->pitchYawRoll = pitchYawRoll;
-	matrixDirty = true;
+	store->SetRotation(index, rotationQuaternion);
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	matrixDirty = true;
+	store->SetScale(index, XMFLOAT3(x, y, z));
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 scale)
 {
-	this->scale = scale;
-	matrixDirty = true;
+	store->SetScale(index, scale);
 }
 
 void Transform::MoveWorld(float x, float y, float z)
 {
-	translation.x += x;
-	translation.y += y;
-	translation.z += z;
-	matrixDirty = true;
+	XMFLOAT3 translation = GetPosition();
+	store->SetPosition(index, XMFLOAT3(translation.x + x, translation.y + y, translation.z + z));
 }
 
 void Transform::MoveWorld(DirectX::XMFLOAT3 offset)
 {
-
+	MoveWorld(offset.x, offset.y, offset.z);
 }
 
 void Transform::MoveLocal(float x, float y, float z)
 {
-	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-
 	//rotate the movement to make it relative
-	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
+	XMFLOAT4 rotation = GetRotation();
+	XMVECTOR dir = XMVector3Rotate(XMVectorSet(x, y, z, 0), XMLoadFloat4(&rotation));
 
 	//add the direction to our position
+	XMFLOAT3 translation = GetPosition();
 	XMStoreFloat3(&translation, XMLoadFloat3(&translation) + dir);
-
-	matrixDirty = true;
+	store->SetPosition(index, translation);
 }
 
 void Transform::MoveLocal(DirectX::XMFLOAT3 offset)
 {
+	MoveLocal(offset.x, offset.y, offset.z);
+}
 
-	matrixDirty = true;
+void Transform::Rotate(DirectX::XMFLOAT4 rotationQuaternion)
+{
+	XMFLOAT4 rotation = GetRotation();
+	XMStoreFloat4(&rotation, XMQuaternionMultiply(XMLoadFloat4(&rotation), XMLoadFloat4(&rotationQuaternion)));
+	store->SetRotation(index, rotation);
 }
 
-void Transform::Rotate(float p, float y, float r)
+void Transform::Scale(float x, float y, float z)
 {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
-	matrixDirty = true;
+	XMFLOAT3 scale = GetScale();
+	store->SetScale(index, XMFLOAT3(scale.x * x, scale.y * y, scale.z * z));
 }
 
-void Transform::Rotate(DirectX::XMFLOAT3 rotation)
+void Transform::Scale(DirectX::XMFLOAT3 scale)
 {
-	pitchYawRoll.x += rotation.x;
-	pitchYawRoll.y += rotation.y;
-	pitchYawRoll.z += rotation.z;
-	matrixDirty = true;
+	Scale(scale.x, scale.y, scale.z);
 }
 
-void Transform::Scale(float x, float y, float z)
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll()
 {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
-	matrixDirty = true;
+	return store->GetPitchYawRoll(index);
 }
 
-void Transform::Scale(DirectX::XMFLOAT3 scale)
+void Transform::SetRotation(float pitch, float yaw, float roll)
+{
+	store->SetPitchYawRoll(index, XMFLOAT3(pitch, yaw, roll));
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT3 pitchYawRoll)
 {
-	scale.x *= scale.x;
-	scale.y *= scale.y;
-	scale.z *= scale.z;
-	matrixDirty = true;
+	store->SetPitchYawRoll(index, pitchYawRoll);
 }
 
-void Transform::UpdateWorldMatrix()
+void Transform::Rotate(float p, float y, float r)
 {
-	
-	if (!matrixDirty)
-	{
-		return;
-	}
+	//roll then pitch before the current rotation, yaw after it
+	XMFLOAT4 rotation = GetRotation();
+	XMVECTOR rotated = XMQuaternionMultiply(
+		XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(p, 0, r), XMLoadFloat4(&rotation)),
+		XMQuaternionRotationRollPitchYaw(0, y, 0));
+	XMStoreFloat4(&rotation, rotated);
+	store->SetRotation(index, rotation);
+}
 
-	//create world matrix
+void Transform::Rotate(DirectX::XMFLOAT3 rotation)
+{
+	Rotate(rotation.x, rotation.y, rotation.z);
+}
 
-	XMMATRIX t = XMMatrixTranslationFromVector(XMLoadFloat3(&translation));
-	XMMATRIX s = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-	XMMATRIX r = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+bool Transform::SetParent(Transform* parent)
+{
+	return hierarchy->SetParent(index, parent ? parent->index : TransformHierarchy::NoParent);
+}
 
-	XMMATRIX worldMat = (s * r) * t;
+bool Transform::HasParent()
+{
+	return hierarchy->GetParent(index) != TransformHierarchy::NoParent;
+}
 
-	XMStoreFloat4x4(&worldMatrix, worldMat); 
-	XMStoreFloat4x4(&worldInverseTranspose,
-		XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
-}
\ No newline at end of file
@@ -1,44 +1,42 @@
 #pragma once
 #include <DirectXMath.h>
+#include "TransformStore.h"
+#include "TransformHierarchy.h"
 
 class Transform
 {
 private:
 
-	//raw transform data
-	DirectX::XMFLOAT3 translation;
-	DirectX::XMFLOAT3 pitchYawRoll; //quaternion would be DirectX::XMFLOAT4 rotationQuaternion;
-	DirectX::XMFLOAT3 scale;
+	//the transform data and its matrices live in a slot of the store, laid out alongside every other transform's
+	TransformStore* store;
+	unsigned int index;
 
-	//combine into a single matrix
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
-
-	//does the matrix need to be changed
-	bool matrixDirty;
-
-	void UpdateWorldMatrix();
+	//parent and children, if it has any
+	TransformHierarchy* hierarchy;
 
 
 
 public:
 	Transform();
-	//no real need for a destructor
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
 
-	//getters
+	//getters (position, rotation, scale and the local axes are relative to the parent, if there is one)
 	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
+	//local axes after rotation, cached with the world matrix (and current even before it's rebuilt)
 	DirectX::XMFLOAT3 GetForwardVector();
 	DirectX::XMFLOAT3 GetUpVector();
 	DirectX::XMFLOAT3 GetRightVector();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	unsigned int GetMatrixVersion();
 	//setters
 	void SetPosition(float x, float y, float z);
 	void SetPosition(DirectX::XMFLOAT3 position);
-	void SetRotation(float pitch, float yaw, float roll);
-	void SetRotation(DirectX::XMFLOAT3 pitchYawRoll);
+	void SetRotation(DirectX::XMFLOAT4 rotationQuaternion);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 scale);
 
@@ -52,12 +50,27 @@ public:
 	void MoveLocal(float x, float y, float z); 
 	void MoveLocal(DirectX::XMFLOAT3 offset);
 
-	void Rotate(float p, float y, float r);
-	void Rotate(DirectX::XMFLOAT3 rotation);
+	//rotate by a quaternion, applied after the current rotation (so about world axes)
+	void Rotate(DirectX::XMFLOAT4 rotationQuaternion);
 
 	void Scale(float x, float y, float z);
 	void Scale(DirectX::XMFLOAT3 scale);
 
+	//euler angles, kept for the editor and older code: the rotation is stored as a quaternion, so these
+	//convert on every call, and angles read back may differ from the ones set (same rotation, pitch in +-pi/2)
+	DirectX::XMFLOAT3 GetPitchYawRoll();
+	void SetRotation(float pitch, float yaw, float roll);
+	void SetRotation(DirectX::XMFLOAT3 pitchYawRoll);
+
+	//pitch and roll about the local axes, yaw about world up (adding to the angles when there's no roll)
+	void Rotate(float p, float y, float r);
+	void Rotate(DirectX::XMFLOAT3 rotation);
+
+	//parenting: the transform follows its parent, its own values become an offset from it (nullptr detaches).
+	//Copies don't bring the parent along, and a destroyed transform's children move up to its parent.
+	//False if the parent is this transform or one below it.
+	bool SetParent(Transform* parent);
+	bool HasParent();
 
 
 };
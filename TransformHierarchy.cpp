@@ -0,0 +1,281 @@
+#include "TransformHierarchy.h"
+
+using namespace DirectX;
+
+TransformHierarchy::TransformHierarchy(TransformStore* store) :
+	store(store),
+	dirty(false),
+	orderValid(true)
+{
+}
+
+TransformHierarchy& TransformHierarchy::GetDefault()
+{
+	static TransformHierarchy hierarchy(&TransformStore::GetDefault());
+	return hierarchy;
+}
+
+bool TransformHierarchy::SetParent(unsigned int transform, unsigned int parent)
+{
+	Reserve();
+	if (parentSlots[transform] == parent)
+		return true;
+
+	//can't go under itself, that would make a loop
+	for (unsigned int ancestor = parent; ancestor != NoParent; ancestor = parentSlots[ancestor])
+	{
+		if (ancestor == transform)
+			return false;
+	}
+
+	Unlink(transform);
+	if (parent != NoParent)
+		Link(transform, parent);
+	orderValid = false;
+
+	//its world changes right away, even if it stops being a node and never sees the rebuild
+	worldVersions[transform]++;
+	return true;
+}
+
+unsigned int TransformHierarchy::GetParent(unsigned int transform)
+{
+	return transform < parentSlots.size() ? parentSlots[transform] : NoParent;
+}
+
+unsigned int TransformHierarchy::GetChildCount(unsigned int transform)
+{
+	unsigned int count = 0;
+	if (transform < firstChildren.size())
+	{
+		for (unsigned int child = firstChildren[transform]; child != NoParent; child = nextSiblings[child])
+			count++;
+	}
+	return count;
+}
+
+void TransformHierarchy::Remove(unsigned int transform)
+{
+	if (!Contains(transform))
+		return;
+
+	unsigned int parent = parentSlots[transform];
+	while (firstChildren[transform] != NoParent)
+	{
+		unsigned int child = firstChildren[transform];
+		Unlink(child);
+		if (parent != NoParent)
+			Link(child, parent);
+		worldVersions[child]++;
+	}
+	Unlink(transform);
+	orderValid = false;
+}
+
+bool TransformHierarchy::Contains(unsigned int transform)
+{
+	return transform < parentSlots.size() &&
+		(parentSlots[transform] != NoParent || firstChildren[transform] != NoParent);
+}
+
+unsigned int TransformHierarchy::GetNodeCount()
+{
+	if (!orderValid)
+		RebuildOrder();
+
+	return (unsigned int)slots.size();
+}
+
+void TransformHierarchy::UpdateMatrices()
+{
+	if (!orderValid)
+		RebuildOrder();
+
+	//a changed node moves everything below it too
+	if (store->GetChangedCount() > 0)
+	{
+		changed.clear();
+		store->TakeChanged(changed);
+		for (unsigned int transform : changed)
+		{
+			if (transform < nodePositions.size() && nodePositions[transform] != NoParent)
+				MarkDirty(nodePositions[transform], subtreeEnds[nodePositions[transform]]);
+		}
+	}
+
+	//the local matrices, batched by the store
+	store->UpdateMatrices();
+
+	if (!dirty)
+		return;
+	dirty = false;
+
+	//parents come first, so one pass in order sees every parent's world already rebuilt
+	for (size_t word = 0; word < dirtyBits.size(); word++)
+	{
+		uint64_t bits = dirtyBits[word];
+		dirtyBits[word] = 0;
+		for (unsigned int bit = 0; bits != 0; bit++, bits >>= 1)
+		{
+			if (!(bits & 1))
+				continue;
+
+			unsigned int position = (unsigned int)word * 64 + bit;
+			unsigned int slot = slots[position];
+			XMMATRIX world = XMLoadFloat4x4(&store->GetWorldMatrix(slot));
+			XMMATRIX inverseTranspose = XMLoadFloat4x4(&store->GetWorldInverseTransposeMatrix(slot));
+
+			//(local * parent)^-1^T is local^-1^T * parent^-1^T, so no inverse needed here either
+			unsigned int parent = parents[position];
+			if (parent != NoParent)
+			{
+				world = XMMatrixMultiply(world, XMLoadFloat4x4(&worldMatrices[parent]));
+				inverseTranspose = XMMatrixMultiply(inverseTranspose, XMLoadFloat4x4(&worldInverseTransposes[parent]));
+			}
+
+			XMStoreFloat4x4(&worldMatrices[position], world);
+			XMStoreFloat4x4(&worldInverseTransposes[position], inverseTranspose);
+			worldVersions[slot]++;
+		}
+	}
+}
+
+const XMFLOAT4X4& TransformHierarchy::GetWorldMatrix(unsigned int transform)
+{
+	Update(transform);
+
+	if (Contains(transform))
+		return worldMatrices[nodePositions[transform]];
+	return store->GetWorldMatrix(transform);
+}
+
+const XMFLOAT4X4& TransformHierarchy::GetWorldInverseTransposeMatrix(unsigned int transform)
+{
+	Update(transform);
+
+	if (Contains(transform))
+		return worldInverseTransposes[nodePositions[transform]];
+	return store->GetWorldInverseTransposeMatrix(transform);
+}
+
+unsigned int TransformHierarchy::GetWorldVersion(unsigned int transform)
+{
+	Update(transform);
+
+	//either can move the world matrix, and both only ever go up
+	return store->GetMatrixVersion(transform) + (transform < worldVersions.size() ? worldVersions[transform] : 0);
+}
+
+void TransformHierarchy::Reserve()
+{
+	size_t size = store->GetCapacity();
+	if (parentSlots.size() >= size)
+		return;
+
+	parentSlots.resize(size, NoParent);
+	firstChildren.resize(size, NoParent);
+	nextSiblings.resize(size, NoParent);
+	nodePositions.resize(size, NoParent);
+	worldVersions.resize(size, 0);
+}
+
+void TransformHierarchy::Update(unsigned int transform)
+{
+	if (Contains(transform))
+		UpdateMatrices();
+	else
+		store->UpdateMatrix(transform);
+}
+
+void TransformHierarchy::Link(unsigned int transform, unsigned int parent)
+{
+	parentSlots[transform] = parent;
+	nextSiblings[transform] = firstChildren[parent];
+	firstChildren[parent] = transform;
+}
+
+void TransformHierarchy::Unlink(unsigned int transform)
+{
+	unsigned int parent = parentSlots[transform];
+	if (parent == NoParent)
+		return;
+
+	unsigned int* link = &firstChildren[parent];
+	while (*link != transform)
+		link = &nextSiblings[*link];
+	*link = nextSiblings[transform];
+
+	parentSlots[transform] = NoParent;
+	nextSiblings[transform] = NoParent;
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+	//everything that was a node gets a new world (or goes back to its store matrix)
+	for (unsigned int slot : slots)
+	{
+		nodePositions[slot] = NoParent;
+		worldVersions[slot]++;
+	}
+	slots.clear();
+	parents.clear();
+
+	//depth first from every root (slot order, so the layout doesn't depend on the order links were made in):
+	//a popped node's children go on the stack, and all of one child's subtree is popped before the next child
+	std::vector<unsigned int> stack;
+	for (unsigned int root = 0; root < (unsigned int)parentSlots.size(); root++)
+	{
+		if (parentSlots[root] != NoParent || firstChildren[root] == NoParent)
+			continue;
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			unsigned int slot = stack.back();
+			stack.pop_back();
+
+			nodePositions[slot] = (unsigned int)slots.size();
+			slots.push_back(slot);
+			parents.push_back(parentSlots[slot] == NoParent ? NoParent : nodePositions[parentSlots[slot]]);
+			for (unsigned int child = firstChildren[slot]; child != NoParent; child = nextSiblings[child])
+				stack.push_back(child);
+		}
+	}
+
+	//a subtree ends where its last descendant's does, and descendants come after their ancestors
+	unsigned int count = (unsigned int)slots.size();
+	subtreeEnds.resize(count);
+	for (unsigned int position = 0; position < count; position++)
+		subtreeEnds[position] = position + 1;
+	for (unsigned int position = count; position-- > 0;)
+	{
+		if (parents[position] != NoParent && subtreeEnds[parents[position]] < subtreeEnds[position])
+			subtreeEnds[parents[position]] = subtreeEnds[position];
+	}
+
+	worldMatrices.resize(count);
+	worldInverseTransposes.resize(count);
+	dirtyBits.assign((count + 63) / 64, 0);
+	MarkDirty(0, count);
+	orderValid = true;
+}
+
+void TransformHierarchy::MarkDirty(unsigned int begin, unsigned int end)
+{
+	for (unsigned int position = begin; position < end;)
+	{
+		//whole words at a time through the middle of big subtrees
+		if (position % 64 == 0 && end - position >= 64)
+		{
+			dirtyBits[position / 64] = ~0ull;
+			position += 64;
+		}
+		else
+		{
+			dirtyBits[position / 64] |= 1ull << (position % 64);
+			position++;
+		}
+	}
+	if (begin < end)
+		dirty = true;
+}
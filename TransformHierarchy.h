@@ -0,0 +1,102 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include "TransformStore.h"
+
+// --------------------------------------------------------
+// Parent/child links between the transforms of a store, and
+// the world matrices they make
+//
+// - A transform's own values (and its store matrices) are
+//   relative to its parent; the hierarchy multiplies them
+//   down the tree into world matrices
+// - Only transforms with a parent or children are nodes,
+//   any other transform's store matrix already is its world
+// - Nodes are kept flattened in depth-first order, so a
+//   subtree is one contiguous range of positions and every
+//   parent comes before its children
+// - A changed transform marks just its subtree's range dirty,
+//   then UpdateMatrices rebuilds the dirty positions in one
+//   pass from first to last, every parent's world already
+//   current by the time its children read it
+// - Linking and unlinking only flags the order stale: it's
+//   rebuilt, and every node with it, on the next update, so
+//   rearranging the tree is meant for setup, not every frame
+// - Not thread safe, like the store
+// --------------------------------------------------------
+class TransformHierarchy
+{
+public:
+	static constexpr unsigned int NoParent = UINT_MAX;
+
+	TransformHierarchy(TransformStore* store);
+
+	// The hierarchy over TransformStore::GetDefault()
+	static TransformHierarchy& GetDefault();
+
+	// Puts transform under parent, keeping its values (so it moves with the parent from here on, offset by
+	// them), or detaches it with NoParent.  False, and nothing changes, if parent is transform or below it.
+	bool SetParent(unsigned int transform, unsigned int parent);
+	unsigned int GetParent(unsigned int transform);
+	unsigned int GetChildCount(unsigned int transform);
+
+	// Takes a transform out before its slot is destroyed, its children move up to its parent
+	void Remove(unsigned int transform);
+
+	// Whether the transform has a parent or children (so its world matrix comes from here)
+	bool Contains(unsigned int transform);
+	unsigned int GetNodeCount();
+
+	// Rebuilds the store's dirty matrices, then the world matrices of every node they moved
+	void UpdateMatrices();
+
+	// World matrices of any transform of the store, a node's from here and anything else's straight from the
+	// store, brought up to date first (usually a no-op, the game updates every dirty transform at once)
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int transform);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int transform);
+
+	// Goes up every time the transform's world matrix changes, so anything derived from it can tell it's stale
+	unsigned int GetWorldVersion(unsigned int transform);
+
+private:
+	TransformStore* store;
+
+	//links, per store slot
+	std::vector<unsigned int> parentSlots;
+	std::vector<unsigned int> firstChildren;
+	std::vector<unsigned int> nextSiblings;
+	std::vector<unsigned int> nodePositions;   //NoParent when the slot isn't a node
+	std::vector<unsigned int> worldVersions;   //bumped on rebuilds here, and when the slot stops being a node
+
+	//nodes, per position in depth-first order
+	std::vector<unsigned int> slots;
+	std::vector<unsigned int> parents;         //position of the parent, NoParent for roots
+	std::vector<unsigned int> subtreeEnds;     //one past the node's last descendant
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	//bit i of word i / 64 is position i
+	std::vector<uint64_t> dirtyBits;
+	bool dirty;
+	bool orderValid;
+
+	//transforms the store says changed, kept around so updates don't allocate
+	std::vector<unsigned int> changed;
+
+	// Grows the per slot arrays to cover every slot of the store
+	void Reserve();
+
+	// Brings one transform's world up to date (a node's depends on its ancestors, so that's the whole,
+	// incremental, update)
+	void Update(unsigned int transform);
+
+	void Link(unsigned int transform, unsigned int parent);
+	void Unlink(unsigned int transform);
+
+	// Flattens the tree again, every node dirty
+	void RebuildOrder();
+	void MarkDirty(unsigned int begin, unsigned int end);
+};
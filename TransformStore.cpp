@@ -0,0 +1,380 @@
+#include "TransformStore.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+//a word other threads may be oring bits into at the same time
+static uint64_t AtomicLoad(const uint64_t& word)
+{
+#ifdef _MSC_VER
+	return *(const volatile uint64_t*)&word;
+#else
+	return __atomic_load_n(&word, __ATOMIC_RELAXED);
+#endif
+}
+
+//ors bits into a word, safe against other threads doing the same to it, and returns what it held before
+static uint64_t AtomicOr(uint64_t& word, uint64_t bits)
+{
+#ifdef _MSC_VER
+	return (uint64_t)_InterlockedOr64((volatile long long*)&word, (long long)bits);
+#else
+	return __atomic_fetch_or(&word, bits, __ATOMIC_RELAXED);
+#endif
+}
+
+TransformStore::TransformStore() :
+	dirtyCount(0),
+	changedCount(0)
+{
+}
+
+TransformStore& TransformStore::GetDefault()
+{
+	static TransformStore store;
+	return store;
+}
+
+unsigned int TransformStore::Create()
+{
+	if (freeSlots.empty())
+	{
+		//grow by a whole group, the spare slots go on the free list
+		unsigned int first = (unsigned int)positionX.size();
+		unsigned int size = first + 4;
+		for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ })
+			component->resize(size);
+		worldMatrices.resize(size);
+		worldInverseTransposes.resize(size);
+		rightVectors.resize(size);
+		upVectors.resize(size);
+		forwardVectors.resize(size);
+		matrixVersions.resize(size, 0);
+		dirtyBits.resize((size + 63) / 64, 0);
+		changedBits.resize((size + 63) / 64, 0);
+		for (unsigned int i = first; i < size; i++)
+		{
+			freeSlots.push_back(i);
+			std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<unsigned int>());
+		}
+	}
+
+	//lowest free slot first, so live transforms stay packed at the front however they were destroyed
+	//(and reset here rather than in Destroy, the slot's about to be written anyway)
+	std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<unsigned int>());
+	unsigned int index = freeSlots.back();
+	freeSlots.pop_back();
+	ResetSlot(index);
+	return index;
+}
+
+void TransformStore::Destroy(unsigned int index)
+{
+	if (IsDirty(index))
+	{
+		dirtyBits[index / 64] &= ~(1ull << (index % 64));
+		dirtyCount--;
+	}
+	if ((changedBits[index / 64] >> (index % 64)) & 1)
+	{
+		changedBits[index / 64] &= ~(1ull << (index % 64));
+		changedCount--;
+	}
+	freeSlots.push_back(index);
+	std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<unsigned int>());
+}
+
+unsigned int TransformStore::GetCount()
+{
+	return (unsigned int)(positionX.size() - freeSlots.size());
+}
+
+unsigned int TransformStore::GetCapacity()
+{
+	return (unsigned int)positionX.size();
+}
+
+XMFLOAT3 TransformStore::GetPosition(unsigned int index)
+{
+	return XMFLOAT3(positionX[index], positionY[index], positionZ[index]);
+}
+
+XMFLOAT4 TransformStore::GetRotation(unsigned int index)
+{
+	return XMFLOAT4(rotationX[index], rotationY[index], rotationZ[index], rotationW[index]);
+}
+
+XMFLOAT3 TransformStore::GetScale(unsigned int index)
+{
+	return XMFLOAT3(scaleX[index], scaleY[index], scaleZ[index]);
+}
+
+void TransformStore::SetPosition(unsigned int index, XMFLOAT3 position)
+{
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	MarkDirty(index);
+}
+
+void TransformStore::SetRotation(unsigned int index, XMFLOAT4 rotation)
+{
+	XMStoreFloat4(&rotation, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	rotationW[index] = rotation.w;
+	MarkDirty(index);
+}
+
+void TransformStore::SetScale(unsigned int index, XMFLOAT3 scale)
+{
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+	MarkDirty(index);
+}
+
+XMFLOAT3 TransformStore::GetPitchYawRoll(unsigned int index)
+{
+	//pick the angles back out of the rotation matrix XMMatrixRotationRollPitchYaw would have built
+	XMFLOAT4 q = GetRotation(index);
+	float m01 = 2.0f * (q.x * q.y + q.z * q.w);
+	float m11 = 1.0f - 2.0f * (q.x * q.x + q.z * q.z);
+	float m20 = 2.0f * (q.x * q.z + q.y * q.w);
+	float m21 = 2.0f * (q.y * q.z - q.x * q.w);
+	float m22 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+
+	//m21 is -sin(pitch)
+	if (fabsf(m21) < 0.99999f)
+		return XMFLOAT3(asinf(-m21), atan2f(m20, m22), atan2f(m01, m11));
+
+	//straight up or down, yaw and roll turn about the same axis, so it all goes into yaw
+	float m00 = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
+	float m02 = 2.0f * (q.x * q.z - q.y * q.w);
+	return XMFLOAT3(m21 < 0.0f ? XM_PIDIV2 : -XM_PIDIV2, atan2f(-m02, m00), 0.0f);
+}
+
+void TransformStore::SetPitchYawRoll(unsigned int index, XMFLOAT3 pitchYawRoll)
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z));
+	SetRotation(index, rotation);
+}
+
+bool TransformStore::IsDirty(unsigned int index)
+{
+	return (dirtyBits[index / 64] >> (index % 64)) & 1;
+}
+
+unsigned int TransformStore::GetDirtyCount()
+{
+	return dirtyCount;
+}
+
+void TransformStore::UpdateMatrices()
+{
+	for (size_t word = 0; word < dirtyBits.size() && dirtyCount > 0; word++)
+	{
+		uint64_t bits = dirtyBits[word];
+		for (unsigned int group = 0; bits != 0; group++, bits >>= 4)
+		{
+			if (bits & 15)
+				UpdateGroup((unsigned int)word * 64 + group * 4);
+		}
+	}
+}
+
+void TransformStore::UpdateMatrix(unsigned int index)
+{
+	if (IsDirty(index))
+		UpdateGroup(index & ~3u);
+}
+
+const XMFLOAT4X4& TransformStore::GetWorldMatrix(unsigned int index)
+{
+	return worldMatrices[index];
+}
+
+const XMFLOAT4X4& TransformStore::GetWorldInverseTransposeMatrix(unsigned int index)
+{
+	return worldInverseTransposes[index];
+}
+
+XMFLOAT3 TransformStore::GetRightVector(unsigned int index)
+{
+	if (!IsDirty(index))
+		return rightVectors[index];
+
+	float x = rotationX[index], y = rotationY[index], z = rotationZ[index], w = rotationW[index];
+	return XMFLOAT3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+}
+
+XMFLOAT3 TransformStore::GetUpVector(unsigned int index)
+{
+	if (!IsDirty(index))
+		return upVectors[index];
+
+	float x = rotationX[index], y = rotationY[index], z = rotationZ[index], w = rotationW[index];
+	return XMFLOAT3(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x));
+}
+
+XMFLOAT3 TransformStore::GetForwardVector(unsigned int index)
+{
+	if (!IsDirty(index))
+		return forwardVectors[index];
+
+	float x = rotationX[index], y = rotationY[index], z = rotationZ[index], w = rotationW[index];
+	return XMFLOAT3(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+}
+
+unsigned int TransformStore::GetMatrixVersion(unsigned int index)
+{
+	return matrixVersions[index];
+}
+
+unsigned int TransformStore::GetChangedCount()
+{
+	return changedCount;
+}
+
+void TransformStore::TakeChanged(std::vector<unsigned int>& indices)
+{
+	size_t first = indices.size();
+	for (size_t word = 0; word < changedBits.size() && changedCount > indices.size() - first; word++)
+	{
+		uint64_t bits = changedBits[word];
+		changedBits[word] = 0;
+		for (unsigned int bit = 0; bits != 0; bit++, bits >>= 1)
+		{
+			if (bits & 1)
+				indices.push_back((unsigned int)word * 64 + bit);
+		}
+	}
+	changedCount -= (unsigned int)(indices.size() - first);
+}
+
+void TransformStore::MarkDirty(unsigned int index)
+{
+	//neighboring slots share a word, and they may be set from different threads at once (a slot that's
+	//already marked, from an earlier setter, is common enough to check for before the locked or)
+	uint64_t bit = 1ull << (index % 64);
+	if (!(AtomicLoad(dirtyBits[index / 64]) & bit) && !(AtomicOr(dirtyBits[index / 64], bit) & bit))
+		dirtyCount++;
+	if (!(AtomicLoad(changedBits[index / 64]) & bit) && !(AtomicOr(changedBits[index / 64], bit) & bit))
+		changedCount++;
+}
+
+void TransformStore::ResetSlot(unsigned int index)
+{
+	positionX[index] = positionY[index] = positionZ[index] = 0.0f;
+	rotationX[index] = rotationY[index] = rotationZ[index] = 0.0f;
+	rotationW[index] = 1.0f;
+	scaleX[index] = scaleY[index] = scaleZ[index] = 1.0f;
+	XMStoreFloat4x4(&worldMatrices[index], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposes[index], XMMatrixIdentity());
+	rightVectors[index] = XMFLOAT3(1, 0, 0);
+	upVectors[index] = XMFLOAT3(0, 1, 0);
+	forwardVectors[index] = XMFLOAT3(0, 0, 1);
+}
+
+void TransformStore::UpdateGroup(unsigned int first)
+{
+	unsigned int dirtyLanes = (unsigned int)(dirtyBits[first / 64] >> (first % 64)) & 15;
+	if (!dirtyLanes)
+		return;
+
+	//every vector holds one component of the four transforms, lane i being transform first + i
+	XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&rotationX[first]);
+	XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&rotationY[first]);
+	XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&rotationZ[first]);
+	XMVECTOR w = XMLoadFloat4((const XMFLOAT4*)&rotationW[first]);
+
+	//rows of the quaternion's rotation matrix (XMMatrixRotationQuaternion), which are also the rotated local axes
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR x2 = XMVectorAdd(x, x);
+	XMVECTOR y2 = XMVectorAdd(y, y);
+	XMVECTOR z2 = XMVectorAdd(z, z);
+	XMVECTOR xx = XMVectorMultiply(x, x2);
+	XMVECTOR yy = XMVectorMultiply(y, y2);
+	XMVECTOR zz = XMVectorMultiply(z, z2);
+	XMVECTOR xy = XMVectorMultiply(x, y2);
+	XMVECTOR xz = XMVectorMultiply(x, z2);
+	XMVECTOR yz = XMVectorMultiply(y, z2);
+	XMVECTOR wx = XMVectorMultiply(w, x2);
+	XMVECTOR wy = XMVectorMultiply(w, y2);
+	XMVECTOR wz = XMVectorMultiply(w, z2);
+	XMVECTOR rotation[3][3] =
+	{
+		{ XMVectorSubtract(one, XMVectorAdd(yy, zz)), XMVectorAdd(xy, wz), XMVectorSubtract(xz, wy) },
+		{ XMVectorSubtract(xy, wz), XMVectorSubtract(one, XMVectorAdd(xx, zz)), XMVectorAdd(yz, wx) },
+		{ XMVectorAdd(xz, wy), XMVectorSubtract(yz, wx), XMVectorSubtract(one, XMVectorAdd(xx, yy)) }
+	};
+
+	XMVECTOR translation[3] =
+	{
+		XMLoadFloat4((const XMFLOAT4*)&positionX[first]),
+		XMLoadFloat4((const XMFLOAT4*)&positionY[first]),
+		XMLoadFloat4((const XMFLOAT4*)&positionZ[first])
+	};
+	XMVECTOR scale[3] =
+	{
+		XMLoadFloat4((const XMFLOAT4*)&scaleX[first]),
+		XMLoadFloat4((const XMFLOAT4*)&scaleY[first]),
+		XMLoadFloat4((const XMFLOAT4*)&scaleZ[first])
+	};
+
+	//world = scale * rotation * translation: row i is rotation row i times scale i, then the translation.
+	//Its inverse is translation^-1 * rotation^T * scale^-1, so the inverse transpose's upper 3x3 is rotation
+	//row i over scale i, and its last column undoes the translation along each of those rows.
+	XMVECTOR zero = XMVectorZero();
+	XMMATRIX world[4];
+	XMMATRIX inverseTranspose[4];
+	XMMATRIX axes[3];
+	for (int row = 0; row < 3; row++)
+	{
+		axes[row] = XMMatrixTranspose(XMMATRIX(rotation[row][0], rotation[row][1], rotation[row][2], zero));
+
+		XMVECTOR inverseScale = XMVectorReciprocal(scale[row]);
+		XMVECTOR distance = XMVectorMultiplyAdd(rotation[row][2], translation[2],
+			XMVectorMultiplyAdd(rotation[row][1], translation[1], XMVectorMultiply(rotation[row][0], translation[0])));
+
+		//transposed, so each row of these ends up holding one transform's row
+		world[row] = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(rotation[row][0], scale[row]),
+			XMVectorMultiply(rotation[row][1], scale[row]),
+			XMVectorMultiply(rotation[row][2], scale[row]),
+			zero));
+		inverseTranspose[row] = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(rotation[row][0], inverseScale),
+			XMVectorMultiply(rotation[row][1], inverseScale),
+			XMVectorMultiply(rotation[row][2], inverseScale),
+			XMVectorNegate(XMVectorMultiply(distance, inverseScale))));
+	}
+	world[3] = XMMatrixTranspose(XMMATRIX(translation[0], translation[1], translation[2], one));
+
+	XMVECTOR lastRow = XMVectorSet(0, 0, 0, 1);
+	unsigned int rebuilt = 0;
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		if (!(dirtyLanes & (1 << lane)))
+			continue;
+
+		unsigned int index = first + lane;
+		XMStoreFloat4x4(&worldMatrices[index], XMMATRIX(world[0].r[lane], world[1].r[lane], world[2].r[lane], world[3].r[lane]));
+		XMStoreFloat4x4(&worldInverseTransposes[index],
+			XMMATRIX(inverseTranspose[0].r[lane], inverseTranspose[1].r[lane], inverseTranspose[2].r[lane], lastRow));
+		XMStoreFloat3(&rightVectors[index], axes[0].r[lane]);
+		XMStoreFloat3(&upVectors[index], axes[1].r[lane]);
+		XMStoreFloat3(&forwardVectors[index], axes[2].r[lane]);
+		matrixVersions[index]++;
+		rebuilt++;
+	}
+	dirtyCount -= rebuilt;
+	dirtyBits[first / 64] &= ~((uint64_t)dirtyLanes << (first % 64));
+}
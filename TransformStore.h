@@ -0,0 +1,118 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Translation, rotation (a unit quaternion) and scale of
+// many transforms, laid out as structure of arrays, with
+// one dirty bit apiece
+//
+// - Transforms are slots picked by index; destroyed slots
+//   are reused by later Creates, lowest first
+// - Setters only mark the slot dirty; UpdateMatrices then
+//   rebuilds every dirty world and inverse transpose matrix,
+//   along with the right, up and forward vectors, in one
+//   pass, four transforms per DirectXMath vector
+// - The inverse transpose is built in closed form (a scale
+//   and rotation are trivial to invert), so there's no
+//   general 4x4 inverse
+// - Matrices are scale * rotation * translation, relative to
+//   the parent when the transform is in a hierarchy (see
+//   TransformHierarchy)
+// - Setters (and getters) of different transforms may run
+//   on different threads at once, so a parallel system can
+//   split its transforms into chunks; anything else, Create,
+//   Destroy and the updates included, needs the store to
+//   itself
+// --------------------------------------------------------
+class TransformStore
+{
+public:
+	TransformStore();
+
+	// The store every Transform lives in
+	static TransformStore& GetDefault();
+
+	// A new identity transform (clean, its matrices are already built)
+	unsigned int Create();
+	void Destroy(unsigned int index);
+
+	// Live transforms, and slots including destroyed ones (indices are always below this)
+	unsigned int GetCount();
+	unsigned int GetCapacity();
+
+	DirectX::XMFLOAT3 GetPosition(unsigned int index);
+	DirectX::XMFLOAT4 GetRotation(unsigned int index);
+	DirectX::XMFLOAT3 GetScale(unsigned int index);
+	void SetPosition(unsigned int index, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int index, DirectX::XMFLOAT4 rotation);   //normalized on the way in
+	void SetScale(unsigned int index, DirectX::XMFLOAT3 scale);
+
+	// The rotation as euler angles, converted on every call (see Transform::GetPitchYawRoll)
+	DirectX::XMFLOAT3 GetPitchYawRoll(unsigned int index);
+	void SetPitchYawRoll(unsigned int index, DirectX::XMFLOAT3 pitchYawRoll);
+
+	bool IsDirty(unsigned int index);
+	unsigned int GetDirtyCount();
+
+	// Rebuilds the matrices of every dirty transform, skipping 64 clean ones at a time
+	void UpdateMatrices();
+
+	// Rebuilds one transform's matrices if it's dirty (along with any dirty neighbors in its group of four)
+	void UpdateMatrix(unsigned int index);
+
+	// Matrices as of the last update, stale while the transform is dirty
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int index);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int index);
+
+	// The rotated local axes (+X, +Y and +Z, unit length), cached by the last update and worked out
+	// from the rotation while the transform is dirty, so they're always current without a rebuild
+	DirectX::XMFLOAT3 GetRightVector(unsigned int index);
+	DirectX::XMFLOAT3 GetUpVector(unsigned int index);
+	DirectX::XMFLOAT3 GetForwardVector(unsigned int index);
+
+	// Bumped every time the transform's matrices are rebuilt, so anything derived from them can tell it's stale
+	unsigned int GetMatrixVersion(unsigned int index);
+
+	// Transforms set since the last TakeChanged, for whatever builds on top of the store (the hierarchy) to
+	// catch up on; unlike the dirty bits these survive UpdateMatrices
+	unsigned int GetChangedCount();
+	void TakeChanged(std::vector<unsigned int>& indices);   //appends them, lowest first, and clears them
+
+private:
+	//one array per component, always a whole number of groups of four long so a group loads as one vector
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> rotationW;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+	std::vector<DirectX::XMFLOAT3> rightVectors;
+	std::vector<DirectX::XMFLOAT3> upVectors;
+	std::vector<DirectX::XMFLOAT3> forwardVectors;
+	std::vector<unsigned int> matrixVersions;
+
+	//bit i of word i / 64 is slot i
+	std::vector<uint64_t> dirtyBits;
+	std::atomic<unsigned int> dirtyCount;
+	std::vector<uint64_t> changedBits;
+	std::atomic<unsigned int> changedCount;
+
+	std::vector<unsigned int> freeSlots;   //a min heap
+
+	void MarkDirty(unsigned int index);
+	void ResetSlot(unsigned int index);
+
+	// Rebuilds the dirty transforms among the four starting at first (a multiple of 4)
+	void UpdateGroup(unsigned int first);
+};
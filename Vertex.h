@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -12,5 +13,22 @@ struct Vertex
 	DirectX::XMFLOAT3 position;	    // The local position of the vertex
 	DirectX::XMFLOAT3 normal;
 	DirectX::XMFLOAT2 uv;
-	DirectX::XMFLOAT3 tangent;
-};
\ No newline at end of file
+	DirectX::XMFLOAT4 tangent;		// W is the bitangent sign
+};
+
+// --------------------------------------------------------
+// The compressed vertex actually stored in vertex buffers
+//
+// - 20 bytes instead of the 44 of a full Vertex
+// - Position is quantized to the mesh bounds (see VertexQuantization),
+//   w holds the bitangent sign
+// - Normal and tangent are octahedral encoded unit vectors
+// - Must match PackedVertexShaderInput in ShaderIncludes.hlsli
+// --------------------------------------------------------
+struct PackedVertex
+{
+	DirectX::PackedVector::XMSHORTN4 position;	// R16G16B16A16_SNORM
+	DirectX::PackedVector::XMSHORTN2 normal;	// R16G16_SNORM
+	DirectX::PackedVector::XMHALF2 uv;			// R16G16_FLOAT
+	DirectX::PackedVector::XMSHORTN2 tangent;	// R16G16_SNORM
+};
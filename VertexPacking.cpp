@@ -0,0 +1,130 @@
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+XMVECTOR XM_CALLCONV OctahedralEncode(FXMVECTOR unitVector)
+{
+	//project onto the octahedron |x| + |y| + |z| = 1
+	//(zero vectors from degenerate tangents just encode as +z)
+	XMVECTOR l1 = XMVector3Dot(XMVectorAbs(unitVector), XMVectorSplatOne());
+	l1 = XMVectorMax(l1, XMVectorReplicate(FLT_MIN));
+	XMVECTOR p = XMVectorDivide(unitVector, l1);
+
+	//fold the lower half over the diagonals: xy = (1 - |yx|) * sign(xy)
+	XMVECTOR sign = XMVectorSelect(XMVectorReplicate(-1.0f), XMVectorSplatOne(), XMVectorGreaterOrEqual(p, XMVectorZero()));
+	XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(XMVectorSwizzle(p, 1, 0, 2, 3))), sign);
+
+	return XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), XMVectorZero()));
+}
+
+XMVECTOR XM_CALLCONV OctahedralDecode(FXMVECTOR encoded)
+{
+	//z = 1 - |x| - |y|, then unfold anything below the xy plane
+	XMVECTOR absXY = XMVectorAbs(encoded);
+	float z = 1.0f - XMVectorGetX(absXY) - XMVectorGetY(absXY);
+	XMVECTOR t = XMVectorReplicate(std::max(-z, 0.0f));
+	XMVECTOR offset = XMVectorSelect(t, XMVectorNegate(t), XMVectorGreaterOrEqual(encoded, XMVectorZero()));
+	XMVECTOR n = XMVectorAdd(encoded, offset);
+	return XMVector3Normalize(XMVectorSet(XMVectorGetX(n), XMVectorGetY(n), z, 0.0f));
+}
+
+VertexQuantization ComputeVertexQuantization(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	XMVECTOR minimum = XMLoadFloat3(&boundsMin);
+	XMVECTOR maximum = XMLoadFloat3(&boundsMax);
+
+	//flat meshes have a zero extent on one axis, keep the scale usable there
+	XMVECTOR half = XMVectorReplicate(0.5f);
+	XMVECTOR scale = XMVectorMultiply(XMVectorSubtract(maximum, minimum), half);
+	scale = XMVectorSelect(scale, XMVectorSplatOne(), XMVectorLessOrEqual(scale, XMVectorZero()));
+
+	VertexQuantization quantization;
+	XMStoreFloat3(&quantization.positionOffset, XMVectorMultiply(XMVectorAdd(minimum, maximum), half));
+	XMStoreFloat3(&quantization.positionScale, scale);
+	return quantization;
+}
+
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& quantization, PackedVertex* packed)
+{
+	XMVECTOR offset = XMLoadFloat3(&quantization.positionOffset);
+	XMVECTOR invScale = XMVectorReciprocal(XMLoadFloat3(&quantization.positionScale));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& out = packed[i];
+
+		//positions go to [-1, 1] inside the bounds, w is the bitangent sign
+		XMVECTOR position = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&v.position), offset), invScale);
+		XMStoreShortN4(&out.position, XMVectorSetW(position, v.tangent.w < 0.0f ? -1.0f : 1.0f));
+
+		XMStoreShortN2(&out.normal, OctahedralEncode(XMVector3Normalize(XMLoadFloat3(&v.normal))));
+		XMStoreShortN2(&out.tangent, OctahedralEncode(XMVector3Normalize(XMVectorSetW(XMLoadFloat4(&v.tangent), 0.0f))));
+		XMStoreHalf2(&out.uv, XMLoadFloat2(&v.uv));
+	}
+}
+
+void UnpackVertices(const PackedVertex* packed, size_t count, const VertexQuantization& quantization, Vertex* vertices)
+{
+	XMVECTOR offset = XMLoadFloat3(&quantization.positionOffset);
+	XMVECTOR scale = XMLoadFloat3(&quantization.positionScale);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const PackedVertex& in = packed[i];
+		Vertex& v = vertices[i];
+
+		XMVECTOR position = XMLoadShortN4(&in.position);
+		XMStoreFloat3(&v.position, XMVectorMultiplyAdd(position, scale, offset));
+		XMStoreFloat3(&v.normal, OctahedralDecode(XMLoadShortN2(&in.normal)));
+		XMStoreFloat4(&v.tangent, XMVectorSetW(OctahedralDecode(XMLoadShortN2(&in.tangent)), XMVectorGetW(position)));
+		XMStoreFloat2(&v.uv, XMLoadHalf2(&in.uv));
+	}
+}
+
+VertexPackingError AnalyzeVertexPacking(const std::vector<Vertex>& vertices, const std::vector<PackedVertex>& packed, const VertexQuantization& quantization)
+{
+	VertexPackingError error = {};
+	if (vertices.size() != packed.size())
+		return error;
+
+	std::vector<Vertex> unpacked(packed.size());
+	UnpackVertices(packed.data(), packed.size(), quantization, unpacked.data());
+
+	//angles come from atan2(|a x b|, a . b), acos loses everything below ~0.02 degrees in float
+	auto angleBetween = [](FXMVECTOR a, FXMVECTOR b)
+	{
+		return atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(a, b))), XMVectorGetX(XMVector3Dot(a, b)));
+	};
+
+	float maxNormalAngle = 0.0f;
+	float maxTangentAngle = 0.0f;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& a = vertices[i];
+		const Vertex& b = unpacked[i];
+
+		XMVECTOR positionDelta = XMVectorSubtract(XMLoadFloat3(&a.position), XMLoadFloat3(&b.position));
+		error.position = std::max(error.position, XMVectorGetX(XMVector3Length(positionDelta)));
+
+		XMVECTOR uvDelta = XMVectorAbs(XMVectorSubtract(XMLoadFloat2(&a.uv), XMLoadFloat2(&b.uv)));
+		error.uv = std::max(error.uv, std::max(XMVectorGetX(uvDelta), XMVectorGetY(uvDelta)));
+
+		//zero length source vectors (degenerate tangents) have no direction to lose
+		XMVECTOR normal = XMLoadFloat3(&a.normal);
+		if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+			maxNormalAngle = std::max(maxNormalAngle, angleBetween(XMVector3Normalize(normal), XMLoadFloat3(&b.normal)));
+
+		XMVECTOR tangent = XMVectorSetW(XMLoadFloat4(&a.tangent), 0.0f);
+		if (XMVectorGetX(XMVector3LengthSq(tangent)) > 0.0f)
+			maxTangentAngle = std::max(maxTangentAngle, angleBetween(XMVector3Normalize(tangent), XMVectorSetW(XMLoadFloat4(&b.tangent), 0.0f)));
+	}
+
+	error.normalDegrees = XMConvertToDegrees(maxNormalAngle);
+	error.tangentDegrees = XMConvertToDegrees(maxTangentAngle);
+	return error;
+}
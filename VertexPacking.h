@@ -0,0 +1,39 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// Maps quantized [-1, 1] positions back to mesh space: position = offset + packed * scale
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 positionOffset;
+	DirectX::XMFLOAT3 positionScale;
+};
+
+// Largest difference between the source vertices and their packed versions
+struct VertexPackingError
+{
+	float position;			// Mesh space distance
+	float normalDegrees;
+	float tangentDegrees;
+	float uv;
+};
+
+// Octahedral encoding of a unit vector into [-1, 1]^2 (x and y of the result)
+DirectX::XMVECTOR XM_CALLCONV OctahedralEncode(DirectX::FXMVECTOR unitVector);
+
+// Inverse of OctahedralEncode, returns a normalized vector
+DirectX::XMVECTOR XM_CALLCONV OctahedralDecode(DirectX::FXMVECTOR encoded);
+
+// Quantization that maps the bounding box onto [-1, 1]
+VertexQuantization ComputeVertexQuantization(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+// Compresses vertices into the GPU format
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& quantization, PackedVertex* packed);
+
+// Expands packed vertices back into full floats (tangents come back unit length)
+void UnpackVertices(const PackedVertex* packed, size_t count, const VertexQuantization& quantization, Vertex* vertices);
+
+// Compares the source vertices against what the GPU will see after packing
+VertexPackingError AnalyzeVertexPacking(const std::vector<Vertex>& vertices, const std::vector<PackedVertex>& packed, const VertexQuantization& quantization);
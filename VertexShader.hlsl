@@ -5,6 +5,8 @@ cbuffer DataPerEntity : register(b0)
 {
 	matrix worldMatrix;
 	matrix worldInvTranspose;
+	float3 positionOffset;
+	float3 positionScale;
 }
 
 //change once every draw call
@@ -36,11 +38,13 @@ VertexToPixel main( VertexShaderInput input )
 	//   a perspective projection matrix, which we'll get to in the future).
 	//output.screenPosition = float4(input.localPosition + offset, 1.0f);
 
+	float3 localPosition = DequantizePosition(input.localPosition, positionOffset, positionScale);
+
 	matrix wvp = mul(projectionMatrix, mul(viewMatrix, worldMatrix));
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
     output.uv = input.uv;
-    output.normal = mul((float3x3)worldInvTranspose, input.normal);
-    output.worldPosition = mul(worldMatrix, float4(input.localPosition, 1)).xyz;
+    output.normal = mul((float3x3)worldInvTranspose, OctahedralDecode(input.normal));
+    output.worldPosition = mul(worldMatrix, float4(localPosition, 1)).xyz;
 	// Pass the color through 
 	// - The values will be interpolated per-pixel by the rasterizer
 	// - We don't need to alter it here, but we do need to send it to the pixel shader